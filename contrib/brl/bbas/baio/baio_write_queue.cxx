@@ -0,0 +1,311 @@
+// This is brl/bbas/baio/baio_write_queue.cxx
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include "baio_write_queue.h"
+//:
+// \file
+
+#if defined(_WIN32)
+# include <io.h>     // for _commit
+#else
+# include <unistd.h> // for fsync
+#endif
+
+baio_write_queue& baio_write_queue::instance()
+{
+  static baio_write_queue queue;
+  return queue;
+}
+
+baio_write_queue::baio_write_queue(std::size_t max_bytes, baio_sync_policy policy)
+  : enabled_(false), max_bytes_(max_bytes), policy_(policy),
+    pending_bytes_(0), writing_(false), failed_(false),
+    thread_running_(false), stop_(false)
+{
+#if VXL_HAS_PTHREAD_H
+  pthread_mutex_init(&mutex_, VXL_NULLPTR);
+  pthread_cond_init(&work_cond_, VXL_NULLPTR);
+  pthread_cond_init(&done_cond_, VXL_NULLPTR);
+#endif
+}
+
+baio_write_queue::~baio_write_queue()
+{
+  this->flush();
+#if VXL_HAS_PTHREAD_H
+  lock();
+  stop_ = true;
+  pthread_cond_signal(&work_cond_);
+  unlock();
+  if (thread_running_)
+    pthread_join(thread_, VXL_NULLPTR);
+  pthread_cond_destroy(&done_cond_);
+  pthread_cond_destroy(&work_cond_);
+  pthread_mutex_destroy(&mutex_);
+#endif
+}
+
+void baio_write_queue::lock() const
+{
+#if VXL_HAS_PTHREAD_H
+  pthread_mutex_lock(&mutex_);
+#endif
+}
+
+void baio_write_queue::unlock() const
+{
+#if VXL_HAS_PTHREAD_H
+  pthread_mutex_unlock(&mutex_);
+#endif
+}
+
+void baio_write_queue::set_enabled(bool enabled)
+{
+  lock();
+#if VXL_HAS_PTHREAD_H
+  // Later synchronous writes must not race with queued ones
+  while (!queue_.empty() || writing_)
+    pthread_cond_wait(&done_cond_, &mutex_);
+#endif
+  enabled_ = enabled;
+  unlock();
+}
+
+void baio_write_queue::set_max_bytes(std::size_t max_bytes)
+{
+  lock();
+  max_bytes_ = max_bytes;
+#if VXL_HAS_PTHREAD_H
+  pthread_cond_broadcast(&done_cond_); // writers may now fit
+#endif
+  unlock();
+}
+
+void baio_write_queue::set_sync_policy(baio_sync_policy policy)
+{
+  lock();
+  policy_ = policy;
+  unlock();
+}
+
+std::string baio_write_queue::error() const
+{
+  lock();
+  std::string msg = error_;
+  unlock();
+  return msg;
+}
+
+std::size_t baio_write_queue::pending_bytes() const
+{
+  lock();
+  std::size_t n = pending_bytes_;
+  unlock();
+  return n;
+}
+
+bool baio_write_queue::write_file(const std::string& filename, const char* data,
+                                  std::size_t n, bool sync, std::string& msg) const
+{
+  std::FILE* fp = std::fopen(filename.c_str(), "wb");
+  if (!fp) {
+    msg = "baio_write_queue: cannot open " + filename + ": " + std::strerror(errno);
+    return false;
+  }
+  bool ok = (n==0 || std::fwrite(data, 1, n, fp)==n) && std::fflush(fp)==0;
+  if (!ok)
+    msg = "baio_write_queue: cannot write " + filename + ": " + std::strerror(errno);
+#if defined(_WIN32)
+  else if (sync && _commit(_fileno(fp))!=0)
+#else
+  else if (sync && fsync(fileno(fp))!=0)
+#endif
+  {
+    msg = "baio_write_queue: cannot sync " + filename + ": " + std::strerror(errno);
+    ok = false;
+  }
+  if (std::fclose(fp)!=0 && ok) {
+    msg = "baio_write_queue: cannot close " + filename + ": " + std::strerror(errno);
+    ok = false;
+  }
+  return ok;
+}
+
+bool baio_write_queue::sync_file(const std::string& filename, std::string& msg) const
+{
+  std::FILE* fp = std::fopen(filename.c_str(), "rb");
+  if (!fp) {
+    msg = "baio_write_queue: cannot open " + filename + ": " + std::strerror(errno);
+    return false;
+  }
+#if defined(_WIN32)
+  bool ok = _commit(_fileno(fp))==0;
+#else
+  bool ok = fsync(fileno(fp))==0;
+#endif
+  if (!ok)
+    msg = "baio_write_queue: cannot sync " + filename + ": " + std::strerror(errno);
+  std::fclose(fp);
+  return ok;
+}
+
+void baio_write_queue::record(const std::string& filename, bool ok, const std::string& msg)
+{
+  if (!ok) {
+    failed_ = true;
+    error_ = msg;
+  }
+  else if (policy_==BAIO_SYNC_ON_FLUSH &&
+           (unsynced_.empty() || unsynced_.back()!=filename))
+    unsynced_.push_back(filename);
+}
+
+bool baio_write_queue::queued(const std::string& filename) const
+{
+  for (std::deque<request*>::const_iterator it = queue_.begin(); it != queue_.end(); ++it)
+    if ((*it)->filename == filename)
+      return true;
+  return false;
+}
+
+bool baio_write_queue::write(const std::string& filename, const char* data, std::size_t n)
+{
+#if VXL_HAS_PTHREAD_H
+  if (enabled_)
+  {
+    request* req = new request;
+    req->filename = filename;
+    req->data.assign(data, data+n);
+
+    lock();
+    if (thread_running_ || start_thread())
+    {
+      // Bound the memory held by the queue; a single oversized buffer is still accepted
+      while (pending_bytes_>0 && pending_bytes_+n>max_bytes_)
+        pthread_cond_wait(&done_cond_, &mutex_);
+
+      // A later write of a file that has not been started replaces the earlier one
+      std::deque<request*>::iterator it = queue_.begin();
+      for (; it != queue_.end(); ++it)
+        if ((*it)->filename == filename)
+          break;
+      if (it != queue_.end()) {
+        pending_bytes_ -= (*it)->data.size();
+        (*it)->data.swap(req->data);
+        delete req;
+      }
+      else
+        queue_.push_back(req);
+      pending_bytes_ += n;
+      pthread_cond_signal(&work_cond_);
+      bool ok = !failed_;
+      unlock();
+      return ok;
+    }
+    unlock();
+    delete req; // Couldn't start thread - write it here
+  }
+#endif
+  std::string msg;
+  bool ok = write_file(filename, data, n, policy_==BAIO_SYNC_EACH_WRITE, msg);
+  lock();
+  record(filename, ok, msg);
+  ok = ok && !failed_;
+  unlock();
+  return ok;
+}
+
+void baio_write_queue::wait_for(const std::string& filename)
+{
+#if VXL_HAS_PTHREAD_H
+  lock();
+  while ((writing_ && in_progress_==filename) || queued(filename))
+    pthread_cond_wait(&done_cond_, &mutex_);
+  unlock();
+#else
+  (void)filename;
+#endif
+}
+
+bool baio_write_queue::flush()
+{
+  lock();
+#if VXL_HAS_PTHREAD_H
+  while (!queue_.empty() || writing_)
+    pthread_cond_wait(&done_cond_, &mutex_);
+#endif
+  std::vector<std::string> names;
+  names.swap(unsynced_);
+  bool ok = !failed_;
+  failed_ = false;
+  unlock();
+
+  for (unsigned i=0; i<names.size(); ++i)
+  {
+    std::string msg;
+    if (!sync_file(names[i], msg)) {
+      lock();
+      error_ = msg;
+      unlock();
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+#if VXL_HAS_PTHREAD_H
+
+//: Called with the lock held
+bool baio_write_queue::start_thread()
+{
+  stop_ = false;
+  thread_running_ = pthread_create(&thread_, VXL_NULLPTR, &baio_write_queue::run_thread, this)==0;
+  return thread_running_;
+}
+
+void* baio_write_queue::run_thread(void* queue)
+{
+  static_cast<baio_write_queue*>(queue)->run();
+  return VXL_NULLPTR;
+}
+
+void baio_write_queue::run()
+{
+  lock();
+  while (true)
+  {
+    while (queue_.empty() && !stop_)
+      pthread_cond_wait(&work_cond_, &mutex_);
+    if (queue_.empty())
+      break;
+
+    request* req = queue_.front();
+    queue_.pop_front();
+    in_progress_ = req->filename;
+    writing_ = true;
+    bool sync = policy_==BAIO_SYNC_EACH_WRITE;
+    unlock();
+
+    std::string msg;
+    bool ok = write_file(req->filename, req->data.empty() ? VXL_NULLPTR : &req->data[0],
+                         req->data.size(), sync, msg);
+
+    lock();
+    pending_bytes_ -= req->data.size();
+    writing_ = false;
+    in_progress_.clear();
+    record(req->filename, ok, msg);
+    pthread_cond_broadcast(&done_cond_);
+    delete req;
+  }
+  unlock();
+}
+
+#else
+
+bool baio_write_queue::start_thread() { return false; }
+void* baio_write_queue::run_thread(void*) { return VXL_NULLPTR; }
+void baio_write_queue::run() {}
+
+#endif
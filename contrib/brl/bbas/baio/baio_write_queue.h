@@ -0,0 +1,145 @@
+// This is brl/bbas/baio/baio_write_queue.h
+#ifndef baio_write_queue_h
+#define baio_write_queue_h
+//:
+// \file
+// \brief Write-behind queue handing file writes to a background thread
+//
+// write() copies the buffer and returns at once; a single I/O thread
+// then replaces the named file with it.  The bytes waiting in the queue
+// are bounded: write() blocks while accepting the buffer would take the
+// queue over max_bytes.  A queued write of a file is replaced by a later
+// write of the same file.  Files are written whole with their usual names,
+// so anything reading them sees the same format as a synchronous write
+// once it has called wait_for() or flush().
+//
+// Errors in background writes are kept until the next flush(), which
+// returns false and leaves the reason in error().
+//
+// \verbatim
+//  Example
+//    baio_write_queue& q = baio_write_queue::instance();
+//    q.set_enabled(true);
+//    q.write("alpha_id_0_0_0.bin", buffer, n_bytes);  // returns immediately
+//    ...
+//    if (!q.flush()) std::cerr << q.error() << '\n';
+// \endverbatim
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstddef>
+#include <vcl_compiler.h>
+#include <vxl_config.h>
+
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
+
+//: When written files are forced to stable storage
+enum baio_sync_policy
+{
+  BAIO_SYNC_NONE       = 0, // leave it to the operating system
+  BAIO_SYNC_ON_FLUSH   = 1, // fsync every file written since the last flush()
+  BAIO_SYNC_EACH_WRITE = 2  // fsync each file as it is written
+};
+
+class baio_write_queue
+{
+ public:
+  //: Queue shared by the boxm2 and bstm storage managers (disabled by default)
+  static baio_write_queue& instance();
+
+  explicit baio_write_queue(std::size_t max_bytes = 256<<20,
+                            baio_sync_policy policy = BAIO_SYNC_NONE);
+
+  //: Flushes outstanding writes and stops the I/O thread
+  ~baio_write_queue();
+
+  //: If false, write() writes synchronously (flush() is then just the sync)
+  void set_enabled(bool enabled);
+  bool enabled() const { return enabled_; }
+
+  //: Maximum number of bytes waiting to be written
+  void set_max_bytes(std::size_t max_bytes);
+  std::size_t max_bytes() const { return max_bytes_; }
+
+  void set_sync_policy(baio_sync_policy policy);
+  baio_sync_policy sync_policy() const { return policy_; }
+
+  //: Write n bytes of data to filename, replacing its contents.
+  //  The data is copied, so the caller may free it on return.
+  //  Returns false if the write (or an earlier one, not yet reported by
+  //  flush()) failed.
+  bool write(const std::string& filename, const char* data, std::size_t n);
+
+  //: Block until no write of filename is queued or in progress.
+  //  Call before reading a file that may have been written through the queue.
+  void wait_for(const std::string& filename);
+
+  //: Block until all queued writes are done, then apply the sync policy.
+  //  Returns false if any write failed since the previous flush().
+  bool flush();
+
+  //: Reason for the most recent failure
+  std::string error() const;
+
+  //: Number of bytes currently waiting to be written
+  std::size_t pending_bytes() const;
+
+ private:
+  struct request
+  {
+    std::string filename;
+    std::vector<char> data;
+  };
+
+  //: Write one file; returns false and sets msg on failure
+  bool write_file(const std::string& filename, const char* data,
+                  std::size_t n, bool sync, std::string& msg) const;
+
+  //: Force an already written file to disk
+  bool sync_file(const std::string& filename, std::string& msg) const;
+
+  //: Record the result of a write (called with the lock held)
+  void record(const std::string& filename, bool ok, const std::string& msg);
+
+  bool queued(const std::string& filename) const;
+  bool start_thread();
+  void run();
+  static void* run_thread(void* queue);
+
+  void lock() const;
+  void unlock() const;
+
+  bool enabled_;
+  std::size_t max_bytes_;
+  baio_sync_policy policy_;
+
+  std::deque<request*> queue_;
+  std::size_t pending_bytes_;
+  //: File being written by the I/O thread, if any
+  std::string in_progress_;
+  bool writing_;
+  //: Files written since the last flush, for BAIO_SYNC_ON_FLUSH
+  std::vector<std::string> unsynced_;
+  bool failed_;
+  std::string error_;
+
+  bool thread_running_;
+  bool stop_;
+#if VXL_HAS_PTHREAD_H
+  pthread_t thread_;
+  mutable pthread_mutex_t mutex_;
+  //: Signalled when work is queued or the thread should stop
+  pthread_cond_t work_cond_;
+  //: Signalled when a write finishes
+  pthread_cond_t done_cond_;
+#endif
+
+  // Not copyable
+  baio_write_queue(const baio_write_queue&);
+  baio_write_queue& operator=(const baio_write_queue&);
+};
+
+#endif // baio_write_queue_h
@@ -1,12 +1,14 @@
 #include <testlib/testlib_register.h>
 DECLARE( test_read );
 DECLARE( test_write );
+DECLARE( test_write_queue );
 
 void
 register_tests()
 {
   REGISTER( test_read );
   REGISTER( test_write );
+  REGISTER( test_write_queue );
 }
 
 DEFINE_MAIN;
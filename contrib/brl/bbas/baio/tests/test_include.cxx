@@ -1,3 +1,4 @@
 #include <baio/baio.h>
+#include <baio/baio_write_queue.h>
 
 int main() { return 0; }
@@ -0,0 +1,83 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <testlib/testlib_test.h>
+#include <testlib/testlib_root_dir.h>
+#include <baio/baio_write_queue.h>
+#include <vcl_compiler.h>
+#include <vpl/vpl.h>
+
+static std::vector<char> read_file(const std::string& filename)
+{
+  std::ifstream is(filename.c_str(), std::ios::binary);
+  std::vector<char> data;
+  char c;
+  while (is.get(c))
+    data.push_back(c);
+  return data;
+}
+
+static std::vector<char> make_buffer(unsigned n, unsigned seed)
+{
+  std::vector<char> data(n);
+  for (unsigned i=0; i<n; ++i)
+    data[i] = char((i*31 + seed*7) % 251);
+  return data;
+}
+
+static void test_write_queue()
+{
+  std::string dir = testlib_root_dir() + "/contrib/brl/bbas/baio/tests/";
+  const unsigned n_files = 8, n_bytes = 100000;
+
+  // Small limit so that writers have to wait for the I/O thread
+  baio_write_queue queue(3*n_bytes, BAIO_SYNC_ON_FLUSH);
+  TEST("Disabled by default", queue.enabled(), false);
+  queue.set_enabled(true);
+
+  std::vector<std::string> names;
+  for (unsigned i=0; i<n_files; ++i)
+  {
+    std::stringstream name;
+    name << dir << "test_write_queue_" << i << ".bin";
+    names.push_back(name.str());
+    std::vector<char> data = make_buffer(n_bytes, i);
+    queue.write(names[i], &data[0], data.size());
+    TEST("Queued bytes bounded", queue.pending_bytes() <= 3*n_bytes, true);
+  }
+
+  // Overwrite one file; the reader must see the later contents
+  std::vector<char> later = make_buffer(n_bytes/2, 99);
+  queue.write(names[3], &later[0], later.size());
+  queue.wait_for(names[3]);
+  TEST("wait_for sees latest write", read_file(names[3]) == later, true);
+
+  TEST("flush succeeds", queue.flush(), true);
+  TEST("Nothing pending after flush", queue.pending_bytes(), 0);
+  bool same = true;
+  for (unsigned i=0; i<n_files; ++i)
+    if (i != 3)
+      same = same && read_file(names[i]) == make_buffer(n_bytes, i);
+  TEST("All files written", same, true);
+
+  // Failures are reported by the next flush
+  std::string bad = dir + "no_such_directory/test_write_queue.bin";
+  queue.write(bad, &later[0], later.size());
+  TEST("flush reports failed write", queue.flush(), false);
+  std::cout << "Reported: " << queue.error() << std::endl;
+  TEST("Error names the file", queue.error().find(bad) != std::string::npos, true);
+  TEST("Error cleared by flush", queue.flush(), true);
+
+  // Synchronous path
+  queue.set_enabled(false);
+  TEST("Synchronous write", queue.write(names[0], &later[0], later.size()), true);
+  TEST("Synchronous write done on return", read_file(names[0]) == later, true);
+  TEST("Synchronous failure reported", queue.write(bad, &later[0], later.size()), false);
+  queue.flush();
+
+  for (unsigned i=0; i<n_files; ++i)
+    vpl_unlink(names[i].c_str());
+}
+
+TESTMAIN(test_write_queue);
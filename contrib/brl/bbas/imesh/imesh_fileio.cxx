@@ -3,6 +3,7 @@
 #include <fstream>
 #include <sstream>
 #include <limits>
+#include <utility>
 #include "imesh_fileio.h"
 //:
 // \file
@@ -12,6 +13,88 @@
 #include <vgl/vgl_point_2d.h>
 
 
+//: Build the face array for faces read into flat lists
+//  The vertices of face \p f are \p corner_verts[face_start[f]] to
+//  \p corner_verts[face_start[f+1]-1].  Triangle and quad meshes are stored
+//  as regular face arrays.  \p groups holds the name and face count of each
+//  call to make_group() made while reading.
+static std::auto_ptr<imesh_face_array_base>
+imesh_build_faces(const std::vector<unsigned int>& face_start,
+                  const std::vector<unsigned int>& corner_verts,
+                  const std::vector<std::pair<std::string,unsigned int> >& groups =
+                      std::vector<std::pair<std::string,unsigned int> >())
+{
+  const unsigned int num_faces = face_start.size()-1;
+  unsigned int regularity = 0;
+  if (num_faces > 0) {
+    regularity = face_start[1] - face_start[0];
+    for (unsigned int f=1; f<num_faces && regularity > 0; ++f)
+      if (face_start[f+1] - face_start[f] != regularity)
+        regularity = 0;
+  }
+
+  std::auto_ptr<imesh_face_array_base> faces;
+  std::auto_ptr<imesh_regular_face_array<3> > tris;
+  std::auto_ptr<imesh_regular_face_array<4> > quads;
+  std::auto_ptr<imesh_face_array> polys;
+  if (regularity == 3)
+    tris.reset(new imesh_regular_face_array<3>);
+  else if (regularity == 4)
+    quads.reset(new imesh_regular_face_array<4>);
+  else
+    polys.reset(new imesh_face_array);
+
+  unsigned int f = 0;
+  for (unsigned int g=0; g<=groups.size(); ++g) {
+    const unsigned int group_end = (g < groups.size()) ? groups[g].second : num_faces;
+    for (; f<group_end; ++f) {
+      const unsigned int* v = &corner_verts[0] + face_start[f];
+      if (tris.get())
+        tris->push_back(imesh_tri(v[0],v[1],v[2]));
+      else if (quads.get())
+        quads->push_back(imesh_quad(v[0],v[1],v[2],v[3]));
+      else
+        polys->push_back(std::vector<unsigned int>(v, v + face_start[f+1] - face_start[f]));
+    }
+    if (g < groups.size()) {
+      if (tris.get())       tris->make_group(groups[g].first);
+      else if (quads.get()) quads->make_group(groups[g].first);
+      else                  polys->make_group(groups[g].first);
+    }
+  }
+
+  if (tris.get())
+    faces.reset(tris.release());
+  else if (quads.get())
+    faces.reset(quads.release());
+  else
+    faces.reset(polys.release());
+  return faces;
+}
+
+
+//: Read \p num_faces counted vertex index lists into flat lists
+static void imesh_read_face_lists(std::istream& is, unsigned int num_faces,
+                                  std::vector<unsigned int>& face_start,
+                                  std::vector<unsigned int>& corner_verts)
+{
+  face_start.assign(1, 0);
+  face_start.reserve(num_faces+1);
+  corner_verts.clear();
+  corner_verts.reserve(3*num_faces);
+  for (unsigned int f=0; f<num_faces; ++f) {
+    unsigned int cnt = 0;
+    is >> cnt;
+    for (unsigned int v=0; v<cnt; ++v) {
+      unsigned int idx = 0;
+      is >> idx;
+      corner_verts.push_back(idx);
+    }
+    face_start.push_back(corner_verts.size());
+  }
+}
+
+
 //: Read a mesh from a file, determine type from extension
 bool imesh_read(const std::string& filename, imesh_mesh& mesh)
 {
@@ -43,22 +126,15 @@ bool imesh_read_ply2(std::istream& is, imesh_mesh& mesh)
   unsigned int num_verts, num_faces;
   is >> num_verts >> num_faces;
   std::auto_ptr<imesh_vertex_array<3> > verts(new imesh_vertex_array<3>(num_verts));
-  std::auto_ptr<imesh_face_array > faces(new imesh_face_array(num_faces));
   for (unsigned int v=0; v<num_verts; ++v) {
     imesh_vertex<3>& vert = (*verts)[v];
     is >> vert[0] >> vert[1] >> vert[2];
   }
-  for (unsigned int f=0; f<num_faces; ++f) {
-    std::vector<unsigned int>& face = (*faces)[f];
-    unsigned int cnt;
-    is >> cnt;
-    face.resize(cnt,0);
-    for (unsigned int v=0; v<cnt; ++v)
-      is >> face[v];
-  }
+  std::vector<unsigned int> face_start, corner_verts;
+  imesh_read_face_lists(is, num_faces, face_start, corner_verts);
 
   mesh.set_vertices(std::auto_ptr<imesh_vertex_array_base>(verts));
-  mesh.set_faces(std::auto_ptr<imesh_face_array_base>(faces));
+  mesh.set_faces(imesh_build_faces(face_start, corner_verts));
   return true;
 }
 
@@ -95,22 +171,15 @@ bool imesh_read_ply(std::istream& is, imesh_mesh& mesh)
     }
   }
   std::auto_ptr<imesh_vertex_array<3> > verts(new imesh_vertex_array<3>(num_verts));
-  std::auto_ptr<imesh_face_array > faces(new imesh_face_array(num_faces));
   for (unsigned int v=0; v<num_verts; ++v) {
     imesh_vertex<3>& vert = (*verts)[v];
     is >> vert[0] >> vert[1] >> vert[2];
   }
-  for (unsigned int f=0; f<num_faces; ++f) {
-    std::vector<unsigned int>& face = (*faces)[f];
-    unsigned int cnt;
-    is >> cnt;
-    face.resize(cnt,0);
-    for (unsigned int v=0; v<cnt; ++v)
-      is >> face[v];
-  }
+  std::vector<unsigned int> face_start, corner_verts;
+  imesh_read_face_lists(is, num_faces, face_start, corner_verts);
 
   mesh.set_vertices(std::auto_ptr<imesh_vertex_array_base>(verts));
-  mesh.set_faces(std::auto_ptr<imesh_face_array_base>(faces));
+  mesh.set_faces(imesh_build_faces(face_start, corner_verts));
   return true;
 }
 
@@ -187,7 +256,8 @@ bool imesh_read_obj(const std::string& filename, imesh_mesh& mesh)
 bool imesh_read_obj(std::istream& is, imesh_mesh& mesh)
 {
   std::auto_ptr<imesh_vertex_array<3> > verts(new imesh_vertex_array<3>);
-  std::auto_ptr<imesh_face_array> faces(new imesh_face_array);
+  std::vector<unsigned int> face_start(1,0), corner_verts;
+  std::vector<std::pair<std::string,unsigned int> > groups;
   std::vector<vgl_vector_3d<double> > normals;
   std::vector<vgl_point_2d<double> > tex;
   std::string last_group = "ungrouped";
@@ -232,11 +302,11 @@ bool imesh_read_obj(std::istream& is, imesh_mesh& mesh)
       {
         std::string line;
         std::getline(is,line);
-        std::vector<unsigned int> vi, ti, ni;
+        std::vector<unsigned int> ti, ni;
         unsigned int v;
         std::stringstream ss(line);
         while (ss >> v) {
-          vi.push_back(v-1);
+          corner_verts.push_back(v-1);
           if (ss.peek() == '/') {
             ss.ignore();
             if (ss.peek() != '/') {
@@ -267,12 +337,12 @@ bool imesh_read_obj(std::istream& is, imesh_mesh& mesh)
             }
           }
         }
-        faces->push_back(vi);
+        face_start.push_back(corner_verts.size());
         break;
       }
       case 'g':
       {
-        faces->make_group(last_group);
+        groups.push_back(std::make_pair(last_group, unsigned(face_start.size()-1)));
         is.ignore();
         std::getline(is,last_group);
         break;
@@ -283,6 +353,8 @@ bool imesh_read_obj(std::istream& is, imesh_mesh& mesh)
     }
   }
 
+  std::auto_ptr<imesh_face_array_base> faces = imesh_build_faces(face_start, corner_verts, groups);
+
   // make the last group
   if (faces->has_groups())
     faces->make_group(last_group);
@@ -291,7 +363,7 @@ bool imesh_read_obj(std::istream& is, imesh_mesh& mesh)
     verts->set_normals(normals);
 
   mesh.set_vertices(std::auto_ptr<imesh_vertex_array_base>(verts));
-  mesh.set_faces(std::auto_ptr<imesh_face_array_base>(faces));
+  mesh.set_faces(faces);
   mesh.set_tex_coords(tex);
 
   return true;
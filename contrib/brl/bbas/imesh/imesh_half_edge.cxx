@@ -1,13 +1,13 @@
 // This is brl/bbas/imesh/imesh_half_edge.cxx
 #include <iostream>
-#include <map>
-#include <utility>
+#include <algorithm>
 #include "imesh_half_edge.h"
 //:
 // \file
 
 #include <vcl_compiler.h>
 #include <vcl_cassert.h>
+#include <imesh/imesh_face.h>
 
 
 //: Construct from a face index list
@@ -17,58 +17,161 @@ imesh_half_edge_set::imesh_half_edge_set(const std::vector<std::vector<unsigned
 }
 
 
+//: Construct from a face array
+imesh_half_edge_set::imesh_half_edge_set(const imesh_face_array_base& faces)
+{
+  build_from_ifs(faces);
+}
+
+
 //: Build the half edges from an indexed face set
 void
 imesh_half_edge_set::build_from_ifs(const std::vector<std::vector<unsigned int> >& face_list)
 {
-  half_edges_.clear();
-  typedef std::pair<unsigned int, unsigned int> vert_pair;
-  std::map<vert_pair, unsigned int> edge_map;
+  const unsigned int num_faces = face_list.size();
+  std::vector<unsigned int> face_start(num_faces+1,0);
+  for (unsigned int f=0; f<num_faces; ++f)
+    face_start[f+1] = face_start[f] + face_list[f].size();
 
-  face_to_he_.resize(face_list.size(), imesh_invalid_idx);
+  std::vector<unsigned int> corner_verts;
+  corner_verts.reserve(face_start[num_faces]);
+  for (unsigned int f=0; f<num_faces; ++f)
+    corner_verts.insert(corner_verts.end(), face_list[f].begin(), face_list[f].end());
 
-  unsigned int max_v = 0;
+  build_from_corners(face_start, corner_verts);
+}
 
-  const unsigned int num_faces = face_list.size();
+
+//: Build the half edges directly from a face array
+void
+imesh_half_edge_set::build_from_ifs(const imesh_face_array_base& faces)
+{
+  const unsigned int num_faces = faces.size();
+  std::vector<unsigned int> face_start(num_faces+1,0);
+  std::vector<unsigned int> corner_verts;
+
+  // triangle meshes are stored contiguously, copy without virtual calls
+  if (faces.regularity() == 3) {
+    const imesh_regular_face_array<3>& tris =
+        static_cast<const imesh_regular_face_array<3>&>(faces);
+    corner_verts.resize(3*num_faces);
+    for (unsigned int f=0; f<num_faces; ++f) {
+      const imesh_regular_face<3>& tri = tris[f];
+      corner_verts[3*f]   = tri[0];
+      corner_verts[3*f+1] = tri[1];
+      corner_verts[3*f+2] = tri[2];
+      face_start[f+1] = face_start[f] + 3;
+    }
+  }
+  else {
+    for (unsigned int f=0; f<num_faces; ++f)
+      face_start[f+1] = face_start[f] + faces.num_verts(f);
+    corner_verts.resize(face_start[num_faces]);
+    for (unsigned int f=0; f<num_faces; ++f)
+      for (unsigned int i=face_start[f]; i<face_start[f+1]; ++i)
+        corner_verts[i] = faces(f,i-face_start[f]);
+  }
+
+  build_from_corners(face_start, corner_verts);
+}
+
+
+namespace
+{
+  //: An undirected edge seen from one face corner, used for sorting
+  struct imesh_corner_edge
+  {
+    unsigned int lo, hi, corner;
+    bool operator<(const imesh_corner_edge& other) const
+    {
+      if (lo != other.lo) return lo < other.lo;
+      if (hi != other.hi) return hi < other.hi;
+      return corner < other.corner;
+    }
+    bool same_edge(const imesh_corner_edge& other) const
+    {
+      return lo == other.lo && hi == other.hi;
+    }
+  };
+}
+
+
+//: Build from flat face lists
+//  Matching corners are found by sorting the undirected edges rather than
+//  with a map lookup per corner.  Edges are numbered in the order they are
+//  first seen in the face list, so the result is identical to a face-by-face
+//  construction.
+void
+imesh_half_edge_set::build_from_corners(const std::vector<unsigned int>& face_start,
+                                        const std::vector<unsigned int>& corner_verts)
+{
+  const unsigned int num_faces = face_start.size()-1;
+  const unsigned int num_corners = corner_verts.size();
+
+  // face and next corner of each corner
+  std::vector<unsigned int> corner_face(num_corners), next_corner(num_corners);
+  unsigned int max_v = 0;
   for (unsigned int f=0; f<num_faces; ++f) {
-    const std::vector<unsigned int>& verts = face_list[f];
-    const unsigned int num_verts = verts.size();
-    unsigned int first_e = imesh_invalid_idx; // first edge index
-    unsigned int prev_e = imesh_invalid_idx; // previous edge index
-    for (unsigned int i=0; i<num_verts; ++i) {
-      const unsigned int& v = verts[i];
-      if (v > max_v) max_v = v;
-      unsigned int ni = (i+1)%num_verts;
-      const unsigned int& nv = verts[ni];
-
-      vert_pair vp(v,nv);
-      if (v > nv) vp = vert_pair(nv,v);
-      std::map<vert_pair, unsigned int>::iterator m = edge_map.find(vp);
-      unsigned int curr_e;
-      if (m == edge_map.end()) {
-        curr_e = half_edges_.size();
-        edge_map.insert(std::pair<vert_pair,unsigned int>(vp,curr_e));
-        half_edges_.push_back(imesh_half_edge(curr_e,imesh_invalid_idx,v,f));
-        half_edges_.push_back(imesh_half_edge(curr_e+1,imesh_invalid_idx,nv,imesh_invalid_idx));
-      }
-      else {
-        curr_e = m->second+1;
-        assert(half_edges_[curr_e].next_index() == imesh_invalid_idx);
-        assert(half_edges_[curr_e].vert_index() == v);
-        half_edges_[curr_e].face_ = f;
+    const unsigned int b = face_start[f], e = face_start[f+1];
+    for (unsigned int c=b; c<e; ++c) {
+      corner_face[c] = f;
+      next_corner[c] = (c+1 < e) ? c+1 : b;
+      if (corner_verts[c] > max_v) max_v = corner_verts[c];
+    }
+  }
+
+  std::vector<imesh_corner_edge> edges(num_corners);
+  for (unsigned int c=0; c<num_corners; ++c) {
+    const unsigned int v = corner_verts[c], nv = corner_verts[next_corner[c]];
+    imesh_corner_edge& ce = edges[c];
+    ce.lo = (v < nv) ? v : nv;
+    ce.hi = (v < nv) ? nv : v;
+    ce.corner = c;
+  }
+  std::sort(edges.begin(), edges.end());
+
+  // pair up the corners sharing an edge; the lower corner creates the edge
+  std::vector<unsigned int> partner(num_corners, imesh_invalid_idx);
+  std::vector<bool> creates_edge(num_corners, false);
+  for (unsigned int i=0; i<num_corners; ) {
+    unsigned int j = i+1;
+    while (j < num_corners && edges[j].same_edge(edges[i]))
+      ++j;
+    for (unsigned int k=i; k<j; k+=2) {
+      creates_edge[edges[k].corner] = true;
+      if (k+1 < j) {
+        partner[edges[k].corner] = edges[k+1].corner;
+        assert(corner_verts[edges[k+1].corner] == corner_verts[next_corner[edges[k].corner]]);
       }
-      if (first_e == imesh_invalid_idx)
-        first_e = curr_e;
-      if (prev_e != imesh_invalid_idx)
-        half_edges_[prev_e].next_ = curr_e;
-      prev_e = curr_e;
     }
-    if (prev_e != imesh_invalid_idx)
-      half_edges_[prev_e].next_ = first_e;
-    face_to_he_[f] = first_e;
+    i = j;
   }
+  edges.clear();
+
+  // number the edges in corner order
+  half_edges_.clear();
+  std::vector<unsigned int> corner_he(num_corners);
+  for (unsigned int c=0; c<num_corners; ++c) {
+    if (!creates_edge[c])
+      continue;
+    const unsigned int curr_e = half_edges_.size();
+    const unsigned int p = partner[c];
+    corner_he[c] = curr_e;
+    half_edges_.push_back(imesh_half_edge(curr_e,imesh_invalid_idx,corner_verts[c],corner_face[c]));
+    half_edges_.push_back(imesh_half_edge(curr_e+1,imesh_invalid_idx,corner_verts[next_corner[c]],
+                                          (p == imesh_invalid_idx) ? imesh_invalid_idx : corner_face[p]));
+    if (p != imesh_invalid_idx)
+      corner_he[p] = curr_e+1;
+  }
+  for (unsigned int c=0; c<num_corners; ++c)
+    half_edges_[corner_he[c]].next_ = corner_he[next_corner[c]];
+
+  face_to_he_.assign(num_faces, imesh_invalid_idx);
+  for (unsigned int f=0; f<num_faces; ++f)
+    if (face_start[f] < face_start[f+1])
+      face_to_he_[f] = corner_he[face_start[f]];
 
-  vert_to_he_.resize(max_v+1, imesh_invalid_idx);
+  vert_to_he_.assign(max_v+1, imesh_invalid_idx);
 
   // create half edges for boundaries
   for (unsigned int i=0; i<half_edges_.size(); ++i) {
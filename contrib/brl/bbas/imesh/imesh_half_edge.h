@@ -16,6 +16,8 @@
 
 #define imesh_invalid_idx (static_cast<unsigned int>(-1))
 
+class imesh_face_array_base;
+
 class imesh_half_edge
 {
     friend class imesh_half_edge_set;
@@ -58,9 +60,16 @@ class imesh_half_edge_set
     //: Construct from a face index list
     imesh_half_edge_set(const std::vector<std::vector<unsigned int> >& face_list);
 
+    //: Construct from a face array
+    explicit imesh_half_edge_set(const imesh_face_array_base& faces);
+
     //: Build the half edges from an indexed face set
     void build_from_ifs(const std::vector<std::vector<unsigned int> >& face_list);
 
+    //: Build the half edges directly from a face array
+    //  Avoids copying the faces into a face index list first
+    void build_from_ifs(const imesh_face_array_base& faces);
+
     //: Access by index
     const imesh_half_edge& operator [] (unsigned int i) const { return half_edges_[i]; }
     //: Access by index
@@ -357,6 +366,11 @@ class imesh_half_edge_set
     unsigned int num_faces() const;
 
   private:
+    //: Build from flat face lists
+    //  The vertices of face \p f are \p corner_verts[face_start[f]] to \p corner_verts[face_start[f+1]-1]
+    void build_from_corners(const std::vector<unsigned int>& face_start,
+                            const std::vector<unsigned int>& corner_verts);
+
     std::vector<imesh_half_edge> half_edges_;
     std::vector<unsigned int> vert_to_he_;
     std::vector<unsigned int> face_to_he_;
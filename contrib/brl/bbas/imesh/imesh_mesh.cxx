@@ -8,6 +8,11 @@
 #include <vgl/vgl_area.h>
 
 #include <vcl_compiler.h>
+#include <vxl_config.h>
+
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
 
 //: Copy Constructor
 imesh_mesh::imesh_mesh(const imesh_mesh& other)
@@ -93,115 +98,247 @@ void imesh_mesh::set_tex_coords(const std::vector<vgl_point_2d<double> >& tc)
 //: Construct the half edges graph structure
 void imesh_mesh::build_edge_graph()
 {
-  const imesh_face_array_base& faces = this->faces();
-  std::vector<std::vector<unsigned int> > face_list(faces.size());
-  for (unsigned int f=0; f<faces.size(); ++f) {
-    face_list[f].resize(faces.num_verts(f));
-    for (unsigned int v=0; v<faces.num_verts(f); ++v)
-      face_list[f][v] =  faces(f,v);
-  }
+  half_edges_.build_from_ifs(this->faces());
+}
+
+
+namespace
+{
+  //: The per-vertex and per-face loops of imesh_mesh, split into ranges for threads
+  //  Each range only writes the entries it owns, so the threads need no locking.
+  class imesh_mesh_loops
+  {
+   public:
+    imesh_mesh_loops(const imesh_vertex_array<3>& verts,
+                     const imesh_face_array_base& faces,
+                     const imesh_half_edge_set& half_edges)
+    : verts_(verts), faces_(faces), half_edges_(half_edges),
+      fnormals_(VXL_NULLPTR), norm_(true) {}
+
+    //: Group the non-boundary half edges by vertex, in increasing half edge order
+    //  With \p at_head the edges are grouped by the vertex they point to
+    //  rather than the one they leave.  Summing in this order reproduces the
+    //  sums of a single loop over the half edges.
+    void group_half_edges_by_vertex(bool at_head)
+    {
+      const unsigned int nv = verts_.size();
+      std::vector<unsigned int> key(half_edges_.size(), imesh_invalid_idx);
+      vert_start_.assign(nv+1, 0);
+      for (unsigned int he=0; he < half_edges_.size(); ++he) {
+        const imesh_half_edge& half_edge = half_edges_[he];
+        if (half_edge.is_boundary())
+          continue;
+        key[he] = at_head ? half_edges_[half_edge.next_index()].vert_index()
+                          : half_edge.vert_index();
+        ++vert_start_[key[he]+1];
+      }
+      for (unsigned int v=0; v<nv; ++v)
+        vert_start_[v+1] += vert_start_[v];
+      vert_he_.resize(vert_start_[nv]);
+      std::vector<unsigned int> fill(vert_start_.begin(), vert_start_.end()-1);
+      for (unsigned int he=0; he < half_edges_.size(); ++he)
+        if (key[he] != imesh_invalid_idx)
+          vert_he_[fill[key[he]]++] = he;
+    }
+
+    //: Average of the normalized normals of the triangles at each corner
+    void vertex_normals(unsigned begin, unsigned end, unsigned /*t*/)
+    {
+      for (unsigned int v=begin; v<end; ++v) {
+        vgl_vector_3d<double>& n = normals_[v];
+        for (unsigned int i=vert_start_[v]; i<vert_start_[v+1]; ++i) {
+          imesh_half_edge_set::f_const_iterator fi(vert_he_[i],half_edges_);
+          unsigned int vp = fi->vert_index();
+          ++fi;
+          unsigned int vn = (++fi)->vert_index();
+          n += normalized(imesh_tri_normal(verts_[v],verts_[vn],verts_[vp]));
+        }
+        average(v);
+      }
+    }
+
+    //: Average of the normalized normals of the faces at each vertex
+    void vertex_normals_from_faces(unsigned begin, unsigned end, unsigned /*t*/)
+    {
+      for (unsigned int v=begin; v<end; ++v) {
+        vgl_vector_3d<double>& n = normals_[v];
+        for (unsigned int i=vert_start_[v]; i<vert_start_[v+1]; ++i)
+          n += normalized((*fnormals_)[half_edges_[vert_he_[i]].face_index()]);
+        average(v);
+      }
+    }
+
+    //: Sum of the triangle fan normals of each face
+    void face_normals(unsigned begin, unsigned end, unsigned /*t*/)
+    {
+      for (unsigned int i=begin; i<end; ++i) {
+        const unsigned int num_v = faces_.num_verts(i);
+        vgl_vector_3d<double>& n = normals_[i];
+        for (unsigned int j=2; j<num_v; ++j) {
+          n += imesh_tri_normal(verts_[faces_(i,0)],
+                                verts_[faces_(i,j-1)],
+                                verts_[faces_(i,j)]);
+        }
+        if (norm_)
+          normalize(n);
+      }
+    }
+
+    //: Area of each face from its triangle fan
+    void face_areas(unsigned begin, unsigned end, unsigned /*t*/)
+    {
+      for (unsigned int i=begin; i<end; ++i) {
+        const unsigned int num_v = faces_.num_verts(i);
+        vgl_vector_3d<double> n(0,0,0);
+        for (unsigned int j=2; j<num_v; ++j) {
+          n += imesh_tri_normal(verts_[faces_(i,0)],
+                                verts_[faces_(i,j-1)],
+                                verts_[faces_(i,j)]);
+        }
+        areas_[i] = n.length()/2.0;
+      }
+    }
+
+    std::vector<vgl_vector_3d<double> > normals_;
+    std::vector<double> areas_;
+    const std::vector<vgl_vector_3d<double> >* fnormals_;
+    bool norm_;
+
+   private:
+    void average(unsigned int v)
+    {
+      vgl_vector_3d<double>& n = normals_[v];
+      n /= double(vert_start_[v+1]-vert_start_[v]);
+      normalize(n);
+      if (n.length() < 0.5)
+        std::cout << "normal "<<v<<" is "<<n <<std::endl;
+    }
+
+    const imesh_vertex_array<3>& verts_;
+    const imesh_face_array_base& faces_;
+    const imesh_half_edge_set& half_edges_;
+    std::vector<unsigned int> vert_start_;
+    std::vector<unsigned int> vert_he_;
+  };
 
-  half_edges_.build_from_ifs(face_list);
+  struct imesh_mesh_loop_job
+  {
+    imesh_mesh_loops* obj;
+    void (imesh_mesh_loops::*fn)(unsigned, unsigned, unsigned);
+    unsigned begin, end, index;
+
+    void run() { (obj->*fn)(begin, end, index); }
+
+    static void* run_thread(void* job)
+    {
+      static_cast<imesh_mesh_loop_job*>(job)->run();
+      return VXL_NULLPTR;
+    }
+  };
+
+  //: Call (obj->*fn)(begin,end,t) over up to n_threads contiguous ranges of [0,n)
+  void imesh_mesh_parallel_for(imesh_mesh_loops* obj,
+                               void (imesh_mesh_loops::*fn)(unsigned, unsigned, unsigned),
+                               unsigned n, unsigned n_threads)
+  {
+    if (n_threads<1) n_threads=1;
+    unsigned n_ranges = n<n_threads ? (n>0 ? n : 1) : n_threads;
+    std::vector<imesh_mesh_loop_job> jobs(n_ranges);
+    unsigned step = (n+n_ranges-1)/n_ranges;
+    for (unsigned t=0;t<n_ranges;++t)
+    {
+      jobs[t].obj = obj;
+      jobs[t].fn = fn;
+      jobs[t].index = t;
+      jobs[t].begin = t*step<n ? t*step : n;
+      jobs[t].end = (t+1)*step<n ? (t+1)*step : n;
+    }
+
+#if VXL_HAS_PTHREAD_H
+    if (n_ranges>1)
+    {
+      std::vector<pthread_t> threads(n_ranges);
+      std::vector<bool> started(n_ranges,false);
+      for (unsigned t=1;t<n_ranges;++t)
+        started[t] = pthread_create(&threads[t], VXL_NULLPTR,
+                                    &imesh_mesh_loop_job::run_thread, &jobs[t])==0;
+      jobs[0].run();
+      for (unsigned t=1;t<n_ranges;++t)
+      {
+        if (started[t])
+          pthread_join(threads[t], VXL_NULLPTR);
+        else
+          jobs[t].run(); // Couldn't start thread - do it here
+      }
+      return;
+    }
+#endif
+    for (unsigned t=0;t<n_ranges;++t)
+      jobs[t].run();
+  }
 }
 
 
 //: Compute vertex normals
-void imesh_mesh::compute_vertex_normals()
+void imesh_mesh::compute_vertex_normals(unsigned int n_threads)
 {
   if (!this->has_half_edges())
     this->build_edge_graph();
 
-  const imesh_half_edge_set& half_edges = this->half_edges();
   imesh_vertex_array<3>& verts = this->vertices<3>();
+  imesh_mesh_loops loops(verts, this->faces(), this->half_edges());
+  loops.group_half_edges_by_vertex(true);
+  loops.normals_.resize(this->num_verts(), vgl_vector_3d<double>(0,0,0));
+  imesh_mesh_parallel_for(&loops, &imesh_mesh_loops::vertex_normals,
+                          verts.size(), n_threads);
 
-  std::vector<vgl_vector_3d<double> > normals(this->num_verts(),
-                                             vgl_vector_3d<double>(0,0,0));
-  std::vector<unsigned int> f_count(this->num_verts(),0);
-
-  for (unsigned int he=0; he < half_edges.size(); ++he) {
-    imesh_half_edge_set::f_const_iterator fi(he,half_edges);
-    if (fi->is_boundary())
-      continue;
-    unsigned int vp = fi->vert_index();
-    unsigned int v = (++fi)->vert_index();
-    unsigned int vn = (++fi)->vert_index();
-    normals[v] += normalized(imesh_tri_normal(verts[v],verts[vn],verts[vp]));
-    ++f_count[v];
-  }
-
-  for (unsigned v=0; v<verts.size(); ++v)
-  {
-    normals[v] /= f_count[v];
-    normalize(normals[v]);
-    if (normals[v].length() < 0.5)
-      std::cout << "normal "<<v<<" is "<<normals[v] <<std::endl;
-  }
-
-  verts.set_normals(normals);
+  verts.set_normals(loops.normals_);
 }
 
 
 //: Compute vertex normals using face normals
-void imesh_mesh::compute_vertex_normals_from_faces()
+void imesh_mesh::compute_vertex_normals_from_faces(unsigned int n_threads)
 {
   if (!this->has_half_edges())
     this->build_edge_graph();
 
   if (!this->faces_->has_normals())
-    this->compute_face_normals();
+    this->compute_face_normals(true, n_threads);
 
-  const std::vector<vgl_vector_3d<double> >& fnormals = faces_->normals();
-
-  const imesh_half_edge_set& half_edges = this->half_edges();
   imesh_vertex_array<3>& verts = this->vertices<3>();
-
-  std::vector<vgl_vector_3d<double> > normals(this->num_verts(),
-                                             vgl_vector_3d<double>(0,0,0));
-  std::vector<unsigned int> f_count(this->num_verts(),0);
-
-  for (unsigned int he=0; he < half_edges.size(); ++he) {
-    const imesh_half_edge& half_edge = half_edges[he];
-    if (half_edge.is_boundary())
-      continue;
-    unsigned int v = half_edge.vert_index();
-    normals[v] += normalized(fnormals[half_edge.face_index()]);
-    ++f_count[v];
-  }
-
-  for (unsigned v=0; v<verts.size(); ++v)
-  {
-    normals[v] /= f_count[v];
-    normalize(normals[v]);
-    if (normals[v].length() < 0.5)
-      std::cout << "normal "<<v<<" is "<<normals[v] <<std::endl;
-  }
-
-  verts.set_normals(normals);
+  imesh_mesh_loops loops(verts, this->faces(), this->half_edges());
+  loops.group_half_edges_by_vertex(false);
+  loops.fnormals_ = &faces_->normals();
+  loops.normals_.resize(this->num_verts(), vgl_vector_3d<double>(0,0,0));
+  imesh_mesh_parallel_for(&loops, &imesh_mesh_loops::vertex_normals_from_faces,
+                          verts.size(), n_threads);
+
+  verts.set_normals(loops.normals_);
 }
 
 
 //: Compute face normals
-void imesh_mesh::compute_face_normals(bool norm)
+void imesh_mesh::compute_face_normals(bool norm, unsigned int n_threads)
 {
   imesh_face_array_base& faces = this->faces();
-  const imesh_vertex_array<3>& verts = this->vertices<3>();
-
-  std::vector<vgl_vector_3d<double> > normals(this->num_faces(),
-                                             vgl_vector_3d<double>(0,0,0));
-
-  for (unsigned int i=0; i<faces.size(); ++i) {
-    const unsigned int num_v = faces.num_verts(i);
-    vgl_vector_3d<double>& n = normals[i];
-    for (unsigned int j=2; j<num_v; ++j) {
-      n += imesh_tri_normal(verts[faces(i,0)],
-                            verts[faces(i,j-1)],
-                            verts[faces(i,j)]);
-    }
-    if (norm)
-      normalize(n);
-  }
+  imesh_mesh_loops loops(this->vertices<3>(), faces, this->half_edges());
+  loops.norm_ = norm;
+  loops.normals_.resize(this->num_faces(), vgl_vector_3d<double>(0,0,0));
+  imesh_mesh_parallel_for(&loops, &imesh_mesh_loops::face_normals,
+                          faces.size(), n_threads);
 
-  faces.set_normals(normals);
+  faces.set_normals(loops.normals_);
+}
+
+
+//: Compute the area of each face
+std::vector<double> imesh_mesh::face_areas(unsigned int n_threads) const
+{
+  imesh_mesh_loops loops(this->vertices<3>(), this->faces(), this->half_edges());
+  loops.areas_.resize(this->num_faces(), 0.0);
+  imesh_mesh_parallel_for(&loops, &imesh_mesh_loops::face_areas,
+                          this->num_faces(), n_threads);
+  return loops.areas_;
 }
 
 
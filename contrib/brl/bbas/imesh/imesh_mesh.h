@@ -99,14 +99,21 @@ class imesh_mesh : public vbl_ref_count
   void remove_edge_graph() { half_edges_.clear(); }
 
   //: Compute vertex normals
-  void compute_vertex_normals();
+  //  The vertices are split between \p n_threads threads
+  void compute_vertex_normals(unsigned int n_threads = 1);
 
   //: Compute vertex normals using face normals
-  void compute_vertex_normals_from_faces();
+  //  The vertices are split between \p n_threads threads
+  void compute_vertex_normals_from_faces(unsigned int n_threads = 1);
 
   //: Compute face normals
-  //  If norm == false the vector lengths are twice the area of the face
-  void compute_face_normals(bool norm = true);
+  //  If norm == false the vector lengths are twice the area of the face.
+  //  The faces are split between \p n_threads threads
+  void compute_face_normals(bool norm = true, unsigned int n_threads = 1);
+
+  //: Compute the area of each face
+  //  The faces are split between \p n_threads threads
+  std::vector<double> face_areas(unsigned int n_threads = 1) const;
 
   //: This type indicates how texture coordinates are indexed
   // ON_VERT is one coordinate per vertex
@@ -5,6 +5,7 @@ DECLARE( test_intersect );
 DECLARE( test_detect );
 DECLARE( test_kd_tree );
 DECLARE( test_imls_surface );
+DECLARE( test_half_edge );
 
 void
 register_tests()
@@ -13,6 +14,7 @@ register_tests()
   REGISTER( test_detect );
   REGISTER( test_kd_tree );
   REGISTER( test_imls_surface );
+  REGISTER( test_half_edge );
 }
 
 DEFINE_MAIN;
@@ -0,0 +1,182 @@
+#include <iostream>
+#include <sstream>
+#include <map>
+#include <cmath>
+#include <testlib/testlib_test.h>
+#include <imesh/imesh_mesh.h>
+#include <imesh/imesh_fileio.h>
+#include <imesh/imesh_operations.h>
+#include "test_share.h"
+
+// half edges of the faces, built one corner at a time with a map lookup
+static std::vector<imesh_half_edge>
+reference_half_edges(const imesh_face_array_base& faces)
+{
+  std::vector<imesh_half_edge> half_edges;
+  std::map<std::pair<unsigned int,unsigned int>, unsigned int> edge_map;
+  for (unsigned int f=0; f<faces.size(); ++f) {
+    const unsigned int num_verts = faces.num_verts(f);
+    for (unsigned int i=0; i<num_verts; ++i) {
+      unsigned int v = faces(f,i), nv = faces(f,(i+1)%num_verts);
+      std::pair<unsigned int,unsigned int> vp(v<nv ? v : nv, v<nv ? nv : v);
+      if (edge_map.find(vp) == edge_map.end()) {
+        unsigned int e = half_edges.size();
+        edge_map[vp] = e;
+        half_edges.push_back(imesh_half_edge(e,imesh_invalid_idx,v,f));
+        half_edges.push_back(imesh_half_edge(e+1,imesh_invalid_idx,nv,imesh_invalid_idx));
+      }
+      else {
+        unsigned int e = edge_map[vp]+1;
+        half_edges[e] = imesh_half_edge(e,imesh_invalid_idx,v,f);
+      }
+    }
+  }
+  return half_edges;
+}
+
+static bool same_half_edges(const imesh_half_edge_set& he,
+                            const std::vector<imesh_half_edge>& ref)
+{
+  if (he.size() != ref.size())
+    return false;
+  for (unsigned int i=0; i<ref.size(); ++i)
+    if (he[i].vert_index() != ref[i].vert_index() ||
+        he[i].face_index() != ref[i].face_index() ||
+        he[i].pair_index() != ref[i].pair_index())
+      return false;
+  return true;
+}
+
+// a triangulated grid of nx by ny squares, which has a boundary
+static void make_grid(imesh_mesh& grid, unsigned int nx, unsigned int ny)
+{
+  imesh_vertex_array<3>* verts = new imesh_vertex_array<3>();
+  for (unsigned int j=0; j<=ny; ++j)
+    for (unsigned int i=0; i<=nx; ++i)
+      verts->push_back(imesh_vertex<3>(i, j, 0.1*i*j));
+  imesh_regular_face_array<3>* faces = new imesh_regular_face_array<3>();
+  for (unsigned int j=0; j<ny; ++j)
+    for (unsigned int i=0; i<nx; ++i) {
+      unsigned int v = j*(nx+1)+i;
+      faces->push_back(imesh_tri(v, v+1, v+nx+2));
+      faces->push_back(imesh_tri(v, v+nx+2, v+nx+1));
+    }
+  std::auto_ptr<imesh_vertex_array_base> vb(verts);
+  std::auto_ptr<imesh_face_array_base> fb(faces);
+  grid.set_vertices(vb);
+  grid.set_faces(fb);
+}
+
+static void test_build(const imesh_mesh& mesh, const std::string& name)
+{
+  const imesh_face_array_base& faces = mesh.faces();
+  imesh_half_edge_set he(faces);
+  TEST(("Half edges match map based build: "+name).c_str(),
+       same_half_edges(he, reference_half_edges(faces)), true);
+
+  std::vector<std::vector<unsigned int> > face_list(faces.size());
+  for (unsigned int f=0; f<faces.size(); ++f)
+    for (unsigned int i=0; i<faces.num_verts(f); ++i)
+      face_list[f].push_back(faces(f,i));
+  imesh_half_edge_set he2(face_list);
+  TEST(("Face list build matches face array build: "+name).c_str(),
+       same_half_edges(he2, reference_half_edges(faces)), true);
+
+  bool loops_ok = true;
+  for (unsigned int f=0; f<faces.size(); ++f) {
+    imesh_half_edge_set::f_const_iterator fi = he.face_begin(f), end = fi;
+    unsigned int i = 0;
+    do {
+      if (fi->face_index() != f || fi->vert_index() != faces(f,i))
+        loops_ok = false;
+      ++fi; ++i;
+    } while (fi != end && i <= faces.num_verts(f));
+    if (i != faces.num_verts(f))
+      loops_ok = false;
+  }
+  TEST(("Face loops follow the faces: "+name).c_str(), loops_ok, true);
+
+  bool boundary_ok = true;
+  for (unsigned int i=0; i<he.size(); ++i)
+    if (he[i].is_boundary() && !he[he[i].next_index()].is_boundary())
+      boundary_ok = false;
+  TEST(("Boundary loops stay on the boundary: "+name).c_str(), boundary_ok, true);
+}
+
+static void test_normals(imesh_mesh& mesh, const std::string& name)
+{
+  mesh.build_edge_graph();
+  mesh.compute_face_normals(false);
+  std::vector<vgl_vector_3d<double> > fn1 = mesh.faces().normals();
+  mesh.compute_face_normals(false, 3);
+  TEST(("Threaded face normals match: "+name).c_str(), mesh.faces().normals() == fn1, true);
+
+  mesh.compute_vertex_normals();
+  std::vector<vgl_vector_3d<double> > vn1 = mesh.vertices<3>().normals();
+  mesh.compute_vertex_normals(4);
+  TEST(("Threaded vertex normals match: "+name).c_str(), mesh.vertices<3>().normals() == vn1, true);
+
+  mesh.compute_vertex_normals_from_faces();
+  vn1 = mesh.vertices<3>().normals();
+  mesh.compute_vertex_normals_from_faces(4);
+  TEST(("Threaded vertex normals from faces match: "+name).c_str(), mesh.vertices<3>().normals() == vn1, true);
+
+  std::vector<double> a1 = mesh.face_areas(), a3 = mesh.face_areas(3);
+  TEST(("Threaded face areas match: "+name).c_str(), a1 == a3, true);
+  bool area_ok = a1.size() == fn1.size();
+  for (unsigned int f=0; f<a1.size() && area_ok; ++f)
+    area_ok = std::fabs(a1[f] - fn1[f].length()/2) < 1e-12;
+  TEST(("Face areas are half the face normal lengths: "+name).c_str(), area_ok, true);
+}
+
+static void test_half_edge()
+{
+  imesh_mesh cube, grid;
+  make_cube(cube);
+  make_grid(grid, 5, 4);
+  imesh_mesh tri_cube(cube);
+  imesh_triangulate(tri_cube);
+
+  test_build(cube, "cube");
+  test_build(tri_cube, "triangulated cube");
+  test_build(grid, "grid");
+
+  std::vector<double> areas = cube.face_areas();
+  TEST_NEAR("Cube face area", areas[0], 4.0, 1e-12);
+
+  cube.compute_vertex_normals_from_faces();
+  vgl_vector_3d<double> n0 = cube.vertices<3>().normals()[0];
+  TEST_NEAR("Cube corner normal", n0.x(), 1.0/std::sqrt(3.0), 1e-12);
+
+  test_normals(cube, "cube");
+  test_normals(tri_cube, "triangulated cube");
+  test_normals(grid, "grid");
+
+  // readers pick a regular face array for triangle and quad meshes
+  std::stringstream tri_s, quad_s, mixed_s;
+  imesh_write_ply2(tri_s, tri_cube);
+  imesh_write_ply2(quad_s, cube);
+  mixed_s << "5\n2\n0 0 0\n1 0 0\n1 1 0\n0 1 0\n2 2 0\n4 0 1 2 3\n3 1 4 2\n";
+  imesh_mesh tri_in, quad_in, mixed_in;
+  imesh_read_ply2(tri_s, tri_in);
+  imesh_read_ply2(quad_s, quad_in);
+  imesh_read_ply2(mixed_s, mixed_in);
+  TEST("PLY2 triangles are regular", tri_in.faces().regularity(), 3);
+  TEST("PLY2 quads are regular", quad_in.faces().regularity(), 4);
+  TEST("PLY2 mixed faces are not regular", mixed_in.faces().regularity(), 0);
+  TEST("PLY2 mixed face sizes", mixed_in.faces().num_verts(0) == 4 &&
+                                mixed_in.faces().num_verts(1) == 3, true);
+  TEST("PLY2 triangles read back", tri_in.faces()(5,2), tri_cube.faces()(5,2));
+
+  std::stringstream obj_s("v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+                          "g a\nf 1 2 3\ng b\nf 1 3 4\nf 2 3 4\n");
+  imesh_mesh obj_in;
+  imesh_read_obj(obj_s, obj_in);
+  TEST("OBJ triangles are regular", obj_in.faces().regularity(), 3);
+  const std::vector<std::pair<std::string,unsigned int> >& groups = obj_in.faces().groups();
+  TEST("OBJ groups", groups.size() == 2 &&
+                     groups[0].first == "a" && groups[0].second == 1 &&
+                     groups[1].first == "b" && groups[1].second == 3, true);
+}
+
+TESTMAIN(test_half_edge);
@@ -13,6 +13,7 @@
 #include <bprb/bprb_process.h>
 #include <bprb/bprb_null_process.h>
 #include <bprb/bprb_parameters.h>
+#include <vul/vul_profile.h>
 
 #include <vcl_compiler.h>
 
@@ -254,6 +255,7 @@ bool bprb_batch_process_manager::run_process()
   if (verbose_)
     std::cout << "Running process: " << current_process_->name() << std::endl;
   // EXECUTE ///////////////////////////////////////////////
+  VUL_PROFILE_SCOPE_NAMED("bprb " + current_process_->name());
   to_return = current_process_->execute();
   //////////////////////////////////////////////////////////
 
@@ -1,103 +1,117 @@
+#include <cstddef>
 #include "bapl_dense_sift.h"
 
+#include <vxl_config.h>
 #include <vil/algo/vil_orientations.h>
 #include<vcl_iomanip.h>
 
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
+
 unsigned bapl_dense_sift::keypoint_id_ = 0;
 
 bapl_dense_sift::bapl_dense_sift(
   const vil_image_resource_sptr& image,
-  unsigned octave_size, unsigned num_octaves )
+  unsigned octave_size, unsigned num_octaves, unsigned n_threads )
+ : pyramid_valid_(false)
 {
-  this->create_pyramid(image,octave_size,num_octaves);
+  this->create_pyramid(image,octave_size,num_octaves,n_threads);
 }//end bapl_dense_sift::bapl_dense_sift
 
 
 void bapl_dense_sift::create_pyramid(
   const vil_image_resource_sptr& image,
-  unsigned octave_size, unsigned num_octaves)
+  unsigned octave_size, unsigned num_octaves, unsigned n_threads)
 {
+  //reuse the last pyramid's buffers for another image of the same size,
+  //unless keypoints still refer to it.
+  bool reuse = this->pyramid_valid_ && this->pyramid_sptr_->get_references() == 1 &&
+               this->ni_ == image->ni() && this->nj_ == image->nj() &&
+               this->pyramid_sptr_->octave_size() == int(octave_size) &&
+               (num_octaves == 0 || this->pyramid_sptr_->num_octaves() == int(num_octaves));
   this->ni_ = image->ni();
   this->nj_ = image->nj();
-  //because the pyramid set is a sptr don't have to worry
-  //about delete and memory leaks, just point to the new set.
-  this->pyramid_sptr_ = new bapl_lowe_pyramid_set(image, octave_size, num_octaves);
+  if (reuse)
+  {
+    this->pyramid_sptr_->set_n_threads(n_threads);
+    this->pyramid_sptr_->set_image(image);
+  }
+  else
+  {
+    //because the pyramid set is a sptr don't have to worry
+    //about delete and memory leaks, just point to the new set.
+    this->pyramid_sptr_ = new bapl_lowe_pyramid_set(image, octave_size, num_octaves, true, n_threads);
+  }
   this->pyramid_valid_ = true;
 }
 
+void bapl_dense_sift::scale_and_orientation(double i, double j,
+                                            float& scale, float& orientation) const
+{
+  //the scale with the largest DoG response; on ties the larger scale wins.
+  float max_response = -1.0f;
+  scale = 0.0f;
+  for ( unsigned int scale_index = 0;
+        scale_index < this->octave_size()*this->num_octaves(); ++scale_index )
+  {
+    const vil_image_view<float>& current_dog = this->pyramid_sptr_->
+      dog_pyramid(scale_index / this->num_octaves(),
+                  scale_index % this->num_octaves());
+
+    //this value is used in the orientation and grad_mag images
+    //in the pyramid to recover the scale_index value which is a linear index
+    //into a 2d coordinate system, a (scale,octave).
+    //We maximize over the linear scale_index then use this value
+    //to retrieve the appropriate ancillary images.
+    float current_scale = (float)std::pow(
+      2.0f,float(scale_index)/this->octave_size()-1);
+
+    //the first level in the pyramid is an 2x upsampled version
+    //of the original image with each resulting octave, the image resolution
+    //is reduced by half. Therefore we need to divide the
+    //image coordinates by the correct power of two of the resolution.
+    float resolution = 1.0f / current_scale;
+    unsigned int ri = (unsigned int)(i*resolution);
+    unsigned int rj = (unsigned int)(j*resolution);
+
+    float response = std::fabs(current_dog(ri,rj));
+    if (response >= max_response)
+    {
+      max_response = response;
+      scale = current_scale;
+    }
+  }//end scale iteration
+
+  //actual scale is the closest image to the maximal scale available in the pyramid.
+  //Describes the resolution of the image at a given scale.
+  float actual_scale;
+  const vil_image_view<float>& orient_img =
+    this->pyramid_sptr_->grad_orient_at(scale, &actual_scale);
+
+  const vil_image_view<float>& mag_img = this->pyramid_sptr_->grad_mag_at(scale);
+
+  float key_x = float(i)/actual_scale;
+  float key_y = float(j)/actual_scale;
+
+  bapl_lowe_orientation orientor(3.0,36);//same parameters matt used.
+  std::vector<float> orientations;
+  orientor.orient_at(key_x, key_y, scale, orient_img, mag_img, orientations);
+
+  //there will be many possible orientations,
+  //normally we would make a new keypoint for each orientation but for
+  //dense sift, we will only use the first orientation.
+  orientation = orientations[0];
+}
+
 bool bapl_dense_sift::make_keypoint(bapl_lowe_keypoint_sptr& keypoint,
                                     double const& i, double const& j)
 {
   if ( this->pyramid_valid_ == true )
   {
-    std::map<float,float> scale_index_map;
-
-    for ( unsigned int scale_index = 0;
-          scale_index < this->octave_size()*this->num_octaves(); ++scale_index )
-    {
-
-      std::cout << "scale " << scale_index + 1 << " of "
-               << this->octave_size()*this->num_octaves()
-               << std::endl;
-
-      const vil_image_view<float>& current_dog = this->pyramid_sptr_->
-        dog_pyramid(scale_index / this->num_octaves(),
-                    scale_index % this->num_octaves());
-
-      std::cout << "current_dog.size() = " << current_dog.ni()
-               << ", " << current_dog.nj() << std::endl;
-
-      //this value is used in the orientation and grad_mag images
-      //in the pyramid to recover the scale_index value which is a linear index
-      //into a 2d coordinate system, a (scale,octave).
-      //We maximize over the linear scale_index then use this value
-      //to retrieve the appropriate ancillary images.
-      float current_scale = (float)std::pow(
-        2.0f,float(scale_index)/this->octave_size()-1);
-
-      //the first level in the pyramid is an 2x upsampled version
-      //of the original image with each resulting octave, the image resolution
-      //is reduced by half. Therefore we need to divide the
-      //image coordinates by the correct power of two of the resolution.
-      float resolution = 1.0f / current_scale;
-      unsigned int ri = (unsigned int)(i*resolution);
-      unsigned int rj = (unsigned int)(j*resolution);
-
-      std::cout << "current_dog size = "
-               << current_dog.ni() << ", "
-               << current_dog.nj() << std::endl;
-
-      scale_index_map[std::fabs(current_dog(ri,rj))] = current_scale;
-    }//end scale iteration
-
-    //map stores pairs from lowest to highest key.
-    //The maximal scale/index pair should be the last element of the map
-    std::map<float,float>::reverse_iterator maximal_scale_map_itr =
-      scale_index_map.rbegin();
-
-    //actual scale is the closest image to the maximal scale available in the pyramid.
-    //Describes the resolution of the image at a given scale.
-    float actual_scale;
-    const vil_image_view<float>& orient_img =
-      this->pyramid_sptr_->grad_orient_at(
-        maximal_scale_map_itr->second, &actual_scale);
-
-    const vil_image_view<float>& mag_img = this->pyramid_sptr_->
-      grad_mag_at(maximal_scale_map_itr->second);
-
-    float key_x = float(i)/actual_scale;
-    float key_y = float(j)/actual_scale;
-
-    bapl_lowe_orientation orientor(3.0,36);//same parameters matt used.
-    std::vector<float> orientations;
-    orientor.orient_at(key_x, key_y, maximal_scale_map_itr->second,
-                       orient_img, mag_img, orientations);
-
-    //there will be many possible orientations,
-    //normally we would make a new keypoint for each orientation but for
-    //dense sift, we will only use the first orientation.
-    keypoint = bapl_lowe_keypoint_new(this->pyramid_sptr_, i, j,
-      maximal_scale_map_itr->second, orientations[0]);
+    float scale, orientation;
+    this->scale_and_orientation(i, j, scale, orientation);
+    keypoint = bapl_lowe_keypoint_new(this->pyramid_sptr_, i, j, scale, orientation);
 
     keypoint->set_id(bapl_dense_sift::keypoint_id_);
     ++bapl_dense_sift::keypoint_id_;
@@ -110,34 +124,108 @@ bool bapl_dense_sift::make_keypoint(bapl_lowe_keypoint_sptr& keypoint,
   }
 }//end bapl_dense_sift::make_keypoint
 
-bool bapl_dense_sift::make_keypoints( std::vector<bapl_lowe_keypoint_sptr>& keypoints, std::vector<vgl_point_2d<unsigned> > const& pts)
+//: A share of a batch of keypoints.
+struct bapl_dense_sift_job
+{
+  bapl_dense_sift* sift;
+  std::vector<std::pair<double,double> > const* locs;
+  bapl_lowe_keypoint_sptr* keypoints;
+  unsigned begin, end;
+
+  void run()
+  {
+    for (unsigned k=begin; k<end; ++k)
+    {
+      const double i = (*locs)[k].first, j = (*locs)[k].second;
+      float scale, orientation;
+      sift->scale_and_orientation(i, j, scale, orientation);
+      keypoints[k] = bapl_lowe_keypoint_new(sift->pyramid_sptr_, i, j, scale, orientation);
+    }
+  }
+
+  static void* run_thread(void* job)
+  {
+    static_cast<bapl_dense_sift_job*>(job)->run();
+    return VXL_NULLPTR;
+  }
+};
+
+bool bapl_dense_sift::make_keypoints_at(std::vector<bapl_lowe_keypoint_sptr>& keypoints,
+                                        std::vector<std::pair<double,double> > const& locs,
+                                        unsigned n_threads)
+{
+  if ( this->pyramid_valid_ != true )
+  {
+    std::cerr << "ERROR: bapl_dense_sift::make_keypoints_at, pyramid is not valid\n";
+    return false;
+  }
+  const unsigned n = unsigned(locs.size());
+  const unsigned n_before = unsigned(keypoints.size());
+  keypoints.resize(n_before + n);
+  if (n==0) return true;
+#if !VXL_HAS_PTHREAD_H
+  n_threads = 1;
+#endif
+  if (n_threads<1) n_threads = 1;
+  if (n_threads>n) n_threads = n;
+
+  std::vector<bapl_dense_sift_job> jobs(n_threads);
+  for (unsigned t=0; t<n_threads; ++t)
+  {
+    jobs[t].sift = this;
+    jobs[t].locs = &locs;
+    jobs[t].keypoints = &keypoints[n_before];
+    jobs[t].begin = unsigned(std::size_t(t)*n/n_threads);
+    jobs[t].end = unsigned(std::size_t(t+1)*n/n_threads);
+  }
+#if VXL_HAS_PTHREAD_H
+  std::vector<pthread_t> threads(n_threads);
+  std::vector<bool> started(n_threads, false);
+  for (unsigned t=1; t<n_threads; ++t)
+    started[t] = pthread_create(&threads[t], VXL_NULLPTR,
+                                &bapl_dense_sift_job::run_thread, &jobs[t])==0;
+  jobs[0].run();
+  for (unsigned t=1; t<n_threads; ++t)
+  {
+    if (started[t]) pthread_join(threads[t], VXL_NULLPTR);
+    else            jobs[t].run(); // Couldn't start thread - do it here
+  }
+#else
+  jobs[0].run();
+#endif
+
+  //number the keypoints in order, as if made one at a time
+  for (unsigned k=n_before; k<keypoints.size(); ++k)
+  {
+    keypoints[k]->set_id(bapl_dense_sift::keypoint_id_);
+    ++bapl_dense_sift::keypoint_id_;
+  }
+  return true;
+}
+
+bool bapl_dense_sift::make_keypoints( std::vector<bapl_lowe_keypoint_sptr>& keypoints, std::vector<vgl_point_2d<unsigned> > const& pts,
+                                      unsigned n_threads)
 {
+  std::vector<std::pair<double,double> > locs;
   std::vector<vgl_point_2d<unsigned> >::const_iterator target_itr,target_end;
   target_end = pts.end();
 
   for (target_itr = pts.begin(); target_itr != target_end; ++target_itr)
-  {
-    bapl_lowe_keypoint_sptr keypoint;
-    if (!this->make_keypoint( keypoint, target_itr->x(), target_itr->y() ))
-      return false;
-    keypoints.push_back(keypoint);
-  }//end target iteration
-  return true;
+    locs.push_back(std::make_pair(double(target_itr->x()), double(target_itr->y())));
+
+  return this->make_keypoints_at(keypoints, locs, n_threads);
 }//end bapl_dense_sift::make_keypoints
 
-bool bapl_dense_sift::make_dense_keypoints(std::vector<bapl_lowe_keypoint_sptr>& keypoints, unsigned const istep, unsigned const jstep)
+bool bapl_dense_sift::make_dense_keypoints(std::vector<bapl_lowe_keypoint_sptr>& keypoints, unsigned const istep, unsigned const jstep,
+                                           unsigned n_threads)
 {
   //the original image resolution is on the second level of the pyramid.
+  std::vector<std::pair<double,double> > locs;
   for (unsigned i = 0; i < this->ni_; i+=istep)
     for (unsigned j = 0; j < this->nj_; j+=jstep)
-    {
-      bapl_lowe_keypoint_sptr keypoint;
-      if (!this->make_keypoint(keypoint,i,j))
-        return false;
-      keypoints.push_back(keypoint);
-    }
+      locs.push_back(std::make_pair(double(i), double(j)));
 
-  return true;
+  return this->make_keypoints_at(keypoints, locs, n_threads);
 }//end bapl_dense_sift::make_keypoints
 
 bool bapl_dense_sift::make_keypoints(std::vector<bapl_lowe_keypoint_sptr>& keypoints)
@@ -15,6 +15,7 @@
 #include <cmath>
 #include <map>
 #include <vector>
+#include <utility>
 #include <bapl/bapl_keypoint_extractor.h>
 #include <bapl/bapl_keypoint_sptr.h>
 #include <bapl/bapl_lowe_pyramid_set.h>
@@ -36,11 +37,16 @@ class bapl_dense_sift:public vbl_ref_count
 
   bapl_dense_sift(const vil_image_resource_sptr& image,
                   unsigned octave_size = 6,
-                  unsigned num_octaves = 1 );
+                  unsigned num_octaves = 1,
+                  unsigned n_threads = 1 );
 
   ~bapl_dense_sift() {}
 
-  void create_pyramid(const vil_image_resource_sptr& image, unsigned octave_size = 6, unsigned num_octaves = 1);
+  //: Build the pyramids of image, on n_threads threads.
+  //  If the last pyramid had the same size and octaves, and no keypoint
+  //  refers to it, its buffers are reused.
+  void create_pyramid(const vil_image_resource_sptr& image, unsigned octave_size = 6, unsigned num_octaves = 1,
+                      unsigned n_threads = 1);
 
   //output := keypoint
   //parameters := (sub)pixel location (i,j)
@@ -48,11 +54,15 @@ class bapl_dense_sift:public vbl_ref_count
 
   //output := keypoints
   //parameters := istep,jstep
-  bool make_dense_keypoints(std::vector<bapl_lowe_keypoint_sptr>& keypoints, unsigned const istep = 1, unsigned const jstep = 1 );
+  //The keypoints are shared between n_threads threads.
+  bool make_dense_keypoints(std::vector<bapl_lowe_keypoint_sptr>& keypoints, unsigned const istep = 1, unsigned const jstep = 1,
+                            unsigned n_threads = 1 );
 
   //output := keypoints
   //parameters := target image locations (vgl_point_2d<unsigned> > pts)
-  bool make_keypoints( std::vector<bapl_lowe_keypoint_sptr>& keypoints, std::vector<vgl_point_2d<unsigned> > const& pts );
+  //The keypoints are shared between n_threads threads.
+  bool make_keypoints( std::vector<bapl_lowe_keypoint_sptr>& keypoints, std::vector<vgl_point_2d<unsigned> > const& pts,
+                       unsigned n_threads = 1 );
 
   //input := vector of keypoints with locations specified in the keypoint
   //output := the modified keypoints
@@ -69,6 +79,16 @@ class bapl_dense_sift:public vbl_ref_count
   unsigned num_octaves() const {return this->pyramid_sptr_->octave_size();}
 
  private:
+  //: Scale of the strongest DoG response at (i,j), and the main gradient orientation there.
+  void scale_and_orientation( double i, double j, float& scale, float& orientation ) const;
+
+  //: Append keypoints at locs, computed on n_threads threads, numbered in order.
+  bool make_keypoints_at( std::vector<bapl_lowe_keypoint_sptr>& keypoints,
+                          std::vector<std::pair<double,double> > const& locs,
+                          unsigned n_threads );
+
+  friend struct bapl_dense_sift_job;
+
   bapl_lowe_pyramid_set_sptr pyramid_sptr_;
   unsigned ni_;
   unsigned nj_;
@@ -0,0 +1,380 @@
+// This is brl/bseg/bapl/bapl_kd_forest.cxx
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include "bapl_kd_forest.h"
+//:
+// \file
+
+#include <vcl_cassert.h>
+#include <vxl_config.h>
+#include <vil/vil_config.h> // for VXL_HAS_SSE2_HARDWARE_SUPPORT
+#include <vnl/vnl_random.h>
+#include <vnl/vnl_vector_fixed.h>
+#include <bapl/bapl_keypoint.h>
+
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
+
+#ifdef VXL_HAS_SSE2_HARDWARE_SUPPORT
+# include <emmintrin.h>
+#endif
+
+// Number of descriptors used to estimate the variances when splitting a node.
+static const unsigned bapl_kd_forest_n_sample = 100;
+
+// Number of highest variance dimensions from which the split is chosen.
+static const unsigned bapl_kd_forest_n_top = 5;
+
+const unsigned bapl_kd_forest::dim;
+const unsigned bapl_kd_forest::no_match;
+
+//: True for descriptors whose component d is below split.
+struct bapl_kd_forest_below
+{
+  const float* data;
+  unsigned d;
+  float split;
+  bool operator()(unsigned i) const { return data[i*bapl_kd_forest::dim+d] < split; }
+};
+
+//: Orders descriptors by component d.
+struct bapl_kd_forest_less
+{
+  const float* data;
+  unsigned d;
+  bool operator()(unsigned i, unsigned j) const
+  { return data[i*bapl_kd_forest::dim+d] < data[j*bapl_kd_forest::dim+d]; }
+};
+
+bapl_kd_forest::bapl_kd_forest()
+{
+}
+
+bapl_kd_forest::bapl_kd_forest(std::vector<float> const& descriptors,
+                               unsigned n_trees, unsigned points_per_leaf,
+                               unsigned seed)
+{
+  build(descriptors, n_trees, points_per_leaf, seed);
+}
+
+bapl_kd_forest::bapl_kd_forest(std::vector<bapl_keypoint_sptr> const& keypoints,
+                               unsigned n_trees, unsigned points_per_leaf,
+                               unsigned seed)
+{
+  std::vector<float> descriptors;
+  descriptor_matrix(keypoints, descriptors);
+  build(descriptors, n_trees, points_per_leaf, seed);
+}
+
+void bapl_kd_forest::descriptor_matrix(std::vector<bapl_keypoint_sptr> const& keypoints,
+                                       std::vector<float>& descriptors)
+{
+  descriptors.resize(keypoints.size()*dim);
+  for (unsigned i=0; i<keypoints.size(); ++i)
+  {
+    vnl_vector_fixed<double,128> const& d = keypoints[i]->descriptor();
+    for (unsigned k=0; k<dim; ++k)
+      descriptors[i*dim+k] = float(d[k]);
+  }
+}
+
+void bapl_kd_forest::build(std::vector<float> const& descriptors,
+                           unsigned n_trees, unsigned points_per_leaf,
+                           unsigned seed)
+{
+  assert(descriptors.size()%dim == 0);
+  data_ = descriptors;
+  nodes_.clear();
+  roots_.clear();
+  leaf_index_.clear();
+
+  const unsigned n = size();
+  if (n==0) return;
+  if (n_trees<1) n_trees = 1;
+  if (points_per_leaf<1) points_per_leaf = 1;
+
+  vnl_random rng(seed);
+  leaf_index_.resize(std::size_t(n_trees)*n);
+  for (unsigned t=0; t<n_trees; ++t)
+  {
+    for (unsigned i=0; i<n; ++i)
+      leaf_index_[t*n+i] = i;
+    roots_.push_back(build_node(t*n, (t+1)*n, points_per_leaf, rng));
+  }
+}
+
+unsigned bapl_kd_forest::build_node(unsigned begin, unsigned end,
+                                    unsigned points_per_leaf, vnl_random& rng)
+{
+  const unsigned index = unsigned(nodes_.size());
+  nodes_.push_back(node());
+  const unsigned n = end-begin;
+
+  if (n > points_per_leaf)
+  {
+    // Estimate the mean and variance of each component from a few descriptors
+    const unsigned n_sample = std::min(n, bapl_kd_forest_n_sample);
+    double mean[dim], var[dim];
+    std::fill(mean, mean+dim, 0.0);
+    std::fill(var, var+dim, 0.0);
+    for (unsigned s=0; s<n_sample; ++s)
+    {
+      const float* d = descriptor(leaf_index_[begin+s]);
+      for (unsigned k=0; k<dim; ++k)
+      {
+        mean[k] += d[k];
+        var[k] += double(d[k])*d[k];
+      }
+    }
+    for (unsigned k=0; k<dim; ++k)
+    {
+      mean[k] /= n_sample;
+      var[k] = var[k]/n_sample - mean[k]*mean[k];
+    }
+
+    // The components of highest (non-zero) variance, highest first
+    unsigned top[bapl_kd_forest_n_top];
+    unsigned n_top = 0;
+    for (unsigned k=0; k<dim; ++k)
+    {
+      if (var[k] <= 0.0) continue;
+      unsigned j = n_top<bapl_kd_forest_n_top ? n_top++ : n_top;
+      for (; j>0 && var[top[j-1]]<var[k]; --j)
+        if (j<bapl_kd_forest_n_top) top[j] = top[j-1];
+      if (j<bapl_kd_forest_n_top) top[j] = k;
+    }
+
+    if (n_top>0)
+    {
+      const unsigned split_dim = top[rng.lrand32(0, n_top-1)];
+      float split = float(mean[split_dim]);
+      unsigned* first = &leaf_index_[begin];
+      unsigned* last = first+n;
+      bapl_kd_forest_below below = { &data_[0], split_dim, split };
+      unsigned* mid = std::partition(first, last, below);
+      if (mid==first || mid==last)
+      {
+        // The sample mean missed the spread of the node - split at the median
+        mid = first+n/2;
+        bapl_kd_forest_less less = { &data_[0], split_dim };
+        std::nth_element(first, mid, last, less);
+        split = descriptor(*mid)[split_dim];
+      }
+      const unsigned m = begin + unsigned(mid-first);
+      const unsigned left = build_node(begin, m, points_per_leaf, rng);
+      const unsigned right = build_node(m, end, points_per_leaf, rng);
+      // nodes_ may have been reallocated by the recursion
+      node& nd = nodes_[index];
+      nd.split_dim = int(split_dim);
+      nd.split = split;
+      nd.first = left;
+      nd.second = right;
+      return index;
+    }
+  }
+
+  // Small, or all the descriptors are the same: make a leaf
+  node& nd = nodes_[index];
+  nd.split_dim = -1;
+  nd.split = 0.0f;
+  nd.first = begin;
+  nd.second = n;
+  return index;
+}
+
+float bapl_kd_forest::dist_sq(const float* a, const float* b)
+{
+  // Both versions sum the components in the same order, so give the same result.
+#ifdef VXL_HAS_SSE2_HARDWARE_SUPPORT
+  __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+  for (unsigned i=0; i<dim; i+=8)
+  {
+    __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a+i), _mm_loadu_ps(b+i));
+    __m128 d1 = _mm_sub_ps(_mm_loadu_ps(a+i+4), _mm_loadu_ps(b+i+4));
+    s0 = _mm_add_ps(s0, _mm_mul_ps(d0, d0));
+    s1 = _mm_add_ps(s1, _mm_mul_ps(d1, d1));
+  }
+  float s[4];
+  _mm_storeu_ps(s, _mm_add_ps(s0, s1));
+  return (s[0]+s[1]) + (s[2]+s[3]);
+#else
+  float s[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+  for (unsigned i=0; i<dim; i+=8)
+    for (unsigned k=0; k<8; ++k)
+    {
+      float d = a[i+k]-b[i+k];
+      s[k] += d*d;
+    }
+  return ((s[0]+s[4])+(s[1]+s[5])) + ((s[2]+s[6])+(s[3]+s[7]));
+#endif
+}
+
+//: Insert neighbour i at square distance d into the sorted list of the n best.
+static inline void bapl_kd_forest_insert(unsigned i, float d, unsigned n,
+                                         unsigned* indices, float* dists_sq,
+                                         unsigned& found)
+{
+  if (found==n && d>=dists_sq[n-1]) return;
+  // A descriptor may be reached through several trees
+  for (unsigned k=0; k<found; ++k)
+    if (indices[k]==i) return;
+  if (found<n) ++found;
+  unsigned k = found-1;
+  for (; k>0 && dists_sq[k-1]>d; --k)
+  {
+    indices[k] = indices[k-1];
+    dists_sq[k] = dists_sq[k-1];
+  }
+  indices[k] = i;
+  dists_sq[k] = d;
+}
+
+unsigned bapl_kd_forest::search(const float* query, unsigned n,
+                                unsigned* indices, float* dists_sq,
+                                unsigned max_checks,
+                                std::vector<std::pair<float,unsigned> >& heap) const
+{
+  for (unsigned k=0; k<n; ++k)
+  {
+    indices[k] = no_match;
+    dists_sq[k] = std::numeric_limits<float>::max();
+  }
+  if (n==0 || roots_.empty()) return 0;
+
+  // A min-heap of branches, keyed on a lower bound of their square distance
+  std::greater<std::pair<float,unsigned> > further;
+  heap.clear();
+  for (unsigned t=0; t<roots_.size(); ++t)
+    heap.push_back(std::make_pair(0.0f, roots_[t]));
+  std::make_heap(heap.begin(), heap.end(), further);
+
+  unsigned found = 0, checks = 0;
+  while (!heap.empty())
+  {
+    std::pop_heap(heap.begin(), heap.end(), further);
+    const float bound = heap.back().first;
+    unsigned ni = heap.back().second;
+    heap.pop_back();
+    if (found==n && bound>=dists_sq[n-1]) break;
+    if (max_checks>0 && checks>=max_checks) break;
+
+    // Descend to a leaf, queueing the branches not taken
+    while (nodes_[ni].split_dim>=0)
+    {
+      node const& nd = nodes_[ni];
+      const float diff = query[nd.split_dim] - nd.split;
+      const float far_bound = std::max(bound, diff*diff);
+      if (found<n || far_bound<dists_sq[n-1])
+      {
+        heap.push_back(std::make_pair(far_bound, diff<0 ? nd.second : nd.first));
+        std::push_heap(heap.begin(), heap.end(), further);
+      }
+      ni = diff<0 ? nd.first : nd.second;
+    }
+
+    node const& leaf = nodes_[ni];
+    for (unsigned k=leaf.first; k<leaf.first+leaf.second; ++k)
+    {
+      const unsigned i = leaf_index_[k];
+      bapl_kd_forest_insert(i, dist_sq(query, descriptor(i)), n, indices, dists_sq, found);
+    }
+    checks += leaf.second;
+  }
+  return found;
+}
+
+unsigned bapl_kd_forest::n_nearest(const float* query, unsigned n,
+                                   unsigned* indices, float* dists_sq,
+                                   unsigned max_checks) const
+{
+  std::vector<std::pair<float,unsigned> > heap;
+  return search(query, n, indices, dists_sq, max_checks, heap);
+}
+
+//: A share of a batch of queries.
+struct bapl_kd_forest_job
+{
+  bapl_kd_forest const* forest;
+  const float* queries;
+  unsigned begin, end;
+  unsigned n;
+  unsigned max_checks;
+  unsigned* indices;
+  float* dists_sq;
+
+  void run()
+  {
+    std::vector<std::pair<float,unsigned> > heap;
+    for (unsigned q=begin; q<end; ++q)
+      forest->search(queries + std::size_t(q)*bapl_kd_forest::dim, n,
+                     indices + std::size_t(q)*n, dists_sq + std::size_t(q)*n,
+                     max_checks, heap);
+  }
+
+  static void* run_thread(void* job)
+  {
+    static_cast<bapl_kd_forest_job*>(job)->run();
+    return VXL_NULLPTR;
+  }
+};
+
+void bapl_kd_forest::n_nearest(std::vector<float> const& queries, unsigned n,
+                               std::vector<unsigned>& indices,
+                               std::vector<float>& dists_sq,
+                               unsigned max_checks, unsigned n_threads) const
+{
+  assert(queries.size()%dim == 0);
+  const unsigned n_queries = unsigned(queries.size()/dim);
+  indices.resize(std::size_t(n_queries)*n);
+  dists_sq.resize(std::size_t(n_queries)*n);
+  if (n_queries==0 || n==0) return;
+#if !VXL_HAS_PTHREAD_H
+  n_threads = 1;
+#endif
+  if (n_threads<1) n_threads = 1;
+  if (n_threads>n_queries) n_threads = n_queries;
+
+  bapl_kd_forest_job proto;
+  proto.forest = this;
+  proto.queries = &queries[0];
+  proto.n = n;
+  proto.max_checks = max_checks;
+  proto.indices = &indices[0];
+  proto.dists_sq = &dists_sq[0];
+  std::vector<bapl_kd_forest_job> jobs(n_threads, proto);
+  for (unsigned t=0; t<n_threads; ++t)
+  {
+    jobs[t].begin = unsigned(std::size_t(t)*n_queries/n_threads);
+    jobs[t].end = unsigned(std::size_t(t+1)*n_queries/n_threads);
+  }
+#if VXL_HAS_PTHREAD_H
+  std::vector<pthread_t> threads(n_threads);
+  std::vector<bool> started(n_threads, false);
+  for (unsigned t=1; t<n_threads; ++t)
+    started[t] = pthread_create(&threads[t], VXL_NULLPTR,
+                                &bapl_kd_forest_job::run_thread, &jobs[t])==0;
+  jobs[0].run();
+  for (unsigned t=1; t<n_threads; ++t)
+  {
+    if (started[t]) pthread_join(threads[t], VXL_NULLPTR);
+    else            jobs[t].run(); // Couldn't start thread - do it here
+  }
+#else
+  jobs[0].run();
+#endif
+}
+
+void bapl_kd_forest::match_ratio(std::vector<float> const& queries, float ratio,
+                                 std::vector<std::pair<unsigned,unsigned> >& matches,
+                                 unsigned max_checks, unsigned n_threads) const
+{
+  std::vector<unsigned> indices;
+  std::vector<float> dists_sq;
+  n_nearest(queries, 2, indices, dists_sq, max_checks, n_threads);
+  const float ratio_sq = ratio*ratio;
+  for (unsigned q=0; 2*q<indices.size(); ++q)
+    if (indices[2*q+1]!=no_match && dists_sq[2*q] < ratio_sq*dists_sq[2*q+1])
+      matches.push_back(std::make_pair(q, indices[2*q]));
+}
@@ -0,0 +1,142 @@
+// This is brl/bseg/bapl/bapl_kd_forest.h
+#ifndef bapl_kd_forest_h_
+#define bapl_kd_forest_h_
+//:
+// \file
+// \brief Randomised k-d forest over a contiguous matrix of 128-d descriptors
+//
+// bapl_bbf_tree stores a smart pointer per keypoint and a pair of
+// 128-d bounding boxes per node, and answers one query at a time.  This
+// forest keeps the descriptors as one row-major matrix of floats, and the
+// nodes of all its trees in a single array.  Each tree splits on a
+// dimension chosen at random among those of highest variance, so the trees
+// partition the descriptors differently; a search descends all the trees
+// and then visits the remaining branches of every tree in order of their
+// distance from the query, from one priority queue.
+//
+// Searches limited to max_checks distance evaluations are approximate;
+// with max_checks = 0 the search is exact.  Searches do not modify the
+// forest, so any number of threads may search it at once; the batched
+// searches share their queries between n_threads threads, if threads are
+// available.
+//
+// A typical use, matching the keypoints of one image against another:
+// \code
+//   std::vector<float> desc1, desc2;
+//   bapl_kd_forest::descriptor_matrix(keypoints1, desc1);
+//   bapl_kd_forest::descriptor_matrix(keypoints2, desc2);
+//   bapl_kd_forest forest(desc2);
+//   std::vector<std::pair<unsigned,unsigned> > matches;
+//   forest.match_ratio(desc1, 0.6f, matches, 200, 4);
+// \endcode
+
+#include <vector>
+#include <utility>
+#include <vcl_compiler.h>
+#include <bapl/bapl_keypoint_sptr.h>
+
+class vnl_random;
+
+class bapl_kd_forest
+{
+ public:
+  //: Length of the descriptors.
+  static const unsigned dim = 128;
+
+  //: Index returned for neighbours which were not found.
+  static const unsigned no_match = static_cast<unsigned>(-1);
+
+  //: A node of one of the trees.
+  // Internal nodes (split_dim >= 0) have children first and second;
+  // leaves hold the descriptors leaf_index_[first] to leaf_index_[first+second-1].
+  struct node
+  {
+    int split_dim;
+    float split;
+    unsigned first;
+    unsigned second;
+  };
+
+  //: Construct an empty forest.
+  bapl_kd_forest();
+
+  //: Construct from descriptors stored row by row, dim floats per descriptor.
+  explicit bapl_kd_forest(std::vector<float> const& descriptors,
+                          unsigned n_trees = 4, unsigned points_per_leaf = 8,
+                          unsigned seed = 9667566);
+
+  //: Construct from the descriptors of keypoints.
+  explicit bapl_kd_forest(std::vector<bapl_keypoint_sptr> const& keypoints,
+                          unsigned n_trees = 4, unsigned points_per_leaf = 8,
+                          unsigned seed = 9667566);
+
+  //: Copy the descriptors of keypoints into a matrix of floats, one row per keypoint.
+  static void descriptor_matrix(std::vector<bapl_keypoint_sptr> const& keypoints,
+                                std::vector<float>& descriptors);
+
+  //: Replace the contents by new descriptors, stored row by row.
+  void build(std::vector<float> const& descriptors,
+             unsigned n_trees = 4, unsigned points_per_leaf = 8,
+             unsigned seed = 9667566);
+
+  //: Number of descriptors.
+  unsigned size() const { return unsigned(data_.size()/dim); }
+
+  //: Number of trees.
+  unsigned n_trees() const { return unsigned(roots_.size()); }
+
+  //: Descriptor i.
+  const float* descriptor(unsigned i) const { return &data_[i*dim]; }
+
+  //: Square distance between two descriptors.
+  static float dist_sq(const float* a, const float* b);
+
+  //: Find the n nearest descriptors to query.
+  // On exit indices[0..n-1] hold the neighbours, nearest first, and
+  // dists_sq their square distances; neighbours not found are no_match.
+  // At most max_checks distances are computed (0 means no limit, and an
+  // exact search).  Returns the number of neighbours found.
+  unsigned n_nearest(const float* query, unsigned n,
+                     unsigned* indices, float* dists_sq,
+                     unsigned max_checks = 0) const;
+
+  //: Find the n nearest descriptors to each of a matrix of queries.
+  // On exit indices[q*n+i] and dists_sq[q*n+i] describe the i-th
+  // neighbour of query q, as for the single query.
+  void n_nearest(std::vector<float> const& queries, unsigned n,
+                 std::vector<unsigned>& indices, std::vector<float>& dists_sq,
+                 unsigned max_checks = 0, unsigned n_threads = 1) const;
+
+  //: Match each of a matrix of queries by the ratio test.
+  // Query q is matched to its nearest descriptor d when that is closer than
+  // ratio times the distance to the second nearest.  The (q,d) pairs are
+  // appended to matches in order of q.
+  void match_ratio(std::vector<float> const& queries, float ratio,
+                   std::vector<std::pair<unsigned,unsigned> >& matches,
+                   unsigned max_checks = 200, unsigned n_threads = 1) const;
+
+ private:
+  //: Build a tree over leaf_index_[begin,end) and return its root node.
+  unsigned build_node(unsigned begin, unsigned end, unsigned points_per_leaf,
+                      vnl_random& rng);
+
+  //: Search for the n nearest descriptors, using heap as the priority queue.
+  unsigned search(const float* query, unsigned n, unsigned* indices, float* dists_sq,
+                  unsigned max_checks, std::vector<std::pair<float,unsigned> >& heap) const;
+
+  friend struct bapl_kd_forest_job;
+
+  //: Descriptors, row by row.
+  std::vector<float> data_;
+
+  //: Nodes of all the trees.
+  std::vector<node> nodes_;
+
+  //: Root node of each tree.
+  std::vector<unsigned> roots_;
+
+  //: Descriptor indices in leaf order, one permutation per tree.
+  std::vector<unsigned> leaf_index_;
+};
+
+#endif // bapl_kd_forest_h_
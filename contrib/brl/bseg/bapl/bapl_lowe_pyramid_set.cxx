@@ -5,33 +5,236 @@
 #include <iostream>
 #include <cmath>
 #include <sstream>
+#include <cstddef>
 #include "bapl_lowe_pyramid_set.h"
 #include <vcl_compiler.h>
+#include <vxl_config.h>
 #include <vnl/vnl_math.h>
+#include <vil/vil_config.h> // for VXL_HAS_SSE2_HARDWARE_SUPPORT
 #include <vil/vil_convert.h>
 #include <vil/vil_resample_bilin.h>
 #include <vil/vil_math.h>
 #include <vil/vil_decimate.h>
-#include <vil/algo/vil_orientations.h>
-#include <brip/brip_vil_ops.h>
+#include <vil/vil_crop.h>
+#include <vil/vil_transpose.h>
+#include <vil/algo/vil_convolve_1d.h>
 #include <bapl/bapl_lowe_keypoint.h>
 
 #include <vil/vil_copy.h>
 #include <vcl_cassert.h>
 
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
+
+#ifdef VXL_HAS_SSE2_HARDWARE_SUPPORT
+# include <emmintrin.h>
+#endif
+
+//: Sobel gradient orientation and magnitude of rows [j0,j1) of src, in one pass.
+//  Gives the same values as vil_orientations_from_sobel(), without the
+//  intermediate gradient images.
+static void bapl_lowe_pyramid_set_gradients(const vil_image_view<float>& src,
+                               vil_image_view<float>& orient,
+                               vil_image_view<float>& mag,
+                               unsigned j0, unsigned j1)
+{
+  const unsigned ni = src.ni(), nj = src.nj();
+  const std::ptrdiff_t s_istep = src.istep(), s_jstep = src.jstep();
+  const std::ptrdiff_t o_istep = orient.istep(), m_istep = mag.istep();
+  const float k125 = 0.125f, k25 = 0.25f;
+  for (unsigned j=j0; j<j1; ++j)
+  {
+    float* po = &orient(0,j);
+    float* pm = &mag(0,j);
+    if (j==0 || j+1>=nj || ni<3)
+    {
+      // Sobel leaves the border at zero
+      for (unsigned i=0; i<ni; ++i, po+=o_istep, pm+=m_istep)
+        *po = *pm = 0.0f;
+      continue;
+    }
+    // rows below, at and above j, offset to column 1
+    const float* r0 = src.top_left_ptr() + (j-1)*s_jstep + s_istep;
+    const float* r1 = r0 + s_jstep;
+    const float* r2 = r1 + s_jstep;
+    po[0] = pm[0] = 0.0f;
+    po += o_istep;
+    pm += m_istep;
+    unsigned i = 1;
+#ifdef VXL_HAS_SSE2_HARDWARE_SUPPORT
+    if (s_istep==1 && o_istep==1 && m_istep==1)
+    {
+      const __m128 c125 = _mm_set1_ps(k125), c25 = _mm_set1_ps(k25);
+      float gi[4], gj[4];
+      for (; i+4<ni; i+=4, r0+=4, r1+=4, r2+=4, po+=4, pm+=4)
+      {
+        const __m128 a0 = _mm_loadu_ps(r0-1), b0 = _mm_loadu_ps(r0), c0 = _mm_loadu_ps(r0+1);
+        const __m128 a1 = _mm_loadu_ps(r1-1), c1 = _mm_loadu_ps(r1+1);
+        const __m128 a2 = _mm_loadu_ps(r2-1), b2 = _mm_loadu_ps(r2), c2 = _mm_loadu_ps(r2+1);
+        const __m128 vgi = _mm_add_ps(
+          _mm_mul_ps(c125, _mm_sub_ps(_mm_add_ps(c2,c0), _mm_add_ps(a2,a0))),
+          _mm_mul_ps(c25, _mm_sub_ps(c1,a1)));
+        const __m128 vgj = _mm_add_ps(
+          _mm_mul_ps(c125, _mm_sub_ps(_mm_add_ps(a2,c2), _mm_add_ps(a0,c0))),
+          _mm_mul_ps(c25, _mm_sub_ps(b2,b0)));
+        _mm_storeu_ps(gi, vgi);
+        _mm_storeu_ps(gj, vgj);
+        _mm_storeu_ps(pm, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(vgi,vgi), _mm_mul_ps(vgj,vgj))));
+        for (unsigned k=0; k<4; ++k)
+          po[k] = std::atan2(gj[k], gi[k]);
+      }
+    }
+#endif
+    for (; i+1<ni; ++i, r0+=s_istep, r1+=s_istep, r2+=s_istep, po+=o_istep, pm+=m_istep)
+    {
+      const float gi = k125*(r2[s_istep]+r0[s_istep] - (r2[-s_istep]+r0[-s_istep]))
+                     + k25*(r1[s_istep]-r1[-s_istep]);
+      const float gj = k125*(r2[-s_istep]+r2[s_istep] - (r0[-s_istep]+r0[s_istep]))
+                     + k25*(r2[0]-r0[0]);
+      *po = std::atan2(gj, gi);
+      *pm = std::sqrt(gi*gi + gj*gj);
+    }
+    *po = *pm = 0.0f;
+  }
+}
+
+//: A share of the rows of one pyramid computation.
+struct bapl_lowe_pyramid_set_job
+{
+  enum kind_t { CONVOLVE, GRADIENT };
+
+  kind_t kind;
+  const vil_image_view<float>* src;
+  vil_image_view<float>* dest;
+  vil_image_view<float>* dest2;
+  const double* kernel;
+  int k_size;
+  unsigned begin, end;
+
+  void run()
+  {
+    if (kind==GRADIENT)
+    {
+      bapl_lowe_pyramid_set_gradients(*src, *dest, *dest2, begin, end);
+      return;
+    }
+    // rows are convolved independently, so each band gives the same
+    // result as convolving the whole image
+    vil_image_view<float> band_src = vil_crop(*src, 0, src->ni(), begin, end-begin);
+    vil_image_view<float> band_dest = vil_crop(*dest, 0, dest->ni(), begin, end-begin);
+    vil_convolve_1d(band_src, band_dest, kernel+k_size/2,
+                    -k_size/2, (k_size-1)/2,
+                    float(0), vil_convolve_constant_extend, vil_convolve_constant_extend);
+  }
+
+  static void* run_thread(void* job)
+  {
+    static_cast<bapl_lowe_pyramid_set_job*>(job)->run();
+    return VXL_NULLPTR;
+  }
+};
+
+//: Share the rows [0,n) of proto between up to n_threads threads.
+static void bapl_lowe_pyramid_set_run(bapl_lowe_pyramid_set_job const& proto,
+                                      unsigned n, unsigned n_threads)
+{
+  if (n==0) return;
+#if !VXL_HAS_PTHREAD_H
+  n_threads = 1;
+#endif
+  // Not worth starting a thread for fewer than 32 rows
+  if (n_threads>n/32) n_threads = n/32;
+  if (n_threads<1) n_threads = 1;
+
+  std::vector<bapl_lowe_pyramid_set_job> jobs(n_threads, proto);
+  for (unsigned t=0; t<n_threads; ++t)
+  {
+    jobs[t].begin = unsigned(std::size_t(t)*n/n_threads);
+    jobs[t].end = unsigned(std::size_t(t+1)*n/n_threads);
+  }
+#if VXL_HAS_PTHREAD_H
+  std::vector<pthread_t> threads(n_threads);
+  std::vector<bool> started(n_threads, false);
+  for (unsigned t=1; t<n_threads; ++t)
+    started[t] = pthread_create(&threads[t], VXL_NULLPTR,
+                                &bapl_lowe_pyramid_set_job::run_thread, &jobs[t])==0;
+  jobs[0].run();
+  for (unsigned t=1; t<n_threads; ++t)
+  {
+    if (started[t]) pthread_join(threads[t], VXL_NULLPTR);
+    else            jobs[t].run(); // Couldn't start thread - do it here
+  }
+#else
+  jobs[0].run();
+#endif
+}
+
+//: Separable Gaussian blur of src into dest, as brip_gauss_filter() with constant extension.
+//  work holds the horizontal pass, and is reused between calls.
+static void bapl_lowe_pyramid_set_blur(const vil_image_view<float>& src,
+                                       vil_image_view<float>& dest,
+                                       vil_image_view<float>& work,
+                                       double sigma, unsigned k_size,
+                                       unsigned n_threads)
+{
+  const unsigned ni = src.ni(), nj = src.nj();
+  assert(k_size>1 && k_size<ni && k_size<nj);
+  std::vector<double> kernel(k_size);
+  double sum = 0.0;
+  for (unsigned i=0; i<k_size; ++i)
+  {
+    double val = ((double(i)+0.5)-double(k_size)/2.0);
+    kernel[i] = std::exp(-(val*val)/(2.0*sigma*sigma));
+  }
+  for (unsigned i=0; i<k_size; ++i) sum += kernel[i];
+  for (unsigned i=0; i<k_size; ++i) kernel[i] /= sum;
+
+  work.set_size(ni, nj);
+  dest.set_size(ni, nj);
+
+  bapl_lowe_pyramid_set_job job;
+  job.kind = bapl_lowe_pyramid_set_job::CONVOLVE;
+  job.kernel = &kernel[0];
+  job.k_size = int(k_size);
+
+  // filter horizontal
+  job.src = &src;
+  job.dest = &work;
+  bapl_lowe_pyramid_set_run(job, nj, n_threads);
+
+  // filter vertical
+  vil_image_view<float> work_t = vil_transpose(work);
+  vil_image_view<float> dest_t = vil_transpose(dest);
+  job.src = &work_t;
+  job.dest = &dest_t;
+  bapl_lowe_pyramid_set_run(job, ni, n_threads);
+}
+
 //: Constructor
 bapl_lowe_pyramid_set::bapl_lowe_pyramid_set( const vil_image_resource_sptr& image,
-                                              unsigned octave_size, unsigned num_octaves, bool verbose)
+                                              unsigned octave_size, unsigned num_octaves,
+                                              bool verbose, unsigned n_threads)
  : gauss_pyramid_(octave_size, num_octaves),
    dog_pyramid_(octave_size, num_octaves),
    grad_orient_pyramid_(octave_size, num_octaves),
    grad_mag_pyramid_(octave_size, num_octaves),
    num_octaves_(num_octaves),
    octave_size_(octave_size),
-   verbose_(verbose)
+   verbose_(verbose),
+   auto_octaves_(num_octaves == 0),
+   n_threads_(n_threads)
+{
+  set_image(image);
+}
+
+
+//: Rebuild all the pyramids from a new image.
+void
+bapl_lowe_pyramid_set::set_image( const vil_image_resource_sptr& image )
 {
   // determine the number of octaves if not provided
-  if ( num_octaves == 0 ) {
+  if ( auto_octaves_ ) {
     int min_size = (image->ni() < image->nj())?image->ni():image->nj();
     min_size *= 2;
     num_octaves_ = 1;
@@ -43,40 +246,42 @@ bapl_lowe_pyramid_set::bapl_lowe_pyramid_set( const vil_image_resource_sptr& ima
     grad_orient_pyramid_.resize(num_octaves_);
     grad_mag_pyramid_.resize(num_octaves_);
   }
+  top_.resize(num_octaves_);
+  work_.resize(num_octaves_);
 
-  if (verbose) {
+  if (verbose_) {
     std::cout << " number of octaves: " << num_octaves_ << std::endl;
   }
 
   // Cast into float and upsample by 2x
-  vil_image_view<float> image2x;
   float dummy=0.0;
   vil_image_view_base_sptr imagef;
   imagef = vil_convert_stretch_range(dummy, image->get_view());
-  vil_resample_bilin( vil_image_view<float>(*imagef), image2x, 0, 0, 0.5, 0, 0, 0.5,
+  vil_resample_bilin( vil_image_view<float>(*imagef), image2x_, 0, 0, 0.5, 0, 0, 0.5,
                       2*imagef->ni(), 2*imagef->nj());
 
   // correct for artefacts of upsampling at the border
-  int ni = image2x.ni(), nj = image2x.nj();
+  int ni = image2x_.ni(), nj = image2x_.nj();
   for (int i=0; i<ni-1; ++i)
-    image2x(i,nj-1) = image2x(i,nj-2);
+    image2x_(i,nj-1) = image2x_(i,nj-2);
   for (int j=0; j<nj; ++j)
-    image2x(ni-1,j) = image2x(ni-2,j);
+    image2x_(ni-1,j) = image2x_(ni-2,j);
 
   //+++++++++++++++++++++++++++++++++++++++++++++
 
-  vil_image_view<float> temp;
-
   // Initial smoothing
-  //brip_gauss_filter(image2x, temp, 1, 7, vil_convolve_constant_extend );
-  brip_gauss_filter(image2x, temp, 1.6, 13, vil_convolve_constant_extend );
+  bapl_lowe_pyramid_set_blur(image2x_, gauss_pyramid_(0,0), work_[0], 1.6, 13, n_threads_);
 
   double reduction = std::sqrt(std::pow(2.0,2.0/octave_size_)-1);
 
-  // create the Gaussian Pyramid
+  // create the Gaussian Pyramid, each image blurred from the one before
   for (int lvl=0; lvl<num_octaves_; ++lvl) {
-    for (unsigned octsz=0; octsz<octave_size; ++octsz) {
-      vil_copy_deep(temp, gauss_pyramid_(lvl,octsz));
+    if (lvl > 0) {
+      vil_image_view<float> decimated = vil_decimate(top_[lvl-1],2);
+      gauss_pyramid_(lvl,0).set_size(decimated.ni(), decimated.nj());
+      vil_copy_reformat(decimated, gauss_pyramid_(lvl,0));
+    }
+    for (int octsz=0; octsz<octave_size_; ++octsz) {
       double scale = std::pow(2.0,double(octsz)/octave_size_);
       double sigma = scale*reduction;
       int size = 2*int(sigma*3.5+0.5)+1;
@@ -85,19 +290,25 @@ bapl_lowe_pyramid_set::bapl_lowe_pyramid_set( const vil_image_resource_sptr& ima
       int nj = gauss_pyramid_(lvl,octsz).nj();
       int smaller = ni < nj ? ni : nj;
       if (size >= smaller) size = smaller - 1;
-      brip_gauss_filter( gauss_pyramid_(lvl,octsz), temp,
-                         sigma, size, vil_convolve_constant_extend );
-      vil_math_image_difference( temp, gauss_pyramid_(lvl,octsz), dog_pyramid_(lvl,octsz));
+      vil_image_view<float>& next = octsz+1 < octave_size_ ? gauss_pyramid_(lvl,octsz+1) : top_[lvl];
+      bapl_lowe_pyramid_set_blur( gauss_pyramid_(lvl,octsz), next, work_[lvl],
+                                  sigma, size, n_threads_ );
+      vil_math_image_difference( next, gauss_pyramid_(lvl,octsz), dog_pyramid_(lvl,octsz));
     }
-    temp = vil_decimate(temp,2);
   }
 
   // compute the gradient magnitude and orientation of each image in the gauss pyramid
+  bapl_lowe_pyramid_set_job job;
+  job.kind = bapl_lowe_pyramid_set_job::GRADIENT;
   for (int lvl=0; lvl<num_octaves_; ++lvl) {
-    for (unsigned octsz=0; octsz<octave_size; ++octsz) {
-      vil_orientations_from_sobel( gauss_pyramid_(lvl,octsz),
-                                   grad_orient_pyramid_(lvl,octsz),
-                                   grad_mag_pyramid_(lvl,octsz) );
+    for (int octsz=0; octsz<octave_size_; ++octsz) {
+      const vil_image_view<float>& gauss = gauss_pyramid_(lvl,octsz);
+      grad_orient_pyramid_(lvl,octsz).set_size(gauss.ni(), gauss.nj());
+      grad_mag_pyramid_(lvl,octsz).set_size(gauss.ni(), gauss.nj());
+      job.src = &gauss;
+      job.dest = &grad_orient_pyramid_(lvl,octsz);
+      job.dest2 = &grad_mag_pyramid_(lvl,octsz);
+      bapl_lowe_pyramid_set_run(job, gauss.nj(), n_threads_);
     }
   }
 }
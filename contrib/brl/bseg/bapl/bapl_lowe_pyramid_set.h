@@ -12,6 +12,7 @@
 //  May 10, 2010 Andrew Hoelscher - Added verbose option to disable printing
 // \endverbatim
 
+#include <vector>
 #include <vil/vil_image_view.h>
 #include <vil/vil_image_resource.h>
 #include <vbl/vbl_ref_count.h>
@@ -28,10 +29,22 @@ class bapl_lowe_pyramid_set : public vbl_ref_count
 {
  public:
   //: Constructor
-  // if \param num_octaves is zero the number of octaves is determined from the image size
+  // if \param num_octaves is zero the number of octaves is determined from the image size.
+  // The blurring and gradient computations are shared between \param n_threads threads.
   bapl_lowe_pyramid_set( const vil_image_resource_sptr& image,
                          unsigned octave_size=3, unsigned num_octaves=0,
-                         bool verbose=true);
+                         bool verbose=true, unsigned n_threads=1);
+
+  //: Rebuild all the pyramids from a new image.
+  //  Images of the same size as the last reuse its buffers, so a video can
+  //  be processed a frame at a time without allocating.  Keypoints made
+  //  from the previous image see the new pyramids.
+  void set_image( const vil_image_resource_sptr& image );
+
+  //: Number of threads used to build the pyramids
+  unsigned n_threads() const { return n_threads_; }
+  //: Set the number of threads used to build the pyramids
+  void set_n_threads(unsigned n) { n_threads_ = n; }
 
   //: Accessor for the Gaussian pyramid
   const vil_image_view<float>& gauss_at( float scale,
@@ -98,6 +111,16 @@ class bapl_lowe_pyramid_set : public vbl_ref_count
   int num_octaves_;
   int octave_size_;
   bool verbose_;
+  //: True if the number of octaves is chosen from the image size
+  bool auto_octaves_;
+  unsigned n_threads_;
+
+  //: The image upsampled by 2
+  vil_image_view<float> image2x_;
+  //: Each octave's most blurred image, decimated to start the next octave
+  std::vector<vil_image_view<float> > top_;
+  //: Each octave's buffer for the horizontally blurred image
+  std::vector<vil_image_view<float> > work_;
 };
 
 #endif // bapl_lowe_pyramid_set_h_
@@ -6,6 +6,7 @@
 #include <bapl/bapl_keypoint_sptr.h>
 #include <bapl/bapl_dense_sift_sptr.h>
 #include <bapl/bapl_lowe_keypoint_sptr.h>
+#include <bapl/bapl_lowe_keypoint.h>
 
 #include <vcl_compiler.h>
 #include <vil/vil_image_view.h>
@@ -37,6 +38,20 @@ static void test_dense_sift()
   //orientation should be 90 degrees
   TEST_NEAR("Testing orientation.", keypoint->orientation(), vnl_math::pi, 1e-3);
 
+  //keypoints made on several threads are those made on one, numbered in order
+  std::vector<bapl_lowe_keypoint_sptr> serial, threaded;
+  dense_sift_sptr->make_dense_keypoints(serial, 3, 3);
+  dense_sift_sptr->make_dense_keypoints(threaded, 3, 3, 4);
+  bool same = serial.size() == 16 && threaded.size() == serial.size();
+  for (unsigned k = 0; same && k < serial.size(); ++k)
+    same = threaded[k]->location_i() == serial[k]->location_i() &&
+           threaded[k]->location_j() == serial[k]->location_j() &&
+           threaded[k]->scale() == serial[k]->scale() &&
+           threaded[k]->orientation() == serial[k]->orientation() &&
+           threaded[k]->descriptor() == serial[k]->descriptor() &&
+           threaded[k]->id() == serial[k]->id() + serial.size();
+  TEST("Threaded dense keypoints match", same, true);
+
   return;
 }
 
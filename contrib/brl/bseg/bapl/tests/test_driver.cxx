@@ -8,6 +8,7 @@ DECLARE( test_lowe_pyramid_set );
 DECLARE( test_compute_tracks );
 DECLARE( test_match_keypoints );
 DECLARE( test_dense_sift );
+DECLARE( test_kd_forest );
 
 void
 register_tests()
@@ -19,6 +20,7 @@ register_tests()
   REGISTER( test_compute_tracks );
   REGISTER( test_match_keypoints );
   REGISTER( test_dense_sift );
+  REGISTER( test_kd_forest );
 }
 
 DEFINE_MAIN;
@@ -5,6 +5,7 @@
 #include <bapl/bapl_connectivity.h>
 #include <bapl/bapl_dense_sift.h>
 #include <bapl/bapl_dsift.h>
+#include <bapl/bapl_kd_forest.h>
 #include <bapl/bapl_keypoint.h>
 #include <bapl/bapl_keypoint_extractor.h>
 #include <bapl/bapl_keypoint_set.h>
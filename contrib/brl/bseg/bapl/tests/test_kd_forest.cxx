@@ -0,0 +1,156 @@
+#include <iostream>
+#include <vector>
+#include <utility>
+#include <vcl_compiler.h>
+#include <testlib/testlib_test.h>
+#include <bapl/bapl_kd_forest.h>
+#include <bapl/bapl_lowe_keypoint.h>
+#include <bapl/bapl_lowe_pyramid_set_sptr.h>
+#include <bapl/bapl_keypoint_sptr.h>
+#include <vnl/vnl_random.h>
+#include <vnl/vnl_vector_fixed.h>
+
+static const unsigned dim = bapl_kd_forest::dim;
+
+//: Descriptors scattered about a few cluster centres, as real descriptors are.
+static void random_descriptors(vnl_random& rng, unsigned n, std::vector<float>& desc)
+{
+  const unsigned n_centres = 20;
+  std::vector<float> centres(n_centres*dim);
+  for (unsigned i=0; i<centres.size(); ++i)
+    centres[i] = float(rng.drand32(0.0, 1.0));
+  desc.resize(n*dim);
+  for (unsigned i=0; i<n; ++i)
+  {
+    unsigned c = rng.lrand32(0, n_centres-1);
+    for (unsigned k=0; k<dim; ++k)
+      desc[i*dim+k] = centres[c*dim+k] + float(rng.normal()*0.05);
+  }
+}
+
+//: The nearest and second nearest descriptors to q, by testing every descriptor.
+static void brute_two_nearest(std::vector<float> const& desc, const float* q,
+                              unsigned& i0, float& d0, float& d1)
+{
+  i0 = bapl_kd_forest::no_match;
+  d0 = d1 = 1e30f;
+  for (unsigned i=0; i<desc.size()/dim; ++i)
+  {
+    float d = bapl_kd_forest::dist_sq(q, &desc[i*dim]);
+    if (d<d0) { d1 = d0; d0 = d; i0 = i; }
+    else if (d<d1) d1 = d;
+  }
+}
+
+static void test_kd_forest()
+{
+  vnl_random rng(1234);
+  std::vector<float> desc, queries;
+  random_descriptors(rng, 2000, desc);
+  // Queries are the first few descriptors, disturbed; some by much more than others
+  const unsigned n_queries = 200;
+  queries.resize(n_queries*dim);
+  for (unsigned q=0; q<n_queries; ++q)
+  {
+    const double sigma = q%2 ? 0.02 : 0.1;
+    for (unsigned k=0; k<dim; ++k)
+      queries[q*dim+k] = desc[q*dim+k] + float(rng.normal()*sigma);
+  }
+
+  bapl_kd_forest forest(desc);
+  TEST("Number of descriptors", forest.size(), 2000);
+  TEST("Number of trees", forest.n_trees(), 4);
+
+  float scalar = 0.0f;
+  for (unsigned k=0; k<dim; ++k)
+    scalar += (desc[k]-desc[dim+k])*(desc[k]-desc[dim+k]);
+  TEST_NEAR("Square distance", bapl_kd_forest::dist_sq(&desc[0], &desc[dim]), scalar, 1e-4);
+
+  // Exact searches match brute force; limited searches mostly do
+  unsigned n_exact = 0, n_approx = 0;
+  for (unsigned q=0; q<n_queries; ++q)
+  {
+    unsigned i0;
+    float d0, d1;
+    brute_two_nearest(desc, &queries[q*dim], i0, d0, d1);
+    unsigned idx[2];
+    float dist[2];
+    if (forest.n_nearest(&queries[q*dim], 2, idx, dist)==2 &&
+        idx[0]==i0 && dist[0]==d0 && dist[1]==d1)
+      ++n_exact;
+    forest.n_nearest(&queries[q*dim], 2, idx, dist, 200);
+    if (idx[0]==i0) ++n_approx;
+  }
+  TEST("Exact search matches brute force", n_exact, n_queries);
+  std::cout << n_approx << " of " << n_queries << " found with 200 checks\n";
+  TEST("Limited search finds most nearest neighbours", n_approx >= 0.8*n_queries, true);
+
+  // Batched searches on several threads give the single query answers
+  std::vector<unsigned> idx1, idx4;
+  std::vector<float> dist1, dist4;
+  forest.n_nearest(queries, 3, idx1, dist1, 200, 1);
+  forest.n_nearest(queries, 3, idx4, dist4, 200, 4);
+  bool batch_ok = idx1==idx4 && dist1==dist4 && idx1.size()==3*n_queries;
+  for (unsigned q=0; q<n_queries && batch_ok; ++q)
+  {
+    unsigned idx[3];
+    float dist[3];
+    forest.n_nearest(&queries[q*dim], 3, idx, dist, 200);
+    for (unsigned k=0; k<3; ++k)
+      batch_ok = batch_ok && idx[k]==idx1[3*q+k] && dist[k]==dist1[3*q+k];
+  }
+  TEST("Threaded batch matches single queries", batch_ok, true);
+
+  // Ratio test, exact
+  const float ratio = 0.9f;
+  std::vector<std::pair<unsigned,unsigned> > expected, matches;
+  for (unsigned q=0; q<n_queries; ++q)
+  {
+    unsigned i0;
+    float d0, d1;
+    brute_two_nearest(desc, &queries[q*dim], i0, d0, d1);
+    if (d0 < ratio*ratio*d1)
+      expected.push_back(std::make_pair(q, i0));
+  }
+  forest.match_ratio(queries, ratio, matches, 0, 3);
+  std::cout << matches.size() << " ratio matches\n";
+  TEST("Ratio matches agree with brute force", matches==expected, true);
+
+  // Too few descriptors for a second neighbour
+  std::vector<float> one(desc.begin(), desc.begin()+dim);
+  bapl_kd_forest single(one);
+  unsigned idx[2];
+  float dist[2];
+  TEST("Single descriptor", single.n_nearest(&queries[0], 2, idx, dist)==1 &&
+                            idx[0]==0 && idx[1]==bapl_kd_forest::no_match, true);
+  matches.clear();
+  single.match_ratio(queries, ratio, matches);
+  TEST("No ratio matches without a second neighbour", matches.empty(), true);
+
+  // Identical descriptors cannot be split
+  std::vector<float> same;
+  for (unsigned i=0; i<50; ++i)
+    same.insert(same.end(), desc.begin(), desc.begin()+dim);
+  bapl_kd_forest same_forest(same, 2);
+  TEST("Identical descriptors", same_forest.n_nearest(&queries[0], 2, idx, dist)==2 &&
+                                dist[0]==dist[1] && idx[0]!=idx[1], true);
+
+  // Construction from keypoints
+  std::vector<bapl_keypoint_sptr> keypoints;
+  for (unsigned i=0; i<20; ++i)
+  {
+    vnl_vector_fixed<double,128> d;
+    for (unsigned k=0; k<dim; ++k)
+      d[k] = desc[i*dim+k];
+    keypoints.push_back(new bapl_lowe_keypoint(bapl_lowe_pyramid_set_sptr(), i, i, 1, 0, d));
+  }
+  bapl_kd_forest kp_forest(keypoints, 1);
+  TEST("Keypoint forest", kp_forest.size()==20 &&
+                          kp_forest.n_nearest(&desc[7*dim], 1, idx, dist)==1 && idx[0]==7, true);
+
+  bapl_kd_forest empty;
+  TEST("Empty forest", empty.size()==0 && empty.n_nearest(&queries[0], 1, idx, dist)==0 &&
+                       idx[0]==bapl_kd_forest::no_match, true);
+}
+
+TESTMAIN(test_kd_forest);
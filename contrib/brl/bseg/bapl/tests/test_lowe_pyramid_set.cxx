@@ -7,6 +7,7 @@
 #include <vil/vil_new.h>
 #include <vil/vil_save.h>
 #include <vil/vil_convert.h>
+#include <vil/algo/vil_orientations.h>
 
 
 MAIN( test_lowe_pyramid_set )
@@ -60,6 +61,44 @@ MAIN( test_lowe_pyramid_set )
 
   TEST("Pyramid Test",good_approx,true);
 
+  // Pyramids built on several threads, or rebuilt in place from another
+  // image, are the same as those built on one thread
+  vil_image_view<vxl_byte> other(512,512);
+  for (unsigned j=0; j<512; ++j)
+    for (unsigned i=0; i<512; ++i)
+      other(i,j) = vxl_byte((i*7+j*3)%256);
+  bapl_lowe_pyramid_set threaded(gaussian_sptr, levels, octaves, false, 4);
+  bapl_lowe_pyramid_set rebuilt(vil_new_image_resource_of_view(other), levels, octaves, false, 2);
+  const float* buffer = rebuilt.gauss_pyramid(1,1).top_left_ptr();
+  rebuilt.set_image(gaussian_sptr);
+  bool threaded_same = true, rebuilt_same = true;
+  for (int lvl=0; lvl<octaves; ++lvl) {
+    for (int s=0; s<levels; ++s) {
+      threaded_same = threaded_same &&
+        vil_image_view_deep_equality(pyramids.gauss_pyramid(lvl,s), threaded.gauss_pyramid(lvl,s)) &&
+        vil_image_view_deep_equality(pyramids.dog_pyramid(lvl,s), threaded.dog_pyramid(lvl,s)) &&
+        vil_image_view_deep_equality(pyramids.grad_orient_pyramid(lvl,s), threaded.grad_orient_pyramid(lvl,s)) &&
+        vil_image_view_deep_equality(pyramids.grad_mag_pyramid(lvl,s), threaded.grad_mag_pyramid(lvl,s));
+      rebuilt_same = rebuilt_same &&
+        vil_image_view_deep_equality(pyramids.gauss_pyramid(lvl,s), rebuilt.gauss_pyramid(lvl,s)) &&
+        vil_image_view_deep_equality(pyramids.dog_pyramid(lvl,s), rebuilt.dog_pyramid(lvl,s)) &&
+        vil_image_view_deep_equality(pyramids.grad_orient_pyramid(lvl,s), rebuilt.grad_orient_pyramid(lvl,s)) &&
+        vil_image_view_deep_equality(pyramids.grad_mag_pyramid(lvl,s), rebuilt.grad_mag_pyramid(lvl,s));
+    }
+  }
+  TEST("Threaded pyramids match", threaded_same, true);
+  TEST("Rebuilt pyramids match", rebuilt_same, true);
+  TEST("Rebuilt pyramids reuse their buffers",
+       rebuilt.gauss_pyramid(1,1).top_left_ptr() == buffer, true);
+
+  // The gradients are those of the Sobel filter
+  vil_image_view<float> orient, mag;
+  vil_orientations_from_sobel(pyramids.gauss_pyramid(1,2), orient, mag);
+  TEST("Gradient orientations match Sobel",
+       vil_image_view_deep_equality(orient, pyramids.grad_orient_pyramid(1,2)), true);
+  TEST("Gradient magnitudes match Sobel",
+       vil_image_view_deep_equality(mag, pyramids.grad_mag_pyramid(1,2)), true);
+
 
   SUMMARY();
 }
@@ -7,8 +7,52 @@
 #include "boct_bit_tree.h"
 #include "boct_tree_cell.h"
 
+#if defined(_MSC_VER)
+# include <intrin.h>
+#endif
+
+// Bytes 0-9 of the tree hold the structure bits: the bit of cell k>0 is
+// bit (k-1)%8 of byte (k-1)/8+1, i.e. bit k+7 of the little-endian bit
+// stream formed by those bytes.  Counting set bits is then a population
+// count over a prefix of that stream.
+
+//: Number of set bits in x.
+static inline int boct_popcount(vxl_uint_64 x)
+{
+#if defined(__GNUC__)
+  return __builtin_popcountll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  return int(__popcnt64(x));
+#else
+  x = x - ((x >> 1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+  return int((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+//: Bytes 0-7 of the tree as one little-endian word.
+static inline vxl_uint_64 boct_low_word(const unsigned char* b)
+{
+  return  vxl_uint_64(b[0])      | (vxl_uint_64(b[1])<<8)
+       | (vxl_uint_64(b[2])<<16) | (vxl_uint_64(b[3])<<24)
+       | (vxl_uint_64(b[4])<<32) | (vxl_uint_64(b[5])<<40)
+       | (vxl_uint_64(b[6])<<48) | (vxl_uint_64(b[7])<<56);
+}
+
+//: Number of set bits in the first n (at most 80) bits of the structure.
+static inline int boct_count_prefix(const unsigned char* b, int n)
+{
+  vxl_uint_64 lo = boct_low_word(b);
+  if (n < 64)
+    return boct_popcount(lo & ((vxl_uint_64(1)<<n) - 1));
+  unsigned hi = unsigned(b[8]) | (unsigned(b[9])<<8);
+  return boct_popcount(lo) + boct_popcount(hi & ((1u<<(n-64)) - 1));
+}
+
 //: default constructor
 boct_bit_tree::boct_bit_tree()
+  : num_levels_(4)
 {
   bits_ = new unsigned char[16];
   std::memset(bits_, 0, 16);
@@ -115,6 +159,38 @@ int boct_bit_tree::traverse_to_level(const vgl_point_3d<double> p, int deepest)
   }
   return bit_index;
 }
+void boct_bit_tree::traverse(std::vector<vgl_point_3d<double> > const& pts,
+                             std::vector<int>& bit_indices, int deepest) const
+{
+  // Same descent as traverse() above, with the depth limit worked out
+  // once for all the points.  At depth 2 the byte read can be one past
+  // the structure bytes, as in traverse(), so b must span all 16 bytes.
+  deepest = std::max(deepest-1, num_levels_-1);
+  const unsigned char* b = bits_;
+
+  const std::size_t n = pts.size();
+  bit_indices.resize(n);
+  for (std::size_t k=0; k<n; ++k)
+  {
+    double px = pts[k].x(), py = pts[k].y(), pz = pts[k].z();
+    int curr_bit = b[0];
+    int child_offset = 0;
+    int depth = 0;
+    int bit_index = 0;
+    while (curr_bit && depth < deepest) {
+      px += px; py += py; pz += pz;
+      int c_index = (((int)std::floor(px)) & 1)
+                  + ((((int)std::floor(py)) & 1)<<1)
+                  + ((((int)std::floor(pz)) & 1)<<2);
+      bit_index = (8*bit_index + 1) + c_index;
+      curr_bit = (1<<c_index) & b[depth+1 + child_offset];
+      child_offset = c_index;
+      depth++;
+    }
+    bit_indices[k] = bit_index;
+  }
+}
+
 vgl_point_3d<double> boct_bit_tree::cell_center(int bit_index)
 {
   //Indexes into precomputed cell_center matrix
@@ -276,39 +352,49 @@ int  boct_bit_tree::get_relative_index(int bit_index) const
   if (bit_index < 9)
     return bit_index;
 
-  //otherwise get parent index, parent byte index and relative bit index
-  unsigned char oneuplevel = (bit_index-1)>>3;          //bit index of parent
-  unsigned char byte_index = ((oneuplevel-1)>>3) + 1;   //byte where parent is found
-
-  //count pre parent bits
-  int count=0;
-  for (int i=0; i<byte_index; ++i)
-    count += bit_lookup[bits_[i]];
+  // Count the set bits before the parent's bit, i.e. the inner cells
+  // stored before it (including the root byte).
+  int parent = (bit_index-1)>>3;
+  int count = boct_count_prefix(bits_, parent+7);
+  return 8*count + 1 + ((bit_index-1)&(8-1));
+}
 
-  //dont forget parent bits occurring the parent BYTE
-  unsigned char sub_bit_index = 8-((oneuplevel-1)&(8-1));
-  unsigned char temp = bits_[byte_index]<<sub_bit_index;
+void boct_bit_tree::get_data_indices(std::vector<int> const& bit_indices,
+                                     std::vector<int>& data_indices,
+                                     bool is_random) const
+{
+  int count_offset;
+  if (is_random)
+    count_offset = (int)bits_[10]*256+(int)bits_[11];
+  else
+    count_offset = (int) (bits_[13]<<24) | (bits_[12]<<16) | (bits_[11]<<8) | (bits_[10]);
 
-  count = count + bit_lookup[temp];
-  unsigned char finestleveloffset=(bit_index-1)&(8-1);
-  count = 8*count+1 +finestleveloffset;
+  // prefix[i] = number of set bits in bytes 0..i-1
+  int prefix[11];
+  prefix[0] = 0;
+  for (int i=0; i<10; ++i)
+    prefix[i+1] = prefix[i] + bit_lookup[bits_[i]];
 
-  return count;
+  const std::size_t n = bit_indices.size();
+  data_indices.resize(n);
+  for (std::size_t k=0; k<n; ++k)
+  {
+    int bit_index = bit_indices[k];
+    if (bit_index < 9) {
+      data_indices[k] = count_offset + bit_index;
+      continue;
+    }
+    int pos = ((bit_index-1)>>3) + 7;   // position of the parent's bit
+    int byte = pos>>3;
+    int count = prefix[byte] + bit_lookup[bits_[byte] & ((1<<(pos&7))-1)];
+    data_indices[k] = count_offset + 8*count + 1 + ((bit_index-1)&(8-1));
+  }
 }
 
 //: return number of cells in this tree (size of data chunk)
 int boct_bit_tree::num_cells() const
 {
-  //count bits for each byte
-  int count = 0 ;
-  for (int i=0; i<10; i++) {
-    unsigned char n = bits_[i];
-    while (n)  {
-      ++count;
-      n &= (n - 1) ;
-    }
-  }
-  return 8*count+1;
+  return 8*boct_count_prefix(bits_, 80)+1;
 }
 
 
@@ -343,8 +429,10 @@ boct_bit_tree::set_bit_at(int index, bool val)
   }
 
   //zero is a special case,
-  if (index == 0)
+  if (index == 0) {
     bits_[0] = (val) ? 1 : 0;
+    return;
+  }
 
   int byte_index =   (index-1)/8+1;
   int child_offset = (index-1)%8;
@@ -20,6 +20,7 @@
 #include <cmath>
 #include <vgl/vgl_point_3d.h>
 #include <vgl/vgl_box_3d.h>
+#include <vxl_config.h>
 
 class boct_bit_tree
 {
@@ -43,9 +44,21 @@ class boct_bit_tree
   //: returns bit index assuming root data is located at 0
   int get_relative_index(int bit_index) const;
 
+  //: Data indices of many cells of this tree.
+  //  Gives the same results as calling get_data_index() for each cell, but
+  //  the counts of set bits before each byte are computed once for the batch.
+  void get_data_indices(std::vector<int> const& bit_indices,
+                        std::vector<int>& data_indices,
+                        bool is_random=false) const;
+
   //: traverse tree to get leaf index that contains point
   int traverse(const vgl_point_3d<double> p, int deepest=4);
 
+  //: traverse tree to get the leaf index of each of the points
+  //  Gives the same results as calling traverse() for each point.
+  void traverse(std::vector<vgl_point_3d<double> > const& pts,
+                std::vector<int>& bit_indices, int deepest=4) const;
+
   //: traverse tree to get leaf index that contains point
 
   int traverse_to_level(const vgl_point_3d<double> p, int deepest=4);
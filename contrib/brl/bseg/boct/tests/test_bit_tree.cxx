@@ -1,8 +1,11 @@
 #include <iostream>
+#include <vector>
+#include <ctime>
 #include <testlib/testlib_test.h>
 
 #include <boct/boct_bit_tree.h>
 #include <vcl_compiler.h>
+#include <vnl/vnl_random.h>
 
 void test_print_centers()
 {
@@ -78,6 +81,99 @@ void test_print_centers()
   std::cout<<centerZ[584]<<"};"<<std::endl;
 }
 
+//: Relative index computed with the original byte-table loop.
+static int reference_relative_index(const unsigned char* bits, int bit_index)
+{
+  if (bit_index < 9)
+    return bit_index;
+  unsigned char oneuplevel = (bit_index-1)>>3;
+  unsigned char byte_index = ((oneuplevel-1)>>3) + 1;
+  int count=0;
+  for (int i=0; i<byte_index; ++i)
+    count += boct_bit_tree::bit_lookup[bits[i]];
+  unsigned char sub_bit_index = 8-((oneuplevel-1)&(8-1));
+  unsigned char temp = bits[byte_index]<<sub_bit_index;
+  count = count + boct_bit_tree::bit_lookup[temp];
+  return 8*count+1 + ((bit_index-1)&(8-1));
+}
+
+//: Compare the popcount lookups with the original algorithm on random trees.
+static void test_popcount_lookups()
+{
+  vnl_random rng(3141);
+  bool rel_ok = true, batch_ok = true, size_ok = true, trav_ok = true;
+  std::vector<int> all_bits(585);
+  for (int i=0; i<585; ++i) all_bits[i] = i;
+
+  std::vector<vgl_point_3d<double> > pts;
+  for (int i=0; i<200; ++i)
+    pts.push_back(vgl_point_3d<double>(rng.drand64(), rng.drand64(), rng.drand64()));
+
+  for (int t=0; t<200; ++t)
+  {
+    unsigned char bits[16];
+    for (int i=0; i<16; ++i)
+      bits[i] = (unsigned char)rng.lrand32(0, 255);
+    boct_bit_tree tree(bits, 4);
+
+    int n_set = 0;
+    for (int i=0; i<10; ++i) n_set += boct_bit_tree::bit_lookup[bits[i]];
+    size_ok = size_ok && tree.num_cells() == 8*n_set+1;
+
+    std::vector<int> data;
+    tree.get_data_indices(all_bits, data, t%2==1);
+    for (int i=0; i<585; ++i) {
+      rel_ok = rel_ok && tree.get_relative_index(i) == reference_relative_index(bits, i);
+      batch_ok = batch_ok && data[i] == tree.get_data_index(i, t%2==1);
+    }
+
+    std::vector<int> leaves;
+    tree.traverse(pts, leaves);
+    for (unsigned i=0; i<pts.size(); ++i)
+      trav_ok = trav_ok && leaves[i] == tree.traverse(pts[i]);
+  }
+  TEST("Relative index matches byte table lookup", rel_ok, true);
+  TEST("Number of cells matches byte table count", size_ok, true);
+  TEST("Batched data indices match single lookups", batch_ok, true);
+  TEST("Batched traverse matches single traverse", trav_ok, true);
+
+  // Points in the last children at depth 3, whose descent reads the byte
+  // after the structure bytes.
+  unsigned char deep[16] = {1,255,255,255,255,255,255,255,255,255,0,0,0,0,0,0};
+  bool deep_ok = true;
+  for (int t=0; t<4; ++t)
+  {
+    for (int i=10; i<16; ++i)
+      deep[i] = (unsigned char)rng.lrand32(0, 255);
+    boct_bit_tree deep_tree(deep, 4);
+    std::vector<vgl_point_3d<double> > corner;
+    for (int i=0; i<50; ++i)
+      corner.push_back(vgl_point_3d<double>(0.875+0.125*rng.drand64(),
+                                            0.875+0.125*rng.drand64(),
+                                            0.875+0.125*rng.drand64()));
+    std::vector<int> leaves;
+    deep_tree.traverse(corner, leaves);
+    for (unsigned i=0; i<corner.size(); ++i)
+      deep_ok = deep_ok && leaves[i] == deep_tree.traverse(corner[i]);
+  }
+  TEST("Batched traverse matches single traverse in last children", deep_ok, true);
+
+  // Rough speed of the batched traverse plus data index lookup.
+  unsigned char full[16] = {1,255,255,255,255,255,255,255,255,255,0,0,0,0,0,0};
+  boct_bit_tree tree(full, 4);
+  std::vector<int> leaves, data;
+  const int n_rep = 500;
+  std::clock_t start = std::clock();
+  for (int r=0; r<n_rep; ++r) {
+    tree.traverse(pts, leaves);
+    tree.get_data_indices(leaves, data);
+  }
+  double secs = double(std::clock()-start)/CLOCKS_PER_SEC;
+  if (secs > 0)
+    std::cout << "Batched traverse + data index: "
+              << n_rep*pts.size()/secs << " cells/sec\n";
+}
+
 static void test_bit_tree()
 {
     unsigned char bits[73] = {  1,
@@ -151,6 +247,7 @@ static void test_bit_tree()
   TEST("Size of tree = 89", size, 89);
 
   test_print_centers();
+  test_popcount_lookups();
 }
 
 TESTMAIN(test_bit_tree);
@@ -1,36 +1,57 @@
+#include <algorithm>
+#include <cstring>
 #include "boxm2_filter_block_function.h"
+#include "boxm2_parallel_for.h"
 
 
 //:
 // \file
 
 //: "default" constructor
-boxm2_filter_block_function::boxm2_filter_block_function(boxm2_scene_sptr scene, boxm2_block_metadata data, boxm2_block* blk, boxm2_data_base* alphas)
-  : scene_(scene)
+boxm2_filter_block_function::boxm2_filter_block_function(boxm2_scene_sptr scene, boxm2_block_metadata data, boxm2_block* blk, boxm2_data_base* alphas,
+                                                         unsigned n_threads)
+  : blk_(blk), data_(data), scene_(scene)
 {
-  //1. allocate new alpha data array (stays the same size)
+  //1. allocate new alpha data array (stays the same size), starting from the
+  //   old alphas so that the cells which are not leaves keep their values
   std::cout<<"Allocating new data blocks"<<std::endl;
   boxm2_block_id id = blk->block_id();
   std::size_t dataSize = alphas->buffer_length();
   boxm2_data_base* newA = new boxm2_data_base(new char[dataSize], dataSize, id);
-  float*   alpha_cpy = (float*) newA->data_buffer();
+  std::memcpy(newA->data_buffer(), alphas->data_buffer(), dataSize);
+  alpha_cpy_ = (float*) newA->data_buffer();
 
   //3d array of trees
-  const boxm2_array_3d<uchar16>& trees = blk->trees();
-  float*   alpha_data = (float*) alphas->data_buffer();
+  trees_ = &blk->trees();
+  alpha_ = (float*) alphas->data_buffer();
 
-  //iterate through each block, filtering the root level first
+  //2. filter each slice of trees; every leaf is written by one thread only
   std::cout<<"Filtering scene: "<<std::flush;
-  for (unsigned int x=0; x<trees.get_row1_count(); ++x)
+  boxm2_parallel_for(this, &boxm2_filter_block_function::filter_slices,
+                     trees_->get_row1_count(), n_threads);
+  std::cout<<std::endl;
+
+  //3. Replace data in the cache
+  boxm2_cache_sptr cache = boxm2_cache::instance();
+  cache->replace_data_base(scene_, id, boxm2_data_traits<BOXM2_ALPHA>::prefix(), newA);
+}
+
+void boxm2_filter_block_function::filter_slices(unsigned begin, unsigned end, unsigned t)
+{
+  const boxm2_array_3d<uchar16>& trees = *trees_;
+
+  //iterate through each block, filtering the root level first
+  for (unsigned int x=begin; x<end; ++x)
   {
-    std::cout<<'['<<x<<'/'<<trees.get_row1_count()<<']'<<std::flush;
+    if (t==0)
+      std::cout<<'['<<x<<'/'<<trees.get_row1_count()<<']'<<std::flush;
     for (unsigned int y=0; y<trees.get_row2_count(); ++y)
     {
       for (unsigned int z=0; z<trees.get_row3_count(); ++z)
       {
         //load current block/tree
         uchar16 tree = trees(x,y,z);
-        boct_bit_tree bit_tree( (unsigned char*) tree.data_block(), data.max_level_);
+        boct_bit_tree bit_tree( (unsigned char*) tree.data_block(), data_.max_level_);
 
         //FOR ALL LEAVES IN CURRENT TREE
         std::vector<int> leafBits = bit_tree.get_leaf_bits();
@@ -58,7 +79,7 @@ boxm2_filter_block_function::boxm2_filter_block_function(boxm2_scene_sptr scene,
                                         (int) abCenter.y(),
                                         (int) abCenter.z() );
             uchar16 ntree = trees(blkIdx.x(), blkIdx.y(), blkIdx.z());
-            boct_bit_tree neighborTree( (unsigned char*) ntree.data_block(), data.max_level_);
+            boct_bit_tree neighborTree( (unsigned char*) ntree.data_block(), data_.max_level_);
 
             //traverse to local center
             vgl_point_3d<double> locCenter((double) abCenter.x() - blkIdx.x(),
@@ -74,8 +95,8 @@ boxm2_filter_block_function::boxm2_filter_block_function(boxm2_scene_sptr scene,
               int neighborDepth = neighborTree.depth_at(neighborBitIdx);
 #endif
               //grab alpha, calculate probability
-              float alpha = alpha_data[idx];
-              float prob = 1.0f - (float)std::exp(-alpha * side_len * data.sub_block_dim_.x());
+              float alpha = alpha_[idx];
+              float prob = 1.0f - (float)std::exp(-alpha * side_len * data_.sub_block_dim_.x());
               probs.push_back(prob);
             }
             else //neighbor is smaller, must combine neighborhood
@@ -95,10 +116,10 @@ boxm2_filter_block_function::boxm2_filter_block_function(boxm2_scene_sptr scene,
                 double nlen = 1.0 / (double) (1<<ndepth);
                 int dataIndex = neighborTree.get_data_index(*leafIter);
 #ifdef USE_AVGPROB
-                totalProb += (1.0f - std::exp(-alpha_data[dataIndex] * nlen * data.sub_block_dim_.x()) );
-                totalLen += nlen*data.sub_block_dim_.x();
+                totalProb += (1.0f - std::exp(-alpha_[dataIndex] * nlen * data_.sub_block_dim_.x()) );
+                totalLen += nlen*data_.sub_block_dim_.x();
 #else
-                totalAlphaL += (float)(alpha_data[dataIndex] * nlen * data.sub_block_dim_.x());
+                totalAlphaL += (float)(alpha_[dataIndex] * nlen * data_.sub_block_dim_.x());
 #endif
               }
 #ifdef USE_AVGPROB
@@ -112,24 +133,20 @@ boxm2_filter_block_function::boxm2_filter_block_function(boxm2_scene_sptr scene,
 
           //if you've collected a nonzero amount of probs, update it
           int currIdx = bit_tree.get_data_index(currBitIndex);
-          float prob = 1.0f - (float)std::exp( -alpha_data[currIdx] * side_len * data.sub_block_dim_.x() );
+          float prob = 1.0f - (float)std::exp( -alpha_[currIdx] * side_len * data_.sub_block_dim_.x() );
           probs.push_back(prob);
           if (probs.size() > 0) {
             std::sort( probs.begin(), probs.end() );
             double median = probs[ (int) (probs.size()/2) ];
-            double medAlpha = - std::log(1.0-median) / ( side_len * data.sub_block_dim_.x() );
+            double medAlpha = - std::log(1.0-median) / ( side_len * data_.sub_block_dim_.x() );
 
             //store the median value in the new alpha (copy)
-            alpha_cpy[currIdx] = float(medAlpha);
+            alpha_cpy_[currIdx] = float(medAlpha);
           }
         } //end leaf for
       } //end z for
     } //end y for
   } // end x for
-
-  //3. Replace data in the cache
-  boxm2_cache_sptr cache = boxm2_cache::instance();
-  cache->replace_data_base(scene_, id, boxm2_data_traits<BOXM2_ALPHA>::prefix(), newA);
 }
 
 
@@ -23,18 +23,26 @@ class boxm2_filter_block_function
   typedef vnl_vector_fixed<ushort, 4> ushort4;
 
   //: "default" constructor
-  boxm2_filter_block_function(boxm2_scene_sptr scene, boxm2_block_metadata data, boxm2_block* blk, boxm2_data_base* alphas);
+  //  Filters the alphas of blk and replaces them in the cache; the
+  //  slices of trees along x are split between n_threads threads.
+  boxm2_filter_block_function(boxm2_scene_sptr scene, boxm2_block_metadata data, boxm2_block* blk, boxm2_data_base* alphas,
+                              unsigned n_threads = 1);
 
  private:
 
+  //: filter the leaves of the trees in slices x = [begin,end) into alpha_cpy_
+  void filter_slices(unsigned begin, unsigned end, unsigned t);
+
   //: returns a list of 3d points (int locations) of neighboring blocks
   std::vector<vgl_point_3d<int> > neighbors( vgl_point_3d<int>& center, boxm2_array_3d<uchar16>& trees );
   //: returns a list of 3d points of neighboring blocks
   std::vector<vgl_point_3d<double> > neighbor_points( vgl_point_3d<double>& cellCenter, double side_len,const boxm2_array_3d<uchar16>& trees );
 
   boxm2_block* blk_;
-  uchar16*     trees_;
+  const boxm2_array_3d<uchar16>* trees_;
   float*       alpha_;
+  float*       alpha_cpy_;
+  boxm2_block_metadata data_;
   boxm2_scene_sptr scene_;
 };
 
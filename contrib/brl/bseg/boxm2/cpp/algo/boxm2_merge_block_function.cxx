@@ -1,16 +1,18 @@
 #include <iostream>
-#include <list>
 #include "boxm2_merge_block_function.h"
+#include "boxm2_parallel_for.h"
 #include <vcl_compiler.h>
 
 //:
 // \file
 
 //: initialize generic data base pointers as their data type
-bool boxm2_merge_block_function::init_data(boxm2_block* blk, std::vector<boxm2_data_base*>& datas, float prob_thresh)
+bool boxm2_merge_block_function::init_data(boxm2_block* blk, std::vector<boxm2_data_base*>& datas, float prob_thresh,
+                                           unsigned n_threads)
 {
     //store block and pointer to uchar16 3d block
     blk_   = blk;
+    n_threads_ = n_threads;
     trees_ = blk_->trees().data_block();
 
     //store data buffers
@@ -90,88 +92,126 @@ bool boxm2_merge_block_function::merge(std::vector<boxm2_data_base*>& datas)
 {
   std::cout<<"CPU merge:"<<std::endl;
 
-  //1. loop over each tree, refine it in place (keep a vector of locations for
+  //1. merge each tree into a copy, keeping the old trees, and sum the new
+  //   tree sizes over each range of trees
   boxm2_array_3d<uchar16>  trees = blk_->trees_copy();  //trees to refine
-  uchar16* trees_copy = new uchar16[trees.size()];  //copy of those trees
-  int* dataIndex = new int[trees.size()];           //data index for each new tree
-  int currIndex = 0;                                //curr tree being looked at
+  unsigned num_trees = (unsigned)trees.size();
+  unsigned n_ranges = boxm2_parallel_for_n_ranges(num_trees, n_threads_);
+  new_trees_ = trees.data_block();
+  trees_copy_.resize(num_trees);
+  sizes_.resize(num_trees);
+  merge_counts_.assign(n_ranges, 0);
+  range_sizes_.assign(n_ranges, 0);
+  range_first_ptr_.assign(n_ranges, -1);
+  boxm2_parallel_for(this, &boxm2_merge_block_function::merge_trees, num_trees, n_threads_);
+
+  //2. scan the range sizes into range offsets; move_trees() scans within each range
   int dataSize = 0;                                 //running sum of data size
-  boxm2_array_3d<uchar16>::iterator blk_iter;
-  for (blk_iter = trees.begin(); blk_iter != trees.end(); ++blk_iter, ++currIndex)
+  bool in_place = true;                             //old data already at the new offsets
+  for (unsigned t=0; t<n_ranges; ++t)
   {
-      //0. store data index for eahc tree.
-      dataIndex[currIndex] = dataSize;
-
-      //1. get current tree information
-      uchar16 tree  = (*blk_iter);
-      boct_bit_tree curr_tree( (unsigned char*) tree.data_block(), max_level_);
-
-      //3. merge tree locally (only updates refined_tree and returns new tree size)
-      boct_bit_tree refined_tree = this->merge_bit_tree(curr_tree, alpha_, prob_thresh_);
-      int newSize = refined_tree.num_cells();
+    merge_count_ += merge_counts_[t];
+    in_place = in_place && range_first_ptr_[t] == dataSize;
+    int rangeSize = range_sizes_[t];
+    range_sizes_[t] = dataSize;
+    dataSize += rangeSize;
+  }
 
-      //cache refined tree
-      std::memcpy (trees_copy[currIndex].data_block(), refined_tree.get_bits(), 16);
-      dataSize += newSize;
+  //nothing merged, so the trees and data would be copied unchanged
+  if (merge_count_ == 0 && in_place && dataSize == data_len_)
+  {
+    std::cout<<"Number of merged cells: 0, keeping the block data"<<std::endl;
+    return true;
   }
 
-  //2. allocate new data arrays of the appropriate size
+  //3. allocate new data arrays of the appropriate size
   std::cout<<"Allocating new data blocks of length "<<dataSize<<std::endl;
   boxm2_block_id id = datas[0]->block_id();
   boxm2_data_base* newA = new boxm2_data_base(new char[dataSize * sizeof(float) ], dataSize * sizeof(float), id);
   boxm2_data_base* newM = new boxm2_data_base(new char[dataSize * sizeof(uchar8)], dataSize * sizeof(uchar8), id);
   boxm2_data_base* newN = new boxm2_data_base(new char[dataSize * sizeof(ushort4)], dataSize * sizeof(ushort4), id);
-  float*   alpha_cpy = (float*) newA->data_buffer();
-  uchar8*  mog_cpy   = (uchar8*) newM->data_buffer();
-  ushort4* num_obs_cpy = (ushort4*) newN->data_buffer();
+  alpha_cpy_   = (float*) newA->data_buffer();
+  mog_cpy_     = (uchar8*) newM->data_buffer();
+  num_obs_cpy_ = (ushort4*) newN->data_buffer();
 
-  //3. loop through tree again, putting the data in the right place
+  //4. loop through trees again, putting the data in the right place
   std::cout<<"Swapping data into new blocks..."<<std::endl;
-  int newInitCount = 0;
-  currIndex = 0;
-  for (blk_iter = trees.begin(); blk_iter != trees.end(); ++blk_iter, ++currIndex)
+  boxm2_parallel_for(this, &boxm2_merge_block_function::move_trees, num_trees, n_threads_);
+  blk_->set_trees(trees);
+  std::cout<<"Number of merged cells: "<<merge_count_ << '\n'
+          <<"  New Alpha Size: "<<newA->buffer_length() / 1024.0/1024.0<<" mb" << '\n'
+          <<"  New MOG   Size: "<<newM->buffer_length() / 1024.0/1024.0<<" mb" << '\n'
+          <<"  New NOBS  Size: "<<newN->buffer_length() / 1024.0/1024.0<<" mb" << std::endl;
+
+  //5. Replace data in the cache
+  boxm2_cache_sptr cache = boxm2_cache::instance();
+  cache->replace_data_base(scene_, id, boxm2_data_traits<BOXM2_ALPHA>::prefix(), newA);
+  cache->replace_data_base(scene_, id, boxm2_data_traits<BOXM2_MOG3_GREY>::prefix(), newM);
+  cache->replace_data_base(scene_, id, boxm2_data_traits<BOXM2_NUM_OBS>::prefix(), newN);
+
+  return true;
+}
+
+void boxm2_merge_block_function::merge_trees(unsigned begin, unsigned end, unsigned t)
+{
+  int rangeSize = 0;
+  int firstPtr = 0;
+  for (unsigned currIndex = begin; currIndex < end; ++currIndex)
   {
       //1. get current tree information
-      uchar16 tree  = (*blk_iter);
-      boct_bit_tree old_tree( (unsigned char*) tree.data_block(), max_level_);
+      boct_bit_tree curr_tree( (unsigned char*) new_trees_[currIndex].data_block(), max_level_);
+
+      //track whether the old data follows on from that of the previous tree;
+      //only used when no tree merges, so old and new sizes are the same
+      int oldDataPtr = curr_tree.get_data_ptr();
+      if (currIndex == begin)
+        firstPtr = oldDataPtr;
+      else if (firstPtr >= 0 && oldDataPtr != firstPtr + rangeSize)
+        firstPtr = -1;
+
+      //2. merge tree locally (only updates refined_tree and returns new tree size)
+      boct_bit_tree refined_tree = this->merge_bit_tree(curr_tree, alpha_, prob_thresh_, merge_counts_[t]);
+      sizes_[currIndex] = refined_tree.num_cells();
+      rangeSize += sizes_[currIndex];
+
+      //cache refined tree
+      std::memcpy (trees_copy_[currIndex].data_block(), refined_tree.get_bits(), 16);
+  }
+  range_sizes_[t] = rangeSize;
+  range_first_ptr_[t] = firstPtr;
+}
+
+void boxm2_merge_block_function::move_trees(unsigned begin, unsigned end, unsigned t)
+{
+  int root_index = range_sizes_[t];  //offset of the range, from the scan
+  for (unsigned currIndex = begin; currIndex < end; ++currIndex)
+  {
+      //1. get current tree information
+      boct_bit_tree old_tree( (unsigned char*) new_trees_[currIndex].data_block(), max_level_);
 
       //2. refine tree locally (only updates refined_tree and returns new tree size)
-      boct_bit_tree refined_tree( (unsigned char*) trees_copy[currIndex].data_block(), max_level_);
+      boct_bit_tree refined_tree( (unsigned char*) trees_copy_[currIndex].data_block(), max_level_);
 
       //2.5 pack data bits into refined tree
       //store data index in bits [10, 11, 12, 13] ;
-      int root_index = dataIndex[currIndex];
       refined_tree.set_data_ptr(root_index, false); //is not random
 
       int old_root_index = old_tree.get_data_ptr();
 
       //3. swap data from old location to new location, pass in shifted buffers
-      newInitCount += this->move_data(old_tree,
-                                      refined_tree,
-                                      alpha_ + old_root_index,
-                                      mog_ + old_root_index,
-                                      num_obs_ + old_root_index,
-                                      alpha_cpy+root_index,
-                                      mog_cpy+root_index,
-                                      num_obs_cpy+root_index);
+      this->move_data(old_tree,
+                      refined_tree,
+                      alpha_ + old_root_index,
+                      mog_ + old_root_index,
+                      num_obs_ + old_root_index,
+                      alpha_cpy_+root_index,
+                      mog_cpy_+root_index,
+                      num_obs_cpy_+root_index);
+      root_index += sizes_[currIndex];
 
       //4. store old tree in new tree, swap data out
-      std::memcpy(blk_iter, refined_tree.get_bits(), 16);
+      std::memcpy(new_trees_[currIndex].data_block(), refined_tree.get_bits(), 16);
   }
-  blk_->set_trees(trees);
-  std::cout<<"Number of merged cells: "<<merge_count_ << '\n'
-          <<"  New Alpha Size: "<<newA->buffer_length() / 1024.0/1024.0<<" mb" << '\n'
-          <<"  New MOG   Size: "<<newM->buffer_length() / 1024.0/1024.0<<" mb" << '\n'
-          <<"  New NOBS  Size: "<<newN->buffer_length() / 1024.0/1024.0<<" mb" << std::endl;
-
-  //3. Replace data in the cache
-  boxm2_cache_sptr cache = boxm2_cache::instance();
-  cache->replace_data_base(scene_, id, boxm2_data_traits<BOXM2_ALPHA>::prefix(), newA);
-  cache->replace_data_base(scene_, id, boxm2_data_traits<BOXM2_MOG3_GREY>::prefix(), newM);
-  cache->replace_data_base(scene_, id, boxm2_data_traits<BOXM2_NUM_OBS>::prefix(), newN);
-
-  delete [] dataIndex;
-  return true;
 }
 
 /////////////////////////////////////////////////////////////////
@@ -183,6 +223,12 @@ bool boxm2_merge_block_function::merge(std::vector<boxm2_data_base*>& datas)
 // on the global level, so buffers, offsets are used
 /////////////////////////////////////////////////////////////////
 boct_bit_tree boxm2_merge_block_function::merge_bit_tree(boct_bit_tree& unrefined_tree, float* alphas, float prob_thresh)
+{
+  return this->merge_bit_tree(unrefined_tree, alphas, prob_thresh, merge_count_);
+}
+
+boct_bit_tree boxm2_merge_block_function::merge_bit_tree(boct_bit_tree& unrefined_tree, float* alphas, float prob_thresh,
+                                                         int& merge_count)
 {
   //initialize tree to return
   boct_bit_tree merged_tree(unrefined_tree.get_bits(), max_level_);
@@ -194,19 +240,20 @@ boct_bit_tree boxm2_merge_block_function::merge_bit_tree(boct_bit_tree& unrefine
   //create float array to keep track of probs
   float probs[8];
 
-  //push back first generation
-  std::list<int> toVisit;
+  //push back first generation; each of the 585 cells is visited at most
+  //once, so a fixed array serves as the queue
+  int toVisit[585];
+  int front = 0, back = 0;
   for (int i=1; i<9; ++i)
-    toVisit.push_back(i);
+    toVisit[back++] = i;
 
   //iterate through tree if there are children to get to
   int genCounter = 0;    //when this hits 8, a full generation should have been reached
   bool allLeaves = true; //true until a non-leaf gets hit
-  while ( !toVisit.empty() )
+  while ( front < back )
   {
     //get front node off the top of the list, do an intersection for all 8 children
-    int currBit = toVisit.front();
-    toVisit.pop_front();
+    int currBit = toVisit[front++];
 
     //get alpha value for this cell;
     int dataIndex = unrefined_tree.get_data_index(currBit);
@@ -221,7 +268,7 @@ boct_bit_tree boxm2_merge_block_function::merge_bit_tree(boct_bit_tree& unrefine
     if (! unrefined_tree.is_leaf(currBit)) {
       allLeaves = false;
       for (int i=0; i<8; ++i)
-        toVisit.push_back( currBit*8+1+i );
+        toVisit[back++] = currBit*8+1+i;
     }
 
     //if we've finished up a set of siblings, check to see if we can merge em
@@ -237,7 +284,7 @@ boct_bit_tree boxm2_merge_block_function::merge_bit_tree(boct_bit_tree& unrefine
       {
         int pi = (currBit-1)>>3; //Bit_index of parent bit
         merged_tree.set_bit_at(pi, false);
-        merge_count_++;
+        merge_count++;
       }
       //reset gen and allLeaves to default
       genCounter = 0;
@@ -277,18 +324,18 @@ int boxm2_merge_block_function::move_data( boct_bit_tree& old_tree,
   float max_alpha = -std::log(1.0f - init_prob_);
 
   //push back root
-  std::list<int> toVisit;
-  toVisit.push_back(0);
-  while ( !toVisit.empty() )
+  int toVisit[585];
+  int front = 0, back = 0;
+  toVisit[back++] = 0;
+  while ( front < back )
   {
     //get front node off the top of the list, do an intersection for all 8 children
-    int currBit = toVisit.front();
-    toVisit.pop_front();
+    int currBit = toVisit[front++];
 
     //we're traversing merged and old at the same time, but don't branch on old tree
     if (old_tree.bit_at(currBit)==1) {
       for (int i=0; i<8; ++i)
-        toVisit.push_back( currBit*8+1+i );
+        toVisit[back++] = currBit*8+1+i;
     }
 
     //first case: gone to leave that doesn't exist in merged, incrememnt old, not new
@@ -328,9 +375,10 @@ void boxm2_merge_block( boxm2_scene_sptr scene,
                         boxm2_block* blk,
                         std::vector<boxm2_data_base*> & datas,
                         float prob_thresh,
-                        bool is_random)
+                        bool is_random,
+                        unsigned n_threads)
 {
   boxm2_merge_block_function merge_block(scene);
-  merge_block.init_data(blk, datas, prob_thresh);
+  merge_block.init_data(blk, datas, prob_thresh, n_threads);
   merge_block.merge(datas);
 }
@@ -4,6 +4,7 @@
 // \file
 
 #include <iostream>
+#include <vector>
 #include <boxm2/boxm2_data_traits.h>
 #include <boct/boct_bit_tree.h>
 #include <vnl/vnl_vector_fixed.h>
@@ -24,10 +25,13 @@ class boxm2_merge_block_function
                                  merge_count_(0),
                                  prob_thresh_(.05f),
                                  init_prob_(.001f),
-                                 block_len_(1.0) {}
+                                 block_len_(1.0),
+                                 n_threads_(1) {}
 
   //: initialize generic data base pointers as their data type
-  bool init_data(boxm2_block* blk, std::vector<boxm2_data_base*> & datas, float prob_thresh);
+  //  The trees are split between n_threads threads.
+  bool init_data(boxm2_block* blk, std::vector<boxm2_data_base*> & datas, float prob_thresh,
+                 unsigned n_threads = 1);
 
   //: refine function;
   bool merge(std::vector<boxm2_data_base*>& datas);
@@ -46,6 +50,15 @@ class boxm2_merge_block_function
                  ushort4* num_obs_cpy);
 
  private:
+  //: merge trees [begin,end) into trees_copy_, summing their sizes for range t
+  void merge_trees(unsigned begin, unsigned end, unsigned t);
+
+  //: place trees [begin,end) after those of the ranges before t, and move their data
+  void move_trees(unsigned begin, unsigned end, unsigned t);
+
+  //: merge bit tree, adding the number of merged cells to merge_count
+  boct_bit_tree merge_bit_tree(boct_bit_tree& curr_tree, float* alphas, float prob_thresh, int& merge_count);
+
   boxm2_scene_sptr scene_;
   int          merge_count_;
   boxm2_block* blk_;
@@ -69,15 +82,36 @@ class boxm2_merge_block_function
 
   //length of one side of a sub block
   double block_len_;
+
+  unsigned n_threads_;
+
+  //working buffers shared by the threads
+  uchar16* new_trees_;
+  std::vector<uchar16> trees_copy_;
+  std::vector<int> sizes_;
+  float*   alpha_cpy_;
+  uchar8*  mog_cpy_;
+  ushort4* num_obs_cpy_;
+
+  //per range counts and data offsets, combined between the passes
+  std::vector<int> merge_counts_;
+  std::vector<int> range_sizes_;
+  //old data pointer of the first tree of each range, or -1 if the old data
+  //of its trees is not contiguous and in tree order
+  std::vector<int> range_first_ptr_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
 //MAIN REFINE FUNCTION
 ////////////////////////////////////////////////////////////////////////////////
+//: Merge the leaves of blk whose siblings are all nearly empty, and move the data to match.
+//  The trees are merged, and their data moved, by n_threads threads, each
+//  over a range of trees; the result is the same for any number of threads.
 void boxm2_merge_block( boxm2_scene_sptr scene,
                         boxm2_block* blk,
                         std::vector<boxm2_data_base*> & datas,
                         float prob_thresh,
-                        bool is_random = true);
+                        bool is_random = true,
+                        unsigned n_threads = 1);
 
 #endif // boxm2_merge_block_function_h
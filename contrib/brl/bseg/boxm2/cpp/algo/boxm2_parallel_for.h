@@ -0,0 +1,84 @@
+#ifndef boxm2_parallel_for_h
+#define boxm2_parallel_for_h
+//:
+// \file
+// \brief Split a loop over the cells, trees or image columns of a block between threads.
+//
+// (obj->*fn)(begin, end, t) is called once for each of up to n_threads
+// contiguous ranges covering [0,n), with t the index of the range.  The
+// ranges depend only on n and n_threads, so per-range results combined in
+// range order give the same answer as the serial loop.  Callers must only
+// write to locations owned by their range.
+
+#include <vector>
+#include <vcl_compiler.h>
+#include <vxl_config.h>
+
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
+
+template <class T>
+struct boxm2_parallel_for_job
+{
+  T* obj;
+  void (T::*fn)(unsigned, unsigned, unsigned);
+  unsigned begin, end, index;
+
+  void run() { (obj->*fn)(begin, end, index); }
+
+  static void* run_thread(void* job)
+  {
+    static_cast<boxm2_parallel_for_job<T>*>(job)->run();
+    return VXL_NULLPTR;
+  }
+};
+
+//: Number of ranges boxm2_parallel_for() will use for n items
+inline unsigned boxm2_parallel_for_n_ranges(unsigned n, unsigned n_threads)
+{
+  if (n_threads<1) n_threads=1;
+  return n<n_threads ? (n>0 ? n : 1) : n_threads;
+}
+
+//: Call (obj->*fn)(begin,end,t) over boxm2_parallel_for_n_ranges(n,n_threads) ranges of [0,n)
+template <class T>
+void boxm2_parallel_for(T* obj, void (T::*fn)(unsigned, unsigned, unsigned),
+                       unsigned n, unsigned n_threads)
+{
+  unsigned n_ranges = boxm2_parallel_for_n_ranges(n, n_threads);
+  std::vector<boxm2_parallel_for_job<T> > jobs(n_ranges);
+  unsigned step = (n+n_ranges-1)/n_ranges;
+  for (unsigned t=0;t<n_ranges;++t)
+  {
+    jobs[t].obj = obj;
+    jobs[t].fn = fn;
+    jobs[t].index = t;
+    jobs[t].begin = t*step<n ? t*step : n;
+    jobs[t].end = (t+1)*step<n ? (t+1)*step : n;
+  }
+
+#if VXL_HAS_PTHREAD_H
+  if (n_ranges>1)
+  {
+    std::vector<pthread_t> threads(n_ranges);
+    std::vector<bool> started(n_ranges,false);
+    for (unsigned t=1;t<n_ranges;++t)
+      started[t] = pthread_create(&threads[t], VXL_NULLPTR,
+                                  &boxm2_parallel_for_job<T>::run_thread, &jobs[t])==0;
+    jobs[0].run();
+    for (unsigned t=1;t<n_ranges;++t)
+    {
+      if (started[t])
+        pthread_join(threads[t], VXL_NULLPTR);
+      else
+        jobs[t].run(); // Couldn't start thread - do it here
+    }
+    return;
+  }
+#endif
+  for (unsigned t=0;t<n_ranges;++t)
+    jobs[t].run();
+}
+
+#endif // boxm2_parallel_for_h
@@ -1,4 +1,5 @@
 #include "boxm2_refine_block_function.h"
+#include "boxm2_parallel_for.h"
 //:
 // \file
 
@@ -6,11 +7,13 @@
 
 
 //: initialize generic data base pointers as their data type
-bool boxm2_refine_block_function::init_data(boxm2_scene_sptr scene, boxm2_block* blk, std::vector<boxm2_data_base*> & datas, float prob_thresh)
+bool boxm2_refine_block_function::init_data(boxm2_scene_sptr scene, boxm2_block* blk, std::vector<boxm2_data_base*> & datas, float prob_thresh,
+                                            unsigned n_threads)
 {
     //store block and pointer to uchar16 3d block
     scene_ = scene;
     blk_   = blk;
+    n_threads_ = n_threads;
 
     //store data buffers
     int i=0;
@@ -74,77 +77,119 @@ bool boxm2_refine_block_function::refine_deterministic(std::vector<boxm2_data_ba
 {
   std::cout<<"CPU deterministic refine:"<<std::endl;
 
-  //loop over each tree, refine it in place (keep a vector of locations for
-  // posterities sake
+  //1. refine each tree into a copy, keeping the old trees, and sum the new
+  //   tree sizes over each range of trees
   boxm2_array_3d<uchar16> trees = blk_->trees_copy();  //trees to refine
-  uchar16* trees_copy = new uchar16[trees.size()];  //copy of those trees
-  int* dataIndex = new int[trees.size()];           //data index for each new tree
-  int currIndex = 0;                                //curr tree being looked at
+  unsigned num_trees = (unsigned)trees.size();
+  unsigned n_ranges = boxm2_parallel_for_n_ranges(num_trees, n_threads_);
+  trees_ = trees.data_block();
+  trees_copy_.resize(num_trees);
+  sizes_.resize(num_trees);
+  split_counts_.assign(n_ranges, 0);
+  init_counts_.assign(n_ranges, 0);
+  range_sizes_.assign(n_ranges, 0);
+  range_first_ptr_.assign(n_ranges, -1);
+  boxm2_parallel_for(this, &boxm2_refine_block_function::refine_trees, num_trees, n_threads_);
+
+  //2. scan the range sizes into range offsets; move_trees() scans within each range
   int dataSize = 0;                                 //running sum of data size
-  boxm2_array_3d<uchar16>::iterator blk_iter;
-  for (blk_iter = trees.begin(); blk_iter != trees.end(); ++blk_iter, ++currIndex)
+  bool in_place = true;                             //old data already at the new offsets
+  for (unsigned t=0; t<n_ranges; ++t)
   {
-      //0. store data index for eahc tree.
-      dataIndex[currIndex] = dataSize;
-
-      //1. get current tree information
-      uchar16 tree  = (*blk_iter);
-      boct_bit_tree curr_tree( (unsigned char*) tree.data_block(), max_level_);
-
-      //3. refine tree locally (only updates refined_tree and returns new tree size)
-      boct_bit_tree refined_tree = this->refine_bit_tree(curr_tree, 0, false);  //i.e. is not random
-      int newSize = refined_tree.num_cells();
-
-      //cache refined tree
-      std::memcpy (trees_copy[currIndex].data_block(), refined_tree.get_bits(), 16);
-      dataSize += newSize;
+    num_split_ += split_counts_[t];
+    in_place = in_place && range_first_ptr_[t] == dataSize;
+    int rangeSize = range_sizes_[t];
+    range_sizes_[t] = dataSize;
+    dataSize += rangeSize;
   }
+  std::cout<<"Number of split cells: "<<num_split_<<std::endl;
 
+  //nothing split, so the trees and data would be copied unchanged
+  if (num_split_ == 0 && in_place && std::size_t(dataSize) * sizeof(float) == datas[0]->buffer_length())
+  {
+    std::cout<<"Block unchanged, keeping its data"<<std::endl;
+    return true;
+  }
 
-  //2. allocate new data arrays of the appropriate size
+  //3. allocate new data arrays of the appropriate size
   std::cout<<"Allocating new data blocks"<<std::endl;
   boxm2_block_id id = datas[0]->block_id();
   boxm2_data_base* newA = new boxm2_data_base(new char[dataSize * sizeof(float) ], dataSize * sizeof(float), id);
   boxm2_data_base* newM = new boxm2_data_base(new char[dataSize * sizeof(uchar8)], dataSize * sizeof(uchar8), id);
   boxm2_data_base* newN = new boxm2_data_base(new char[dataSize * sizeof(ushort4)], dataSize * sizeof(ushort4), id);
-  float*   alpha_cpy = (float*) newA->data_buffer();
-  uchar8*  mog_cpy   = (uchar8*) newM->data_buffer();
-  ushort4* num_obs_cpy = (ushort4*) newN->data_buffer();
+  alpha_cpy_   = (float*) newA->data_buffer();
+  mog_cpy_     = (uchar8*) newM->data_buffer();
+  num_obs_cpy_ = (ushort4*) newN->data_buffer();
 
-  //3. loop through tree again, putting the data in the right place
+  //4. loop through trees again, putting the data in the right place
   std::cout<<"Swapping data into new blocks..."<<std::endl;
+  boxm2_parallel_for(this, &boxm2_refine_block_function::move_trees, num_trees, n_threads_);
   int newInitCount = 0;
-  currIndex = 0;
-  for (blk_iter = trees.begin(); blk_iter != trees.end(); ++blk_iter, ++currIndex)
+  for (unsigned t=0; t<n_ranges; ++t)
+    newInitCount += init_counts_[t];
+  blk_->set_trees(trees);
+  std::cout<<"Number of new cells: "<<newInitCount<<std::endl;
+
+  //5. Replace data in the cache
+  boxm2_cache_sptr cache = boxm2_cache::instance();
+  cache->replace_data_base(scene_, id, boxm2_data_traits<BOXM2_ALPHA>::prefix(), newA);
+  cache->replace_data_base(scene_, id, boxm2_data_traits<BOXM2_MOG3_GREY>::prefix(), newM);
+  cache->replace_data_base(scene_, id, boxm2_data_traits<BOXM2_NUM_OBS>::prefix(), newN);
+
+  return true;
+}
+
+void boxm2_refine_block_function::refine_trees(unsigned begin, unsigned end, unsigned t)
+{
+  int rangeSize = 0;
+  int firstPtr = 0;
+  for (unsigned currIndex = begin; currIndex < end; ++currIndex)
   {
       //1. get current tree information
-      uchar16 tree  = (*blk_iter);
-      boct_bit_tree old_tree( (unsigned char*) tree.data_block(), max_level_);
+      boct_bit_tree curr_tree( (unsigned char*) trees_[currIndex].data_block(), max_level_);
+
+      //track whether the old data follows on from that of the previous tree;
+      //only used when no tree splits, so old and new sizes are the same
+      int oldDataPtr = curr_tree.get_data_ptr(false);
+      if (currIndex == begin)
+        firstPtr = oldDataPtr;
+      else if (firstPtr >= 0 && oldDataPtr != firstPtr + rangeSize)
+        firstPtr = -1;
 
       //2. refine tree locally (only updates refined_tree and returns new tree size)
-      boct_bit_tree refined_tree( (unsigned char*) trees_copy[currIndex].data_block(), max_level_);
+      boct_bit_tree refined_tree = this->refine_bit_tree(curr_tree, 0, false, split_counts_[t]);  //i.e. is not random
+      sizes_[currIndex] = refined_tree.num_cells();
+      rangeSize += sizes_[currIndex];
+
+      //cache refined tree
+      std::memcpy (trees_copy_[currIndex].data_block(), refined_tree.get_bits(), 16);
+  }
+  range_sizes_[t] = rangeSize;
+  range_first_ptr_[t] = firstPtr;
+}
+
+void boxm2_refine_block_function::move_trees(unsigned begin, unsigned end, unsigned t)
+{
+  int dataIndex = range_sizes_[t];  //offset of the range, from the scan
+  for (unsigned currIndex = begin; currIndex < end; ++currIndex)
+  {
+      //1. get current tree information
+      boct_bit_tree old_tree( (unsigned char*) trees_[currIndex].data_block(), max_level_);
+
+      //2. refine tree locally (only updates refined_tree and returns new tree size)
+      boct_bit_tree refined_tree( (unsigned char*) trees_copy_[currIndex].data_block(), max_level_);
 
       //2.5 pack data bits into refined tree
       //store data index in bits [10, 11, 12, 13] ;
-      int root_index = dataIndex[currIndex];
-      refined_tree.set_data_ptr(root_index, false); //is not random
+      refined_tree.set_data_ptr(dataIndex, false); //is not random
+      dataIndex += sizes_[currIndex];
 
       //3. swap data from old location to new location
-      newInitCount += this->move_data(old_tree, refined_tree, alpha_cpy, mog_cpy, num_obs_cpy);
+      init_counts_[t] += this->move_data(old_tree, refined_tree, alpha_cpy_, mog_cpy_, num_obs_cpy_);
 
       //4. store old tree in new tree, swap data out
-      std::memcpy(blk_iter, refined_tree.get_bits(), 16);
+      std::memcpy(trees_[currIndex].data_block(), refined_tree.get_bits(), 16);
   }
-  blk_->set_trees(trees);
-  std::cout<<"Number of new cells: "<<newInitCount<<std::endl;
-
-  //3. Replace data in the cache
-  boxm2_cache_sptr cache = boxm2_cache::instance();
-  cache->replace_data_base(scene_, id, boxm2_data_traits<BOXM2_ALPHA>::prefix(), newA);
-  cache->replace_data_base(scene_, id, boxm2_data_traits<BOXM2_MOG3_GREY>::prefix(), newM);
-  cache->replace_data_base(scene_, id, boxm2_data_traits<BOXM2_NUM_OBS>::prefix(), newN);
-
-  return true;
 }
 
 /////////////////////////////////////////////////////////////////
@@ -158,6 +203,14 @@ bool boxm2_refine_block_function::refine_deterministic(std::vector<boxm2_data_ba
 boct_bit_tree boxm2_refine_block_function::refine_bit_tree(boct_bit_tree& unrefined_tree,
                                                            int buff_offset,
                                                            bool is_random)
+{
+  return this->refine_bit_tree(unrefined_tree, buff_offset, is_random, num_split_);
+}
+
+boct_bit_tree boxm2_refine_block_function::refine_bit_tree(boct_bit_tree& unrefined_tree,
+                                                           int buff_offset,
+                                                           bool is_random,
+                                                           int& num_split)
 {
   //initialize tree to return
   boct_bit_tree refined_tree(unrefined_tree.get_bits(), max_level_);
@@ -196,7 +249,7 @@ boct_bit_tree boxm2_refine_block_function::refine_bit_tree(boct_bit_tree& unrefi
         refined_tree.set_bit_at(i, true);
 
         //keep track of number of nodes that split
-        ++num_split_;
+        ++num_split;
       }
       ////////////////////////////////////////////
       //END LEAF SPECIFIC CODE
@@ -285,10 +338,11 @@ void boxm2_refine_block( boxm2_scene_sptr scene,
                          boxm2_block* blk,
                          std::vector<boxm2_data_base*> & datas,
                          float prob_thresh,
-                         bool is_random)
+                         bool is_random,
+                         unsigned n_threads)
 {
   boxm2_refine_block_function refine_block;
-  refine_block.init_data(scene, blk, datas, prob_thresh);
+  refine_block.init_data(scene, blk, datas, prob_thresh, n_threads);
 
   refine_block.refine_deterministic(datas);
 }
@@ -4,6 +4,7 @@
 // \file
 
 #include <iostream>
+#include <vector>
 #include <boxm2/boxm2_data_traits.h>
 #include <boxm2/cpp/algo/boxm2_cast_ray_function.h>
 #include <boxm2/cpp/algo/boxm2_mog3_grey_processor.h>
@@ -25,7 +26,9 @@ class boxm2_refine_block_function
   boxm2_refine_block_function() {}
 
   //: initialize generic data base pointers as their data type
-  bool init_data(boxm2_scene_sptr scene, boxm2_block* blk, std::vector<boxm2_data_base*> & datas, float prob_thresh);
+  //  The trees are split between n_threads threads.
+  bool init_data(boxm2_scene_sptr scene, boxm2_block* blk, std::vector<boxm2_data_base*> & datas, float prob_thresh,
+                 unsigned n_threads = 1);
 
   //: refine function;
   bool refine();
@@ -47,6 +50,16 @@ class boxm2_refine_block_function
   int free_space(int startPtr, int endPtr);
 
  private:
+  //: refine trees [begin,end) into trees_copy_, summing their sizes for range t
+  void refine_trees(unsigned begin, unsigned end, unsigned t);
+
+  //: place trees [begin,end) after those of the ranges before t, and move their data
+  void move_trees(unsigned begin, unsigned end, unsigned t);
+
+  //: refine bit tree, adding the number of split cells to num_split
+  boct_bit_tree refine_bit_tree(boct_bit_tree& curr_tree, int buff_offset,
+                                bool is_random, int& num_split);
+
   boxm2_scene_sptr scene_;
   boxm2_block* blk_;
 
@@ -69,15 +82,37 @@ class boxm2_refine_block_function
   double block_len_;
 
   int num_split_;
+
+  unsigned n_threads_;
+
+  //working buffers shared by the threads
+  uchar16* trees_;
+  std::vector<uchar16> trees_copy_;
+  std::vector<int> sizes_;
+  float*   alpha_cpy_;
+  uchar8*  mog_cpy_;
+  ushort4* num_obs_cpy_;
+
+  //per range counts and data offsets, combined between the passes
+  std::vector<int> split_counts_;
+  std::vector<int> init_counts_;
+  std::vector<int> range_sizes_;
+  //old data pointer of the first tree of each range, or -1 if the old data
+  //of its trees is not contiguous and in tree order
+  std::vector<int> range_first_ptr_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
 //MAIN REFINE FUNCTION
 ////////////////////////////////////////////////////////////////////////////////
+//: Refine the trees of blk whose leaves are too occupied, and move the data to match.
+//  The trees are refined, and their data moved, by n_threads threads, each
+//  over a range of trees; the result is the same for any number of threads.
 void boxm2_refine_block( boxm2_scene_sptr scene,
                          boxm2_block* blk,
                          std::vector<boxm2_data_base*> & datas,
                          float prob_thresh,
-                         bool is_random = true);
+                         bool is_random = true,
+                         unsigned n_threads = 1);
 
 #endif
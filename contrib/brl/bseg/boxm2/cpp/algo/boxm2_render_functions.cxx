@@ -3,6 +3,7 @@
 #include "boxm2_render_depth_of_max_prob_functor.h"
 #include "boxm2_cast_cone_ray_function.h"
 #include <vul/vul_timer.h>
+#include <vul/vul_profile.h>
 
 void boxm2_render_expected_image( boxm2_scene_info * linfo,
                                   boxm2_block * blk_sptr,
@@ -15,6 +16,7 @@ void boxm2_render_expected_image( boxm2_scene_info * linfo,
                                   unsigned int roi_ni0,
                                   unsigned int roi_nj0, std::string data_type)
 {
+  VUL_PROFILE_SCOPE("boxm2_render_expected_image");
   if ( data_type.find(boxm2_data_traits<BOXM2_MOG3_GREY>::prefix()) != std::string::npos )
   {
     boxm2_render_exp_image_functor<BOXM2_MOG3_GREY> render_functor;
@@ -62,6 +64,7 @@ void boxm2_render_expected_depth( boxm2_scene_info * linfo,
                                   unsigned int roi_ni0,
                                   unsigned int roi_nj0)
 {
+  VUL_PROFILE_SCOPE("boxm2_render_expected_depth");
   boxm2_render_exp_depth_functor render_functor;
   render_functor.init_data(data,expected,vis,len_img);
   cast_ray_per_block<boxm2_render_exp_depth_functor>
@@ -2,11 +2,13 @@
 #include <boxm2/cpp/algo/boxm2_cone_update_image_functor.h>
 #include "boxm2_cast_cone_ray_function.h"
 #include <boxm2/cpp/algo/boxm2_data_serial_iterator.h>
+#include <boxm2/cpp/algo/boxm2_parallel_for.h>
 #include <boxm2/cpp/algo/boxm2_update_image_functor.h>
 #include <boxm2/cpp/algo/boxm2_update_with_shadow_functor.h>
 #include <boxm2/cpp/algo/boxm2_update_using_quality_functor.h>
 #include <vil/vil_math.h>
 #include <vil/vil_save.h>
+#include <vul/vul_profile.h>
 #include <vpgl/vpgl_perspective_camera.h>
 #include <bsta/bsta_gauss_sf1.h>
 
@@ -147,6 +149,159 @@ bool boxm2_update_cone_image(boxm2_scene_sptr & scene,
     return true;
 }
 
+//: Per-thread BOXM2_AUX buffers for the ray passes of boxm2_update_image().
+//  Band 0 accumulates into the block's own buffer and the other bands into
+//  private copies, which reduce() adds back in band order.  Components below
+//  first_sum are only read during the pass, so the copies take them from the
+//  block's buffer; the others start at zero.
+class boxm2_update_aux_buffers
+{
+ public:
+  typedef boxm2_data_traits<BOXM2_AUX>::datatype aux_t;
+
+  boxm2_update_aux_buffers(boxm2_data_base* aux, unsigned n_bands, unsigned first_sum)
+  : first_sum_(first_sum)
+  {
+    n_cells_ = unsigned(aux->buffer_length()/sizeof(aux_t));
+    buffers_.push_back(aux);
+    const aux_t* src = reinterpret_cast<const aux_t*>(aux->data_buffer());
+    for (unsigned t=1;t<n_bands;++t)
+    {
+      char* bytes = new char[aux->buffer_length()];
+      aux_t* dst = reinterpret_cast<aux_t*>(bytes);
+      for (unsigned i=0;i<n_cells_;++i)
+        for (unsigned k=0;k<4;++k)
+          dst[i][k] = k<first_sum ? src[i][k] : 0.0f;
+      buffers_.push_back(new boxm2_data_base(bytes, aux->buffer_length(), aux->block_id()));
+    }
+  }
+
+  ~boxm2_update_aux_buffers()
+  {
+    for (unsigned t=1;t<buffers_.size();++t)
+      delete buffers_[t];
+  }
+
+  boxm2_data_base* buffer(unsigned t) { return buffers_[t]; }
+
+  //: Add the private sums into the block's buffer
+  void reduce(unsigned n_threads)
+  {
+    if (buffers_.size()>1)
+      boxm2_parallel_for(this, &boxm2_update_aux_buffers::reduce_cells, n_cells_, n_threads);
+  }
+
+ private:
+  void reduce_cells(unsigned begin, unsigned end, unsigned /*range*/)
+  {
+    aux_t* dst = reinterpret_cast<aux_t*>(buffers_[0]->data_buffer());
+    for (unsigned t=1;t<buffers_.size();++t)
+    {
+      const aux_t* src = reinterpret_cast<const aux_t*>(buffers_[t]->data_buffer());
+      for (unsigned i=begin;i<end;++i)
+        for (unsigned k=first_sum_;k<4;++k)
+          dst[i][k] += src[i][k];
+    }
+  }
+
+  std::vector<boxm2_data_base*> buffers_;
+  unsigned n_cells_;
+  unsigned first_sum_;
+};
+
+//: Casts the rays of one block with functors[t] handling the t-th band of image columns
+template <class F>
+class boxm2_update_band_caster
+{
+ public:
+  boxm2_update_band_caster(std::vector<F>& functors, boxm2_scene_info* info,
+                           boxm2_block* blk, vpgl_camera_double_sptr cam, unsigned nj)
+  : functors_(functors), info_(info), blk_(blk), cam_(cam), nj_(nj), ok_(functors.size(), 1) {}
+
+  bool cast(unsigned ni)
+  {
+    boxm2_parallel_for(this, &boxm2_update_band_caster<F>::cast_band, ni, (unsigned)functors_.size());
+    for (unsigned t=0;t<ok_.size();++t)
+      if (!ok_[t]) return false;
+    return true;
+  }
+
+ private:
+  void cast_band(unsigned begin, unsigned end, unsigned t)
+  {
+    ok_[t] = cast_ray_per_block<F>(functors_[t], info_, blk_, cam_, end, nj_, begin, 0);
+  }
+
+  std::vector<F>& functors_;
+  boxm2_scene_info* info_;
+  boxm2_block* blk_;
+  vpgl_camera_double_sptr cam_;
+  unsigned nj_;
+  std::vector<char> ok_;
+};
+
+//: Applies the update of pass 3 to a range of cells
+template <class F>
+struct boxm2_update_cells
+{
+  F* functor;
+  void process(unsigned begin, unsigned end, unsigned /*range*/)
+  {
+    for (unsigned i=begin;i<end;++i)
+      functor->process_cell(int(i));
+  }
+};
+
+//: Passes 1 and 2 of boxm2_update_image() over one block
+template <boxm2_data_type APM_TYPE>
+static bool boxm2_update_block_pass(unsigned pass_no,
+                                    std::vector<boxm2_data_base*> const& datas,
+                                    boxm2_scene_info* info, boxm2_block* blk,
+                                    vpgl_camera_double_sptr cam,
+                                    unsigned ni, unsigned nj,
+                                    vil_image_view<float>& pre_img,
+                                    vil_image_view<float>& vis_img,
+                                    vil_image_view<float>& proc_norm_img,
+                                    unsigned n_threads)
+{
+  unsigned n_bands = boxm2_parallel_for_n_ranges(ni, n_threads);
+  if (pass_no==1)
+  {
+    // Each band only writes its own pixels of pre_img and vis_img
+    std::vector<boxm2_update_pass1_functor<APM_TYPE> > pass1(n_bands);
+    std::vector<boxm2_data_base*> band_datas(datas);
+    for (unsigned t=0;t<n_bands;++t)
+      pass1[t].init_data(band_datas,&pre_img,&vis_img);
+    return boxm2_update_band_caster<boxm2_update_pass1_functor<APM_TYPE> >(pass1,info,blk,cam,nj).cast(ni);
+  }
+
+  // aux[2] and aux[3] are sums over rays, so each band gets its own buffer
+  boxm2_update_aux_buffers aux_buffers(datas[0], n_bands, 2);
+  std::vector<boxm2_update_pass2_functor<APM_TYPE> > pass2(n_bands);
+  for (unsigned t=0;t<n_bands;++t)
+  {
+    std::vector<boxm2_data_base*> band_datas(datas);
+    band_datas[0] = aux_buffers.buffer(t);
+    pass2[t].init_data(band_datas,&pre_img,&vis_img,&proc_norm_img);
+  }
+  bool success = boxm2_update_band_caster<boxm2_update_pass2_functor<APM_TYPE> >(pass2,info,blk,cam,nj).cast(ni);
+  aux_buffers.reduce(n_threads);
+  return success;
+}
+
+//: Pass 3 of boxm2_update_image(): update alpha and appearance from the aux sums
+template <boxm2_data_type APM_TYPE>
+static void boxm2_update_block_data(std::vector<boxm2_data_base*>& datas, boxm2_block* blk,
+                                    unsigned data_buff_length, unsigned n_threads)
+{
+  boxm2_update_data_functor<APM_TYPE> data_functor;
+  data_functor.init_data(datas, float(blk->sub_block_dim().x()), blk->max_level());
+  boxm2_update_cells<boxm2_update_data_functor<APM_TYPE> > cells;
+  cells.functor = &data_functor;
+  boxm2_parallel_for(&cells, &boxm2_update_cells<boxm2_update_data_functor<APM_TYPE> >::process,
+                     data_buff_length, n_threads);
+}
+
 bool boxm2_update_image(boxm2_scene_sptr & scene,
                         std::string data_type,int appTypeSize,
                         std::string num_obs_type,
@@ -155,14 +310,18 @@ bool boxm2_update_image(boxm2_scene_sptr & scene,
                         unsigned int roi_ni,
                         unsigned int roi_nj,
                         unsigned int roi_ni0,
-                        unsigned int roi_nj0)
+                        unsigned int roi_nj0,
+                        unsigned int n_threads)
 {
+    VUL_PROFILE_SCOPE("boxm2_update_image");
     boxm2_cache_sptr cache=boxm2_cache::instance();
     std::vector<boxm2_block_id> vis_order;
     if (vpgl_perspective_camera<double>* pcam = // assignment, not comparison
         dynamic_cast<vpgl_perspective_camera<double>* >(cam.ptr()))
     {
         vis_order=scene->get_vis_blocks(pcam);
+        // backproject() caches an SVD of the camera; build it before the threads share the camera
+        pcam->backproject(0.0, 0.0);
     }
     else
     {
@@ -174,11 +333,15 @@ bool boxm2_update_image(boxm2_scene_sptr & scene,
         return true;
     }
 
+    VUL_PROFILE_COUNT("boxm2_update_image blocks", vis_order.size());
     unsigned int num_passes=3;
+    unsigned ni = input_image->ni(), nj = input_image->nj();
+    // Rays are split between threads by bands of image columns
+    unsigned n_bands = boxm2_parallel_for_n_ranges(ni, n_threads);
 
-    vil_image_view<float> pre_img(input_image->ni(),input_image->nj());
-    vil_image_view<float> vis_img(input_image->ni(),input_image->nj());
-    vil_image_view<float> proc_norm_img(input_image->ni(),input_image->nj());
+    vil_image_view<float> pre_img(ni,nj);
+    vil_image_view<float> vis_img(ni,nj);
+    vil_image_view<float> proc_norm_img(ni,nj);
     proc_norm_img.fill(0.0);
     int alphaTypeSize = (int)boxm2_data_info::datasize(boxm2_data_traits<BOXM2_ALPHA>::prefix());
     int nobsTypeSize = (int)boxm2_data_info::datasize(boxm2_data_traits<BOXM2_NUM_OBS>::prefix());
@@ -211,51 +374,29 @@ bool boxm2_update_image(boxm2_scene_sptr & scene,
             // pass 0
             if (pass_no==0)
             {
-                boxm2_update_pass0_functor pass0;
-                pass0.init_data(datas,input_image);
-                success=success && cast_ray_per_block<boxm2_update_pass0_functor>
-                                       (pass0,
-                                        scene_info_wrapper->info,
-                                        blk,
-                                        cam,
-                                        input_image->ni(),
-                                        input_image->nj());
+                // aux[0] and aux[1] are sums over rays, so each band gets its own buffer
+                boxm2_update_aux_buffers aux_buffers(aux, n_bands, 0);
+                std::vector<boxm2_update_pass0_functor> pass0(n_bands);
+                for (unsigned t=0;t<n_bands;++t)
+                {
+                    std::vector<boxm2_data_base*> band_datas(datas);
+                    band_datas[0] = aux_buffers.buffer(t);
+                    pass0[t].init_data(band_datas,input_image);
+                }
+                success=success && boxm2_update_band_caster<boxm2_update_pass0_functor>
+                                       (pass0,scene_info_wrapper->info,blk,cam,nj).cast(ni);
+                aux_buffers.reduce(n_threads);
             }
-            // pass 1
-            else if (pass_no==1)
+            // pass 1 and 2
+            else if (data_type.find(boxm2_data_traits<BOXM2_GAUSS_GREY>::prefix()) != std::string::npos)
             {
-              if (data_type.find(boxm2_data_traits<BOXM2_GAUSS_GREY>::prefix()) != std::string::npos)
-              {
-                boxm2_update_pass1_functor<BOXM2_GAUSS_GREY> pass1;
-                pass1.init_data(datas,&pre_img,&vis_img);
-                success=success&&cast_ray_per_block<boxm2_update_pass1_functor<BOXM2_GAUSS_GREY> >
-                  (pass1,scene_info_wrapper->info,blk,cam,input_image->ni(),input_image->nj());
-              }
-              else if (data_type.find(boxm2_data_traits<BOXM2_MOG3_GREY>::prefix()) != std::string::npos)
-              {
-                boxm2_update_pass1_functor<BOXM2_MOG3_GREY> pass1;
-                pass1.init_data(datas,&pre_img,&vis_img);
-                success=success&&cast_ray_per_block<boxm2_update_pass1_functor<BOXM2_MOG3_GREY> >
-                  (pass1,scene_info_wrapper->info,blk,cam,input_image->ni(),input_image->nj());
-              }
+                success=success && boxm2_update_block_pass<BOXM2_GAUSS_GREY>
+                  (pass_no,datas,scene_info_wrapper->info,blk,cam,ni,nj,pre_img,vis_img,proc_norm_img,n_threads);
             }
-            // pass 2
-            else if (pass_no==2)
+            else if (data_type.find(boxm2_data_traits<BOXM2_MOG3_GREY>::prefix()) != std::string::npos)
             {
-              if (data_type.find(boxm2_data_traits<BOXM2_GAUSS_GREY>::prefix()) != std::string::npos)
-              {
-                boxm2_update_pass2_functor<BOXM2_GAUSS_GREY> pass2;
-                pass2.init_data(datas,&pre_img,&vis_img, & proc_norm_img);
-                success=success&&cast_ray_per_block<boxm2_update_pass2_functor<BOXM2_GAUSS_GREY> >
-                  (pass2,scene_info_wrapper->info,blk,cam,input_image->ni(),input_image->nj());
-              }
-              else if (data_type.find(boxm2_data_traits<BOXM2_MOG3_GREY>::prefix()) != std::string::npos)
-              {
-                boxm2_update_pass2_functor<BOXM2_MOG3_GREY> pass2;
-                pass2.init_data(datas,&pre_img,&vis_img, & proc_norm_img);
-                success=success&&cast_ray_per_block<boxm2_update_pass2_functor<BOXM2_MOG3_GREY> >
-                  (pass2,scene_info_wrapper->info,blk,cam,input_image->ni(),input_image->nj());
-              }
+                success=success && boxm2_update_block_pass<BOXM2_MOG3_GREY>
+                  (pass_no,datas,scene_info_wrapper->info,blk,cam,ni,nj,pre_img,vis_img,proc_norm_img,n_threads);
             }
         }
         if (pass_no==1)
@@ -285,19 +426,11 @@ bool boxm2_update_image(boxm2_scene_sptr & scene,
         datas.push_back(alph);
         datas.push_back(mog);
         datas.push_back(nobs);
-        int data_buff_length = (int) (alph->buffer_length()/alphaTypeSize);
+        unsigned data_buff_length = (unsigned) (alph->buffer_length()/alphaTypeSize);
         if (data_type.find(boxm2_data_traits<BOXM2_GAUSS_GREY>::prefix()) != std::string::npos)
-        {
-          boxm2_update_data_functor<BOXM2_GAUSS_GREY> data_functor;
-          data_functor.init_data(datas, float(blk->sub_block_dim().x()), blk->max_level());
-          boxm2_data_serial_iterator<boxm2_update_data_functor<BOXM2_GAUSS_GREY> >(data_buff_length,data_functor);
-        }
+          boxm2_update_block_data<BOXM2_GAUSS_GREY>(datas, blk, data_buff_length, n_threads);
         else if (data_type.find(boxm2_data_traits<BOXM2_MOG3_GREY>::prefix()) != std::string::npos)
-        {
-          boxm2_update_data_functor<BOXM2_MOG3_GREY> data_functor;
-          data_functor.init_data(datas, float(blk->sub_block_dim().x()), blk->max_level());
-          boxm2_data_serial_iterator<boxm2_update_data_functor<BOXM2_MOG3_GREY> >(data_buff_length,data_functor);
-        }
+          boxm2_update_block_data<BOXM2_MOG3_GREY>(datas, blk, data_buff_length, n_threads);
 
         cache->remove_data_base(scene,*id,boxm2_data_traits<BOXM2_AUX>::prefix());
     }
@@ -317,6 +450,7 @@ bool boxm2_update_with_shadow(boxm2_scene_sptr & scene,
                               unsigned int roi_ni0,
                               unsigned int roi_nj0)
 {
+    VUL_PROFILE_SCOPE("boxm2_update_with_shadow");
     boxm2_cache_sptr cache=boxm2_cache::instance();
     std::vector<boxm2_block_id> vis_order=scene->get_vis_blocks(reinterpret_cast<vpgl_generic_camera<double>*>(cam.ptr()));
     if (vis_order.empty())
@@ -481,6 +615,7 @@ bool boxm2_update_using_quality(boxm2_scene_sptr & scene,
                                 unsigned int roi_ni0,
                                 unsigned int roi_nj0)
 {
+    VUL_PROFILE_SCOPE("boxm2_update_using_quality");
     boxm2_cache_sptr cache=boxm2_cache::instance();
     std::vector<boxm2_block_id> vis_order=scene->get_vis_blocks(reinterpret_cast<vpgl_generic_camera<double>*>(cam.ptr()));
     if (vis_order.empty())
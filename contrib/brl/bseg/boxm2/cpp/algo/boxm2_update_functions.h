@@ -19,6 +19,10 @@ bool boxm2_update_cone_image(boxm2_scene_sptr & scene,
                              unsigned int roi_nj0=0);
 
 
+//: Update the scene from one image.
+//  The rays are cast by n_threads threads, each over a band of image columns;
+//  sums over rays go to per-thread buffers that are added once a pass is done,
+//  so results match the single-threaded update up to float rounding.
 bool boxm2_update_image(boxm2_scene_sptr & scene,
                              std::string data_type,int appTypeSize,
                              std::string num_obs_type,
@@ -27,7 +31,8 @@ bool boxm2_update_image(boxm2_scene_sptr & scene,
                              unsigned int roi_ni,
                              unsigned int roi_nj,
                              unsigned int roi_ni0=0,
-                             unsigned int roi_nj0=0);
+                             unsigned int roi_nj0=0,
+                             unsigned int n_threads=1);
 
 bool boxm2_update_with_shadow(boxm2_scene_sptr & scene,
                               std::string data_type,int appTypeSize,
@@ -14,6 +14,7 @@
 #include <boxm2/cpp/algo/boxm2_cone_update_image_functor.h>
 #include <boxm2/cpp/algo/boxm2_create_mog_image_functor.h>
 #include <boxm2/cpp/algo/boxm2_data_serial_iterator.h>
+#include <boxm2/cpp/algo/boxm2_parallel_for.h>
 #include <boxm2/cpp/algo/boxm2_export_oriented_point_cloud_function.h>
 #include <boxm2/cpp/algo/boxm2_export_stack_images_function.h>
 #include <boxm2/cpp/algo/boxm2_filter_block_function.h>
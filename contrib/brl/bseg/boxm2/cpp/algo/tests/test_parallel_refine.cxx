@@ -0,0 +1,172 @@
+//:
+// \file
+// \brief Compares multi-threaded refine, merge and filter of a boxm2 block with the single-threaded ones
+
+#include <vector>
+#include <cstring>
+#include <iostream>
+#include <testlib/testlib_test.h>
+#include <vgl/vgl_point_3d.h>
+
+#include <boxm2/boxm2_scene.h>
+#include <boxm2/boxm2_block.h>
+#include <boxm2/boxm2_data_base.h>
+#include <boxm2/boxm2_block_metadata.h>
+#include <boxm2/io/boxm2_lru_cache.h>
+#include <boxm2/cpp/algo/boxm2_refine_block_function.h>
+#include <boxm2/cpp/algo/boxm2_merge_block_function.h>
+#include <boxm2/cpp/algo/boxm2_filter_block_function.h>
+
+//: Trees and data buffers of a block
+struct boxm2_block_state
+{
+  std::vector<unsigned char> trees;
+  std::vector<char> alpha, mog, nobs;
+};
+
+static std::vector<char> buffer_copy(boxm2_data_base* data)
+{
+  return std::vector<char>(data->data_buffer(), data->data_buffer()+data->buffer_length());
+}
+
+static boxm2_data_base* data_copy(std::vector<char> const& buffer, boxm2_block_id id)
+{
+  char* data = new char[buffer.size()];
+  std::memcpy(data, &buffer[0], buffer.size());
+  return new boxm2_data_base(data, buffer.size(), id);
+}
+
+static boxm2_block_state current_state(boxm2_scene_sptr& scene, boxm2_block_id id)
+{
+  boxm2_cache_sptr cache = boxm2_cache::instance();
+  boxm2_block_state state;
+  const boxm2_array_3d<vnl_vector_fixed<unsigned char,16> >& trees = cache->get_block(scene,id)->trees();
+  const unsigned char* bits = trees.begin()->data_block();
+  state.trees.assign(bits, bits + 16*trees.size());
+  state.alpha = buffer_copy(cache->get_data_base(scene,id,boxm2_data_traits<BOXM2_ALPHA>::prefix()));
+  state.mog = buffer_copy(cache->get_data_base(scene,id,boxm2_data_traits<BOXM2_MOG3_GREY>::prefix()));
+  state.nobs = buffer_copy(cache->get_data_base(scene,id,boxm2_data_traits<BOXM2_NUM_OBS>::prefix()));
+  return state;
+}
+
+static void restore_state(boxm2_scene_sptr& scene, boxm2_block_id id, boxm2_block_state const& state)
+{
+  boxm2_cache_sptr cache = boxm2_cache::instance();
+  boxm2_block* blk = cache->get_block(scene,id);
+  boxm2_array_3d<vnl_vector_fixed<unsigned char,16> > trees = blk->trees_copy();
+  std::memcpy(trees.begin()->data_block(), &state.trees[0], state.trees.size());
+  blk->set_trees(trees);
+  cache->replace_data_base(scene, id, boxm2_data_traits<BOXM2_ALPHA>::prefix(), data_copy(state.alpha, id));
+  cache->replace_data_base(scene, id, boxm2_data_traits<BOXM2_MOG3_GREY>::prefix(), data_copy(state.mog, id));
+  cache->replace_data_base(scene, id, boxm2_data_traits<BOXM2_NUM_OBS>::prefix(), data_copy(state.nobs, id));
+}
+
+static std::vector<boxm2_data_base*> block_datas(boxm2_scene_sptr& scene, boxm2_block_id id)
+{
+  boxm2_cache_sptr cache = boxm2_cache::instance();
+  std::vector<boxm2_data_base*> datas;
+  datas.push_back(cache->get_data_base(scene,id,boxm2_data_traits<BOXM2_ALPHA>::prefix()));
+  datas.push_back(cache->get_data_base(scene,id,boxm2_data_traits<BOXM2_MOG3_GREY>::prefix()));
+  datas.push_back(cache->get_data_base(scene,id,boxm2_data_traits<BOXM2_NUM_OBS>::prefix()));
+  return datas;
+}
+
+static bool same_state(boxm2_block_state const& a, boxm2_block_state const& b)
+{
+  return a.trees == b.trees && a.alpha == b.alpha && a.mog == b.mog && a.nobs == b.nobs;
+}
+
+static boxm2_block_state refine(boxm2_scene_sptr& scene, boxm2_block_id id, unsigned n_threads)
+{
+  std::vector<boxm2_data_base*> datas = block_datas(scene, id);
+  boxm2_refine_block(scene, boxm2_cache::instance()->get_block(scene,id), datas, 0.3f, false, n_threads);
+  return current_state(scene, id);
+}
+
+static boxm2_block_state merge(boxm2_scene_sptr& scene, boxm2_block_id id, unsigned n_threads)
+{
+  std::vector<boxm2_data_base*> datas = block_datas(scene, id);
+  boxm2_merge_block(scene, boxm2_cache::instance()->get_block(scene,id), datas, 0.5f, false, n_threads);
+  return current_state(scene, id);
+}
+
+static boxm2_block_state filter(boxm2_scene_sptr& scene, boxm2_block_id id, unsigned n_threads)
+{
+  boxm2_cache_sptr cache = boxm2_cache::instance();
+  boxm2_filter_block_function(scene, scene->blocks()[id], cache->get_block(scene,id),
+                              cache->get_data_base(scene,id,boxm2_data_traits<BOXM2_ALPHA>::prefix()), n_threads);
+  return current_state(scene, id);
+}
+
+void test_parallel_refine()
+{
+  boxm2_scene_sptr scene = new boxm2_scene();
+  scene->set_local_origin( vgl_point_3d<double>(0,0,0) );
+  std::map<boxm2_block_id, boxm2_block_metadata> blocks;
+  boxm2_block_id id(0,0,0);
+  blocks[id] = boxm2_block_metadata(id, vgl_point_3d<double>(0,0,0),
+                                    vgl_vector_3d<double>(1.0, 1.0, 1.0),
+                                    vgl_vector_3d<unsigned>(6,5,4),
+                                    1, 4, 100, 0.01);
+  scene->set_blocks(blocks);
+  std::vector<std::string> appearances;
+  appearances.push_back(boxm2_data_traits<BOXM2_MOG3_GREY>::prefix());
+  appearances.push_back(boxm2_data_traits<BOXM2_NUM_OBS>::prefix());
+  scene->set_appearances(appearances);
+  boxm2_lru_cache::create(scene);
+
+  // Occupancies spread either side of the refine threshold
+  boxm2_data_base* alpha = boxm2_cache::instance()->get_data_base(scene,id,boxm2_data_traits<BOXM2_ALPHA>::prefix());
+  float* alphas = reinterpret_cast<float*>(alpha->data_buffer());
+  unsigned seed = 11;
+  for (unsigned i=0; i<alpha->buffer_length()/sizeof(float); ++i)
+  {
+    seed = seed*1103515245u + 12345u;
+    alphas[i] = float((seed>>16)&0x7fff)/32768.0f;
+  }
+
+  boxm2_block_state initial = current_state(scene, id);
+  boxm2_block_state refined = refine(scene, id, 1);
+  std::cout << "Refined data length " << refined.alpha.size()/sizeof(float)
+            << " from " << initial.alpha.size()/sizeof(float) << '\n';
+  TEST("Serial refine split cells", refined.alpha.size() > initial.alpha.size(), true);
+
+  // New cells start just below the threshold; raise them all to split again
+  alpha = boxm2_cache::instance()->get_data_base(scene,id,boxm2_data_traits<BOXM2_ALPHA>::prefix());
+  alphas = reinterpret_cast<float*>(alpha->data_buffer());
+  for (unsigned i=0; i<alpha->buffer_length()/sizeof(float); ++i)
+    alphas[i] *= 3.0f;
+  boxm2_block_state raised = current_state(scene, id);
+  boxm2_block_state refined_twice = refine(scene, id, 1);
+  TEST("Serial refine split cells again", refined_twice.alpha.size() > refined.alpha.size(), true);
+
+  for (unsigned n_threads = 3; n_threads <= 7; n_threads += 4)
+  {
+    restore_state(scene, id, initial);
+    TEST("Refine matches serial", same_state(refine(scene, id, n_threads), refined), true);
+    restore_state(scene, id, raised);
+    TEST("Second refine matches serial", same_state(refine(scene, id, n_threads), refined_twice), true);
+  }
+
+  // A block with nothing to split keeps its data
+  boxm2_data_base* before = boxm2_cache::instance()->get_data_base(scene,id,boxm2_data_traits<BOXM2_ALPHA>::prefix());
+  std::vector<boxm2_data_base*> datas = block_datas(scene, id);
+  boxm2_refine_block(scene, boxm2_cache::instance()->get_block(scene,id), datas, 0.999999f, false, 3);
+  TEST("Unchanged block keeps its buffers",
+       boxm2_cache::instance()->get_data_base(scene,id,boxm2_data_traits<BOXM2_ALPHA>::prefix()) == before &&
+       same_state(current_state(scene, id), refined_twice), true);
+
+  boxm2_block_state merged = merge(scene, id, 1);
+  std::cout << "Merged data length " << merged.alpha.size()/sizeof(float) << '\n';
+  TEST("Serial merge merged cells", merged.alpha.size() < refined_twice.alpha.size(), true);
+  restore_state(scene, id, refined_twice);
+  TEST("Merge matches serial", same_state(merge(scene, id, 4), merged), true);
+
+  restore_state(scene, id, refined_twice);
+  boxm2_block_state filtered = filter(scene, id, 1);
+  TEST("Serial filter changed alpha", filtered.alpha != refined_twice.alpha, true);
+  restore_state(scene, id, refined_twice);
+  TEST("Filter matches serial", same_state(filter(scene, id, 5), filtered), true);
+}
+
+TESTMAIN(test_parallel_refine);
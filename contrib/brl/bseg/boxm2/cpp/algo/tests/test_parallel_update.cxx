@@ -0,0 +1,134 @@
+//:
+// \file
+// \brief Compares the multi-threaded boxm2_update_image() with the single-threaded one
+
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <iostream>
+#include <testlib/testlib_test.h>
+#include <vgl/vgl_point_3d.h>
+#include <vpgl/vpgl_perspective_camera.h>
+#include <vil/vil_image_view.h>
+
+#include <boxm2/boxm2_scene.h>
+#include <boxm2/boxm2_block.h>
+#include <boxm2/boxm2_data_base.h>
+#include <boxm2/boxm2_block_metadata.h>
+#include <boxm2/io/boxm2_lru_cache.h>
+#include <boxm2/cpp/algo/boxm2_update_functions.h>
+
+//: Contents of the data buffers updated by boxm2_update_image()
+struct boxm2_update_state
+{
+  std::vector<char> alpha, mog, nobs;
+};
+
+static std::vector<char> buffer_copy(boxm2_data_base* data)
+{
+  return std::vector<char>(data->data_buffer(), data->data_buffer()+data->buffer_length());
+}
+
+static boxm2_update_state current_state(boxm2_scene_sptr& scene, boxm2_block_id id)
+{
+  boxm2_cache_sptr cache = boxm2_cache::instance();
+  boxm2_update_state state;
+  state.alpha = buffer_copy(cache->get_data_base(scene,id,boxm2_data_traits<BOXM2_ALPHA>::prefix()));
+  state.mog = buffer_copy(cache->get_data_base(scene,id,boxm2_data_traits<BOXM2_MOG3_GREY>::prefix()));
+  state.nobs = buffer_copy(cache->get_data_base(scene,id,boxm2_data_traits<BOXM2_NUM_OBS>::prefix()));
+  return state;
+}
+
+static void restore_state(boxm2_scene_sptr& scene, boxm2_block_id id, boxm2_update_state const& state)
+{
+  boxm2_cache_sptr cache = boxm2_cache::instance();
+  std::memcpy(cache->get_data_base(scene,id,boxm2_data_traits<BOXM2_ALPHA>::prefix())->data_buffer(),
+              &state.alpha[0], state.alpha.size());
+  std::memcpy(cache->get_data_base(scene,id,boxm2_data_traits<BOXM2_MOG3_GREY>::prefix())->data_buffer(),
+              &state.mog[0], state.mog.size());
+  std::memcpy(cache->get_data_base(scene,id,boxm2_data_traits<BOXM2_NUM_OBS>::prefix())->data_buffer(),
+              &state.nobs[0], state.nobs.size());
+}
+
+static boxm2_update_state update(boxm2_scene_sptr& scene, boxm2_block_id id,
+                                 vpgl_camera_double_sptr cam, vil_image_view<float>& img,
+                                 unsigned n_threads)
+{
+  boxm2_update_image(scene, boxm2_data_traits<BOXM2_MOG3_GREY>::prefix(),
+                     (int)boxm2_data_info::datasize(boxm2_data_traits<BOXM2_MOG3_GREY>::prefix()),
+                     boxm2_data_traits<BOXM2_NUM_OBS>::prefix(),
+                     cam, &img, img.ni(), img.nj(), 0, 0, n_threads);
+  return current_state(scene, id);
+}
+
+void test_parallel_update()
+{
+  boxm2_scene_sptr scene = new boxm2_scene();
+  scene->set_local_origin( vgl_point_3d<double>(0,0,0) );
+  std::map<boxm2_block_id, boxm2_block_metadata> blocks;
+  boxm2_block_id id(0,0,0);
+  blocks[id] = boxm2_block_metadata(id, vgl_point_3d<double>(0,0,0),
+                                    vgl_vector_3d<double>(1.0/8.0, 1.0/8.0, 1.0/8.0),
+                                    vgl_vector_3d<unsigned>(8,8,2),
+                                    2, 4, 100, 0.01);
+  scene->set_blocks(blocks);
+  std::vector<std::string> appearances;
+  appearances.push_back(boxm2_data_traits<BOXM2_MOG3_GREY>::prefix());
+  appearances.push_back(boxm2_data_traits<BOXM2_NUM_OBS>::prefix());
+  scene->set_appearances(appearances);
+  boxm2_lru_cache::create(scene);
+
+  // Camera looking straight down on the block
+  vpgl_calibration_matrix<double> K(2400.0, vgl_point_2d<double>(12.0,12.0));
+  vnl_matrix_fixed<double,3,3> mr(0.0);
+  mr[0][0]=1.0; mr[1][1]=-1.0; mr[2][2]=-1.0;
+  vpgl_camera_double_sptr cam =
+    new vpgl_perspective_camera<double>(K, vgl_point_3d<double>(0.5,0.5,100), vgl_rotation_3d<double>(mr));
+
+  vil_image_view<float> img(24,24);
+  unsigned seed = 7;
+  for (unsigned j=0;j<img.nj();++j)
+    for (unsigned i=0;i<img.ni();++i)
+    {
+      seed = seed*1103515245u + 12345u;
+      img(i,j) = float((seed>>16)&0x7fff)/32768.0f;
+    }
+
+  boxm2_update_state initial = current_state(scene, id);
+  boxm2_update_state serial = update(scene, id, cam, img, 1);
+  TEST("Serial update changed alpha", serial.alpha != initial.alpha, true);
+  TEST("Serial update changed appearance", serial.mog != initial.mog, true);
+
+  for (unsigned n_threads = 3; n_threads <= 5; n_threads += 2)
+  {
+    restore_state(scene, id, initial);
+    boxm2_update_state parallel = update(scene, id, cam, img, n_threads);
+
+    const float* a = reinterpret_cast<const float*>(&serial.alpha[0]);
+    const float* b = reinterpret_cast<const float*>(&parallel.alpha[0]);
+    double max_rel = 0.0;
+    for (unsigned i=0;i<serial.alpha.size()/sizeof(float);++i)
+    {
+      double d = std::fabs(a[i]-b[i])/std::max(1e-6, double(std::fabs(a[i])));
+      if (d>max_rel) max_rel = d;
+    }
+    std::cout << n_threads << " threads: largest relative alpha difference " << max_rel << '\n';
+    TEST("Alpha matches serial update", max_rel < 1e-4, true);
+
+    int max_app = 0;
+    for (unsigned i=0;i<serial.mog.size();++i)
+      max_app = std::max(max_app, std::abs(int((unsigned char)serial.mog[i]) - int((unsigned char)parallel.mog[i])));
+    TEST("Appearance matches serial update", max_app <= 1, true);
+
+    const unsigned short* na = reinterpret_cast<const unsigned short*>(&serial.nobs[0]);
+    const unsigned short* nb = reinterpret_cast<const unsigned short*>(&parallel.nobs[0]);
+    int max_nobs = 0;
+    for (unsigned i=0;i<serial.nobs.size()/sizeof(unsigned short);++i)
+      max_nobs = std::max(max_nobs, std::abs(int(na[i])-int(nb[i])));
+    TEST("Observation counts match serial update", max_nobs <= 1, true);
+  }
+}
+
+TESTMAIN(test_parallel_update);
@@ -23,7 +23,7 @@
 
 namespace boxm2_cpp_filter_process_globals
 {
-  const unsigned n_inputs_ =  2;
+  const unsigned n_inputs_ =  3;
   const unsigned n_outputs_ = 0;
 }
 
@@ -35,12 +35,14 @@ bool boxm2_cpp_filter_process_cons(bprb_func_process& pro)
   std::vector<std::string> input_types_(n_inputs_);
   input_types_[0] = "boxm2_scene_sptr";
   input_types_[1] = "boxm2_cache_sptr";
-  //input_types_[2] = "float";
+  input_types_[2] = "unsigned";  // number of threads filtering each block (default 1)
 
   // process has 1 output:
   // output[0]: scene sptr
   std::vector<std::string>  output_types_(n_outputs_);
-  return pro.set_input_types(input_types_) && pro.set_output_types(output_types_);
+  bool good = pro.set_input_types(input_types_) && pro.set_output_types(output_types_);
+  pro.set_input(2, new brdb_value_t<unsigned>(1));
+  return good;
 }
 
 bool boxm2_cpp_filter_process(bprb_func_process& pro)
@@ -55,6 +57,7 @@ bool boxm2_cpp_filter_process(bprb_func_process& pro)
   unsigned i = 0;
   boxm2_scene_sptr scene =pro.get_input<boxm2_scene_sptr>(i++);
   boxm2_cache_sptr cache= pro.get_input<boxm2_cache_sptr>(i++);
+  unsigned n_threads = pro.get_input<unsigned>(i++);
 
   //zip through each block
   std::map<boxm2_block_id, boxm2_block_metadata> blocks = scene->blocks();
@@ -69,7 +72,7 @@ bool boxm2_cpp_filter_process(bprb_func_process& pro)
 
     //refine block and datas
     boxm2_block_metadata data = blk_iter->second;
-    boxm2_filter_block_function(scene, data, blk,alph);
+    boxm2_filter_block_function(scene, data, blk,alph, n_threads);
   }
 
   return true;
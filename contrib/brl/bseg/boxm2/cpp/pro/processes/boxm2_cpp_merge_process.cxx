@@ -24,7 +24,7 @@
 
 namespace boxm2_cpp_merge_process_globals
 {
-  const unsigned n_inputs_ =  3;
+  const unsigned n_inputs_ =  4;
   const unsigned n_outputs_ = 0;
 }
 
@@ -37,10 +37,13 @@ bool boxm2_cpp_merge_process_cons(bprb_func_process& pro)
   input_types_[0] = "boxm2_scene_sptr";   //scene to operate on
   input_types_[1] = "boxm2_cache_sptr";   //cache with access to scene blocks
   input_types_[2] = "float";              //threshold occupancy probability (if all 8 children are below this, merge them)
+  input_types_[3] = "unsigned";           //number of threads merging each block (default 1)
 
   // process has 0 output:
   std::vector<std::string>  output_types_(n_outputs_);
-  return pro.set_input_types(input_types_) && pro.set_output_types(output_types_);
+  bool good = pro.set_input_types(input_types_) && pro.set_output_types(output_types_);
+  pro.set_input(3, new brdb_value_t<unsigned>(1));
+  return good;
 }
 
 bool boxm2_cpp_merge_process(bprb_func_process& pro)
@@ -58,6 +61,7 @@ bool boxm2_cpp_merge_process(bprb_func_process& pro)
   boxm2_cache_sptr cache = pro.get_input<boxm2_cache_sptr>(i++);
   std::cout<<"Getting thresh input"<<std::endl;
   float thresh = pro.get_input<float>(i++);
+  unsigned n_threads = pro.get_input<unsigned>(i++);
 
   //check datatype
   bool foundDataType = false;
@@ -99,7 +103,7 @@ bool boxm2_cpp_merge_process(bprb_func_process& pro)
 
     //refine block and datas
     boxm2_block_metadata data = blk_iter->second;
-    boxm2_merge_block(scene, blk,datas, thresh, false);
+    boxm2_merge_block(scene, blk,datas, thresh, false, n_threads);
     blk->enable_write(); // now cache will make sure that it is written to disc
   }
 
@@ -23,7 +23,7 @@
 
 namespace boxm2_cpp_refine_process2_globals
 {
-  const unsigned n_inputs_ =  4;
+  const unsigned n_inputs_ =  5;
   const unsigned n_outputs_ = 0;
 }
 
@@ -37,6 +37,7 @@ bool boxm2_cpp_refine_process2_cons(bprb_func_process& pro)
   input_types_[1] = "boxm2_cache_sptr";
   input_types_[2] = "float";
   input_types_[3] = "vcl_string";// if identifier is empty, then only one appearance model
+  input_types_[4] = "unsigned";  // number of threads refining each block (default 1)
 
   // process has 1 output:
   // output[0]: scene sptr
@@ -46,6 +47,7 @@ bool boxm2_cpp_refine_process2_cons(bprb_func_process& pro)
   // in case the 4th input is not set
   brdb_value_sptr id = new brdb_value_t<std::string>("");
   pro.set_input(3, id);
+  pro.set_input(4, new brdb_value_t<unsigned>(1));
   return good;
 }
 
@@ -63,6 +65,7 @@ bool boxm2_cpp_refine_process2(bprb_func_process& pro)
   boxm2_cache_sptr cache= pro.get_input<boxm2_cache_sptr>(i++);
   float  thresh=pro.get_input<float>(i++);
   std::string identifier = pro.get_input<std::string>(i++);
+  unsigned n_threads = pro.get_input<unsigned>(i++);
 
   bool foundDataType = false;
   std::string data_type;
@@ -108,7 +111,7 @@ bool boxm2_cpp_refine_process2(bprb_func_process& pro)
 
     //refine block and datas
     boxm2_block_metadata data = blk_iter->second;
-    boxm2_refine_block(scene,blk,datas, thresh, false);
+    boxm2_refine_block(scene,blk,datas, thresh, false, n_threads);
     blk->enable_write(); // now cache will make sure that it is written to disc
   }
 
@@ -26,7 +26,7 @@
 
 namespace boxm2_cpp_update_image_process_globals
 {
-  const unsigned n_inputs_ = 5;
+  const unsigned n_inputs_ = 6;
   const unsigned n_outputs_ = 0;
 }
 
@@ -34,18 +34,20 @@ bool boxm2_cpp_update_image_process_cons(bprb_func_process& pro)
 {
   using namespace boxm2_cpp_update_image_process_globals;
 
-  //process takes 4 inputs
+  //process takes 6 inputs
   // 0) scene
   // 1) cache
   // 2) camera
   // 3) image
   // 4) illumination_bin_index
+  // 5) number of threads casting rays (default 1)
   std::vector<std::string> input_types_(n_inputs_);
   input_types_[0] = "boxm2_scene_sptr";
   input_types_[1] = "boxm2_cache_sptr";
   input_types_[2] = "vpgl_camera_double_sptr";
   input_types_[3] = "vil_image_view_base_sptr";
   input_types_[4] = "vcl_string";// if identifier is empty, then only one appearance model
+  input_types_[5] = "unsigned";
   // process has 1 output:
   // output[0]: scene sptr
   std::vector<std::string>  output_types_(n_outputs_);
@@ -54,6 +56,7 @@ bool boxm2_cpp_update_image_process_cons(bprb_func_process& pro)
   // in case the 5th input is not set
   brdb_value_sptr idx = new brdb_value_t<std::string>("");
   pro.set_input(4, idx);
+  pro.set_input(5, new brdb_value_t<unsigned>(1));
   return good;
 }
 
@@ -71,7 +74,8 @@ bool boxm2_cpp_update_image_process(bprb_func_process& pro)
     boxm2_cache_sptr cache= pro.get_input<boxm2_cache_sptr>(i++);
     vpgl_camera_double_sptr cam= pro.get_input<vpgl_camera_double_sptr>(i++);
     vil_image_view_base_sptr in_img=pro.get_input<vil_image_view_base_sptr>(i++);
-    std::string identifier = pro.get_input<std::string>(i);
+    std::string identifier = pro.get_input<std::string>(i++);
+    unsigned n_threads = pro.get_input<unsigned>(i);
 
     vil_image_view_base_sptr float_image=boxm2_util::prepare_input_image(in_img);
     if (vil_image_view<float> * input_image=dynamic_cast<vil_image_view<float> * > (float_image.ptr()))
@@ -125,7 +129,9 @@ bool boxm2_cpp_update_image_process(bprb_func_process& pro)
                                   cam,
                                   input_image,
                                   input_image->ni(),
-                                  input_image->nj());
+                                  input_image->nj(),
+                                  0, 0,
+                                  n_threads);
     }
 
     return false;
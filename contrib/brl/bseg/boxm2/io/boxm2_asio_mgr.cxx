@@ -57,7 +57,8 @@ void boxm2_asio_mgr::load_block(std::string dir, boxm2_block_id block_id,boxm2_b
     std::string filepath = dir + block_id.to_string() + ".bin";
     //std::cout<<"boxm2_asio_mgr:: load requested from file:"<<filepath<<std::endl;
 
-    //get file size
+    //get file size, once any queued write of the file has finished
+    baio_write_queue::instance().wait_for(filepath);
     unsigned long numBytes = vul_file::size(filepath);
 
     //read bytes asynchronously, store aio object in aio list
@@ -191,7 +192,8 @@ void boxm2_asio_mgr::load_block_data_generic(std::string dir, boxm2_block_id blo
     std::string filename = dir + type + "_" + block_id.to_string() + ".bin";
     //std::cout<<"boxm2_asio_mgr:: data load requested from file:"<<filename<<std::endl;
 
-    // get file size
+    // get file size, once any queued write of the file has finished
+    baio_write_queue::instance().wait_for(filename);
     unsigned long buflength = vul_file::size(filename);
 
     // allocate buffer and read to it, store aio object in list
@@ -12,6 +12,7 @@
 #include <boxm2/basic/boxm2_block_id.h>
 #include <vcl_compiler.h>
 #include <bbas/baio/baio.h>
+#include <bbas/baio/baio_write_queue.h>
 #include <vul/vul_file.h>
 
 //: disk level storage class.
@@ -106,7 +107,8 @@ void boxm2_asio_mgr::load_block_data(std::string dir, boxm2_block_id block_id)
     std::string filename = dir + boxm2_data_traits<data_type>::prefix() + "_" + block_id.to_string() + ".bin";
     //std::cout<<"boxm2_asio_mgr:: data load requested from file:"<<filename<<std::endl;
 
-    // get file size
+    // get file size, once any queued write of the file has finished
+    baio_write_queue::instance().wait_for(filename);
     unsigned long buflength = vul_file::size(filename);
 
     // allocate buffer and read to it, store aio object in list
@@ -8,6 +8,7 @@
 #include <boxm2/boxm2_block_metadata.h>
 #include <vcl_compiler.h>
 #include <boxm2/boxm2_data_traits.h>
+#include <baio/baio_write_queue.h>
 //: PUBLIC create method, for creating singleton instance of boxm2_cache
 void boxm2_lru_cache::create(boxm2_scene_sptr scene, BOXM2_IO_FS_TYPE fs_type)
 {
@@ -370,6 +371,9 @@ void boxm2_lru_cache::write_to_disk()
       }
   }
 
+  // wait for the write-behind queue so the scene is on disk on return
+  if (!baio_write_queue::instance().flush())
+    std::cerr << "boxm2_lru_cache::write_to_disk: " << baio_write_queue::instance().error() << '\n';
 }
 //: dumps all data onto disk
 void boxm2_lru_cache::write_to_disk(boxm2_scene_sptr & scene)
@@ -402,6 +406,9 @@ void boxm2_lru_cache::write_to_disk(boxm2_scene_sptr & scene)
           boxm2_sio_mgr::save_block(scene_block_iter->first->data_path(), iter->second);
       }
   }
+  // wait for the write-behind queue so the scene is on disk on return
+  if (!baio_write_queue::instance().flush())
+    std::cerr << "boxm2_lru_cache::write_to_disk: " << baio_write_queue::instance().error() << '\n';
 }
 
 //: add a new scene to the cache
@@ -4,6 +4,7 @@
 //:
 // \file
 #include <boxm2/boxm2_block_metadata.h>
+#include <baio/baio_write_queue.h>
 #include <vcl_compiler.h>
 
 //: PUBLIC create method, for creating singleton instance of boxm2_cache1
@@ -340,6 +341,9 @@ void boxm2_lru_cache1::write_to_disk()
     // if (!iter->second->read_only())
     boxm2_sio_mgr::save_block(scene_dir_, iter->second);
   }
+  // wait for the write-behind queue so the scene is on disk on return
+  if (!baio_write_queue::instance().flush())
+    std::cerr << "boxm2_lru_cache1::write_to_disk: " << baio_write_queue::instance().error() << '\n';
 }
 
 //: shows elements in cache
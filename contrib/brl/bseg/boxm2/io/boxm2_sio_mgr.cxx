@@ -3,6 +3,7 @@
 #include "boxm2_sio_mgr.h"
 #include <vcl_compiler.h>
 #include <sys/stat.h>  //for getting file sizes
+#include <baio/baio_write_queue.h>
 
 #if defined(HAS_HDFS) && HAS_HDFS
 #include <bhdfs/bhdfs_manager.h>
@@ -16,7 +17,8 @@ boxm2_block* boxm2_sio_mgr::load_block(std::string dir, boxm2_block_id block_id,
   char* bytes=VXL_NULLPTR;
 
   if (fs_type == LOCAL) {
-    //get file size
+    //get file size, once any queued write of the file has finished
+    baio_write_queue::instance().wait_for(filepath);
     numBytes = vul_file::size(filepath);
 
     //Read bytes into stream
@@ -57,7 +59,8 @@ boxm2_block* boxm2_sio_mgr::load_block(std::string dir, boxm2_block_id block_id,
   char* bytes=VXL_NULLPTR;
 
   if (fs_type == LOCAL) {
-    //get file size
+    //get file size, once any queued write of the file has finished
+    baio_write_queue::instance().wait_for(filepath);
     numBytes = vul_file::size(filepath);
 
     //Read bytes into stream
@@ -98,10 +101,9 @@ void boxm2_sio_mgr::save_block(std::string dir, boxm2_block* block)
   char * bytes = block->buffer();
   block->b_write(bytes);
 
-  // synchronously write to disk
-  std::ofstream myFile (filepath.c_str(), std::ios::out | std::ios::binary);
-  myFile.write(bytes, block->byte_count());
-  myFile.close();
+  // write to disk, in the background if the write queue is enabled
+  if (!baio_write_queue::instance().write(filepath, bytes, block->byte_count()))
+    std::cerr << "boxm2_sio_mgr::save_block: " << baio_write_queue::instance().error() << '\n';
 }
 
 // loads a generic boxm2_data_base* from disk (given data_type string prefix)
@@ -112,7 +114,8 @@ boxm2_data_base* boxm2_sio_mgr::load_block_data_generic(std::string dir, boxm2_b
   unsigned long numBytes = 0;
   char* bytes=VXL_NULLPTR;
   if (fs_type == LOCAL) {
-    //get file size
+    //get file size, once any queued write of the file has finished
+    baio_write_queue::instance().wait_for(filename);
     numBytes=vul_file::size(filename);
 
     //Read bytes into stream
@@ -151,10 +154,8 @@ void boxm2_sio_mgr::save_block_data_base(std::string dir, boxm2_block_id block_i
   std::string filename = dir + prefix + "_" + block_id.to_string() + ".bin";
 
   char * bytes = data->data_buffer();
-  std::ofstream myFile (filename.c_str(), std::ios::out | std::ios::binary);
-  myFile.write(bytes, data->buffer_length());
-  myFile.close();
-  return;
+  if (!baio_write_queue::instance().write(filename, bytes, data->buffer_length()))
+    std::cerr << "boxm2_sio_mgr::save_block_data_base: " << baio_write_queue::instance().error() << '\n';
 }
 
 char* boxm2_sio_mgr::load_from_hdfs(std::string filepath, unsigned long &numBytes)
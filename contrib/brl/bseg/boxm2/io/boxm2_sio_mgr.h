@@ -82,13 +82,7 @@ boxm2_data<data_type> *  boxm2_sio_mgr::load_block_data(std::string dir, boxm2_b
 template <boxm2_data_type data_type>
 void boxm2_sio_mgr::save_block_data(std::string dir, boxm2_block_id block_id, boxm2_data<data_type> * block_data )
 {
-    std::string filename = dir + boxm2_data_traits<data_type>::prefix() + "_" + block_id.to_string() + ".bin";
-
-    char * bytes = block_data->data_buffer();
-    std::ofstream myFile (filename.c_str(), std::ios::out | std::ios::binary);
-    myFile.write(bytes, block_data->buffer_length());
-    myFile.close();
-    return;
+    save_block_data_base(dir, block_id, block_data, boxm2_data_traits<data_type>::prefix());
 }
 
 #endif // boxm2_sio_mgr_h_
@@ -0,0 +1,194 @@
+// This is brl/bseg/brip/brip_fft_correlation.cxx
+#include <cmath>
+#include "brip_fft_correlation.h"
+//:
+// \file
+
+#include <vnl/algo/vnl_fft_2d.h>
+#include <vxl_config.h>
+
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
+
+brip_fft_correlation::brip_fft_correlation(vil_image_view<float> const& image)
+{
+  set_image(image);
+}
+
+void brip_fft_correlation::set_image(vil_image_view<float> const& image)
+{
+  ni_ = image.ni(); nj_ = image.nj();
+  // Only outputs whose kernel lies inside the image are kept, and those
+  // never wrap round, so padding is needed only to reach a size the FFT
+  // can factorise.
+  spectrum_.set_size(fft_size(nj_), fft_size(ni_));
+  spectrum_.fill(std::complex<double>(0.0, 0.0));
+  for (unsigned j = 0; j<nj_; ++j)
+    for (unsigned i = 0; i<ni_; ++i)
+      spectrum_(j, i) = std::complex<double>(image(i, j), 0.0);
+  vnl_fft_2d<double> fft(spectrum_.rows(), spectrum_.cols());
+  fft.fwd_transform(spectrum_);
+}
+
+unsigned brip_fft_correlation::fft_size(unsigned n)
+{
+  if (n<1) return 1;
+  for (;; ++n)
+  {
+    unsigned m = n;
+    while (m%2==0) m/=2;
+    while (m%3==0) m/=3;
+    while (m%5==0) m/=5;
+    if (m==1)
+      return n;
+  }
+}
+
+bool brip_fft_correlation::faster_than_direct(unsigned ni, unsigned nj,
+                                              unsigned n_coefficients,
+                                              unsigned n_kernels)
+{
+  // The image is transformed once, and each pair of kernels shares a
+  // forward and an inverse transform of the padded image.  Direct
+  // summation does n_coefficients multiply-adds per pixel for each kernel.
+  if (n_kernels<1) n_kernels = 1;
+  double pi = fft_size(ni), pj = fft_size(nj);
+  double transform_cost = 3.0*std::log(pi*pj)/std::log(2.0)*pi*pj/(double(ni)*nj);
+  double n_transforms = 1.0 + 2.0*((n_kernels+1)/2);
+  return n_coefficients > transform_cost*n_transforms/n_kernels;
+}
+
+void brip_fft_correlation::
+correlate_pair(vbl_array_2d<float> const* k0, vbl_array_2d<float> const* k1,
+               vil_image_view<float>* out0, vil_image_view<float>* out1,
+               vnl_fft_2d<double>& fft,
+               vnl_matrix<std::complex<double> >& buf) const
+{
+  const int pi = spectrum_.cols(), pj = spectrum_.rows();
+  buf.set_size(pj, pi);
+  buf.fill(std::complex<double>(0.0, 0.0));
+
+  // Place coefficient (ii,jj) at (-ii,-jj), so that the circular
+  // convolution with the image is the correlation with the kernel.
+  // k0 is the real part of the signal and k1 the imaginary part.
+  vbl_array_2d<float> const* kernels[2] = { k0, k1 };
+  bool fits[2] = { false, false };
+  for (unsigned k = 0; k<2; ++k)
+  {
+    if (!kernels[k]) continue;
+    vbl_array_2d<float> const& kern = *kernels[k];
+    const int rj = (int(kern.rows())-1)/2, ri = (int(kern.cols())-1)/2;
+    fits[k] = 2*ri+1 <= int(ni_) && 2*rj+1 <= int(nj_);
+    if (!fits[k]) continue;
+    for (int jj = -rj; jj<=rj; ++jj)
+      for (int ii = -ri; ii<=ri; ++ii)
+      {
+        double v = kern[jj+rj][ii+ri];
+        if (v==0.0) continue;
+        std::complex<double>& b = buf((pj-jj)%pj, (pi-ii)%pi);
+        b += k==0 ? std::complex<double>(v, 0.0) : std::complex<double>(0.0, v);
+      }
+  }
+
+  if (fits[0] || fits[1])
+  {
+    fft.fwd_transform(buf);
+    std::complex<double>* b = buf.data_block();
+    std::complex<double> const* s = spectrum_.data_block();
+    const unsigned n = buf.size();
+    for (unsigned q = 0; q<n; ++q)
+      b[q] *= s[q];
+    fft.bwd_transform(buf);
+  }
+
+  const double scale = 1.0/(double(pi)*pj);
+  vil_image_view<float>* outs[2] = { out0, out1 };
+  for (unsigned k = 0; k<2; ++k)
+  {
+    if (!kernels[k]) continue;
+    vil_image_view<float>& out = *outs[k];
+    out.set_size(ni_, nj_);
+    out.fill(0.0f);
+    if (!fits[k]) continue;
+    const unsigned rj = (kernels[k]->rows()-1)/2, ri = (kernels[k]->cols()-1)/2;
+    for (unsigned j = rj; j<nj_-rj; ++j)
+      for (unsigned i = ri; i<ni_-ri; ++i)
+      {
+        std::complex<double> const& v = buf(j, i);
+        out(i, j) = static_cast<float>(scale*(k==0 ? v.real() : v.imag()));
+      }
+  }
+}
+
+void brip_fft_correlation::correlate(vbl_array_2d<float> const& kernel,
+                                     vil_image_view<float>& out) const
+{
+  vnl_fft_2d<double> fft(spectrum_.rows(), spectrum_.cols());
+  vnl_matrix<std::complex<double> > buf;
+  correlate_pair(&kernel, VXL_NULLPTR, &out, VXL_NULLPTR, fft, buf);
+}
+
+//: Work for one thread: every n_threads'th pair of kernels.
+struct brip_fft_correlation_job
+{
+  brip_fft_correlation const* corr;
+  std::vector<vbl_array_2d<float> > const* kernels;
+  std::vector<vil_image_view<float> >* out;
+  unsigned thread, n_threads;
+
+  void run()
+  {
+    const unsigned n = kernels->size();
+    vnl_fft_2d<double> fft(corr->spectrum_.rows(), corr->spectrum_.cols());
+    vnl_matrix<std::complex<double> > buf;
+    for (unsigned k = 2*thread; k<n; k += 2*n_threads)
+    {
+      bool pair = k+1<n;
+      corr->correlate_pair(&(*kernels)[k], pair ? &(*kernels)[k+1] : VXL_NULLPTR,
+                           &(*out)[k], pair ? &(*out)[k+1] : VXL_NULLPTR,
+                           fft, buf);
+    }
+  }
+
+  static void* run_thread(void* arg)
+  {
+    static_cast<brip_fft_correlation_job*>(arg)->run();
+    return VXL_NULLPTR;
+  }
+};
+
+void brip_fft_correlation::
+correlate(std::vector<vbl_array_2d<float> > const& kernels,
+          std::vector<vil_image_view<float> >& out, unsigned n_threads) const
+{
+  out.resize(kernels.size());
+  if (n_threads<1) n_threads=1;
+#if !VXL_HAS_PTHREAD_H
+  n_threads=1;
+#endif
+  std::vector<brip_fft_correlation_job> jobs(n_threads);
+#if VXL_HAS_PTHREAD_H
+  std::vector<pthread_t> threads(n_threads);
+  std::vector<bool> started(n_threads, false);
+#endif
+  for (unsigned t = 0; t<n_threads; ++t)
+  {
+    jobs[t].corr = this; jobs[t].kernels = &kernels; jobs[t].out = &out;
+    jobs[t].thread = t; jobs[t].n_threads = n_threads;
+#if VXL_HAS_PTHREAD_H
+    if (t>0)
+      started[t] = pthread_create(&threads[t], VXL_NULLPTR,
+                                  brip_fft_correlation_job::run_thread,
+                                  &jobs[t])==0;
+#endif
+  }
+  jobs[0].run();
+#if VXL_HAS_PTHREAD_H
+  for (unsigned t = 1; t<n_threads; ++t)
+  {
+    if (started[t]) pthread_join(threads[t], VXL_NULLPTR);
+    else            jobs[t].run();  // Couldn't start thread - do it here
+  }
+#endif
+}
@@ -0,0 +1,93 @@
+// This is brl/bseg/brip/brip_fft_correlation.h
+#ifndef brip_fft_correlation_h_
+#define brip_fft_correlation_h_
+//:
+// \file
+// \brief Correlate one image with many dense kernels, using the FFT
+//
+// Correlating an image with a (2*ri+1) x (2*rj+1) kernel directly costs
+// O(ri*rj) per pixel, which dominates operators such as
+// brip_vil_float_ops::extrema_rotational() that apply large oriented
+// kernels at many angles.  Here the image is transformed once, when the
+// object is constructed; each kernel then costs a forward and an inverse
+// transform whatever its size.  Since the image and kernels are real, two
+// kernels are handled by each complex transform, as the real and imaginary
+// parts of the signal.
+//
+// The kernels are applied exactly as written (there is no separable or
+// steerable approximation), so the results agree with direct summation
+// to within floating point rounding.
+//
+// \verbatim
+//  Modifications
+//   none
+// \endverbatim
+
+#include <vector>
+#include <complex>
+#include <vnl/vnl_matrix.h>
+#include <vbl/vbl_array_2d.h>
+#include <vil/vil_image_view.h>
+#include <vcl_compiler.h>
+
+template <class T> struct vnl_fft_2d;
+
+class brip_fft_correlation
+{
+ public:
+  //: Construct with no image; call set_image() before correlate().
+  brip_fft_correlation() : ni_(0), nj_(0) {}
+
+  //: Transform the image, ready for correlation with kernels.
+  brip_fft_correlation(vil_image_view<float> const& image);
+
+  //: Transform the image, ready for correlation with kernels.
+  void set_image(vil_image_view<float> const& image);
+
+  //: Correlate the image with a kernel.
+  //  kernel[jj+rj][ii+ri] multiplies image(i+ii,j+jj), where the kernel has
+  //  2*rj+1 rows and 2*ri+1 columns.  On exit out(i,j) holds the sum for
+  //  the pixels where the kernel lies inside the image, i.e.
+  //  ri <= i < ni-ri and rj <= j < nj-rj, and is zero elsewhere.
+  void correlate(vbl_array_2d<float> const& kernel,
+                 vil_image_view<float>& out) const;
+
+  //: Correlate the image with each kernel.
+  //  out[k] is as for correlate(kernels[k], out[k]).  The kernels are
+  //  shared between n_threads threads, if threads are available.
+  void correlate(std::vector<vbl_array_2d<float> > const& kernels,
+                 std::vector<vil_image_view<float> >& out,
+                 unsigned n_threads = 1) const;
+
+  //: True if correlating n_kernels kernels by FFT should beat direct summation.
+  //  n_coefficients is the number of non-zero coefficients in each kernel.
+  //  The forward transform of the image is shared by all the kernels, and
+  //  each pair of kernels needs one forward and one inverse transform, so a
+  //  single kernel costs three transforms, but many cost about one each.
+  static bool faster_than_direct(unsigned ni, unsigned nj,
+                                 unsigned n_coefficients,
+                                 unsigned n_kernels = 1);
+
+  //: Smallest n' >= n with no prime factors other than 2, 3 and 5.
+  static unsigned fft_size(unsigned n);
+
+  unsigned ni() const { return ni_; }
+  unsigned nj() const { return nj_; }
+
+ private:
+  friend struct brip_fft_correlation_job;
+
+  //: Correlate with kernel k0 and (if not null) k1 using the given workspace
+  void correlate_pair(vbl_array_2d<float> const* k0,
+                      vbl_array_2d<float> const* k1,
+                      vil_image_view<float>* out0,
+                      vil_image_view<float>* out1,
+                      vnl_fft_2d<double>& fft,
+                      vnl_matrix<std::complex<double> >& buf) const;
+
+  unsigned ni_, nj_;
+  //: Spectrum of the zero padded image; rows are j, columns i
+  vnl_matrix<std::complex<double> > spectrum_;
+};
+
+#endif // brip_fft_correlation_h_
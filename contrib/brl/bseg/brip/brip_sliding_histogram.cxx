@@ -0,0 +1,287 @@
+// This is brl/bseg/brip/brip_sliding_histogram.cxx
+#include <vector>
+#include <cmath>
+#include "brip_sliding_histogram.h"
+//:
+// \file
+
+#include <vnl/vnl_math.h>
+#include <vcl_cassert.h>
+#include <vxl_config.h>
+
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
+
+//: Pixels contributing to one histogram whose entropy is wanted.
+struct brip_sliding_channel
+{
+  vil_image_view<int> bins;
+  //: Empty if all weights are 1
+  vil_image_view<float> weights;
+  unsigned n_bins;
+  //: Multiplier for the entropy of this histogram in the result
+  float sign;
+};
+
+//: Weighted histogram, keeping its total and the sum of c*ln(c) over its bins.
+//  The entropy is then ln(total) - sum(c*ln(c))/total, so changing a bin
+//  only costs one logarithm.
+class brip_window_histogram
+{
+ public:
+  void reset(unsigned n_bins)
+  {
+    counts_.assign(n_bins, 0.0);
+    total_ = 0.0; sum_clogc_ = 0.0;
+  }
+
+  void add(unsigned bin, double w)
+  {
+    double c = counts_[bin];
+    counts_[bin] = c + w;
+    total_ += w;
+    sum_clogc_ += clogc(c+w) - clogc(c);
+  }
+
+  //: Entropy in bits
+  double entropy() const
+  {
+    if (total_ <= 0.0)
+      return 0.0;
+    return (std::log(total_) - sum_clogc_/total_)*vnl_math::log2e;
+  }
+
+ private:
+  static double clogc(double c) { return c > 0.0 ? c*std::log(c) : 0.0; }
+
+  std::vector<double> counts_;
+  double total_;
+  double sum_clogc_;
+};
+
+//: Work for one thread: a band of output rows.
+struct brip_sliding_job
+{
+  std::vector<brip_sliding_channel> const* channels;
+  unsigned i_radius, j_radius, step;
+  vil_image_view<float>* out;
+  unsigned thread, n_threads;
+
+  //: Add (sign = 1) or remove (sign = -1) row j of channel c to the column histograms
+  void update_columns(brip_sliding_channel const& c, std::vector<double>& cols,
+                      unsigned j, double sign) const
+  {
+    const unsigned ni = c.bins.ni();
+    const bool weighted = c.weights.size() > 0;
+    for (unsigned i = 0; i<ni; ++i)
+    {
+      int b = c.bins(i, j);
+      if (b < 0) continue;
+      cols[i*c.n_bins + b] += weighted ? sign*c.weights(i, j) : sign;
+    }
+  }
+
+  void run()
+  {
+    std::vector<brip_sliding_channel> const& chan = *channels;
+    const unsigned n_chan = chan.size();
+    const unsigned ni = chan[0].bins.ni(), nj = chan[0].bins.nj();
+    const unsigned wi = 2*i_radius+1, wj = 2*j_radius+1;
+    const unsigned n_ci = (ni-wi)/step+1, n_cj = (nj-wj)/step+1;
+    const unsigned k0 = thread*n_cj/n_threads, k1 = (thread+1)*n_cj/n_threads;
+    if (k0 == k1)
+      return;
+
+    std::vector<std::vector<double> > cols(n_chan);
+    std::vector<brip_window_histogram> win(n_chan);
+    unsigned r0 = 0, r1 = 0;  // rows [r0,r1) are in the column histograms
+    for (unsigned k = k0; k<k1; ++k)
+    {
+      const unsigned j = j_radius + k*step;
+      for (unsigned c = 0; c<n_chan; ++c)
+      {
+        if (k == k0 || step >= wj) {
+          cols[c].assign(ni*chan[c].n_bins, 0.0);
+          for (unsigned y = j-j_radius; y<=j+j_radius; ++y)
+            update_columns(chan[c], cols[c], y, 1.0);
+        }
+        else {
+          for (unsigned y = r0; y<j-j_radius; ++y)
+            update_columns(chan[c], cols[c], y, -1.0);
+          for (unsigned y = r1; y<=j+j_radius; ++y)
+            update_columns(chan[c], cols[c], y, 1.0);
+        }
+      }
+      r0 = j-j_radius; r1 = j+j_radius+1;
+
+      for (unsigned ci = 0; ci<n_ci; ++ci)
+      {
+        const unsigned i = i_radius + ci*step;
+        double value = 0.0;
+        for (unsigned c = 0; c<n_chan; ++c)
+        {
+          const unsigned nb = chan[c].n_bins;
+          std::vector<double> const& col = cols[c];
+          brip_window_histogram& w = win[c];
+          if (ci == 0 || step >= wi) {
+            w.reset(nb);
+            for (unsigned x = i-i_radius; x<=i+i_radius; ++x)
+              for (unsigned b = 0; b<nb; ++b)
+                if (col[x*nb+b] != 0.0)
+                  w.add(b, col[x*nb+b]);
+          }
+          else {
+            // columns i-i_radius-step ... leave as i+i_radius-step+1 ... enter
+            for (unsigned s = 0; s<step; ++s)
+            {
+              const double* out_col = &col[(i-i_radius-step+s)*nb];
+              const double* in_col = &col[(i+i_radius-step+1+s)*nb];
+              for (unsigned b = 0; b<nb; ++b)
+              {
+                double d = in_col[b] - out_col[b];
+                if (d != 0.0)
+                  w.add(b, d);
+              }
+            }
+          }
+          value += chan[c].sign*w.entropy();
+        }
+        (*out)(i/step, j/step) = float(value);
+      }
+    }
+  }
+
+  static void* run_thread(void* arg)
+  {
+    static_cast<brip_sliding_job*>(arg)->run();
+    return VXL_NULLPTR;
+  }
+};
+
+//: Sum of signed window entropies of the channels, at each window centre.
+static void brip_sliding_run(std::vector<brip_sliding_channel> const& channels,
+                             unsigned i_radius, unsigned j_radius,
+                             unsigned step, vil_image_view<float>& out,
+                             unsigned n_threads)
+{
+  assert(!channels.empty());
+  if (step < 1) step = 1;
+  const unsigned ni = channels[0].bins.ni(), nj = channels[0].bins.nj();
+  out.set_size(ni/step+1, nj/step+1);
+  out.fill(0.0f);
+  if (ni < 2*i_radius+1 || nj < 2*j_radius+1)
+    return;
+
+  if (n_threads<1) n_threads=1;
+#if !VXL_HAS_PTHREAD_H
+  n_threads=1;
+#endif
+  std::vector<brip_sliding_job> jobs(n_threads);
+#if VXL_HAS_PTHREAD_H
+  std::vector<pthread_t> threads(n_threads);
+  std::vector<bool> started(n_threads, false);
+#endif
+  for (unsigned t = 0; t<n_threads; ++t)
+  {
+    jobs[t].channels = &channels;
+    jobs[t].i_radius = i_radius; jobs[t].j_radius = j_radius;
+    jobs[t].step = step; jobs[t].out = &out;
+    jobs[t].thread = t; jobs[t].n_threads = n_threads;
+#if VXL_HAS_PTHREAD_H
+    if (t>0)
+      started[t] = pthread_create(&threads[t], VXL_NULLPTR,
+                                  brip_sliding_job::run_thread, &jobs[t])==0;
+#endif
+  }
+  jobs[0].run();
+#if VXL_HAS_PTHREAD_H
+  for (unsigned t = 1; t<n_threads; ++t)
+  {
+    if (started[t]) pthread_join(threads[t], VXL_NULLPTR);
+    else            jobs[t].run();  // Couldn't start thread - do it here
+  }
+#endif
+}
+
+void brip_sliding_histogram_bins(vil_image_view<float> const& values,
+                                 float range, unsigned n_bins,
+                                 vil_image_view<int>& bins)
+{
+  const unsigned ni = values.ni(), nj = values.nj();
+  const float delta = range/n_bins;
+  bins.set_size(ni, nj);
+  for (unsigned j = 0; j<nj; ++j)
+    for (unsigned i = 0; i<ni; ++i)
+    {
+      float x = values(i, j);
+      int bin = -1;
+      if (x>=0.0f && x<=range)
+      {
+        // start just below the estimated bin and search up as upcount() does
+        int guess = static_cast<int>(x/delta) - 2;
+        for (unsigned b = guess>0 ? guess : 0; b<n_bins; ++b)
+          if (float((b+1)*delta) >= x) { bin = b; break; }
+      }
+      bins(i, j) = bin;
+    }
+}
+
+void brip_sliding_entropy(vil_image_view<int> const& bins,
+                          vil_image_view<float> const& weights,
+                          unsigned n_bins,
+                          unsigned i_radius, unsigned j_radius,
+                          unsigned step,
+                          vil_image_view<float>& ent,
+                          unsigned n_threads)
+{
+  assert(weights.size()==0 ||
+         (weights.ni()==bins.ni() && weights.nj()==bins.nj()));
+  std::vector<brip_sliding_channel> channels(1);
+  channels[0].bins = bins;
+  channels[0].weights = weights;
+  channels[0].n_bins = n_bins;
+  channels[0].sign = 1.0f;
+  brip_sliding_run(channels, i_radius, j_radius, step, ent, n_threads);
+}
+
+bool brip_sliding_minfo(vil_image_view<int> const& bins0,
+                        vil_image_view<float> const& weights0,
+                        vil_image_view<int> const& bins1,
+                        vil_image_view<float> const& weights1,
+                        unsigned n_bins,
+                        unsigned i_radius, unsigned j_radius,
+                        unsigned step,
+                        vil_image_view<float>& mi,
+                        unsigned n_threads)
+{
+  const unsigned ni = bins0.ni(), nj = bins0.nj();
+  assert(bins1.ni()==ni && bins1.nj()==nj);
+  assert(weights0.size()==0 || (weights0.ni()==ni && weights0.nj()==nj));
+  assert(weights1.size()==0 || (weights1.ni()==ni && weights1.nj()==nj));
+  if (n_bins > brip_sliding_minfo_max_bins)
+    return false;
+
+  // The joint histogram bins are pairs of bins; a pair counts only if
+  // both pixels fall in a bin, with the sum of their weights.
+  vil_image_view<int> joint_bins(ni, nj);
+  vil_image_view<float> joint_weights(ni, nj);
+  for (unsigned j = 0; j<nj; ++j)
+    for (unsigned i = 0; i<ni; ++i)
+    {
+      int b0 = bins0(i, j), b1 = bins1(i, j);
+      joint_bins(i, j) = (b0 < 0 || b1 < 0) ? -1 : int(b0*n_bins + b1);
+      joint_weights(i, j) = (weights0.size() ? weights0(i, j) : 1.0f) +
+                            (weights1.size() ? weights1(i, j) : 1.0f);
+    }
+
+  std::vector<brip_sliding_channel> channels(3);
+  channels[0].bins = bins0;  channels[0].weights = weights0;
+  channels[0].n_bins = n_bins;  channels[0].sign = 1.0f;
+  channels[1].bins = bins1;  channels[1].weights = weights1;
+  channels[1].n_bins = n_bins;  channels[1].sign = 1.0f;
+  channels[2].bins = joint_bins;  channels[2].weights = joint_weights;
+  channels[2].n_bins = n_bins*n_bins;  channels[2].sign = -1.0f;
+  brip_sliding_run(channels, i_radius, j_radius, step, mi, n_threads);
+  return true;
+}
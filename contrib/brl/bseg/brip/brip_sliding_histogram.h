@@ -0,0 +1,76 @@
+// This is brl/bseg/brip/brip_sliding_histogram.h
+#ifndef brip_sliding_histogram_h_
+#define brip_sliding_histogram_h_
+//:
+// \file
+// \brief Entropy and mutual information of a window about every pixel
+//
+// Computing the histogram of a (2*i_radius+1) x (2*j_radius+1) window
+// separately at each pixel costs O(i_radius*j_radius) per pixel.  These
+// functions slide the window instead, in the manner of Huang's running
+// median filter: a histogram is kept for each image column over the rows
+// of the window, and moving the window along a row adds the entering
+// column's histogram and subtracts the leaving one.  Moving down a row
+// updates each column histogram by one pixel in and one out.  The entropy
+// is updated with the bins that change, so the cost per pixel does not
+// depend on the window size.
+//
+// Pixels are given as images of bin indices, e.g. from
+// brip_sliding_histogram_bins(), with an optional image of weights.  Rows
+// of the output are shared between n_threads threads, if threads are
+// available.
+//
+
+#include <vil/vil_image_view.h>
+#include <vcl_compiler.h>
+
+//: Largest number of bins accepted by brip_sliding_minfo().
+const unsigned brip_sliding_minfo_max_bins = 32;
+
+//: Set bins(i,j) to the bin of values(i,j) in a bsta_histogram<float>(range, n_bins).
+//  Values outside [0,range] get -1.  The comparisons are those of
+//  bsta_histogram::upcount(), so the bins are identical to that class's.
+void brip_sliding_histogram_bins(vil_image_view<float> const& values,
+                                 float range, unsigned n_bins,
+                                 vil_image_view<int>& bins);
+
+//: Entropy (in bits) of the weighted histogram of the window about each pixel.
+//  bins(i,j) is the bin of pixel (i,j) in [0,n_bins), or -1 to leave the
+//  pixel out.  If weights is empty every pixel has weight 1.
+//  On exit ent is (ni/step+1) x (nj/step+1); ent(i/step,j/step) holds the
+//  entropy of the window centred at (i,j), for i = i_radius, i_radius+step,
+//  ... < ni-i_radius (and likewise for j).  Other pixels of ent are zero.
+//  The entropy matches that of a bsta_histogram filled with the same bins
+//  and weights.
+void brip_sliding_entropy(vil_image_view<int> const& bins,
+                          vil_image_view<float> const& weights,
+                          unsigned n_bins,
+                          unsigned i_radius, unsigned j_radius,
+                          unsigned step,
+                          vil_image_view<float>& ent,
+                          unsigned n_threads = 1);
+
+//: Mutual information (in bits) of corresponding windows in two images.
+//  The window about (i,j) in image 0 is compared with the window about
+//  (i,j) in image 1, which must be the same size.  bins0, bins1, weights0
+//  and weights1 are as for brip_sliding_entropy().  As in
+//  bsta_joint_histogram::upcount(), the weight of a pixel pair in the joint
+//  histogram is the sum of the two weights, so for unweighted images the
+//  result is H0 + H1 - H01, as computed by brip_vil_float_ops::minfo_i().
+//  mi has the layout described for ent in brip_sliding_entropy().
+//
+//  The joint histogram has n_bins*n_bins bins, and each thread keeps one
+//  per image column, i.e. 8*ni*n_bins*n_bins bytes (16MB for ni=2000 and
+//  n_bins=32).  So n_bins must be at most brip_sliding_minfo_max_bins;
+//  otherwise false is returned and mi is left unchanged.
+bool brip_sliding_minfo(vil_image_view<int> const& bins0,
+                        vil_image_view<float> const& weights0,
+                        vil_image_view<int> const& bins1,
+                        vil_image_view<float> const& weights1,
+                        unsigned n_bins,
+                        unsigned i_radius, unsigned j_radius,
+                        unsigned step,
+                        vil_image_view<float>& mi,
+                        unsigned n_threads = 1);
+
+#endif // brip_sliding_histogram_h_
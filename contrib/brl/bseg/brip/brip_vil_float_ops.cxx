@@ -2,6 +2,7 @@
 #include <iostream>
 #include <complex>
 #include <limits>
+#include <algorithm>
 #include "brip_vil_float_ops.h"
 //:
 // \file
@@ -29,6 +30,7 @@
 #include <vil/vil_new.h>
 #include <vil/vil_math.h>
 #include <vil/algo/vil_convolve_1d.h>
+#include <vil/algo/vil_integral_image.h>
 
 #include <vsol/vsol_box_2d.h>
 #include <vsol/vsol_polygon_2d_sptr.h>
@@ -37,6 +39,8 @@
 #include <bsta/bsta_histogram.h>
 #include <bsta/bsta_joint_histogram.h>
 #include <brip/brip_roi.h>
+#include <brip/brip_sliding_histogram.h>
+#include <brip/brip_fft_correlation.h>
 
 // === Local utility functions ===
 
@@ -633,15 +637,25 @@ brip_vil_float_ops::abs_clip_to_level(vil_image_view<float> const& image,
   return out;
 }
 
+// Box sums are read from an integral image, so the cost is independent of N.
+// The output matches convolution with an NxN kernel of value 1/(N*N),
+// including the zero border of width (N-1)/2.
 vil_image_view<float> brip_vil_float_ops::average_NxN(vil_image_view<float> const & img, int N)
 {
   vil_image_view<float> result;
-  unsigned w = img.ni(), h = img.nj();
+  int w = static_cast<int>(img.ni()), h = static_cast<int>(img.nj());
   result.set_size (w, h);
-
-  vbl_array_2d <float> averaging_filt(N, N);
-  averaging_filt.fill( float(1.00/double(N*N)) );
-  result = brip_vil_float_ops::convolve(img, averaging_filt);
+  result.fill(0.0f);
+  int n = (N-1)/2, m = 2*n+1;
+  if (N<1 || w<m || h<m)
+    return result;
+
+  vil_image_view<double> sum;
+  vil_integral_image(img, sum);
+  double scale = 1.0/(double(N)*N);
+  for (int y = n; y<(h-n); y++)
+    for (int x = n; x<(w-n); x++)
+      result(x,y) = float(scale*vil_integral_box_sum(sum, x-n, y-n, m, m));
   return result;
 }
 
@@ -3274,6 +3288,25 @@ float brip_vil_float_ops::entropy_hs(const unsigned i, const unsigned j,
   return hg.entropy();
 }
 
+//: Gradient direction (degrees in [0,360]) and magnitude weights as used by entropy_g
+static void brip_gradient_dir_mag(vil_image_view<float> const& gradx,
+                                  vil_image_view<float> const& grady,
+                                  vil_image_view<float>& ang,
+                                  vil_image_view<float>& mag)
+{
+  static const float deg_rad = (float)(vnl_math::deg_per_rad);
+  const unsigned ni = gradx.ni(), nj = gradx.nj();
+  ang.set_size(ni, nj);
+  mag.set_size(ni, nj);
+  for (unsigned j = 0; j<nj; ++j)
+    for (unsigned i = 0; i<ni; ++i)
+    {
+      float Ix = gradx(i, j), Iy = grady(i, j);
+      ang(i, j) = deg_rad*std::atan2(Iy, Ix) + 180.0f;
+      mag(i, j) = std::abs(Ix)+std::abs(Iy);
+    }
+}
+
 vil_image_view<float>
 brip_vil_float_ops::entropy(const unsigned i_radius,
                             const unsigned j_radius,
@@ -3283,7 +3316,8 @@ brip_vil_float_ops::entropy(const unsigned i_radius,
                             const unsigned bins,
                             const bool intensity,
                             const bool gradient,
-                            const bool ihs)
+                            const bool ihs,
+                            const unsigned n_threads)
 {
   vil_image_view<float> ent;
   if (!intensity&&!gradient&&!ihs)
@@ -3299,34 +3333,37 @@ brip_vil_float_ops::entropy(const unsigned i_radius,
   unsigned ni = img->ni(), nj = img->nj();
   ent.set_size(ni/step+1, nj/step+1);
   ent.fill(0.0f);
+  vil_image_view<int> bin_image;
+  vil_image_view<float> term, no_weights;
   if (intensity)
-    for (unsigned j = j_radius; j<(nj-j_radius); j+=step)
-      for (unsigned i = i_radius; i<(ni-i_radius); i+=step)
-        ent(i/step,j/step) =
-          brip_vil_float_ops::entropy_i(i, j, i_radius, j_radius, gimage, 255.0f, bins);
+  {
+    brip_sliding_histogram_bins(gimage, 255.0f, bins, bin_image);
+    brip_sliding_entropy(bin_image, no_weights, bins, i_radius, j_radius,
+                         step, term, n_threads);
+    vil_math_image_sum(ent, term, ent);
+  }
 
   if (gradient)
   {
-    vil_image_view<float> grad_x, grad_y;
+    vil_image_view<float> grad_x, grad_y, ang, mag;
     grad_x.set_size(ni, nj);
     grad_y.set_size(ni, nj);
     brip_vil_float_ops::gradient_3x3 (gimage , grad_x , grad_y);
-    for (unsigned j = j_radius; j<(nj-j_radius); j+=step)
-      for (unsigned i = i_radius; i<(ni-i_radius); i+=step)
-        ent(i/step,j/step) +=
-          brip_vil_float_ops::entropy_g(i, j, i_radius, j_radius,
-                                        grad_x, grad_y);
+    brip_gradient_dir_mag(grad_x, grad_y, ang, mag);
+    brip_sliding_histogram_bins(ang, 360.0f, 8, bin_image);
+    brip_sliding_entropy(bin_image, mag, 8, i_radius, j_radius,
+                         step, term, n_threads);
+    vil_math_image_sum(ent, term, ent);
   }
   if (ihs&&img->nplanes()==3)
   {
     vil_image_view<float> inten, hue, sat;
     vil_image_view<vil_rgb<vxl_byte> > cimage = img->get_view();
     brip_vil_float_ops::convert_to_IHS(cimage, inten, hue, sat);
-    for (unsigned j = j_radius; j<(nj-j_radius); j+=step)
-      for (unsigned i = i_radius; i<(ni-i_radius); i+=step)
-        ent(i/step,j/step) +=
-          brip_vil_float_ops::entropy_hs(i, j, i_radius, j_radius,
-                                         hue, sat);
+    brip_sliding_histogram_bins(hue, 360.0f, 8, bin_image);
+    brip_sliding_entropy(bin_image, sat, 8, i_radius, j_radius,
+                         step, term, n_threads);
+    vil_math_image_sum(ent, term, ent);
   }
   return ent;
 }
@@ -3531,6 +3568,86 @@ bool brip_vil_float_ops::minfo(const unsigned i_radius,
   return true;
 }
 
+bool brip_vil_float_ops::minfo_map(const unsigned i_radius,
+                                   const unsigned j_radius,
+                                   const unsigned step,
+                                   vil_image_resource_sptr const& img0,
+                                   vil_image_resource_sptr const& img1,
+                                   vil_image_view<float>& MI,
+                                   const float sigma,
+                                   const bool intensity,
+                                   const bool gradient,
+                                   const bool ihs,
+                                   const unsigned n_threads)
+{
+  if (!intensity&&!gradient&&!ihs)
+  {
+    std::cout << "In brip_vil_float_ops::minfo_map(.) - No computation to do\n";
+    return false;
+  }
+  unsigned ni = img0->ni(), nj = img0->nj();
+  if (img1->ni()!=ni||img1->nj()!=nj)
+  {
+    std::cout << "In brip_vil_float_ops::minfo_map(...) - images differ in size\n";
+    return false;
+  }
+  if (ni<2*i_radius+1||nj<2*j_radius+1)
+  {
+    std::cout << "In brip_vil_float_ops::minfo_map(...) - image too small\n";
+    return false;
+  }
+
+  vil_image_view<float> fimage0 = brip_vil_float_ops::convert_to_float(img0);
+  vil_image_view<float> gimage0 =
+    brip_vil_float_ops::gaussian(fimage0, sigma);
+  vil_image_view<float> fimage1 = brip_vil_float_ops::convert_to_float(img1);
+  vil_image_view<float> gimage1 =
+    brip_vil_float_ops::gaussian(fimage1, sigma);
+
+  MI.set_size(ni/step+1, nj/step+1);
+  MI.fill(0.0f);
+  vil_image_view<int> bins0, bins1;
+  vil_image_view<float> term, no_weights;
+  if (intensity)
+  {
+    brip_sliding_histogram_bins(gimage0, 255.0f, 16, bins0);
+    brip_sliding_histogram_bins(gimage1, 255.0f, 16, bins1);
+    brip_sliding_minfo(bins0, no_weights, bins1, no_weights, 16,
+                       i_radius, j_radius, step, term, n_threads);
+    vil_math_image_sum(MI, term, MI);
+  }
+  if (gradient)
+  {
+    vil_image_view<float> grad_x0(ni, nj), grad_y0(ni, nj);
+    vil_image_view<float> grad_x1(ni, nj), grad_y1(ni, nj);
+    vil_image_view<float> ang0, mag0, ang1, mag1;
+    brip_vil_float_ops::gradient_3x3 (gimage0 , grad_x0 , grad_y0);
+    brip_vil_float_ops::gradient_3x3 (gimage1 , grad_x1 , grad_y1);
+    brip_gradient_dir_mag(grad_x0, grad_y0, ang0, mag0);
+    brip_gradient_dir_mag(grad_x1, grad_y1, ang1, mag1);
+    brip_sliding_histogram_bins(ang0, 360.0f, 8, bins0);
+    brip_sliding_histogram_bins(ang1, 360.0f, 8, bins1);
+    brip_sliding_minfo(bins0, mag0, bins1, mag1, 8,
+                       i_radius, j_radius, step, term, n_threads);
+    vil_math_image_sum(MI, term, MI);
+  }
+  if (ihs&&img0->nplanes()==3&&img1->nplanes()==3)
+  {
+    vil_image_view<float> inten0, hue0, sat0;
+    vil_image_view<float> inten1, hue1, sat1;
+    vil_image_view<vil_rgb<vxl_byte> > cimage0 = img0->get_view();
+    vil_image_view<vil_rgb<vxl_byte> > cimage1 = img1->get_view();
+    brip_vil_float_ops::convert_to_IHS(cimage0, inten0, hue0, sat0);
+    brip_vil_float_ops::convert_to_IHS(cimage1, inten1, hue1, sat1);
+    brip_sliding_histogram_bins(hue0, 360.0f, 8, bins0);
+    brip_sliding_histogram_bins(hue1, 360.0f, 8, bins1);
+    brip_sliding_minfo(bins0, sat0, bins1, sat1, 8,
+                       i_radius, j_radius, step, term, n_threads);
+    vil_math_image_sum(MI, term, MI);
+  }
+  return true;
+}
+
 // compute the average of the image intensity within the specified region
 float brip_vil_float_ops::
 average_in_box(vil_image_view<float> const& v, vgl_box_2d<double> const&  box)
@@ -4023,13 +4140,25 @@ brip_vil_float_ops::extrema(vil_image_view<float> const& input,
   vil_image_view<float> temp(ni, nj);
   vil_image_view<float> temp2(ni, nj);
   temp.fill(0.0f); temp2.fill(0.0f);
+  // large kernels are applied by FFT (the kernel is zero outside the mask)
+  unsigned n_coef = 0;
+  for (unsigned r = 0; r<nrows; ++r)
+    for (unsigned c = 0; c<ncols; ++c)
+      if (mask[r][c]) ++n_coef;
+  bool use_fft = brip_fft_correlation::faster_than_direct(ni, nj, n_coef);
+  vil_image_view<float> corr;
+  if (use_fft)
+    brip_fft_correlation(input).correlate(fa, corr);
   for (unsigned j = rj; j<(nj-rj); j++)
     for (unsigned i = ri; i<(ni-ri); i++) {
       double sum = 0;
-      for (int jj=-rj; jj<=rj; ++jj)
-        for (int ii=-ri; ii<=ri; ++ii)
-          if (mask[jj+rj][ii+ri])
-            sum += coef[jj+rj][ii+ri]*input(i+ii, j+jj);
+      if (use_fft)
+        sum = corr(i,j);
+      else
+        for (int jj=-rj; jj<=rj; ++jj)
+          for (int ii=-ri; ii<=ri; ++ii)
+            if (mask[jj+rj][ii+ri])
+              sum += coef[jj+rj][ii+ri]*input(i+ii, j+jj);
       temp2(i,j) = static_cast<float>(sum);
       if (mag_only) {
         temp(i,j) = static_cast<float>(std::fabs(sum));
@@ -4101,7 +4230,7 @@ extrema_rotational(vil_image_view<float> const& input, float lambda0,
                    float lambda1, float theta_interval, bool bright,
                    bool mag_only, bool signed_response,
                    bool scale_invariant, bool non_max_suppress,
-                   float cutoff_per)
+                   float cutoff_per, unsigned n_threads)
 {
   //invalid response
   assert(!(mag_only&&signed_response));
@@ -4150,29 +4279,63 @@ extrema_rotational(vil_image_view<float> const& input, float lambda0,
   for (float theta = 0.0f; theta < 180.0f; theta += theta_interval) { angles.push_back(theta); }
 
   std::vector<vbl_array_2d<bool> > mask_vect(angles.size(), vbl_array_2d<bool>());
+  std::vector<vbl_array_2d<float> > kern_vect(angles.size(), vbl_array_2d<float>());
   int max_rji = 0;
+  unsigned max_coef = 0;
   // elliptical operator has 180 degree rotational symmetry, so only the angles in the range [0,180] matter
-  float theta = 0.0f; unsigned theta_i = 1;
-  for ( ; theta < 180; theta += theta_interval, theta_i++)
+  for (unsigned theta_i = 1; theta_i<angles.size(); ++theta_i)
   {
-    // compute the response
-    vbl_array_2d<float> fa; vbl_array_2d<bool> mask;
-    brip_vil_float_ops::extrema_kernel_mask(lambda0, lambda1, theta,
-                                            fa, mask, cutoff_per, scale_invariant);
-    mask_vect[theta_i] = mask;
-    unsigned nrows = fa.rows(), ncols = fa.cols();
-    int rj = (nrows-1)/2, ri = (ncols-1)/2;
+    brip_vil_float_ops::extrema_kernel_mask(lambda0, lambda1, angles[theta_i],
+                                            kern_vect[theta_i], mask_vect[theta_i],
+                                            cutoff_per, scale_invariant);
+    vbl_array_2d<bool> const& mask = mask_vect[theta_i];
+    int rj = (int(mask.rows())-1)/2, ri = (int(mask.cols())-1)/2;
     if (rj > max_rji) max_rji = rj;
     if (ri > max_rji) max_rji = ri;
+    unsigned n_coef = 0;
+    for (unsigned r = 0; r<mask.rows(); ++r)
+      for (unsigned c = 0; c<mask.cols(); ++c)
+        if (mask[r][c]) ++n_coef;
+    if (n_coef > max_coef) max_coef = n_coef;
+  }
+
+  // Large kernels are applied by FFT, a few orientations at a time to
+  // bound the memory used; small kernels by direct summation.
+  brip_fft_correlation fft_corr;
+  const bool use_fft =
+    brip_fft_correlation::faster_than_direct(ni, nj, max_coef,
+                                             unsigned(angles.size())-1);
+  if (use_fft)
+    fft_corr.set_image(input);
+  if (n_threads<1) n_threads=1;
+  const unsigned batch = 2*n_threads;
+  std::vector<vbl_array_2d<float> > batch_kernels;
+  std::vector<vil_image_view<float> > batch_resp;
+
+  for (unsigned theta_i = 1; theta_i<angles.size(); theta_i++)
+  {
+    vbl_array_2d<float> const& fa = kern_vect[theta_i];
+    vbl_array_2d<bool> const& mask = mask_vect[theta_i];
+    unsigned nrows = fa.rows(), ncols = fa.cols();
+    int rj = (nrows-1)/2, ri = (ncols-1)/2;
+    unsigned b = (theta_i-1)%batch;
+    if (use_fft && b==0) {
+      unsigned n = std::min(batch, unsigned(angles.size())-theta_i);
+      batch_kernels.assign(kern_vect.begin()+theta_i, kern_vect.begin()+theta_i+n);
+      fft_corr.correlate(batch_kernels, batch_resp, n_threads);
+    }
     for (unsigned j = rj; j<(nj-rj); j++) {
       for (unsigned i = ri; i<(ni-ri); i++) {
         float res = 0.0f;
         double sum = 0;
-        for (int jj=-rj; jj<=rj; ++jj)
-          for (int ii=-ri; ii<=ri; ++ii)
-            if (mask[jj+rj][ii+ri]) {
-              sum += double(fa[jj+rj][ii+ri])*input(i+ii, j+jj);
-            }
+        if (use_fft)
+          sum = batch_resp[b](i,j);
+        else
+          for (int jj=-rj; jj<=rj; ++jj)
+            for (int ii=-ri; ii<=ri; ++ii)
+              if (mask[jj+rj][ii+ri]) {
+                sum += double(fa[jj+rj][ii+ri])*input(i+ii, j+jj);
+              }
         if (mag_only) {
           res = static_cast<float>(std::fabs(sum));
         }
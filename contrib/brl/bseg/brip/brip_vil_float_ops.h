@@ -221,6 +221,8 @@ class brip_vil_float_ops
   //: Find anisotropic intensity extrema at a range of orientations and return the maximal response at the best orientation.
   // \p theta_interval is in degrees
   //  If \p lambda0 == \p lambda1 then reduces to the normal extrema operator
+  //  Large kernels are applied by FFT (see brip_fft_correlation), with the
+  //  orientations shared between \p n_threads threads.
   static vil_image_view<float> extrema_rotational(vil_image_view<float> const& input,
                                                   float lambda0, float lambda1,
                                                   float theta_interval,
@@ -229,7 +231,8 @@ class brip_vil_float_ops
                                                   bool signed_response = false,
                                                   bool scale_invariant = false,
                                                   bool non_max_suppress = true,
-                                                  float cutoff_per = 0.01f);
+                                                  float cutoff_per = 0.01f,
+                                                  unsigned n_threads = 1);
 
   //: Compute the inscribed rectangle in an ellipse with largest $(1+h)(1+w)$.
   //  Needed for fast non-maximal suppression.
@@ -635,6 +638,9 @@ class brip_vil_float_ops
                           const float range = 360.0f, const unsigned bins = 8);
 
   //: Compute the entropy of the specified region about each pixel
+  //  The result is the sum of the entropy_i, entropy_g and entropy_hs
+  //  terms selected, computed with sliding window histograms.  Rows are
+  //  shared between n_threads threads.
   static vil_image_view<float> entropy(const unsigned i_radius,
                                        const unsigned j_radius,
                                        const unsigned step,
@@ -643,7 +649,8 @@ class brip_vil_float_ops
                                        const unsigned bins = 16,
                                        const bool intensity = true,
                                        const bool gradient = true,
-                                       const bool ihs = false);
+                                       const bool ihs = false,
+                                       const unsigned n_threads = 1);
 
   //: Compute the intensity minfo of a region about the specified pixel
   //  No bounds check
@@ -692,6 +699,23 @@ class brip_vil_float_ops
                     const bool gradient = true,
                     const bool ihs = false);
 
+  //: Compute the minfo between corresponding regions about each pixel
+  //  MI(i/step,j/step) is the mutual information between the windows
+  //  centred at (i,j) in img0 and in img1, which must be the same size.
+  //  The terms are as computed by minfo_i, minfo_g and minfo_hs.
+  //  Rows are shared between n_threads threads.
+  static bool minfo_map(const unsigned i_radius,
+                        const unsigned j_radius,
+                        const unsigned step,
+                        vil_image_resource_sptr const& img0,
+                        vil_image_resource_sptr const& img1,
+                        vil_image_view<float>& MI,
+                        const float sigma = 1.0f,
+                        const bool intensity = true,
+                        const bool gradient = true,
+                        const bool ihs = false,
+                        const unsigned n_threads = 1);
+
   //  ===  Arithmetic operations  ===
 
   //: Blur the image with an NxN averaging filter
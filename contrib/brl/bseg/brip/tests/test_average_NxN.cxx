@@ -0,0 +1,61 @@
+#include <iostream>
+#include <cmath>
+#include <testlib/testlib_test.h>
+#include <vcl_compiler.h>
+#include <vil/vil_image_view.h>
+#include <vnl/vnl_random.h>
+#include <brip/brip_vil_float_ops.h>
+
+//: Local average computed as brip_vil_float_ops::average_NxN once did.
+// Each pixel in the (2n+1)x(2n+1) window is weighted by float(1/(N*N)),
+// and the products are accumulated in float.  The border is zero.
+static vil_image_view<float> direct_average(vil_image_view<float> const& img,
+                                            int N)
+{
+  int w = static_cast<int>(img.ni()), h = static_cast<int>(img.nj());
+  int n = (N-1)/2;
+  float k = float(1.00/double(N*N));
+  vil_image_view<float> result(w, h);
+  result.fill(0.0f);
+  for (int y = n; y<(h-n); y++)
+    for (int x = n; x<(w-n); x++)
+    {
+      float accum = 0;
+      for (int j = -n; j<=n; j++)
+        for (int i = -n; i<=n; i++)
+          accum += img(x+i,y+j)*k;
+      result(x,y) = accum;
+    }
+  return result;
+}
+
+static void test_average_NxN()
+{
+  vnl_random rng(1234);
+  const unsigned ni = 37, nj = 29;
+  vil_image_view<float> img(ni, nj);
+  for (unsigned j = 0; j<nj; ++j)
+    for (unsigned i = 0; i<ni; ++i)
+      img(i,j) = float(rng.drand32(0.0, 255.0));
+
+  const int sizes[] = {1, 3, 4, 5, 9};
+  for (unsigned s = 0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+  {
+    int N = sizes[s];
+    vil_image_view<float> fast = brip_vil_float_ops::average_NxN(img, N);
+    vil_image_view<float> direct = direct_average(img, N);
+    double max_diff = 0.0;
+    bool same_size = fast.ni()==ni && fast.nj()==nj;
+    for (unsigned j = 0; j<nj && same_size; ++j)
+      for (unsigned i = 0; i<ni; ++i)
+      {
+        double d = std::fabs(double(fast(i,j))-double(direct(i,j)));
+        if (d>max_diff) max_diff = d;
+      }
+    std::cout << "N = " << N << " max difference " << max_diff << '\n';
+    TEST("average_NxN size", same_size, true);
+    TEST_NEAR("average_NxN matches direct float average", max_diff, 0.0, 1e-3);
+  }
+}
+
+TESTMAIN(test_average_NxN);
@@ -1,6 +1,7 @@
 #include <testlib/testlib_register.h>
 
 DECLARE( test_histogram );
+DECLARE( test_sliding_histogram );
 DECLARE( test_mutual_info );
 DECLARE( test_watershed );
 DECLARE( test_fourier );
@@ -16,10 +17,13 @@ DECLARE( test_filter_bank );
 DECLARE( test_gain_offset_solver );
 DECLARE( test_nitf_ops );
 DECLARE( test_phase_correlation );
+DECLARE( test_fft_correlation );
+DECLARE( test_average_NxN );
 void
 register_tests()
 {
   REGISTER( test_histogram );
+  REGISTER( test_sliding_histogram );
   REGISTER( test_mutual_info );
   REGISTER( test_watershed );
   REGISTER( test_fourier );
@@ -35,6 +39,8 @@ register_tests()
   REGISTER( test_gain_offset_solver );
   REGISTER( test_nitf_ops );
   REGISTER( test_phase_correlation );
+  REGISTER( test_fft_correlation );
+  REGISTER( test_average_NxN );
 }
 
 DEFINE_MAIN;
@@ -0,0 +1,133 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <testlib/testlib_test.h>
+#include <vcl_compiler.h>
+#include <vil/vil_image_view.h>
+#include <vbl/vbl_array_2d.h>
+#include <vnl/vnl_random.h>
+#include <brip/brip_fft_correlation.h>
+#include <brip/brip_vil_float_ops.h>
+
+//: Correlate by direct summation, for comparison
+static void direct_correlate(vil_image_view<float> const& im,
+                             vbl_array_2d<float> const& kern,
+                             vil_image_view<float>& out)
+{
+  int ni = im.ni(), nj = im.nj();
+  int rj = (int(kern.rows())-1)/2, ri = (int(kern.cols())-1)/2;
+  out.set_size(ni, nj);
+  out.fill(0.0f);
+  for (int j = rj; j<nj-rj; ++j)
+    for (int i = ri; i<ni-ri; ++i)
+    {
+      double sum = 0;
+      for (int jj = -rj; jj<=rj; ++jj)
+        for (int ii = -ri; ii<=ri; ++ii)
+          sum += double(kern[jj+rj][ii+ri])*im(i+ii, j+jj);
+      out(i, j) = static_cast<float>(sum);
+    }
+}
+
+static double max_difference(vil_image_view<float> const& a,
+                             vil_image_view<float> const& b)
+{
+  if (a.ni()!=b.ni() || a.nj()!=b.nj())
+    return 1e30;
+  double d = 0;
+  for (unsigned j = 0; j<a.nj(); ++j)
+    for (unsigned i = 0; i<a.ni(); ++i)
+      d = std::max(d, double(std::fabs(a(i,j)-b(i,j))));
+  return d;
+}
+
+static void test_fft_correlation()
+{
+  TEST("fft_size(97)", brip_fft_correlation::fft_size(97), 100);
+  TEST("fft_size(128)", brip_fft_correlation::fft_size(128), 128);
+
+  vnl_random rng(5151);
+  vil_image_view<float> im(61, 47);
+  for (unsigned j = 0; j<im.nj(); ++j)
+    for (unsigned i = 0; i<im.ni(); ++i)
+      im(i,j) = float(rng.drand64(0.0, 255.0));
+
+  // Oriented extrema kernels of several shapes, and a kernel too large
+  // for the image.
+  std::vector<vbl_array_2d<float> > kernels;
+  for (float theta = 0.0f; theta<180.0f; theta += 30.0f)
+  {
+    vbl_array_2d<float> kern;
+    vbl_array_2d<bool> mask;
+    brip_vil_float_ops::extrema_kernel_mask(3.0f, 1.5f, theta, kern, mask);
+    kernels.push_back(kern);
+  }
+  kernels.push_back(vbl_array_2d<float>(49, 9, 1.0f));
+
+  brip_fft_correlation corr(im);
+  std::vector<vil_image_view<float> > out, out3;
+  corr.correlate(kernels, out);
+  corr.correlate(kernels, out3, 3);
+  double err = 0, err3 = 0;
+  for (unsigned k = 0; k<kernels.size(); ++k)
+  {
+    vil_image_view<float> expected;
+    direct_correlate(im, kernels[k], expected);
+    err = std::max(err, max_difference(expected, out[k]));
+    err3 = std::max(err3, max_difference(expected, out3[k]));
+  }
+  // responses are O(100); the FFT is computed in double precision
+  TEST_NEAR("FFT correlation matches direct summation", err, 0.0, 1e-3);
+  TEST_NEAR("Threaded FFT correlation matches direct summation", err3, 0.0, 1e-3);
+
+  vil_image_view<float> single;
+  corr.correlate(kernels[1], single);
+  TEST_NEAR("Single kernel", max_difference(single, out[1]), 0.0, 1e-6);
+
+  TEST("Small kernels are summed directly",
+       brip_fft_correlation::faster_than_direct(1000, 1000, 9), false);
+  TEST("Large kernels use the FFT",
+       brip_fft_correlation::faster_than_direct(1000, 1000, 31*31), true);
+  TEST("One medium kernel is summed directly",
+       brip_fft_correlation::faster_than_direct(1000, 1000, 100), false);
+  TEST("Many medium kernels use the FFT",
+       brip_fft_correlation::faster_than_direct(1000, 1000, 100, 32), true);
+
+  brip_fft_correlation later;
+  later.set_image(im);
+  vil_image_view<float> later_single;
+  later.correlate(kernels[1], later_single);
+  TEST_NEAR("set_image", max_difference(later_single, single), 0.0, 1e-9);
+
+  // extrema() switches to the FFT for large kernels; the signed response
+  // must agree with direct summation of the same kernel.
+  vbl_array_2d<float> kern;
+  vbl_array_2d<bool> mask;
+  brip_vil_float_ops::extrema_kernel_mask(4.0f, 2.0f, 30.0f, kern, mask);
+  vil_image_view<float> resp =
+    brip_vil_float_ops::extrema(im, 4.0f, 2.0f, 30.0f, true, false,
+                                false, true, false, false);
+  vil_image_view<float> expected;
+  direct_correlate(im, kern, expected);
+  double e = 0;
+  for (unsigned j = 0; j<im.nj(); ++j)
+    for (unsigned i = 0; i<im.ni(); ++i)
+      e = std::max(e, double(std::fabs(expected(i,j) - resp(i,j,1))));
+  TEST_NEAR("extrema() signed response", e, 0.0, 1e-3);
+
+  // extrema_rotational() gives the same result with several threads
+  vil_image_view<float> rot1 =
+    brip_vil_float_ops::extrema_rotational(im, 3.0f, 1.5f, 30.0f);
+  vil_image_view<float> rot3 =
+    brip_vil_float_ops::extrema_rotational(im, 3.0f, 1.5f, 30.0f, true, false,
+                                           false, false, true, 0.01f, 3);
+  bool same = rot1.nplanes()==3 && rot3.nplanes()==3;
+  for (unsigned p = 0; same && p<3; ++p)
+    for (unsigned j = 0; j<im.nj(); ++j)
+      for (unsigned i = 0; i<im.ni(); ++i)
+        same = same && rot1(i,j,p)==rot3(i,j,p);
+  TEST("extrema_rotational() threaded", same, true);
+}
+
+TESTMAIN(test_fft_correlation);
@@ -1,4 +1,5 @@
 #include <brip/brip_blobwise_mutual_info.h>
+#include <brip/brip_fft_correlation.h>
 #include <brip/brip_filter_bank.h>
 #include <brip/brip_gain_offset_solver.h>
 #include <brip/brip_gaussian_kernel.h>
@@ -15,6 +16,7 @@
 #include <brip/brip_quadtree_node_base_sptr.h>
 #include <brip/brip_quadtree_utils.h>
 #include <brip/brip_rect_mask.h>
+#include <brip/brip_sliding_histogram.h>
 #include <brip/brip_region_pixel.h>
 #include <brip/brip_region_pixel_sptr.h>
 #include <brip/brip_roi.h>
@@ -0,0 +1,141 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <testlib/testlib_test.h>
+#include <vcl_compiler.h>
+#include <vil/vil_image_view.h>
+#include <vil/vil_new.h>
+#include <vnl/vnl_random.h>
+#include <vnl/vnl_math.h>
+#include <bsta/bsta_histogram.h>
+#include <bsta/bsta_joint_histogram.h>
+#include <brip/brip_sliding_histogram.h>
+#include <brip/brip_vil_float_ops.h>
+
+//: Entropy of the window about (i,j) computed directly with bsta_histogram
+static float direct_entropy(vil_image_view<int> const& bins,
+                            vil_image_view<float> const& w,
+                            unsigned n_bins, int i, int j, int ir, int jr)
+{
+  bsta_histogram<float> h(float(n_bins), n_bins);
+  for (int y = j-jr; y<=j+jr; ++y)
+    for (int x = i-ir; x<=i+ir; ++x)
+      if (bins(x,y)>=0)
+        h.upcount(bins(x,y)+0.5f, w.size() ? w(x,y) : 1.0f);
+  return h.entropy();
+}
+
+static void test_sliding_histogram()
+{
+  const unsigned ni = 37, nj = 29, n_bins = 8;
+  vnl_random rng(4711);
+  vil_image_view<float> im0(ni, nj), im1(ni, nj), w(ni, nj);
+  for (unsigned j = 0; j<nj; ++j)
+    for (unsigned i = 0; i<ni; ++i)
+    {
+      // smooth structure plus noise, with some values out of range
+      im0(i,j) = float(10.0*std::sin(0.3*i)+0.5*j + rng.drand64(0.0, 4.0));
+      im1(i,j) = 0.5f*im0(i,j) + float(rng.drand64(0.0, 3.0));
+      w(i,j) = float(rng.drand64(0.0, 2.0));
+    }
+  vil_image_view<int> bins0, bins1;
+  brip_sliding_histogram_bins(im0, 20.0f, n_bins, bins0);
+  brip_sliding_histogram_bins(im1, 20.0f, n_bins, bins1);
+
+  bsta_histogram<float> hb(20.0f, n_bins);
+  bool bins_ok = true;
+  for (unsigned j = 0; j<nj; ++j)
+    for (unsigned i = 0; i<ni; ++i)
+      bins_ok = bins_ok && bins0(i,j) == hb.bin_at_val(im0(i,j));
+  TEST("Bins agree with bsta_histogram", bins_ok, true);
+
+  vil_image_view<float> no_weights;
+  const unsigned radii[3][3] = { {1,1,1}, {3,2,1}, {4,5,3} };  // ir, jr, step
+  for (unsigned r = 0; r<3; ++r)
+  {
+    unsigned ir = radii[r][0], jr = radii[r][1], step = radii[r][2];
+    vil_image_view<float> ent, went, ent3, mi;
+    brip_sliding_entropy(bins0, no_weights, n_bins, ir, jr, step, ent);
+    brip_sliding_entropy(bins0, w, n_bins, ir, jr, step, went);
+    brip_sliding_entropy(bins0, w, n_bins, ir, jr, step, ent3, 3);
+    brip_sliding_minfo(bins0, no_weights, bins1, no_weights, n_bins,
+                       ir, jr, step, mi, 2);
+    TEST("Output size", ent.ni()==ni/step+1 && ent.nj()==nj/step+1, true);
+
+    double max_err = 0, max_werr = 0, max_merr = 0;
+    double max_terr = 0;
+    for (unsigned j = jr; j+jr<nj; j+=step)
+      for (unsigned i = ir; i+ir<ni; i+=step)
+      {
+        float e = direct_entropy(bins0, no_weights, n_bins, i, j, ir, jr);
+        float we = direct_entropy(bins0, w, n_bins, i, j, ir, jr);
+        max_err = std::max(max_err, double(std::fabs(e - ent(i/step,j/step))));
+        max_werr = std::max(max_werr, double(std::fabs(we - went(i/step,j/step))));
+        max_terr = std::max(max_terr, double(std::fabs(went(i/step,j/step) - ent3(i/step,j/step))));
+
+        bsta_histogram<float> h0(float(n_bins), n_bins), h1(float(n_bins), n_bins);
+        bsta_joint_histogram<float> hj(float(n_bins), n_bins);
+        for (unsigned y = j-jr; y<=j+jr; ++y)
+          for (unsigned x = i-ir; x<=i+ir; ++x)
+          {
+            float a = bins0(x,y)+0.5f, b = bins1(x,y)+0.5f;
+            if (bins0(x,y)>=0) h0.upcount(a, 1.0f);
+            if (bins1(x,y)>=0) h1.upcount(b, 1.0f);
+            if (bins0(x,y)>=0 && bins1(x,y)>=0) hj.upcount(a, 1.0f, b, 1.0f);
+          }
+        float m = h0.entropy() + h1.entropy() - hj.entropy();
+        max_merr = std::max(max_merr, double(std::fabs(m - mi(i/step,j/step))));
+      }
+    std::cout << "radius " << ir << 'x' << jr << " step " << step << '\n';
+    TEST_NEAR("Sliding entropy matches direct histogram", max_err, 0.0, 1e-4);
+    TEST_NEAR("Weighted sliding entropy matches direct histogram", max_werr, 0.0, 1e-4);
+    TEST_NEAR("Threaded entropy matches serial", max_terr, 0.0, 1e-5);
+    TEST_NEAR("Sliding minfo matches direct histograms", max_merr, 0.0, 1e-4);
+  }
+
+  vil_image_view<float> big_mi;
+  TEST("Too many bins for minfo", brip_sliding_minfo(bins0, no_weights, bins1, no_weights,
+                                                     brip_sliding_minfo_max_bins+1,
+                                                     1, 1, 1, big_mi), false);
+
+  // A constant image has zero entropy, and an image split into two equal
+  // halves within the window has entropy one bit.
+  vil_image_view<int> halves(10, 10);
+  for (unsigned j = 0; j<10; ++j)
+    for (unsigned i = 0; i<10; ++i)
+      halves(i,j) = i<5 ? 2 : 6;
+  vil_image_view<float> ent;
+  brip_sliding_entropy(halves, no_weights, n_bins, 2, 2, 1, ent);
+  TEST_NEAR("Constant window", ent(2,2), 0.0, 1e-6);
+  brip_sliding_entropy(halves, no_weights, n_bins, 2, 1, 1, ent);
+  TEST_NEAR("Straddling window", ent(5,5), -(0.6*std::log(0.6)+0.4*std::log(0.4))*vnl_math::log2e, 1e-5);
+
+  // brip_vil_float_ops::entropy gives the sum of entropy_i and entropy_g
+  vil_image_view<vxl_byte> bimg(24, 20);
+  for (unsigned j = 0; j<bimg.nj(); ++j)
+    for (unsigned i = 0; i<bimg.ni(); ++i)
+      bimg(i,j) = vxl_byte(rng.lrand32(0, 255));
+  vil_image_resource_sptr res = vil_new_image_resource_of_view(bimg);
+  vil_image_view<float> e = brip_vil_float_ops::entropy(3, 2, 2, res, 1.0f, 16,
+                                                        true, true, false, 2);
+  vil_image_view<float> g = brip_vil_float_ops::gaussian(brip_vil_float_ops::convert_to_float(res), 1.0f);
+  vil_image_view<float> gx(24, 20), gy(24, 20);
+  brip_vil_float_ops::gradient_3x3(g, gx, gy);
+  double max_err = 0;
+  for (unsigned j = 2; j<18; j+=2)
+    for (unsigned i = 3; i<21; i+=2)
+    {
+      float direct = brip_vil_float_ops::entropy_i(i, j, 3, 2, g, 255.0f, 16) +
+                     brip_vil_float_ops::entropy_g(i, j, 3, 2, gx, gy);
+      max_err = std::max(max_err, double(std::fabs(direct - e(i/2,j/2))));
+    }
+  TEST_NEAR("entropy() matches entropy_i + entropy_g", max_err, 0.0, 1e-4);
+
+  vil_image_view<float> MI;
+  TEST("minfo_map", brip_vil_float_ops::minfo_map(3, 2, 1, res, res, MI, 1.0f,
+                                                  true, false, false), true);
+  float self = brip_vil_float_ops::minfo_i(10, 10, 10, 10, 3, 2, g, g);
+  TEST_NEAR("minfo_map of an image with itself", MI(10,10), self, 1e-4);
+}
+
+TESTMAIN(test_sliding_histogram);
@@ -1,26 +1,43 @@
 #include <iostream>
 #include <algorithm>
 #include "bstm_majority_filter.h"
+#include "bstm_parallel_for.h"
 #include <vcl_compiler.h>
 
 
-bstm_majority_filter::bstm_majority_filter(bstm_block_metadata data, bstm_block* blk, bstm_time_block* blk_t, bstm_data_base* changes)
+bstm_majority_filter::bstm_majority_filter(bstm_block_metadata data, bstm_block* blk, bstm_time_block* blk_t, bstm_data_base* changes,
+                                           unsigned n_threads)
 {
 
   boxm2_array_3d<uchar16>& trees = blk->trees();
 
   std::size_t data_size = changes->buffer_length();
   bstm_data_base* new_change = new bstm_data_base(new char[data_size], data_size, data.id_);
-  bstm_data_traits<BSTM_CHANGE>::datatype*  new_change_data = (bstm_data_traits<BSTM_CHANGE>::datatype*) new_change->data_buffer();
-  bstm_data_traits<BSTM_CHANGE>::datatype * change_data = (bstm_data_traits<BSTM_CHANGE>::datatype*) changes->data_buffer();
+  new_change_data_ = (bstm_data_traits<BSTM_CHANGE>::datatype*) new_change->data_buffer();
+  change_data_ = (bstm_data_traits<BSTM_CHANGE>::datatype*) changes->data_buffer();
+  trees_ = &trees;
+  max_level_ = data.max_level_;
 
-  //iterate through each tree
-  for (unsigned int x = 0; x < trees.get_row1_count(); ++x) {
+  //iterate through each tree, splitting the slices along x between threads
+  bstm_parallel_for(this, &bstm_majority_filter::filter_slices, (unsigned)trees.get_row1_count(), n_threads);
+
+  //replace the data
+  bstm_cache_sptr cache = bstm_cache::instance();
+  cache->replace_data_base(data.id_, bstm_data_traits<BSTM_CHANGE>::prefix(), new_change);
+}
+
+
+
+//: filter the cells of the trees with x index in [begin,end)
+void bstm_majority_filter::filter_slices(unsigned begin, unsigned end, unsigned /*t*/)
+{
+  boxm2_array_3d<uchar16>& trees = *trees_;
+  for (unsigned int x = begin; x < end; ++x) {
     for (unsigned int y = 0; y < trees.get_row2_count(); ++y) {
      for (unsigned int z = 0; z < trees.get_row3_count(); ++z) {
        //load current block/tree
        uchar16 tree = trees(x, y, z);
-       boct_bit_tree bit_tree((unsigned char*) tree.data_block(), data.max_level_);
+       boct_bit_tree bit_tree((unsigned char*) tree.data_block(), max_level_);
        //iterate through leaves of the tree
        std::vector<int> leafBits = bit_tree.get_leaf_bits(0);
        std::vector<int>::iterator iter;
@@ -45,7 +62,7 @@ bstm_majority_filter::bstm_majority_filter(bstm_block_metadata data, bstm_block*
                                         (int) abCenter.y(),
                                         (int) abCenter.z() );
             uchar16 ntree = trees(blkIdx.x(), blkIdx.y(), blkIdx.z());
-            boct_bit_tree neighborTree( (unsigned char*) ntree.data_block(), data.max_level_);
+            boct_bit_tree neighborTree( (unsigned char*) ntree.data_block(), max_level_);
 
             //traverse to local center
             vgl_point_3d<double> locCenter((double) abCenter.x() - blkIdx.x(),
@@ -57,7 +74,7 @@ bstm_majority_filter::bstm_majority_filter(bstm_block_metadata data, bstm_block*
             if ( neighborTree.is_leaf(neighborBitIdx) ) {
               //get data index
               int idx = neighborTree.get_data_index(neighborBitIdx);
-              probs.push_back(change_data[idx]);
+              probs.push_back(change_data_[idx]);
             }
             else //neighbor is smaller, must combine neighborhood
             {
@@ -74,7 +91,7 @@ bstm_majority_filter::bstm_majority_filter(bstm_block_metadata data, bstm_block*
                 double nlen = 1.0 / (double) (1<<ndepth);
                 int dataIndex = neighborTree.get_data_index(*leafIter);
 
-                totalChange += change_data[dataIndex] * nlen;
+                totalChange += change_data_[dataIndex] * nlen;
                 totalLen += nlen;
               }
               float change = totalChange/ totalLen;
@@ -84,11 +101,11 @@ bstm_majority_filter::bstm_majority_filter(bstm_block_metadata data, bstm_block*
           }
 
           //if you've collected a nonzero amount of probs, update it
-          probs.push_back(change_data[currIdx] );
+          probs.push_back(change_data_[currIdx] );
           if (probs.size() > 0) {
             std::sort( probs.begin(), probs.end() );
             double median = probs[ (int) (3*probs.size()/4) ];
-            new_change_data[currIdx] = float(median);
+            new_change_data_[currIdx] = float(median);
           }
 
        }
@@ -96,14 +113,8 @@ bstm_majority_filter::bstm_majority_filter(bstm_block_metadata data, bstm_block*
      }
     }
   }
-
-  //replace the data
-  bstm_cache_sptr cache = bstm_cache::instance();
-  cache->replace_data_base(data.id_, bstm_data_traits<BSTM_CHANGE>::prefix(), new_change);
 }
 
-
-
 //: returns a list of 3d points of neighboring blocks
 std::vector<vgl_point_3d<double> >
 bstm_majority_filter::neighbor_points( vgl_point_3d<double>& cellCenter, double side_len, boxm2_array_3d<uchar16>& trees )
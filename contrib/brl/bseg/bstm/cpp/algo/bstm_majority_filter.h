@@ -15,12 +15,21 @@ class bstm_majority_filter
   typedef vnl_vector_fixed<uchar, 16> uchar16;
 
   //: "default" constructor
-  bstm_majority_filter(bstm_block_metadata data, bstm_block* blk,bstm_time_block* blk_t, bstm_data_base* changes);
+  //  The trees are split between n_threads threads.
+  bstm_majority_filter(bstm_block_metadata data, bstm_block* blk,bstm_time_block* blk_t, bstm_data_base* changes,
+                       unsigned n_threads = 1);
 
  private:
+  //: filter the cells of the trees with x index in [begin,end)
+  void filter_slices(unsigned begin, unsigned end, unsigned t);
+
   //: returns a list of 3d points of neighboring blocks
   std::vector<vgl_point_3d<double> > neighbor_points( vgl_point_3d<double>& cellCenter, double side_len, boxm2_array_3d<uchar16>& trees );
 
+  boxm2_array_3d<uchar16>* trees_;
+  int max_level_;
+  bstm_data_traits<BSTM_CHANGE>::datatype* change_data_;
+  bstm_data_traits<BSTM_CHANGE>::datatype* new_change_data_;
 };
 
 
@@ -1,9 +1,11 @@
 #include <iostream>
 #include <set>
 #include "bstm_merge_tt_function.h"
+#include "bstm_parallel_for.h"
 #include <vcl_compiler.h>
 
-bool bstm_merge_tt_function::init_data(bstm_time_block* blk_t, bstm_block* blk, std::vector<bstm_data_base*> & datas, float prob_thresh)
+bool bstm_merge_tt_function::init_data(bstm_time_block* blk_t, bstm_block* blk, std::vector<bstm_data_base*> & datas, float prob_thresh,
+                                       unsigned n_threads)
 {
   //store block and pointer to uchar16 3d block
    blk_   = blk;
@@ -62,6 +64,7 @@ bool bstm_merge_tt_function::init_data(bstm_time_block* blk_t, bstm_block* blk,
    }
 
    prob_t_ = prob_thresh;
+   n_threads_ = n_threads;
 
    return true;
 }
@@ -69,15 +72,81 @@ bool bstm_merge_tt_function::init_data(bstm_time_block* blk_t, bstm_block* blk,
 
 bool bstm_merge_tt_function::merge(std::vector<bstm_data_base*>& datas)
 {
-  //1. loop over each tree to save spatial depth of each time tree
+  std::vector<bstm_data_base*> new_datas;
+  if (!this->merge(datas, new_datas))
+    return false;
+
+  //update cache, replace data
+  bstm_block_id id = blk_->block_id();
+  bstm_cache_sptr cache = bstm_cache::instance();
+  cache->replace_data_base(id, bstm_data_traits<BSTM_ALPHA>::prefix(), new_datas[0]);
+  cache->replace_data_base(id, bstm_data_traits<BSTM_MOG6_VIEW_COMPACT>::prefix(), new_datas[1]);
+  cache->replace_data_base(id, bstm_data_traits<BSTM_NUM_OBS_VIEW_COMPACT>::prefix(), new_datas[2]);
+  return true;
+}
+
+bool bstm_merge_tt_function::merge(std::vector<bstm_data_base*>& /*datas*/, std::vector<bstm_data_base*>& new_datas)
+{
+  //1. loop over each tree to save spatial depth of each space cell;
+  //   the time trees of cell i are at [i*sub_block_num_t_, (i+1)*sub_block_num_t_)
   boxm2_array_1d<uchar8>&  old_time_trees = blk_t_->time_trees();    //old time trees
-  char* depths = new char[old_time_trees.size()];
-  boxm2_array_3d<uchar16>&  trees = blk_->trees();  //trees to refine
-  boxm2_array_3d<uchar16>::iterator blk_iter;
-  for (blk_iter = trees.begin(); blk_iter != trees.end(); ++blk_iter)
+  unsigned num_time_trees = (unsigned)old_time_trees.size();
+  depths_ = new char[num_time_trees / sub_block_num_t_];
+  bstm_parallel_for(this, &bstm_merge_tt_function::find_depths, (unsigned)blk_->trees().size(), n_threads_);
+
+  //2. loop over time trees to merge them
+  trees_copy_ = new uchar8[num_time_trees];  //copy of time trees
+  dataIndex_ = new int[num_time_trees]; //data index for each new tree
+  num_leaves_ = new int[num_time_trees];
+  old_num_leaves_ = new int[num_time_trees];
+  bstm_parallel_for(this, &bstm_merge_tt_function::merge_trees, num_time_trees, n_threads_);
+
+  int dataSize = 0;                                 //running sum of data size
+  int old_dataSize = 0;
+  for (unsigned currIndex = 0; currIndex < num_time_trees; ++currIndex)
+  {
+    dataIndex_[currIndex] = dataSize;
+    dataSize += num_leaves_[currIndex];
+    old_dataSize += old_num_leaves_[currIndex];
+  }
+
+  //3. alloc new buffers
+  bstm_block_id id = blk_->block_id();
+  bstm_data_base* newA = new bstm_data_base(new char[dataSize * bstm_data_traits<BSTM_ALPHA>::datasize() ],
+                                                      dataSize * bstm_data_traits<BSTM_ALPHA>::datasize(), id);
+  bstm_data_base* newM = new bstm_data_base(new char[dataSize * bstm_data_traits<BSTM_MOG6_VIEW_COMPACT>::datasize() ],
+                                                      dataSize * bstm_data_traits<BSTM_MOG6_VIEW_COMPACT>::datasize() , id);
+  bstm_data_base* newN = new bstm_data_base(new char[dataSize * bstm_data_traits<BSTM_NUM_OBS_VIEW_COMPACT>::datasize() ],
+                                                      dataSize * bstm_data_traits<BSTM_NUM_OBS_VIEW_COMPACT>::datasize(), id);
+  alpha_cpy_ = (bstm_data_traits<BSTM_ALPHA>::datatype *) newA->data_buffer();
+  mog_cpy_ = (bstm_data_traits<BSTM_MOG6_VIEW_COMPACT>::datatype *) newM->data_buffer();
+  numobs_cpy_ = (bstm_data_traits<BSTM_NUM_OBS_VIEW_COMPACT>::datatype *) newN->data_buffer();
+
+  std::cout << "Num elements saved: " << old_dataSize - dataSize << "." << std::endl;
+
+  //4. loop through trees again, putting the time trees in the right place as well as refining the time trees
+  bstm_parallel_for(this, &bstm_merge_tt_function::move_trees, num_time_trees, n_threads_);
+
+  new_datas.clear();
+  new_datas.push_back(newA);
+  new_datas.push_back(newM);
+  new_datas.push_back(newN);
+
+  delete[] trees_copy_;
+  delete[] dataIndex_;
+  delete[] num_leaves_;
+  delete[] old_num_leaves_;
+  delete[] depths_;
+  return true;
+}
+
+void bstm_merge_tt_function::find_depths(unsigned begin, unsigned end, unsigned /*t*/)
+{
+  boxm2_array_3d<uchar16>&  trees = blk_->trees();
+  for (unsigned currIndex = begin; currIndex < end; ++currIndex)
   {
       //1. get current tree information
-      uchar16 tree  = (*blk_iter);
+      uchar16 tree  = trees.begin()[currIndex];
       boct_bit_tree curr_tree( (unsigned char*) tree.data_block(), max_level_);
 
       int cellsHit = 0;
@@ -88,84 +157,52 @@ bool bstm_merge_tt_function::merge(std::vector<bstm_data_base*>& datas)
         bool validParent = curr_tree.bit_at(pi) || (i==0); // special case for root
         if (validParent)
         {
-          depths[curr_tree.get_data_index(i, false) ] = curr_tree.depth_at(i);
+          depths_[curr_tree.get_data_index(i, false) ] = curr_tree.depth_at(i);
           cellsHit++;
         }
       }
   }
+}
 
-
-  //2. loop over time trees to merge them
-  boxm2_array_1d<uchar8>::iterator old_time_trees_iter;
-  uchar8* trees_copy = new uchar8[old_time_trees.size()];  //copy of time trees
-  int* dataIndex = new int[old_time_trees.size()]; //data index for each new tree
-  int currIndex = 0;                                //curr tree being looked at
-  int dataSize = 0;                                 //running sum of data size
-  int old_dataSize = 0;
-  for (old_time_trees_iter = old_time_trees.begin(); old_time_trees_iter != old_time_trees.end(); ++old_time_trees_iter, ++currIndex)
+void bstm_merge_tt_function::merge_trees(unsigned begin, unsigned end, unsigned /*t*/)
+{
+  boxm2_array_1d<uchar8>&  old_time_trees = blk_t_->time_trees();
+  for (unsigned currIndex = begin; currIndex < end; ++currIndex)
   {
-      //0. store data index for each tree.
-      dataIndex[currIndex] = dataSize;
       //1. get old time tree
-      bstm_time_tree old_time_tree((unsigned char*) (*old_time_trees_iter).data_block(), max_level_t_);
+      bstm_time_tree old_time_tree((unsigned char*) old_time_trees[currIndex].data_block(), max_level_t_);
       //2. merge time tree
-      bstm_time_tree new_time_tree = this->merge_tt(old_time_tree, depths[currIndex]);
+      bstm_time_tree new_time_tree = this->merge_tt(old_time_tree, depths_[currIndex / sub_block_num_t_]);
       //3. copy new tree into trees_copy
-      std::memcpy (trees_copy[currIndex].data_block(), new_time_tree.get_bits(), TT_NUM_BYTES);
+      std::memcpy (trees_copy_[currIndex].data_block(), new_time_tree.get_bits(), TT_NUM_BYTES);
       //4. account new datasize
-      dataSize += new_time_tree.num_leaves();
-      old_dataSize += old_time_tree.num_leaves();
+      num_leaves_[currIndex] = new_time_tree.num_leaves();
+      old_num_leaves_[currIndex] = old_time_tree.num_leaves();
   }
+}
 
-  //3. alloc new buffers
-  bstm_block_id id = blk_->block_id();
-  bstm_data_base* newA = new bstm_data_base(new char[dataSize * bstm_data_traits<BSTM_ALPHA>::datasize() ],
-                                                      dataSize * bstm_data_traits<BSTM_ALPHA>::datasize(), id);
-  bstm_data_base* newM = new bstm_data_base(new char[dataSize * bstm_data_traits<BSTM_MOG6_VIEW_COMPACT>::datasize() ],
-                                                      dataSize * bstm_data_traits<BSTM_MOG6_VIEW_COMPACT>::datasize() , id);
-  bstm_data_base* newN = new bstm_data_base(new char[dataSize * bstm_data_traits<BSTM_NUM_OBS_VIEW_COMPACT>::datasize() ],
-                                                      dataSize * bstm_data_traits<BSTM_NUM_OBS_VIEW_COMPACT>::datasize(), id);
-  bstm_data_traits<BSTM_ALPHA>::datatype *   alpha_cpy = (bstm_data_traits<BSTM_ALPHA>::datatype *) newA->data_buffer();
-  bstm_data_traits<BSTM_MOG6_VIEW_COMPACT>::datatype *  mog_cpy = (bstm_data_traits<BSTM_MOG6_VIEW_COMPACT>::datatype *) newM->data_buffer();
-  bstm_data_traits<BSTM_NUM_OBS_VIEW_COMPACT>::datatype *  numobs_cpy = (bstm_data_traits<BSTM_NUM_OBS_VIEW_COMPACT>::datatype *) newN->data_buffer();
-
-
-
-  std::cout << "Num elements saved: " << old_dataSize - dataSize << "." << std::endl;
-
-  //43. loop through trees again, putting the time trees in the right place as well as refining the time trees
-  currIndex = 0;
-  for (old_time_trees_iter = old_time_trees.begin(); old_time_trees_iter != old_time_trees.end(); ++old_time_trees_iter, ++currIndex)
+void bstm_merge_tt_function::move_trees(unsigned begin, unsigned end, unsigned /*t*/)
+{
+  boxm2_array_1d<uchar8>&  old_time_trees = blk_t_->time_trees();
+  for (unsigned currIndex = begin; currIndex < end; ++currIndex)
   {
       //1. get current tree information
-      bstm_time_tree old_tree( (unsigned char*) (*old_time_trees_iter).data_block(), max_level_t_);
+      bstm_time_tree old_tree( (unsigned char*) old_time_trees[currIndex].data_block(), max_level_t_);
 
       //2. merged tree
-      bstm_time_tree merged_tree( (unsigned char*) trees_copy[currIndex].data_block(), max_level_t_);
+      bstm_time_tree merged_tree( (unsigned char*) trees_copy_[currIndex].data_block(), max_level_t_);
 
       //2.5 pack data bits into merged tree
       //store data index in bits [10, 11, 12, 13] ;
-      int root_index = dataIndex[currIndex];
+      int root_index = dataIndex_[currIndex];
       merged_tree.set_data_ptr(root_index);
 
       //3. swap data from old location to new location
-      this->move_data(old_tree, merged_tree,  depths[currIndex], alpha_cpy, mog_cpy, numobs_cpy);
+      this->move_data(old_tree, merged_tree,  depths_[currIndex / sub_block_num_t_], alpha_cpy_, mog_cpy_, numobs_cpy_);
 
       //4. store old tree in new tree, swap data out
-      std::memcpy(old_time_trees_iter, merged_tree.get_bits(), TT_NUM_BYTES);
+      std::memcpy(old_time_trees[currIndex].data_block(), merged_tree.get_bits(), TT_NUM_BYTES);
   }
-
-
-  //5. update cache, replace time trees
-  bstm_cache_sptr cache = bstm_cache::instance();
-  cache->replace_data_base(id, bstm_data_traits<BSTM_ALPHA>::prefix(), newA);
-  cache->replace_data_base(id, bstm_data_traits<BSTM_MOG6_VIEW_COMPACT>::prefix(), newM);
-  cache->replace_data_base(id, bstm_data_traits<BSTM_NUM_OBS_VIEW_COMPACT>::prefix(), newN);
-
-  delete[] trees_copy;
-  delete[] dataIndex;
-  delete[] depths;
-  return true;
 }
 
 void bstm_merge_tt_function::move_data(bstm_time_tree old_tree, bstm_time_tree merged_tree,  int depth, bstm_data_traits<BSTM_ALPHA>::datatype* alpha_cpy,
@@ -278,9 +315,9 @@ bstm_time_tree bstm_merge_tt_function::merge_tt(const bstm_time_tree& old_tree,
 ////////////////////////////////////////////////////////////////////////////////
 void bstm_merge_tt_blk(bstm_time_block* t_blk, bstm_block* blk,
                           std::vector<bstm_data_base*> & datas,
-                          float prob_thresh)
+                          float prob_thresh, unsigned n_threads)
 {
   bstm_merge_tt_function merge_block;
-  merge_block.init_data(t_blk, blk, datas, prob_thresh);
+  merge_block.init_data(t_blk, blk, datas, prob_thresh, n_threads);
   merge_block.merge(datas);
 }
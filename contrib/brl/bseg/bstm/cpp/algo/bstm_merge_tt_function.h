@@ -27,11 +27,26 @@ class bstm_merge_tt_function
   bstm_merge_tt_function() {}
 
   //: initialize generic data base pointers as their data type
-  bool init_data(bstm_time_block* t_blk, bstm_block* blk, std::vector<bstm_data_base*> & datas, float prob_thresh);
+  //  The time trees are split between n_threads threads.
+  bool init_data(bstm_time_block* t_blk, bstm_block* blk, std::vector<bstm_data_base*> & datas, float prob_thresh,
+                 unsigned n_threads = 1);
 
+  //: merge the time trees and replace the block's data in the cache
   bool merge(std::vector<bstm_data_base*>& datas);
 
+  //: merge the time trees, returning the new alpha, mog and num_obs data in new_datas
+  //  The time trees of the block are updated in place.
+  bool merge(std::vector<bstm_data_base*>& datas, std::vector<bstm_data_base*>& new_datas);
+
  private:
+  //: record the depth of the space cells of trees [begin,end)
+  void find_depths(unsigned begin, unsigned end, unsigned t);
+
+  //: merge time trees [begin,end) into trees_copy_
+  void merge_trees(unsigned begin, unsigned end, unsigned t);
+
+  //: move the data of time trees [begin,end) into the new buffers
+  void move_trees(unsigned begin, unsigned end, unsigned t);
 
   //merge time tree
   bstm_time_tree merge_tt(const bstm_time_tree& old_tree, int curr_depth);
@@ -63,6 +78,18 @@ class bstm_merge_tt_function
   unsigned sub_block_num_t_;
 
   float prob_t_;
+
+  unsigned n_threads_;
+
+  //working buffers shared by the threads, one entry per tree
+  char* depths_;
+  uchar8* trees_copy_;
+  int* dataIndex_;
+  int* num_leaves_;
+  int* old_num_leaves_;
+  bstm_data_traits<BSTM_ALPHA>::datatype* alpha_cpy_;
+  bstm_data_traits<BSTM_MOG6_VIEW_COMPACT>::datatype* mog_cpy_;
+  bstm_data_traits<BSTM_NUM_OBS_VIEW_COMPACT>::datatype* numobs_cpy_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -70,6 +97,6 @@ class bstm_merge_tt_function
 ////////////////////////////////////////////////////////////////////////////////
 void bstm_merge_tt_blk( bstm_time_block* t_blk, bstm_block* blk,
                          std::vector<bstm_data_base*> & datas,
-                         float prob_thresh);
+                         float prob_thresh, unsigned n_threads = 1);
 
 #endif //bstm_merge_tt_function_h
@@ -1,11 +1,13 @@
 #include <iostream>
 #include <algorithm>
 #include "bstm_refine_blk_in_spacetime_function.h"
+#include "bstm_parallel_for.h"
 #include <bstm/io/bstm_lru_cache.h>
 #include <vcl_compiler.h>
 
 
-bool bstm_refine_blk_in_spacetime_function::init_data(bstm_time_block* blk_t, bstm_block* blk, std::vector<bstm_data_base*> & datas, float prob_thresh)
+bool bstm_refine_blk_in_spacetime_function::init_data(bstm_time_block* blk_t, bstm_block* blk, std::vector<bstm_data_base*> & datas, float prob_thresh,
+                                                      unsigned n_threads)
 {
   //store block and pointer to uchar16 3d block
    blk_   = blk;
@@ -68,97 +70,81 @@ bool bstm_refine_blk_in_spacetime_function::init_data(bstm_time_block* blk_t, bs
    num_split_t_ = 0;
 
    prob_t_ = prob_thresh;
+   n_threads_ = n_threads;
 
    return true;
 }
 
 bool bstm_refine_blk_in_spacetime_function::refine(std::vector<bstm_data_base*>& datas)
 {
+  bstm_time_block* newRefinedTimeBlk = VXL_NULLPTR;
+  std::vector<bstm_data_base*> new_datas;
+  if (!this->refine(datas, newRefinedTimeBlk, new_datas))
+    return false;
 
-  //1. loop over each tree, refine it in place
+  //update cache, replace time trees
+  bstm_block_id id = blk_->block_id();
+  bstm_cache_sptr cache = bstm_cache::instance();
+  cache->replace_time_block(id, newRefinedTimeBlk);
+  cache->replace_data_base(id, bstm_data_traits<BSTM_ALPHA>::prefix(), new_datas[0]);
+  cache->replace_data_base(id, bstm_data_traits<BSTM_MOG6_VIEW_COMPACT>::prefix(), new_datas[1]);
+  cache->replace_data_base(id, bstm_data_traits<BSTM_NUM_OBS_VIEW_COMPACT>::prefix(), new_datas[2]);
+  return true;
+}
+
+bool bstm_refine_blk_in_spacetime_function::refine(std::vector<bstm_data_base*>& /*datas*/,
+                                                   bstm_time_block*& new_blk_t,
+                                                   std::vector<bstm_data_base*>& new_datas)
+{
+  //1. loop over each tree, refine it
   boxm2_array_3d<uchar16>&  trees = blk_->trees();  //trees to refine
-  uchar16* trees_copy = new uchar16[trees.size()];  //copy of those trees
-  int* dataIndex = new int[trees.size()];           //data index for each new tree
-  int currIndex = 0;                                //curr tree being looked at
+  unsigned num_trees = (unsigned)trees.size();
+  trees_copy_ = new uchar16[num_trees];             //copy of those trees
+  dataIndex_ = new int[num_trees];                  //data index for each new tree
+  sizes_ = new int[num_trees];                      //size of each new tree
+  split_counts_.assign(bstm_parallel_for_n_ranges(num_trees, n_threads_), 0);
+  bstm_parallel_for(this, &bstm_refine_blk_in_spacetime_function::refine_trees, num_trees, n_threads_);
+  for (unsigned t = 0; t < split_counts_.size(); ++t)
+    num_split_ += split_counts_[t];
+
   int dataSize = 0;                                 //running sum of data size
-  boxm2_array_3d<uchar16>::iterator blk_iter;
-  for (blk_iter = trees.begin(); blk_iter != trees.end(); ++blk_iter, ++currIndex)
+  for (unsigned currIndex = 0; currIndex < num_trees; ++currIndex)
   {
-      //0. store data index for eahc tree.
-      dataIndex[currIndex] = dataSize;
-
-      //1. get current tree information
-      uchar16 tree  = (*blk_iter);
-      boct_bit_tree curr_tree( (unsigned char*) tree.data_block(), max_level_);
-
-      //3. refine tree locally (only updates refined_tree and returns new tree size)
-      boct_bit_tree refined_tree = this->refine_bit_tree(curr_tree);
-      int newSize = refined_tree.num_cells();
-
-      //save refined tree to trees_copy
-      std::memcpy (trees_copy[currIndex].data_block(), refined_tree.get_bits(), sizeof(uchar16));
-      dataSize += newSize;
+    dataIndex_[currIndex] = dataSize;
+    dataSize += sizes_[currIndex];
   }
   std::cout << "Num space cells split: " << num_split_ << std::endl;
 
-
-
-
   //2. allocate new time blk of the appropriate size
   bstm_block_id id = blk_->block_id();
   bstm_block_metadata m_data; m_data.init_level_t_ = blk_t_->init_level(); m_data.max_level_t_ = blk_t_->max_level(); m_data.sub_block_num_t_ = blk_t_->sub_block_num();
-  bstm_time_block* newTimeBlk = new bstm_time_block(id, m_data, dataSize); //create empty time block
-  bstm_time_block* newRefinedTimeBlk = new bstm_time_block(id, m_data, dataSize); //create empty time block
-  char* depths = new char[dataSize];
-
+  newTimeBlk_ = new bstm_time_block(id, m_data, dataSize); //create empty time block
+  newRefinedTimeBlk_ = new bstm_time_block(id, m_data, dataSize); //create empty time block
+  depths_ = new char[dataSize];
 
   //3. loop through trees again, putting the time trees in the right place as well as refining the time trees
-  int newInitCount = 0;
-  currIndex = 0;
-  for (blk_iter = trees.begin(); blk_iter != trees.end(); ++blk_iter, ++currIndex)
-  {
-      //1. get current tree information
-      uchar16 tree  = (*blk_iter);
-      boct_bit_tree old_tree( (unsigned char*) tree.data_block(), max_level_);
-
-      //2. refine tree locally (only updates refined_tree and returns new tree size)
-      boct_bit_tree refined_tree( (unsigned char*) trees_copy[currIndex].data_block(), max_level_);
-
-      //2.5 pack data bits into refined tree
-      //store data index in bits [10, 11, 12, 13] ;
-      int root_index = dataIndex[currIndex];
-      refined_tree.set_data_ptr(root_index, false); //is not random
-
-      //3. swap data from old location to new location
-      newInitCount += this->move_time_trees(old_tree, refined_tree, newTimeBlk, newRefinedTimeBlk, depths);
-
-      //4. store old tree in new tree, swap data out
-      std::memcpy(blk_iter, refined_tree.get_bits(), sizeof(uchar16));
-  }
+  split_counts_.assign(split_counts_.size(), 0);
+  bstm_parallel_for(this, &bstm_refine_blk_in_spacetime_function::move_trees, num_trees, n_threads_);
+  for (unsigned t = 0; t < split_counts_.size(); ++t)
+    num_split_t_ += split_counts_[t];
 
   std::cout << "Num time cells split: " << num_split_t_ << std::endl;
 
-
-  delete[] trees_copy;
-  delete[] dataIndex;
-
-
+  delete[] trees_copy_;
+  delete[] dataIndex_;
+  delete[] sizes_;
 
   //4. figure out new data size
-  boxm2_array_1d<uchar8>&  new_refined_time_trees = newRefinedTimeBlk->time_trees();    //refined new time trees
-  boxm2_array_1d<uchar8>&  new_unrefined_time_trees = newTimeBlk->time_trees();         //unrefined new time treesunrefined_time_tree
-  boxm2_array_1d<uchar8>::iterator refined_time_trees_iter, unrefined_time_trees_iter;
-  dataIndex = new int[new_refined_time_trees.size()];                  //data index for each new tree
-  currIndex = 0;                                                        //curr tree being looked at
+  boxm2_array_1d<uchar8>&  new_refined_time_trees = newRefinedTimeBlk_->time_trees();    //refined new time trees
+  unsigned num_time_trees = (unsigned)new_refined_time_trees.size();
+  dataIndex_ = new int[num_time_trees];             //data index for each new tree
+  sizes_ = new int[num_time_trees];                 //number of leaves, not all cells.
+  bstm_parallel_for(this, &bstm_refine_blk_in_spacetime_function::count_leaves, num_time_trees, n_threads_);
   dataSize = 0;
-  for (refined_time_trees_iter = new_refined_time_trees.begin(); refined_time_trees_iter != new_refined_time_trees.end(); ++refined_time_trees_iter, ++currIndex)
+  for (unsigned currIndex = 0; currIndex < num_time_trees; ++currIndex)
   {
-      //0. store data index for each tree.
-      dataIndex[currIndex] = dataSize;
-      //1. get refined tree
-      bstm_time_tree new_time_tree((unsigned char*) (*refined_time_trees_iter).data_block(), max_level_t_);
-      int newSize = new_time_tree.num_leaves(); //number of leaves, not all cells.
-      dataSize += newSize;
+    dataIndex_[currIndex] = dataSize;
+    dataSize += sizes_[currIndex];
   }
   std::cout << "New data size: " << dataSize << std::endl;
 
@@ -169,41 +155,96 @@ bool bstm_refine_blk_in_spacetime_function::refine(std::vector<bstm_data_base*>&
                                                       dataSize * bstm_data_traits<BSTM_MOG6_VIEW_COMPACT>::datasize() , id);
   bstm_data_base* newN = new bstm_data_base(new char[dataSize * bstm_data_traits<BSTM_NUM_OBS_VIEW_COMPACT>::datasize() ],
                                                       dataSize * bstm_data_traits<BSTM_NUM_OBS_VIEW_COMPACT>::datasize(), id);
-  bstm_data_traits<BSTM_ALPHA>::datatype *   alpha_cpy = (bstm_data_traits<BSTM_ALPHA>::datatype *) newA->data_buffer();
-  bstm_data_traits<BSTM_MOG6_VIEW_COMPACT>::datatype *  mog_cpy = ( bstm_data_traits<BSTM_MOG6_VIEW_COMPACT>::datatype *) newM->data_buffer();
-  bstm_data_traits<BSTM_NUM_OBS_VIEW_COMPACT>::datatype *  numobs_cpy = (bstm_data_traits<BSTM_NUM_OBS_VIEW_COMPACT>::datatype *) newN->data_buffer();
-
+  alpha_cpy_ = (bstm_data_traits<BSTM_ALPHA>::datatype *) newA->data_buffer();
+  mog_cpy_ = ( bstm_data_traits<BSTM_MOG6_VIEW_COMPACT>::datatype *) newM->data_buffer();
+  numobs_cpy_ = (bstm_data_traits<BSTM_NUM_OBS_VIEW_COMPACT>::datatype *) newN->data_buffer();
 
   //5. move data from old data buffers to new data buffers
-  currIndex = 0;
-  for (refined_time_trees_iter = new_refined_time_trees.begin(), unrefined_time_trees_iter = new_unrefined_time_trees.begin();
-        refined_time_trees_iter != new_refined_time_trees.end(); ++refined_time_trees_iter, ++currIndex, ++unrefined_time_trees_iter)
+  bstm_parallel_for(this, &bstm_refine_blk_in_spacetime_function::move_tree_data, num_time_trees, n_threads_);
+
+  new_blk_t = newRefinedTimeBlk_;
+  new_datas.clear();
+  new_datas.push_back(newA);
+  new_datas.push_back(newM);
+  new_datas.push_back(newN);
+
+  delete[] dataIndex_;
+  delete[] sizes_;
+  delete newTimeBlk_;
+  delete[] depths_;
+
+  return true;
+}
+
+void bstm_refine_blk_in_spacetime_function::refine_trees(unsigned begin, unsigned end, unsigned t)
+{
+  boxm2_array_3d<uchar16>&  trees = blk_->trees();
+  for (unsigned currIndex = begin; currIndex < end; ++currIndex)
   {
-      //1. get refined and unrefined tree
-      bstm_time_tree refined_time_tree((unsigned char*) (*refined_time_trees_iter).data_block(), max_level_t_);
-      bstm_time_tree unrefined_time_tree((unsigned char*) (*unrefined_time_trees_iter).data_block(), max_level_t_);
-      //2. correct data ptr
-      refined_time_tree.set_data_ptr(dataIndex[currIndex]);
-      //3. save it back to newRefinedTimeBlk
-      std::memcpy(refined_time_trees_iter, refined_time_tree.get_bits(), TT_NUM_BYTES);
-      //4. move the data
-      this->move_data(unrefined_time_tree, refined_time_tree, alpha_cpy, mog_cpy, numobs_cpy, (int)( depths[currIndex / sub_block_num_t_]) );
+      //1. get current tree information
+      uchar16 tree  = trees.begin()[currIndex];
+      boct_bit_tree curr_tree( (unsigned char*) tree.data_block(), max_level_);
+
+      //2. refine tree locally (only updates refined_tree and returns new tree size)
+      boct_bit_tree refined_tree = this->refine_bit_tree(curr_tree, split_counts_[t]);
+      sizes_[currIndex] = refined_tree.num_cells();
+
+      //save refined tree to trees_copy
+      std::memcpy (trees_copy_[currIndex].data_block(), refined_tree.get_bits(), sizeof(uchar16));
   }
+}
 
+void bstm_refine_blk_in_spacetime_function::move_trees(unsigned begin, unsigned end, unsigned t)
+{
+  boxm2_array_3d<uchar16>&  trees = blk_->trees();
+  for (unsigned currIndex = begin; currIndex < end; ++currIndex)
+  {
+      //1. get current tree information
+      uchar16 tree  = trees.begin()[currIndex];
+      boct_bit_tree old_tree( (unsigned char*) tree.data_block(), max_level_);
 
+      //2. refine tree locally (only updates refined_tree and returns new tree size)
+      boct_bit_tree refined_tree( (unsigned char*) trees_copy_[currIndex].data_block(), max_level_);
 
-  //6. update cache, replace time trees
-  bstm_cache_sptr cache = bstm_cache::instance();
-  cache->replace_time_block(id, newRefinedTimeBlk);
-  cache->replace_data_base(id, bstm_data_traits<BSTM_ALPHA>::prefix(), newA);
-  cache->replace_data_base(id, bstm_data_traits<BSTM_MOG6_VIEW_COMPACT>::prefix(), newM);
-  cache->replace_data_base(id, bstm_data_traits<BSTM_NUM_OBS_VIEW_COMPACT>::prefix(), newN);
+      //2.5 pack data bits into refined tree
+      //store data index in bits [10, 11, 12, 13] ;
+      int root_index = dataIndex_[currIndex];
+      refined_tree.set_data_ptr(root_index, false); //is not random
 
-  delete[] dataIndex;
-  delete newTimeBlk;
-  delete[] depths;
+      //3. swap data from old location to new location
+      this->move_time_trees(old_tree, refined_tree, newTimeBlk_, newRefinedTimeBlk_, depths_, split_counts_[t]);
 
-  return true;
+      //4. store old tree in new tree, swap data out
+      std::memcpy(trees.begin()[currIndex].data_block(), refined_tree.get_bits(), sizeof(uchar16));
+  }
+}
+
+void bstm_refine_blk_in_spacetime_function::count_leaves(unsigned begin, unsigned end, unsigned /*t*/)
+{
+  boxm2_array_1d<uchar8>&  new_refined_time_trees = newRefinedTimeBlk_->time_trees();
+  for (unsigned currIndex = begin; currIndex < end; ++currIndex)
+  {
+      bstm_time_tree new_time_tree((unsigned char*) new_refined_time_trees[currIndex].data_block(), max_level_t_);
+      sizes_[currIndex] = new_time_tree.num_leaves();
+  }
+}
+
+void bstm_refine_blk_in_spacetime_function::move_tree_data(unsigned begin, unsigned end, unsigned /*t*/)
+{
+  boxm2_array_1d<uchar8>&  new_refined_time_trees = newRefinedTimeBlk_->time_trees();
+  boxm2_array_1d<uchar8>&  new_unrefined_time_trees = newTimeBlk_->time_trees();
+  for (unsigned currIndex = begin; currIndex < end; ++currIndex)
+  {
+      //1. get refined and unrefined tree
+      bstm_time_tree refined_time_tree((unsigned char*) new_refined_time_trees[currIndex].data_block(), max_level_t_);
+      bstm_time_tree unrefined_time_tree((unsigned char*) new_unrefined_time_trees[currIndex].data_block(), max_level_t_);
+      //2. correct data ptr
+      refined_time_tree.set_data_ptr(dataIndex_[currIndex]);
+      //3. save it back to newRefinedTimeBlk
+      std::memcpy(new_refined_time_trees[currIndex].data_block(), refined_time_tree.get_bits(), TT_NUM_BYTES);
+      //4. move the data
+      this->move_data(unrefined_time_tree, refined_time_tree, alpha_cpy_, mog_cpy_, numobs_cpy_, (int)( depths_[currIndex / sub_block_num_t_]) );
+  }
 }
 
 void bstm_refine_blk_in_spacetime_function::move_data(bstm_time_tree& unrefined_time_tree, bstm_time_tree& refined_time_tree,
@@ -253,7 +294,8 @@ void bstm_refine_blk_in_spacetime_function::move_data(bstm_time_tree& unrefined_
 }
 
 int bstm_refine_blk_in_spacetime_function::move_time_trees(boct_bit_tree& unrefined_tree, boct_bit_tree& refined_tree,
-                                                                  bstm_time_block* newTimeBlk, bstm_time_block* newRefinedTimeBlk, char* depths )
+                                                                  bstm_time_block* newTimeBlk, bstm_time_block* newRefinedTimeBlk, char* depths,
+                                                                  int& num_split_t)
 {
   int newSize = refined_tree.num_cells();
 
@@ -298,7 +340,7 @@ int bstm_refine_blk_in_spacetime_function::move_time_trees(boct_bit_tree& unrefi
         boxm2_array_1d<vnl_vector_fixed<unsigned char, 8> > refined_time_trees = newRefinedTimeBlk->get_cell_all_tt(newDataPtr);
         for (unsigned int t_idx = 0;t_idx < sub_block_num_t_; ++t_idx) {
           bstm_time_tree tmp_tree(refined_time_trees[t_idx].data_block() );       //create tree by copying the tree data
-          bstm_time_tree refined_tree = refine_time_tree(tmp_tree, side_len );    //refine time tree
+          bstm_time_tree refined_tree = refine_time_tree(tmp_tree, side_len, num_split_t );    //refine time tree
           refined_time_trees[t_idx].set( refined_tree.get_bits() );               //copy to refined_time_trees.
         }
       }
@@ -327,7 +369,7 @@ int bstm_refine_blk_in_spacetime_function::move_time_trees(boct_bit_tree& unrefi
       boxm2_array_1d<vnl_vector_fixed<unsigned char, 8> > refined_time_trees = newRefinedTimeBlk->get_cell_all_tt(newDataPtr);
       for (unsigned int t_idx = 0;t_idx < sub_block_num_t_; ++t_idx) {
         bstm_time_tree tmp_tree(refined_time_trees[t_idx].data_block() );       //create tree by copying the tree data
-        bstm_time_tree refined_tree = refine_time_tree(tmp_tree, side_len );    //refine time tree
+        bstm_time_tree refined_tree = refine_time_tree(tmp_tree, side_len, num_split_t );    //refine time tree
         refined_time_trees[t_idx].set( refined_tree.get_bits() );               //copy to refined_time_trees.
       }
 
@@ -364,7 +406,7 @@ bool bstm_refine_blk_in_spacetime_function::decide_refinement_in_space(int dataI
   return false;
 }
 
-bstm_time_tree bstm_refine_blk_in_spacetime_function::refine_time_tree(bstm_time_tree& unrefined_time_tree, double side_len )
+bstm_time_tree bstm_refine_blk_in_spacetime_function::refine_time_tree(bstm_time_tree& unrefined_time_tree, double side_len, int& num_split_t )
 {
   //initialize tree to return
   bstm_time_tree refined_tree(unrefined_time_tree.get_bits(), max_level_t_);
@@ -381,14 +423,14 @@ bstm_time_tree bstm_refine_blk_in_spacetime_function::refine_time_tree(bstm_time
     bool should_refine = (p > prob_t_);
     if (should_refine && unrefined_time_tree.depth_at(*iter) < max_level_t_ -1) {
       refined_tree.set_bit_at(*iter, true);
-      num_split_t_++;
+      num_split_t++;
     }
   }
   return refined_tree;
 }
 
 
-boct_bit_tree bstm_refine_blk_in_spacetime_function::refine_bit_tree(const boct_bit_tree& unrefined_tree)
+boct_bit_tree bstm_refine_blk_in_spacetime_function::refine_bit_tree(const boct_bit_tree& unrefined_tree, int& num_split)
 {
   //initialize tree to return
   boct_bit_tree refined_tree(unrefined_tree.get_bits(), max_level_);
@@ -419,7 +461,7 @@ boct_bit_tree bstm_refine_blk_in_spacetime_function::refine_bit_tree(const boct_
         refined_tree.set_bit_at(i, true);
 
         //keep track of number of nodes that split
-        ++num_split_;
+        ++num_split;
       }
       ////////////////////////////////////////////
       //END LEAF SPECIFIC CODE
@@ -434,10 +476,10 @@ boct_bit_tree bstm_refine_blk_in_spacetime_function::refine_bit_tree(const boct_
 ////////////////////////////////////////////////////////////////////////////////
 void bstm_refine_block_spacetime(bstm_time_block* t_blk, bstm_block* blk,
                         std::vector<bstm_data_base*> & datas,
-                        float prob_thresh)
+                        float prob_thresh, unsigned n_threads)
 {
   bstm_refine_blk_in_spacetime_function refine_block;
-  refine_block.init_data(t_blk, blk, datas, prob_thresh);
+  refine_block.init_data(t_blk, blk, datas, prob_thresh, n_threads);
 
   refine_block.refine(datas);
 }
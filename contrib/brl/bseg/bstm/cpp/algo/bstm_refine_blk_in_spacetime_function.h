@@ -27,24 +27,43 @@ class bstm_refine_blk_in_spacetime_function
   bstm_refine_blk_in_spacetime_function() {}
 
   //: initialize generic data base pointers as their data type
-  bool init_data(bstm_time_block* t_blk, bstm_block* blk, std::vector<bstm_data_base*> & datas, float prob_thresh);
+  //  The trees are split between n_threads threads.
+  bool init_data(bstm_time_block* t_blk, bstm_block* blk, std::vector<bstm_data_base*> & datas, float prob_thresh,
+                 unsigned n_threads = 1);
 
+  //: refine the block and replace its time trees and data in the cache
   bool refine(std::vector<bstm_data_base*>& datas);
 
+  //: refine the block, returning the new time block and the new alpha, mog and num_obs data
+  //  The space trees of the block are updated in place.
+  bool refine(std::vector<bstm_data_base*>& datas, bstm_time_block*& new_blk_t, std::vector<bstm_data_base*>& new_datas);
+
  private:
 
+  //: refine space trees [begin,end) into trees_copy_
+  void refine_trees(unsigned begin, unsigned end, unsigned t);
+
+  //: move and refine the time trees of space trees [begin,end)
+  void move_trees(unsigned begin, unsigned end, unsigned t);
+
+  //: count the leaves of refined time trees [begin,end)
+  void count_leaves(unsigned begin, unsigned end, unsigned t);
+
+  //: move the data of refined time trees [begin,end) into the new buffers
+  void move_tree_data(unsigned begin, unsigned end, unsigned t);
+
   //: refine input tree and return refined tree
-  boct_bit_tree refine_bit_tree(const boct_bit_tree& input_tree);
+  boct_bit_tree refine_bit_tree(const boct_bit_tree& input_tree, int& num_split);
 
   //: decides if the provided space cell should refine
   bool decide_refinement_in_space(int dataIndex, double side_len);
 
   //: moves time trees to their new locations after space cells are subdivded
   int move_time_trees(boct_bit_tree& unrefined_tree, boct_bit_tree& refined_tree,
-                        bstm_time_block* newTimeBlk, bstm_time_block* newRefinedTimeBlk, char* depths);
+                        bstm_time_block* newTimeBlk, bstm_time_block* newRefinedTimeBlk, char* depths, int& num_split_t);
 
   //: refines a time tree
-  bstm_time_tree refine_time_tree(bstm_time_tree& unrefined_time_tree, double sidelen );
+  bstm_time_tree refine_time_tree(bstm_time_tree& unrefined_time_tree, double sidelen, int& num_split_t );
 
   //: moves data from old time trees to new tree
   void move_data(bstm_time_tree& unrefined_time_tree, bstm_time_tree& refined_time_tree, bstm_data_traits<BSTM_ALPHA>::datatype* alpha_cpy,
@@ -79,6 +98,22 @@ class bstm_refine_blk_in_spacetime_function
   int num_split_t_;
 
   float prob_t_;
+
+  unsigned n_threads_;
+
+  //working buffers shared by the threads
+  uchar16* trees_copy_;
+  int* dataIndex_;
+  int* sizes_;
+  char* depths_;
+  bstm_time_block* newTimeBlk_;
+  bstm_time_block* newRefinedTimeBlk_;
+  bstm_data_traits<BSTM_ALPHA>::datatype* alpha_cpy_;
+  bstm_data_traits<BSTM_MOG6_VIEW_COMPACT>::datatype* mog_cpy_;
+  bstm_data_traits<BSTM_NUM_OBS_VIEW_COMPACT>::datatype* numobs_cpy_;
+
+  //per thread counts of split cells, summed after each pass
+  std::vector<int> split_counts_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -86,6 +121,6 @@ class bstm_refine_blk_in_spacetime_function
 ////////////////////////////////////////////////////////////////////////////////
 void bstm_refine_block_spacetime( bstm_time_block* t_blk, bstm_block* blk,
                          std::vector<bstm_data_base*> & datas,
-                         float prob_thresh);
+                         float prob_thresh, unsigned n_threads = 1);
 
 #endif //bstm_refine_blk_in_spacetime_function_h
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <testlib/testlib_test.h>
+
+#include <bstm/bstm_block.h>
+#include <bstm/bstm_time_block.h>
+#include <bstm/bstm_data_base.h>
+#include <bstm/bstm_data_traits.h>
+#include <bstm/cpp/algo/bstm_refine_blk_in_spacetime_function.h>
+#include <bstm/cpp/algo/bstm_merge_tt_function.h>
+
+#include <vcl_compiler.h>
+
+//: Results of refining then merging one block
+struct refine_merge_result
+{
+  std::vector<char> trees, refined_time_trees, merged_time_trees;
+  std::vector<std::vector<char> > refined_data, merged_data;
+};
+
+static std::vector<char> buffer_copy(const char* data, std::size_t n)
+{
+  return std::vector<char>(data, data+n);
+}
+
+static refine_merge_result refine_and_merge(unsigned n_threads, unsigned& n_cells)
+{
+  bstm_block_id id(0,0,0,0);
+  bstm_block_metadata mdata(id, vgl_point_3d<double>(0,0,0), 0.0f,
+                            vgl_vector_3d<double>(1,1,1), 1.0,
+                            vgl_vector_3d<unsigned>(4,4,4), 2,
+                            2, 4, 100.0, 0.001, 1, 1, 6);
+  bstm_block blk(mdata);
+  bstm_time_block blk_t(mdata);
+
+  // One leaf per time tree to start with; fill with a fixed pseudo-random occupancy
+  unsigned n = (unsigned)blk_t.time_trees().size();
+  n_cells = n;
+  std::vector<bstm_data_base*> datas;
+  datas.push_back(new bstm_data_base(new char[n*bstm_data_traits<BSTM_ALPHA>::datasize()],
+                                     n*bstm_data_traits<BSTM_ALPHA>::datasize(), id));
+  datas.push_back(new bstm_data_base(new char[n*bstm_data_traits<BSTM_MOG6_VIEW_COMPACT>::datasize()],
+                                     n*bstm_data_traits<BSTM_MOG6_VIEW_COMPACT>::datasize(), id));
+  datas.push_back(new bstm_data_base(new char[n*bstm_data_traits<BSTM_NUM_OBS_VIEW_COMPACT>::datasize()],
+                                     n*bstm_data_traits<BSTM_NUM_OBS_VIEW_COMPACT>::datasize(), id));
+  float* alpha = (float*)datas[0]->data_buffer();
+  unsigned seed = 12345;
+  for (unsigned i=0;i<n;++i)
+  {
+    seed = seed*1103515245u + 12345u;
+    alpha[i] = float((seed>>16)&0x7fff)/32768.0f;
+  }
+  for (unsigned i=0;i<datas[1]->buffer_length();++i)
+    datas[1]->data_buffer()[i] = char(i%251);
+  for (unsigned i=0;i<datas[2]->buffer_length();++i)
+    datas[2]->data_buffer()[i] = char(i%7);
+
+  refine_merge_result result;
+  bstm_refine_blk_in_spacetime_function refine_block;
+  refine_block.init_data(&blk_t, &blk, datas, 0.3f, n_threads);
+  bstm_time_block* refined_t = VXL_NULLPTR;
+  std::vector<bstm_data_base*> refined;
+  refine_block.refine(datas, refined_t, refined);
+
+  result.trees = buffer_copy((const char*)blk.trees().data_block(), blk.trees().size()*16);
+  result.refined_time_trees = buffer_copy(refined_t->buffer(), refined_t->byte_count());
+  for (unsigned i=0;i<refined.size();++i)
+    result.refined_data.push_back(buffer_copy(refined[i]->data_buffer(), refined[i]->buffer_length()));
+
+  bstm_merge_tt_function merge_block;
+  merge_block.init_data(refined_t, &blk, refined, 0.5f, n_threads);
+  std::vector<bstm_data_base*> merged;
+  merge_block.merge(refined, merged);
+
+  result.merged_time_trees = buffer_copy(refined_t->buffer(), refined_t->byte_count());
+  for (unsigned i=0;i<merged.size();++i)
+    result.merged_data.push_back(buffer_copy(merged[i]->data_buffer(), merged[i]->buffer_length()));
+
+  for (unsigned i=0;i<datas.size();++i) delete datas[i];
+  for (unsigned i=0;i<refined.size();++i) delete refined[i];
+  for (unsigned i=0;i<merged.size();++i) delete merged[i];
+  delete refined_t;
+  return result;
+}
+
+static void test_parallel_refine()
+{
+  unsigned n_cells = 0;
+  refine_merge_result serial = refine_and_merge(1, n_cells);
+  TEST("Refinement added cells", serial.refined_data[0].size() > n_cells*sizeof(float), true);
+  TEST("Merge removed cells", serial.merged_data[0].size() < serial.refined_data[0].size(), true);
+
+  for (unsigned n_threads = 2; n_threads <= 7; n_threads += 5)
+  {
+    std::cout << "Comparing " << n_threads << " threads with serial path\n";
+    refine_merge_result parallel = refine_and_merge(n_threads, n_cells);
+    TEST("Same refined space trees", parallel.trees == serial.trees, true);
+    TEST("Same refined time trees", parallel.refined_time_trees == serial.refined_time_trees, true);
+    TEST("Same refined data", parallel.refined_data == serial.refined_data, true);
+    TEST("Same merged time trees", parallel.merged_time_trees == serial.merged_time_trees, true);
+    TEST("Same merged data", parallel.merged_data == serial.merged_data, true);
+  }
+}
+
+TESTMAIN( test_parallel_refine );
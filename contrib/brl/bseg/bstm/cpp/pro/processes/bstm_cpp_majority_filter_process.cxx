@@ -10,6 +10,7 @@
 // \date June 25, 2013
 
 #include <vcl_compiler.h>
+#include <brdb/brdb_value.h>
 #include <bstm/bstm_scene.h>
 #include <bstm/bstm_util.h>
 #include <bstm/io/bstm_cache.h>
@@ -20,7 +21,7 @@
 
 namespace bstm_cpp_majority_filter_process_globals
 {
-  const unsigned n_inputs_ = 3;
+  const unsigned n_inputs_ = 4;
   const unsigned n_outputs_ = 0;
 }
 
@@ -28,14 +29,18 @@ bool bstm_cpp_majority_filter_process_cons (bprb_func_process& pro)
 {
   using namespace bstm_cpp_majority_filter_process_globals;
 
-  //process takes 3 inputs, no outputs
+  //process takes 4 inputs, no outputs
   std::vector<std::string>  output_types_(n_outputs_);
   std::vector<std::string> input_types_(n_inputs_);
   input_types_[0] = "bstm_scene_sptr";
   input_types_[1] = "bstm_cache_sptr";
   input_types_[2] = "float"; //time
+  input_types_[3] = "unsigned"; //number of threads
 
-  return pro.set_input_types(input_types_) && pro.set_output_types(output_types_);
+  bool good = pro.set_input_types(input_types_) && pro.set_output_types(output_types_);
+  // in case the number of threads is not set
+  pro.set_input(3, new brdb_value_t<unsigned>(1));
+  return good;
 }
 
 
@@ -52,6 +57,7 @@ bool bstm_cpp_majority_filter_process (bprb_func_process& pro)
   bstm_scene_sptr scene = pro.get_input<bstm_scene_sptr>(i++);
   bstm_cache_sptr cache = pro.get_input<bstm_cache_sptr>(i++);
   float time = pro.get_input<float>(i++);
+  unsigned n_threads = pro.get_input<unsigned>(i++);
 
   //zip through each block
   std::map<bstm_block_id, bstm_block_metadata> blocks = scene->blocks();
@@ -71,7 +77,7 @@ bool bstm_cpp_majority_filter_process (bprb_func_process& pro)
     bstm_time_block *     blk_t     = cache->get_time_block(id);
 
     bstm_data_base * change = cache->get_data_base(id,bstm_data_traits<BSTM_CHANGE>::prefix());
-    bstm_majority_filter(data, blk, blk_t,change);
+    bstm_majority_filter(data, blk, blk_t,change, n_threads);
   }
 
   return true;
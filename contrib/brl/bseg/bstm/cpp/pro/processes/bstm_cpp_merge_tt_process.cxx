@@ -23,7 +23,7 @@
 
 namespace bstm_cpp_merge_tt_process_globals
 {
-  const unsigned n_inputs_ =  4;
+  const unsigned n_inputs_ =  5;
   const unsigned n_outputs_ = 0;
 }
 
@@ -38,6 +38,7 @@ bool bstm_cpp_merge_tt_process_cons(bprb_func_process& pro)
   input_types_[1] = "bstm_cache_sptr";
   input_types_[2] = "float"; //p_threshold
   input_types_[3] = "float"; //time
+  input_types_[4] = "unsigned"; //number of threads
 
 
   // process has 0 output:
@@ -45,6 +46,8 @@ bool bstm_cpp_merge_tt_process_cons(bprb_func_process& pro)
   std::vector<std::string>  output_types_(n_outputs_);
 
   bool good = pro.set_input_types(input_types_) && pro.set_output_types(output_types_);
+  // in case the number of threads is not set
+  pro.set_input(4, new brdb_value_t<unsigned>(1));
   return good;
 }
 
@@ -64,6 +67,7 @@ bool bstm_cpp_merge_tt_process(bprb_func_process& pro)
   bstm_cache_sptr cache= pro.get_input<bstm_cache_sptr>(i++);
   float p_threshold =pro.get_input<float>(i++);
   float time =pro.get_input<float>(i++);
+  unsigned n_threads = pro.get_input<unsigned>(i++);
 
 
   bool foundAppDataType = false, foundNumobsDataType = false;
@@ -110,7 +114,7 @@ bool bstm_cpp_merge_tt_process(bprb_func_process& pro)
     datas.push_back(num_obs);
 
     //refine block and datas
-    bstm_merge_tt_blk( blk_t, blk, datas, p_threshold);
+    bstm_merge_tt_blk( blk_t, blk, datas, p_threshold, n_threads);
   }
 
   std::cout << "Finished merging scene..." << std::endl;
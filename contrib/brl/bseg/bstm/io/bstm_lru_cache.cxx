@@ -5,6 +5,7 @@
 // \file
 #include <bstm/bstm_block_metadata.h>
 #include <bstm/io/bstm_sio_mgr.h>
+#include <baio/baio_write_queue.h>
 #include <vcl_compiler.h>
 
 //: PUBLIC create method, for creating singleton instance of bstm_cache
@@ -410,6 +411,9 @@ void bstm_lru_cache::write_to_disk()
     // if (!iter->second->read_only())
     bstm_sio_mgr::save_time_block(scene_dir_, iter->second);
   }
+  // wait for the write-behind queue so the scene is on disk on return
+  if (!baio_write_queue::instance().flush())
+    std::cerr << "bstm_lru_cache::write_to_disk: " << baio_write_queue::instance().error() << '\n';
 }
 
 //: shows elements in cache
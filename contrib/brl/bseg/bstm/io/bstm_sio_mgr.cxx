@@ -5,12 +5,14 @@
 #include <vcl_compiler.h>
 #include <sys/stat.h>  //for getting file sizes
 #include <vul/vul_file.h>
+#include <baio/baio_write_queue.h>
 
 bstm_block* bstm_sio_mgr::load_block(std::string dir, bstm_block_id block_id, bstm_block_metadata data )
 {
   std::string filepath = dir + block_id.to_string() + ".bin";
 
-  //get file size
+  //get file size, once any queued write of the file has finished
+  baio_write_queue::instance().wait_for(filepath);
   unsigned long numBytes = vul_file::size(filepath);
 
   //Read bytes into stream
@@ -30,7 +32,8 @@ bstm_time_block* bstm_sio_mgr::load_time_block(std::string dir, bstm_block_id bl
 {
   std::string filepath = dir + "tt_" + block_id.to_string() + ".bin";
 
-  //get file size
+  //get file size, once any queued write of the file has finished
+  baio_write_queue::instance().wait_for(filepath);
   unsigned long numBytes = vul_file::size(filepath);
 
   //Read bytes into stream
@@ -52,7 +55,8 @@ bstm_data_base* bstm_sio_mgr::load_block_data_generic(std::string dir, bstm_bloc
   // file name
   std::string filename = dir + data_type + "_" + id.to_string() + ".bin";
 
-  //get file size
+  //get file size, once any queued write of the file has finished
+  baio_write_queue::instance().wait_for(filename);
   unsigned long numBytes=vul_file::size(filename);
 
   //Read bytes into stream
@@ -76,10 +80,9 @@ void bstm_sio_mgr::save_block(std::string dir, bstm_block* block)
   char * bytes = block->buffer();
   block->b_write(bytes);
 
-  // synchronously write to disk
-  std::ofstream myFile (filepath.c_str(), std::ios::out | std::ios::binary);
-  myFile.write(bytes, block->byte_count());
-  myFile.close();
+  // write to disk, in the background if the write queue is enabled
+  if (!baio_write_queue::instance().write(filepath, bytes, block->byte_count()))
+    std::cerr << "bstm_sio_mgr::save_block: " << baio_write_queue::instance().error() << '\n';
 }
 
 void bstm_sio_mgr::save_time_block(std::string dir, bstm_time_block* block)
@@ -88,10 +91,9 @@ void bstm_sio_mgr::save_time_block(std::string dir, bstm_time_block* block)
   //std::cout<<"bstm_sio_mgr::write save to file: "<<filepath<<std::endl;
   char * bytes = block->buffer();
 
-  // synchronously write to disk
-  std::ofstream myFile (filepath.c_str(), std::ios::out | std::ios::binary);
-  myFile.write(bytes, block->byte_count());
-  myFile.close();
+  // write to disk, in the background if the write queue is enabled
+  if (!baio_write_queue::instance().write(filepath, bytes, block->byte_count()))
+    std::cerr << "bstm_sio_mgr::save_time_block: " << baio_write_queue::instance().error() << '\n';
 }
 
 // generically saves data_base * to disk (given prefix)
@@ -100,10 +102,8 @@ void bstm_sio_mgr::save_block_data_base(std::string dir, bstm_block_id block_id,
   std::string filename = dir + prefix + "_" + block_id.to_string() + ".bin";
 
   char * bytes = data->data_buffer();
-  std::ofstream myFile (filename.c_str(), std::ios::out | std::ios::binary);
-  myFile.write(bytes, data->buffer_length());
-  myFile.close();
-  return;
+  if (!baio_write_queue::instance().write(filename, bytes, data->buffer_length()))
+    std::cerr << "bstm_sio_mgr::save_block_data_base: " << baio_write_queue::instance().error() << '\n';
 }
 
 
@@ -21,11 +21,17 @@
 #include <vnl/vnl_double_3x1.h>
 #include <vil/vil_resample_bilin.h>
 #include <vil/vil_math.h>
+#include <vil/vil_warp_homography.h>
 #include <bil/algo/bil_edt.h>
 
 #include "grid/bvxm_voxel_slab.h"
 
 #include <vcl_compiler.h>
+#include <vxl_config.h>
+
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
 
 bool bvxm_util::read_cameras(const std::string filename, std::vector<vnl_double_3x3> &Ks, std::vector<vnl_double_3x3> &Rs, std::vector<vnl_double_3x1> &Ts)
 {
@@ -123,6 +129,92 @@ void bvxm_util::bilinear_weights(vgl_h_matrix_2d<double> invH, unsigned nx_out,
 }
 
 
+void bvxm_util::bilinear_samples_row(const double H[9], unsigned y, unsigned nx, bilinear_sample *samples)
+{
+  // positions are computed in blocks, to keep them in cache
+  const unsigned block = 64;
+  double xs[block], ys[block];
+  for (unsigned x0=0; x0<nx; x0+=block)
+  {
+    const unsigned n = nx-x0 < block ? nx-x0 : block;
+    vil_warp_homography_row(H, double(y), x0, n, xs, ys);
+    for (unsigned i=0; i<n; ++i)
+    {
+      bilinear_sample &s = samples[x0+i];
+      float pix_in_x = (float)xs[i];
+      float pix_in_y = (float)ys[i];
+      // calculate weights and pixel positions
+      unsigned x0_pix = (unsigned)std::floor(pix_in_x);
+      unsigned x1_pix = (unsigned)std::ceil(pix_in_x);
+      float x0_weight = (float)x1_pix - pix_in_x;
+      float x1_weight = 1.0f - x0_weight;
+      unsigned y0_pix = (unsigned)std::floor(pix_in_y);
+      unsigned y1_pix = (unsigned)std::ceil(pix_in_y);
+      float y0_weight = (float)y1_pix - pix_in_y;
+      float y1_weight = 1.0f - y0_weight;
+      s.x[0] = x0_pix; s.x[1] = x0_pix; s.x[2] = x1_pix; s.x[3] = x1_pix;
+      s.y[0] = y0_pix; s.y[1] = y1_pix; s.y[2] = y0_pix; s.y[3] = y1_pix;
+      s.w[0] = x0_weight*y0_weight;
+      s.w[1] = x0_weight*y1_weight;
+      s.w[2] = x1_weight*y0_weight;
+      s.w[3] = x1_weight*y1_weight;
+    }
+  }
+}
+
+//: A range of rows for bvxm_util::parallel_rows
+struct bvxm_util_rows_job
+{
+  void (*rows)(void*, unsigned, unsigned);
+  void *data;
+  unsigned y0, y1;
+
+  void run() { rows(data, y0, y1); }
+
+  static void* run_thread(void* job)
+  {
+    static_cast<bvxm_util_rows_job*>(job)->run();
+    return VXL_NULLPTR;
+  }
+};
+
+void bvxm_util::parallel_rows(unsigned ny, unsigned n_threads,
+                              void (*rows)(void*, unsigned, unsigned), void *data)
+{
+  if (n_threads < 1) n_threads = 1;
+  unsigned n_ranges = ny < n_threads ? (ny > 0 ? ny : 1) : n_threads;
+  std::vector<bvxm_util_rows_job> jobs(n_ranges);
+  unsigned step = (ny+n_ranges-1)/n_ranges;
+  for (unsigned t=0; t<n_ranges; ++t)
+  {
+    jobs[t].rows = rows;
+    jobs[t].data = data;
+    jobs[t].y0 = t*step < ny ? t*step : ny;
+    jobs[t].y1 = (t+1)*step < ny ? (t+1)*step : ny;
+  }
+
+#if VXL_HAS_PTHREAD_H
+  if (n_ranges > 1)
+  {
+    std::vector<pthread_t> threads(n_ranges);
+    std::vector<bool> started(n_ranges, false);
+    for (unsigned t=1; t<n_ranges; ++t)
+      started[t] = pthread_create(&threads[t], VXL_NULLPTR, &bvxm_util_rows_job::run_thread, &jobs[t])==0;
+    jobs[0].run();
+    for (unsigned t=1; t<n_ranges; ++t)
+    {
+      if (started[t])
+        pthread_join(threads[t], VXL_NULLPTR);
+      else
+        jobs[t].run(); // Couldn't start thread - do it here
+    }
+    return;
+  }
+#endif
+  for (unsigned t=0; t<n_ranges; ++t)
+    jobs[t].run();
+}
+
 vil_image_view_base_sptr bvxm_util::downsample_image_by_two(vil_image_view_base_sptr image)
 {
   vil_image_view<float>*img_view_float = new vil_image_view<float>(image->ni(),image->nj(),image->nplanes());
@@ -68,10 +68,49 @@ class bvxm_util
                           bvxm_voxel_slab<bool> const& s2,
                           bvxm_voxel_slab<bool> &result);
 
+  //: Warp slab_in through the homography invH, which maps slab_out pixels to slab_in pixels.
+  // Rows of slab_out are shared between n_threads threads, if threads are available.
   template <class T, class M>
   static void warp_slab_bilinear(bvxm_voxel_slab<M> const& slab_in,
                                  vgl_h_matrix_2d<double> invH,
-                                 bvxm_voxel_slab<T> &slab_out);
+                                 bvxm_voxel_slab<T> &slab_out,
+                                 unsigned n_threads = 1);
+
+  //: Warp several slabs through the same homography in one pass.
+  // Equivalent to calling warp_slab_bilinear(*slabs_in[i],invH,*slabs_out[i])
+  // for each i, but each sample position is computed once for all the slabs.
+  // All the output slabs must have the same size.
+  template <class T, class M>
+  static void warp_slabs_bilinear(std::vector<bvxm_voxel_slab<M> const*> const& slabs_in,
+                                  vgl_h_matrix_2d<double> invH,
+                                  std::vector<bvxm_voxel_slab<T>*> const& slabs_out,
+                                  unsigned n_threads = 1);
+
+  //: The (up to) four input pixels blended into one output pixel by warp_slab_bilinear.
+  struct bilinear_sample
+  {
+    unsigned x[4], y[4];
+    float w[4];
+  };
+
+  //: Compute the input pixels and weights warp_slab_bilinear uses for output pixels (0,y) to (nx-1,y).
+  // H is the row-major 3x3 matrix of invH, e.g. invH.get_matrix().data_block().
+  // The projective transform is evaluated a row at a time by
+  // vil_warp_homography_row.  Pixels outside the input are left in the
+  // samples, and skipped by sample_bilinear.
+  static void bilinear_samples_row(const double H[9], unsigned y, unsigned nx,
+                                   bilinear_sample *samples);
+
+  //: Blend the pixels of plane z of slab_in given by s, as warp_slab_bilinear does.
+  // This allows a warp to be fused with the computation using its result,
+  // without storing the warped slab.
+  template <class T, class M>
+  static void sample_bilinear(bvxm_voxel_slab<M> const& slab_in, bilinear_sample const& s,
+                              unsigned z, T &val);
+
+  //: Call rows(data,y0,y1) over ranges [y0,y1) covering [0,ny), shared between n_threads threads.
+  static void parallel_rows(unsigned ny, unsigned n_threads,
+                            void (*rows)(void*, unsigned, unsigned), void *data);
 
   template <class T>
   static void warp_slab_nearest_neighbor(bvxm_voxel_slab<T> const& slab_in,
@@ -154,19 +193,51 @@ class bvxm_util
                                vnl_matrix<float> &weights);
 };
 
+//: The slabs and homography of a warp_slabs_bilinear call, warped a range of rows at a time.
+template <class T, class M>
+struct bvxm_util_warp_slabs_job
+{
+  const double* H;
+  std::vector<bvxm_voxel_slab<M> const*> const* slabs_in;
+  std::vector<bvxm_voxel_slab<T>*> const* slabs_out;
+
+  static void rows(void* job, unsigned y0, unsigned y1)
+  {
+    bvxm_util_warp_slabs_job<T,M> const& j = *static_cast<bvxm_util_warp_slabs_job<T,M>*>(job);
+    bvxm_voxel_slab<T> const& first_out = *(*j.slabs_out)[0];
+    const unsigned nx = first_out.nx(), nz = first_out.nz(), n_slabs = (unsigned)j.slabs_in->size();
+    std::vector<bvxm_util::bilinear_sample> samples(nx);
+    for (unsigned y=y0; y<y1; ++y)
+    {
+      bvxm_util::bilinear_samples_row(j.H, y, nx, &samples[0]);
+      // if z > 1, it would be more efficient to put the z loop as the inner-most.
+      // z will probably be 1 most of the time though, so leave it here for now.
+      for (unsigned z=0; z<nz; ++z)
+        for (unsigned s=0; s<n_slabs; ++s)
+        {
+          bvxm_voxel_slab<M> const& slab_in = *(*j.slabs_in)[s];
+          bvxm_voxel_slab<T> &slab_out = *(*j.slabs_out)[s];
+          for (unsigned x=0; x<nx; ++x)
+            bvxm_util::sample_bilinear(slab_in, samples[x], z, slab_out(x,y,z));
+        }
+    }
+  }
+};
+
 template <class T, class M>
 void bvxm_util::warp_slab_bilinear(bvxm_voxel_slab<M> const& slab_in,
-                                   vgl_h_matrix_2d<double> invH, bvxm_voxel_slab<T> &slab_out)
+                                   vgl_h_matrix_2d<double> invH, bvxm_voxel_slab<T> &slab_out,
+                                   unsigned n_threads)
 {
   // smoothing radius of filter
   // TODO: is gaussian convolution with std = projected_size the right amount to get us to Nyquist res?
   float xstd = 0.0f, ystd = 0.0f;
 
-  vnl_matrix_fixed<double,3,3> Hd = invH.get_matrix();
 #if 0 // normalize homogeneous coordinates
   // test if slab_in's projection is higher resolution than slab out.
   // if so, we need to smooth slab_in
   // choose a pixel near the center of slab_out
+  vnl_matrix_fixed<double,3,3> Hd = invH.get_matrix();
   vnl_vector_fixed<double,3> test_pix0(slab_out.nx()/2.0, slab_out.ny()/2.0, 1);
   vnl_vector_fixed<double,3> test_pix1(test_pix0[0]+1,test_pix0[1]+1,1);
   vnl_vector_fixed<double,3> test_pix_out0 = Hd*test_pix0;
@@ -184,63 +255,46 @@ void bvxm_util::warp_slab_bilinear(bvxm_voxel_slab<M> const& slab_in,
   std::cout << "xsize = " << xsize << " ysize = " << ysize << std::endl;
 #endif // 0
 
+  std::vector<bvxm_voxel_slab<M> const*> slabs_in(1, &slab_in);
+  std::vector<bvxm_voxel_slab<T>*> slabs_out(1, &slab_out);
   bvxm_voxel_slab<M> slab_in_smooth;
-  slab_in_smooth.deep_copy(slab_in);
-  smooth_gaussian(slab_in_smooth, xstd, ystd);
-
-  // perform bilinear interpolation.
-  vnl_matrix_fixed<float,3,3> H;
-  // convert H to a float matrix
-  vnl_matrix_fixed<float,3,3>::iterator Hit = H.begin();
-  vnl_matrix_fixed<double,3,3>::iterator Hdit = Hd.begin();
-  for (; Hit != H.end(); ++Hit, ++Hdit)
-    *Hit = (float)(*Hdit);
-
-  slab_out.fill(T(0.0)); // this should work whether T is a vector_fixed or a scalar
-
-  typename bvxm_voxel_slab<T>::iterator out_it = slab_out.begin();
+  if (xstd > 0.0f || ystd > 0.0f) {
+    slab_in_smooth.deep_copy(slab_in);
+    smooth_gaussian(slab_in_smooth, xstd, ystd);
+    slabs_in[0] = &slab_in_smooth;
+  }
+  warp_slabs_bilinear(slabs_in, invH, slabs_out, n_threads);
+}
 
-  // if z > 1, it would be more efficient to put the z loop as the inner-most.
-  // z will probably be 1 most of the time though, so leave it here for now.
-  for (unsigned z=0; z<slab_out.nz(); ++z)
-  {
-    for (unsigned y=0; y<slab_out.ny(); ++y)
-    {
-      for (unsigned x=0; x<slab_out.nx(); ++x, ++out_it)
-      {
-        vnl_vector_fixed<float,3> pix_in_homg = H*vnl_vector_fixed<float,3>((float)x,(float)y,1.0f);
-        // normalize homogeneous coordinate
+template <class T, class M>
+void bvxm_util::warp_slabs_bilinear(std::vector<bvxm_voxel_slab<M> const*> const& slabs_in,
+                                    vgl_h_matrix_2d<double> invH,
+                                    std::vector<bvxm_voxel_slab<T>*> const& slabs_out,
+                                    unsigned n_threads)
+{
+  assert(slabs_in.size() == slabs_out.size());
+  if (slabs_out.empty())
+    return;
+  vnl_matrix_fixed<double,3,3> H = invH.get_matrix();
+  bvxm_util_warp_slabs_job<T,M> job;
+  job.H = H.data_block();
+  job.slabs_in = &slabs_in;
+  job.slabs_out = &slabs_out;
+  parallel_rows(slabs_out[0]->ny(), n_threads, &bvxm_util_warp_slabs_job<T,M>::rows, &job);
+}
 
-        float pix_in_x = pix_in_homg[0] / pix_in_homg[2];
-        float pix_in_y = pix_in_homg[1] / pix_in_homg[2];
-        // calculate weights and pixel values
-        unsigned x0 = (unsigned)std::floor(pix_in_x);
-        unsigned x1 = (unsigned)std::ceil(pix_in_x);
-        float x0_weight = (float)x1 - pix_in_x;
-        float x1_weight = 1.0f - (float)x0_weight;
-        unsigned y0 = (unsigned)std::floor(pix_in_y);
-        unsigned y1 = (unsigned)std::ceil(pix_in_y);
-        float y0_weight = (float)y1 - pix_in_y;
-        float y1_weight = 1.0f - (float)y0_weight;
-        vnl_vector_fixed<unsigned,4>xvals(x0,x0,x1,x1);
-        vnl_vector_fixed<unsigned,4>yvals(y0,y1,y0,y1);
-        vnl_vector_fixed<float,4> weights(x0_weight*y0_weight,
-                                          x0_weight*y1_weight,
-                                          x1_weight*y0_weight,
-                                          x1_weight*y1_weight);
-
-        for (unsigned i=0; i<4; ++i) {
-          // check if input pixel is inbounds
-          if (xvals[i] < slab_in_smooth.nx() &&
-              yvals[i] < slab_in_smooth.ny()) {
-            // pixel is good
-            (*out_it) += slab_in_smooth(xvals[i],yvals[i],z)*weights[i];
-          }
-        }
-      } //x
-    } // y
-  } // z
-  return;
+template <class T, class M>
+void bvxm_util::sample_bilinear(bvxm_voxel_slab<M> const& slab_in, bilinear_sample const& s,
+                                unsigned z, T &val)
+{
+  val = T(0.0); // this should work whether T is a vector_fixed or a scalar
+  for (unsigned i=0; i<4; ++i) {
+    // check if input pixel is inbounds
+    if (s.x[i] < slab_in.nx() && s.y[i] < slab_in.ny()) {
+      // pixel is good
+      val += slab_in(s.x[i],s.y[i],z)*s.w[i];
+    }
+  }
 }
 
 template <class T>
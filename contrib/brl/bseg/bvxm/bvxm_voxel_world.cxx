@@ -514,6 +514,12 @@ bool bvxm_voxel_world::update_edges_lidar(vil_image_view_base_sptr& lidar_height
   bvxm_voxel_slab<float> lidar_edges_backproj(grid_size.x(),grid_size.y(),1);
   bvxm_voxel_slab<float> lidar_edges_prob_backproj(grid_size.x(),grid_size.y(),1);
 
+  // the lidar slabs are backprojected together, sharing the sample positions
+  std::vector<bvxm_voxel_slab<float> const*> lidar_slabs;
+  lidar_slabs.push_back(&lidar_height_slab); lidar_slabs.push_back(&lidar_edges_slab); lidar_slabs.push_back(&lidar_edges_prob_slab);
+  std::vector<bvxm_voxel_slab<float>*> lidar_backproj;
+  lidar_backproj.push_back(&lidar_height_backproj); lidar_backproj.push_back(&lidar_edges_backproj); lidar_backproj.push_back(&lidar_edges_prob_backproj);
+
   // get edges probability grid
   bvxm_voxel_grid_base_sptr edges_grid_base = this->get_grid<EDGES>(0,scale);
   bvxm_voxel_grid<edges_datatype> *edges_grid  = static_cast<bvxm_voxel_grid<edges_datatype>*>(edges_grid_base.ptr());
@@ -525,9 +531,7 @@ bool bvxm_voxel_world::update_edges_lidar(vil_image_view_base_sptr& lidar_height
     std::cout << k_idx << std::endl;
 
     // backproject image onto voxel plane
-    bvxm_util::warp_slab_bilinear(lidar_height_slab, H_plane_to_img[k_idx], lidar_height_backproj);
-    bvxm_util::warp_slab_bilinear(lidar_edges_slab, H_plane_to_img[k_idx], lidar_edges_backproj);
-    bvxm_util::warp_slab_bilinear(lidar_edges_prob_slab, H_plane_to_img[k_idx], lidar_edges_prob_backproj);
+    bvxm_util::warp_slabs_bilinear(lidar_slabs, H_plane_to_img[k_idx], lidar_backproj);
 
     bvxm_voxel_slab<float> lidar_prob(lidar_height_backproj.nx(), lidar_height_backproj.ny(), lidar_height_backproj.nz());
     lidar_prob.fill(0.0);
@@ -779,10 +783,15 @@ bool bvxm_voxel_world::heightmap_exp(vpgl_camera_double_sptr virtual_camera, vil
   bvxm_voxel_slab<float> slab_y_pre_virtual(heightmap.ni(), heightmap.nj(), 1);
   bvxm_voxel_slab<float> slab_z_pre_virtual(heightmap.ni(), heightmap.nj(), 1);
 
+  // the x, y and z slabs are warped together, sharing the sample positions
+  std::vector<bvxm_voxel_slab<float> const*> xyz_slabs;
+  xyz_slabs.push_back(&x_slab); xyz_slabs.push_back(&y_slab); xyz_slabs.push_back(&z_slab);
+  std::vector<bvxm_voxel_slab<float>*> xyz_virtual, xyz_pre_virtual;
+  xyz_virtual.push_back(&slab_x_virtual); xyz_virtual.push_back(&slab_y_virtual); xyz_virtual.push_back(&slab_z_virtual);
+  xyz_pre_virtual.push_back(&slab_x_pre_virtual); xyz_pre_virtual.push_back(&slab_y_pre_virtual); xyz_pre_virtual.push_back(&slab_z_pre_virtual);
+
   // initialize the pres using z = -1 height
-  bvxm_util::warp_slab_bilinear(x_slab,Hi2p,slab_x_pre_virtual);
-  bvxm_util::warp_slab_bilinear(y_slab,Hi2p,slab_y_pre_virtual);
-  bvxm_util::warp_slab_bilinear(z_slab,Hi2p,slab_z_pre_virtual);
+  bvxm_util::warp_slabs_bilinear(xyz_slabs,Hi2p,xyz_pre_virtual);
 
   //heightmap_rough.fill((float)grid_size.z());
   visX_accum_virtual.fill(1.0f);
@@ -811,9 +820,7 @@ bool bvxm_voxel_world::heightmap_exp(vpgl_camera_double_sptr virtual_camera, vil
       y_slab(i, j) = pt.y();
       z_slab(i, j) = pt.z();
     }
-    bvxm_util::warp_slab_bilinear(x_slab,Hi2p,slab_x_virtual);
-    bvxm_util::warp_slab_bilinear(y_slab,Hi2p,slab_y_virtual);
-    bvxm_util::warp_slab_bilinear(z_slab,Hi2p,slab_z_virtual);
+    bvxm_util::warp_slabs_bilinear(xyz_slabs,Hi2p,xyz_virtual);
 
 
     // compute the current depths
@@ -854,9 +861,7 @@ bool bvxm_voxel_world::heightmap_exp(vpgl_camera_double_sptr virtual_camera, vil
       z_slab(i, j) = pt.z();
     }
 
-  bvxm_util::warp_slab_bilinear(x_slab,Hi2p,slab_x_virtual);
-  bvxm_util::warp_slab_bilinear(y_slab,Hi2p,slab_y_virtual);
-  bvxm_util::warp_slab_bilinear(z_slab,Hi2p,slab_z_virtual);
+  bvxm_util::warp_slabs_bilinear(xyz_slabs,Hi2p,xyz_virtual);
 
   // compute the current depths
   bvxm_voxel_slab<float>::iterator depth_it = depth.begin(), x_it = slab_x_virtual.begin(), y_it = slab_y_virtual.begin(), z_it = slab_z_virtual.begin();
@@ -71,6 +71,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <string>
+#include <algorithm>
 #include <vector>
 #include <set>
 #include <iostream>
@@ -85,6 +86,7 @@
 #include <vgl/algo/vgl_h_matrix_2d.h>
 
 #include <vnl/vnl_math.h>
+#include <vnl/vnl_matrix_fixed.h>
 
 #include <vil/vil_image_view.h>
 #include <vpgl/vpgl_camera_double_sptr.h>
@@ -568,28 +570,30 @@ bool bvxm_voxel_world::update_impl(bvxm_image_metadata const& metadata,
     return false;
   }
 
-  // temporary voxel grids to hold preX and PI*visX values
-  bvxm_voxel_grid<float> preX(grid_size);
-  bvxm_voxel_grid<float> PIvisX(grid_size);
+  // Temporary voxel grid holding PI*visX + preX, the only per voxel value of
+  // pass 1 needed in pass 2.
+  bvxm_voxel_grid<float> PIvisX_preX(grid_size);
 
   bvxm_voxel_slab<float> PIPX(grid_size.x(),grid_size.y(),1);
   bvxm_voxel_slab<float> PXvisX(grid_size.x(), grid_size.y(),1);
 
   bvxm_voxel_slab<float> preX_accum(image_slab.nx(),image_slab.ny(),1);
   bvxm_voxel_slab<float> visX_accum(image_slab.nx(),image_slab.ny(),1);
-  bvxm_voxel_slab<float> img_scratch(image_slab.nx(),image_slab.ny(),1);
-  bvxm_voxel_slab<float> PIPX_img(image_slab.nx(), image_slab.ny(),1);
-  bvxm_voxel_slab<float> PX_img(image_slab.nx(), image_slab.ny(),1);
   bvxm_voxel_slab<float> mask_slab(image_slab.nx(), image_slab.ny(),1);
 
   preX_accum.fill(0.0f);
   visX_accum.fill(1.0f);
+  mask_slab.fill(0.0f);
 
-  // slabs for holding backprojections of visX
+  // slabs for holding backprojections of preX and visX
+  bvxm_voxel_slab<float> preX(grid_size.x(),grid_size.y(),1);
   bvxm_voxel_slab<float> visX(grid_size.x(),grid_size.y(),1);
 
   bvxm_voxel_slab<obs_datatype> frame_backproj(grid_size.x(),grid_size.y(),1);
 
+  // bilinear samples of a row of the voxel plane or image, for the fused warps below
+  std::vector<bvxm_util::bilinear_sample> samples(std::max(grid_size.x(), image_slab.nx()));
+
   std::cout << "Pass 1:" << std::endl;
 
   // get occupancy probability grid
@@ -602,10 +606,9 @@ bool bvxm_voxel_world::update_impl(bvxm_image_metadata const& metadata,
 
   typename bvxm_voxel_grid<ocp_datatype>::const_iterator ocp_slab_it = ocp_grid->begin();
   typename bvxm_voxel_grid<apm_datatype>::iterator apm_slab_it = apm_grid->begin();
-  typename bvxm_voxel_grid<float>::iterator preX_slab_it = preX.begin();
-  typename bvxm_voxel_grid<float>::iterator PIvisX_slab_it = PIvisX.begin();
+  typename bvxm_voxel_grid<float>::iterator PIvisX_preX_slab_it = PIvisX_preX.begin();
 
-  for (unsigned z=0; z<(unsigned)grid_size.z(); ++z, ++ocp_slab_it, ++apm_slab_it, ++preX_slab_it, ++PIvisX_slab_it)
+  for (unsigned z=0; z<(unsigned)grid_size.z(); ++z, ++ocp_slab_it, ++apm_slab_it, ++PIvisX_preX_slab_it)
   {
     std::cout << '.';
     std::cout.flush();
@@ -615,104 +618,110 @@ bool bvxm_voxel_world::update_impl(bvxm_image_metadata const& metadata,
       return false;
     }
 
-    // backproject image onto voxel plane
-    bvxm_util::warp_slab_bilinear(image_slab, H_plane_to_img[z], frame_backproj);
+    // backproject the image, preX and visX onto the voxel plane in one pass
+    {
+      typename bvxm_voxel_slab<obs_datatype>::iterator frame_it = frame_backproj.begin();
+      typename bvxm_voxel_slab<float>::iterator preX_it = preX.begin(), visX_it = visX.begin();
+      vnl_matrix_fixed<double,3,3> H = H_plane_to_img[z].get_matrix();
+      for (unsigned y=0; y<grid_size.y(); ++y) {
+        bvxm_util::bilinear_samples_row(H.data_block(), y, grid_size.x(), &samples[0]);
+        for (unsigned x=0; x<grid_size.x(); ++x, ++frame_it, ++preX_it, ++visX_it) {
+          bvxm_util::sample_bilinear(image_slab, samples[x], 0, *frame_it);
+          bvxm_util::sample_bilinear(preX_accum, samples[x], 0, *preX_it);
+          bvxm_util::sample_bilinear(visX_accum, samples[x], 0, *visX_it);
+        }
+      }
+    }
 #ifdef BVXM_DEBUG
     bvxm_util::write_slab_as_image(frame_backproj,"C:/research/registration/output/frame_backproj.tiff");
 #endif
-    // transform preX to voxel plane for this level
-    bvxm_util::warp_slab_bilinear(preX_accum, H_plane_to_img[z], *preX_slab_it);
-    // transform visX to voxel plane for this level
-    bvxm_util::warp_slab_bilinear(visX_accum, H_plane_to_img[z], visX);
 
-    // initialize PIvisX with PI(X)
     bvxm_voxel_slab<float> PI = apm_processor.prob_density(*apm_slab_it, frame_backproj);
 
-    // now multiply by visX
-    bvxm_util::multiply_slabs(visX,PI,*PIvisX_slab_it);
+    // PI*visX + preX for pass 2, PX*visX to weight the appearance update and PI*PX
+    {
+      typename bvxm_voxel_slab<float>::const_iterator PI_it = PI.begin(), preX_it = preX.begin(), visX_it = visX.begin();
+      typename bvxm_voxel_slab<ocp_datatype>::const_iterator PX_it = ocp_slab_it->begin();
+      typename bvxm_voxel_slab<float>::iterator PIvisX_preX_it = PIvisX_preX_slab_it->begin(),
+                                                PXvisX_it = PXvisX.begin(),
+                                                PIPX_it = PIPX.begin();
+      for (; PIPX_it != PIPX.end(); ++PI_it, ++preX_it, ++visX_it, ++PX_it, ++PIvisX_preX_it, ++PXvisX_it, ++PIPX_it) {
+        float PIvisX = *visX_it * *PI_it;
+        *PIvisX_preX_it = PIvisX + *preX_it;
+        *PXvisX_it = *visX_it * *PX_it;
+        *PIPX_it = *PI_it * *PX_it;
+      }
+    }
 
     // update appearance model, using PX*visX as the weights
-    bvxm_util::multiply_slabs(visX,*ocp_slab_it,PXvisX);
     apm_processor.update(*apm_slab_it, frame_backproj, PXvisX);
-
-    // multiply to get PIPX
-    bvxm_util::multiply_slabs(PI,*ocp_slab_it,PIPX);
 #ifdef BVXM_DEBUG
     bvxm_util::write_slab_as_image(PI,"PI.tiff");
     bvxm_util::write_slab_as_image(*ocp_slab_it,"PX.tiff");
 #endif
-    // warp PIPX back to image domain
-    bvxm_util::warp_slab_bilinear(PIPX, H_img_to_plane[z], PIPX_img);
 
-    // multiply PIPX by visX and add to preX_accum
-    typename bvxm_voxel_slab<float>::iterator PIPX_img_it = PIPX_img.begin();
-    typename bvxm_voxel_slab<float>::iterator visX_accum_it = visX_accum.begin();
-    typename bvxm_voxel_slab<float>::iterator preX_accum_it = preX_accum.begin();
-
-    for (; preX_accum_it != preX_accum.end(); ++preX_accum_it, ++PIPX_img_it, ++visX_accum_it) {
-      *preX_accum_it += (*PIPX_img_it) * (*visX_accum_it);
+    // warp PIPX and PX back to the image domain, add PIPX*visX to preX_accum
+    // and accumulate visX for the next level.
+    // note: doing scale and offset in image domain so invalid pixels become 1.0 and don't affect visX
+    {
+      typename bvxm_voxel_slab<float>::iterator preX_accum_it = preX_accum.begin(),
+                                                visX_accum_it = visX_accum.begin(),
+                                                mask_it = mask_slab.begin();
+      vnl_matrix_fixed<double,3,3> H = H_img_to_plane[z].get_matrix();
+      for (unsigned y=0; y<image_slab.ny(); ++y) {
+        bvxm_util::bilinear_samples_row(H.data_block(), y, image_slab.nx(), &samples[0]);
+        for (unsigned x=0; x<image_slab.nx(); ++x, ++preX_accum_it, ++visX_accum_it, ++mask_it) {
+          float PIPX_img, PX_img;
+          bvxm_util::sample_bilinear(PIPX, samples[x], 0, PIPX_img);
+          bvxm_util::sample_bilinear(*ocp_slab_it, samples[x], 0, PX_img);
+          *preX_accum_it += PIPX_img * (*visX_accum_it);
+          if (return_mask)
+            *mask_it += PX_img;
+          *visX_accum_it *= (1 - PX_img);
+        }
+      }
     }
 #ifdef BVXM_DEBUG
-    bvxm_util::write_slab_as_image(PIPX_img,"PIPX_img.tiff");
     bvxm_util::write_slab_as_image(visX_accum,"visX_accum.tiff");
     bvxm_util::write_slab_as_image(preX_accum,"preX_accum.tiff");
 #endif
-    // scale and offset voxel probabilities to get (1-P(X))
-    // transform (1-P(X)) to image plane to accumulate visX for next level
-    bvxm_util::warp_slab_bilinear(*ocp_slab_it, H_img_to_plane[z], PX_img);
-
-    if (return_mask) {
-      bvxm_util::add_slabs(PX_img,mask_slab,mask_slab);
-    }
-
-    // note: doing scale and offset in image domain so invalid pixels become 1.0 and don't affect visX
-    typename bvxm_voxel_slab<float>::iterator PX_img_it = PX_img.begin();
-    visX_accum_it = visX_accum.begin();
-    for (; visX_accum_it != visX_accum.end(); ++visX_accum_it, ++PX_img_it) {
-      *visX_accum_it *= (1 - *PX_img_it);
-    }
   }
   // now traverse a second time, computing new P(X) along the way.
+  // Only the image domain sums and PI*visX + preX are needed, so preX_sum
+  // and visX_sum are sampled voxel by voxel rather than warped into slabs.
 
-  bvxm_voxel_slab<float> preX_accum_vox(grid_size.x(),grid_size.y(),1);
-  bvxm_voxel_slab<float> visX_accum_vox(grid_size.x(),grid_size.y(),1);
-#ifdef BVXM_DEBUG
-  bvxm_util::write_slab_as_image(visX_accum,"visX_accum.tiff");
-  bvxm_util::write_slab_as_image(preX_accum,"preX_accum.tiff");
-#endif
   std::cout << "\nPass 2:" << std::endl;
-  PIvisX_slab_it = PIvisX.begin();
-  preX_slab_it = preX.begin();
+  PIvisX_preX_slab_it = PIvisX_preX.begin();
   typename bvxm_voxel_grid<ocp_datatype>::iterator ocp_slab_it2 = ocp_grid->begin();
-  for (unsigned z = 0; z < (unsigned)grid_size.z(); ++z, ++PIvisX_slab_it, ++preX_slab_it, ++ocp_slab_it2)
+  for (unsigned z = 0; z < (unsigned)grid_size.z(); ++z, ++PIvisX_preX_slab_it, ++ocp_slab_it2)
   {
     std::cout << '.';
     std::cout.flush();
-    // transform preX_sum to current level
-    bvxm_util::warp_slab_bilinear(preX_accum, H_plane_to_img[z], preX_accum_vox);
-
-    // transform visX_sum to current level
-    bvxm_util::warp_slab_bilinear(visX_accum, H_plane_to_img[z], visX_accum_vox);
 
     const float preX_sum_thresh = 0.01f;
 
-    typename bvxm_voxel_slab<float>::const_iterator preX_it = preX_slab_it->begin(),
-                                                    PIvisX_it = PIvisX_slab_it->begin(),
-                                                    preX_sum_it = preX_accum_vox.begin(),
-                                                    visX_sum_it = visX_accum_vox.begin();
+    typename bvxm_voxel_slab<float>::const_iterator PIvisX_preX_it = PIvisX_preX_slab_it->begin();
     typename bvxm_voxel_slab<float>::iterator PX_it = ocp_slab_it2->begin();
 
-    for (; PX_it != ocp_slab_it2->end(); ++PX_it, ++preX_it, ++PIvisX_it, ++preX_sum_it, ++visX_sum_it) {
-      // if preX_sum is zero at the voxel, no ray passed through the voxel (out of image)
-      if (*preX_sum_it > preX_sum_thresh) {
-        float multiplier = (*PIvisX_it + *preX_it) / *preX_sum_it;
-        float ray_norm = 1 - *visX_sum_it; // normalize based on probability that a surface voxel is located along the ray. This was not part of the original Pollard + Mundy algorithm.
-        *PX_it *= multiplier * ray_norm;
+    vnl_matrix_fixed<double,3,3> H = H_plane_to_img[z].get_matrix();
+    for (unsigned y=0; y<grid_size.y(); ++y) {
+      bvxm_util::bilinear_samples_row(H.data_block(), y, grid_size.x(), &samples[0]);
+      for (unsigned x=0; x<grid_size.x(); ++x, ++PX_it, ++PIvisX_preX_it) {
+        // transform preX_sum and visX_sum to current level
+        float preX_sum, visX_sum;
+        bvxm_util::sample_bilinear(preX_accum, samples[x], 0, preX_sum);
+        // if preX_sum is zero at the voxel, no ray passed through the voxel (out of image)
+        if (preX_sum > preX_sum_thresh) {
+          bvxm_util::sample_bilinear(visX_accum, samples[x], 0, visX_sum);
+          float multiplier = *PIvisX_preX_it / preX_sum;
+          float ray_norm = 1 - visX_sum; // normalize based on probability that a surface voxel is located along the ray. This was not part of the original Pollard + Mundy algorithm.
+          *PX_it *= multiplier * ray_norm;
+        }
+        if (*PX_it < min_vox_prob)
+          *PX_it = min_vox_prob;
+        if (*PX_it > max_vox_prob)
+          *PX_it = max_vox_prob;
       }
-      if (*PX_it < min_vox_prob)
-        *PX_it = min_vox_prob;
-      if (*PX_it > max_vox_prob)
-        *PX_it = max_vox_prob;
     }
   }
   std::cout << "\ndone." << std::endl;
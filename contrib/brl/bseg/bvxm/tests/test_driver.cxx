@@ -8,6 +8,7 @@ DECLARE( test_voxel_world_mog_image );
 DECLARE( test_platform_computations );
 DECLARE( test_tangent_update );
 DECLARE( test_illum );
+DECLARE( test_warp_slab );
 void register_tests()
 {
   REGISTER( test_apm_processors );
@@ -18,6 +19,7 @@ void register_tests()
   REGISTER( test_platform_computations );
   REGISTER( test_tangent_update );
   REGISTER( test_illum );
+  REGISTER( test_warp_slab );
 }
 
 DEFINE_MAIN;
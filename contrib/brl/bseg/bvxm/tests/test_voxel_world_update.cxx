@@ -1,3 +1,5 @@
+#include <iostream>
+#include <iomanip>
 #include <testlib/testlib_test.h>
 #include <vul/vul_file.h>
 
@@ -10,6 +12,7 @@
 #include <vil/vil_image_view.h>
 #include <vpgl/vpgl_proj_camera.h>
 #include <vpl/vpl.h>
+#include <vnl/vnl_random.h>
 
 
 static void test_voxel_world_update()
@@ -76,6 +79,63 @@ static void test_voxel_world_update()
   TEST("world update", result, true);
 
   //TO DO: check update for other processors
+
+  // several slabs seen at an angle, updated with textured images
+  vgl_vector_3d<unsigned> grid_size2(10,10,6);
+  bvxm_world_params_sptr params2 = new bvxm_world_params;
+  params2->set_params(model_dir,grid_corner,grid_size2,vox_len,lvcs);
+  bvxm_voxel_world world2;
+  world2.set_params(params2);
+  world2.clean_grids();
+
+  camera_matrix.fill(0.0);
+  camera_matrix.put(0,0,10); camera_matrix.put(0,2,2); camera_matrix.put(0,3,5);
+  camera_matrix.put(1,1,10); camera_matrix.put(1,2,1); camera_matrix.put(1,3,5);
+  camera_matrix.put(2,3,1);
+  vpgl_camera_double_sptr camera2 = new vpgl_proj_camera<double>(camera_matrix);
+
+  vnl_random rng(1234);
+  vil_image_view<float> prob_map2(64,64,1);
+  vil_image_view<bool> mask2(64,64,1);
+  bool result2 = true;
+  for (unsigned i=0; i<3; ++i)
+  {
+    vil_image_view<vxl_byte>* img = new vil_image_view<vxl_byte>(64,64,1,1);
+    for (unsigned j=0; j<64; ++j)
+      for (unsigned k=0; k<64; ++k)
+        (*img)(k,j) = vxl_byte(((k/8+j/8)%2)*128 + rng.lrand32(0,63));
+    bvxm_image_metadata obs2(img,camera2);
+    result2 = result2 && world2.update<APM_MOG_GREY>(obs2, prob_map2, mask2, 0);
+  }
+  TEST("world update with textured images", result2, true);
+
+  typedef bvxm_voxel_traits<OCCUPANCY>::voxel_datatype ocp_datatype;
+  bvxm_voxel_grid<ocp_datatype>* ocp_grid =
+    static_cast<bvxm_voxel_grid<ocp_datatype>*>(world2.get_grid<OCCUPANCY>(0,0).ptr());
+  double ocp_sum = 0.0;
+  bool ocp_ok = true;
+  for (bvxm_voxel_grid<ocp_datatype>::iterator it = ocp_grid->begin(); it != ocp_grid->end(); ++it)
+    for (bvxm_voxel_slab<ocp_datatype>::iterator vit = it->begin(); vit != it->end(); ++vit) {
+      ocp_sum += *vit;
+      if (!(*vit >= params2->min_occupancy_prob() && *vit <= params2->max_occupancy_prob()))
+        ocp_ok = false;
+    }
+  TEST("occupancy probabilities in range", ocp_ok, true);
+
+  // pixels whose rays pass through the world
+  double prob_sum = 0.0;
+  bool prob_ok = true, mask_ok = true;
+  for (unsigned j=10; j<50; ++j)
+    for (unsigned i=10; i<50; ++i) {
+      prob_sum += prob_map2(i,j);
+      if (!(prob_map2(i,j) >= 0.0f))
+        prob_ok = false;
+      if (!mask2(i,j))
+        mask_ok = false;
+    }
+  std::cout << std::setprecision(12) << "occupancy sum " << ocp_sum << ", pixel probability sum " << prob_sum << std::endl;
+  TEST("pixel probabilities are valid", prob_ok, true);
+  TEST("pixels seeing the world are in the mask", mask_ok, true);
 }
 
 TESTMAIN( test_voxel_world_update );
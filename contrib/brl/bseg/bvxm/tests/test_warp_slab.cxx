@@ -0,0 +1,95 @@
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <testlib/testlib_test.h>
+#include <bvxm/bvxm_util.h>
+#include <bvxm/grid/bvxm_voxel_slab.h>
+#include <vgl/algo/vgl_h_matrix_2d.h>
+#include <vnl/vnl_matrix_fixed.h>
+#include <vnl/vnl_random.h>
+
+// bilinear warp of one pixel, with the homography applied in double precision
+static float reference_warp(bvxm_voxel_slab<float> const& in, vnl_matrix_fixed<double,3,3> const& H,
+                            unsigned x, unsigned y)
+{
+  double w = H(2,0)*x + H(2,1)*y + H(2,2);
+  double px = (H(0,0)*x + H(0,1)*y + H(0,2)) / w;
+  double py = (H(1,0)*x + H(1,1)*y + H(1,2)) / w;
+  double fx = std::floor(px), fy = std::floor(py);
+  double val = 0.0;
+  for (int dx=0; dx<2; ++dx)
+    for (int dy=0; dy<2; ++dy) {
+      double xi = fx+dx, yi = fy+dy;
+      double wt = (dx ? px-fx : 1-(px-fx)) * (dy ? py-fy : 1-(py-fy));
+      if (xi >= 0 && yi >= 0 && xi < in.nx() && yi < in.ny())
+        val += wt*in((unsigned)xi,(unsigned)yi);
+    }
+  return (float)val;
+}
+
+static void test_warp_slab()
+{
+  vnl_random rng(4321);
+  std::vector<bvxm_voxel_slab<float> > in(3, bvxm_voxel_slab<float>(40,30,1));
+  for (unsigned s=0; s<in.size(); ++s)
+    for (bvxm_voxel_slab<float>::iterator it = in[s].begin(); it != in[s].end(); ++it)
+      *it = (float)rng.drand32(0.0, 1.0);
+
+  vnl_matrix_fixed<double,3,3> M;
+  M(0,0) = 1.2;   M(0,1) = 0.3;   M(0,2) = -2.0;
+  M(1,0) = -0.2;  M(1,1) = 0.9;   M(1,2) = 3.5;
+  M(2,0) = 0.004; M(2,1) = 0.002; M(2,2) = 1.0;
+  vgl_h_matrix_2d<double> H(M);
+
+  // one slab against a direct evaluation of the warp
+  bvxm_voxel_slab<float> out(33,37,1);
+  bvxm_util::warp_slab_bilinear(in[0], H, out);
+  double max_diff = 0.0;
+  unsigned n_outside = 0;
+  for (unsigned y=0; y<out.ny(); ++y)
+    for (unsigned x=0; x<out.nx(); ++x) {
+      max_diff = std::max(max_diff, (double)std::fabs(out(x,y) - reference_warp(in[0], M, x, y)));
+      if (out(x,y) == 0.0f) ++n_outside;
+    }
+  TEST_NEAR("Warp matches direct evaluation", max_diff, 0.0, 1e-4);
+  TEST("Some pixels map outside the input", n_outside > 0, true);
+
+  // batched and threaded warps match single slab warps
+  std::vector<bvxm_voxel_slab<float> > single(3, bvxm_voxel_slab<float>(33,37,1)),
+                                       batched(3, bvxm_voxel_slab<float>(33,37,1));
+  std::vector<bvxm_voxel_slab<float> const*> slabs_in;
+  std::vector<bvxm_voxel_slab<float>*> slabs_out;
+  for (unsigned s=0; s<in.size(); ++s) {
+    bvxm_util::warp_slab_bilinear(in[s], H, single[s]);
+    slabs_in.push_back(&in[s]);
+    slabs_out.push_back(&batched[s]);
+  }
+  bool same = true;
+  for (unsigned n_threads=1; n_threads<=4; n_threads*=2) {
+    bvxm_util::warp_slabs_bilinear(slabs_in, H, slabs_out, n_threads);
+    for (unsigned s=0; s<in.size(); ++s)
+      if (!std::equal(single[s].begin(), single[s].end(), batched[s].begin()))
+        same = false;
+  }
+  TEST("Batched threaded warps match single warps", same, true);
+
+  bvxm_voxel_slab<float> threaded(33,37,1);
+  bvxm_util::warp_slab_bilinear(in[1], H, threaded, 3);
+  TEST("Threaded warp matches", std::equal(single[1].begin(), single[1].end(), threaded.begin()), true);
+
+  // fused row sampling matches the warp
+  std::vector<bvxm_util::bilinear_sample> samples(out.nx());
+  bool fused_ok = true;
+  for (unsigned y=0; y<out.ny(); ++y) {
+    bvxm_util::bilinear_samples_row(M.data_block(), y, out.nx(), &samples[0]);
+    for (unsigned x=0; x<out.nx(); ++x) {
+      float v;
+      bvxm_util::sample_bilinear(in[0], samples[x], 0, v);
+      if (v != out(x,y))
+        fused_ok = false;
+    }
+  }
+  TEST("Row samples match the warp", fused_ok, true);
+}
+
+TESTMAIN( test_warp_slab );
@@ -20,6 +20,7 @@
 #include <vdgl/vdgl_edgel_chain.h>
 #include <vdgl/vdgl_interpolator.h>
 #include <vsol/vsol_point_2d.h>
+#include <vsol/vsol_pool.h>
 //--------------------------------------------------------------------------------
 //
 //: Constructors.
@@ -114,6 +115,9 @@ bool  sdet_detector::DoContour()
 {
   if (edges && vertices) return true;
 
+  // Edges and vertices built below come from one pool if requested
+  vsol_pool_scope pool_scope(this->pool_topology);
+
   if (!DoStep()) {
     std::cout << "***Fail on DoContour.\n";
     return false;
@@ -173,6 +177,9 @@ bool  sdet_detector::DoFoldContour()
 {
   if (edges && vertices) return true;
 
+  // Edges and vertices built below come from one pool if requested
+  vsol_pool_scope pool_scope(this->pool_topology);
+
 #if 0
   if (!DoFold()) {
     std::cout << "***Fail on DoFoldContour.\n";
@@ -424,6 +431,7 @@ void sdet_detector::print(std::ostream &strm) const
        << "    maxGap " <<   maxGap << std::endl   // Bridge small gaps up to max_gap across.
        << "    spacingp " <<   spacingp << std::endl  // equalize spacing?
        << "    borderp " <<   borderp << std::endl   // insert virtual border for closure?
+       << "    pool_topology " <<   pool_topology << std::endl // allocate edges and vertices from a vsol_pool?
        << "    corner_angle " <<   corner_angle << std::endl // smallest angle at corner
        << "    separation " <<   separation << std::endl // |mean1-mean2|/sigma
        << "    min_corner_length " <<   min_corner_length << std::endl // min length to find corners
@@ -20,6 +20,7 @@ sdet_detector_params::sdet_detector_params(const sdet_detector_params& dp)
              dp.peaks_only, dp.valleys_only,
              dp.corner_angle, dp.separation, dp.min_corner_length,
              dp.cycle, dp.ndimension);
+  pool_topology = dp.pool_topology;
 }
 
 sdet_detector_params::sdet_detector_params(float smooth_sigma, float noise_w,
@@ -63,6 +64,7 @@ void sdet_detector_params::InitParams(float smooth_sigma, float noise_w,
   minLength = minl;
   spacingp = equal_spacing;
   borderp = follow_b;
+  pool_topology = false;
   junctionp = recover_j;
   // Fold Parameters
   peaks_only = only_peaks;
@@ -117,6 +119,11 @@ void sdet_detector_params::set_close_borders(bool cb)
   borderp = cb;
 }
 
+void sdet_detector_params::set_pool_topology(bool pt)
+{
+  pool_topology = pt;
+}
+
 
 //-----------------------------------------------------------------------------
 //
@@ -260,7 +267,8 @@ std::ostream& operator << (std::ostream& os, const sdet_detector_params& dp)
      << " Corner Angle " << dp.corner_angle << std::endl
      << " Corner Separation " << dp.separation  << std::endl
      << " Min Corner Length " << dp.min_corner_length << std::endl
-     << " Close borders " << dp.borderp << std::endl << std::endl;
+     << " Close borders " << dp.borderp << std::endl
+     << " Pool topology " << dp.pool_topology << std::endl << std::endl;
 }
 #if 0
 //------------------------------------------------------------
@@ -56,6 +56,9 @@
 // - bool borderp:              If true, insert virtual contours at the border
 //                              to close regions. Nominally false.
 //
+// - bool pool_topology:        If true, allocate the vsol/vtol objects of a
+//                              detection run from a vsol_pool.  Nominally false.
+//
 // \author
 //             Joseph L. Mundy - November 1997
 //             GE Corporate Research and Development
@@ -93,6 +96,7 @@ class sdet_detector_params : public gevd_param_mixin
   void set_automatic_threshold(bool automatic_threshold);
   void set_aggressive_junction_closure(int aggressive_junction_closure);
   void set_close_borders(bool close_borders);
+  void set_pool_topology(bool pool_topology);
 
  protected:
   void InitParams(float smooth_sigma, float noise_w,
@@ -125,6 +129,7 @@ class sdet_detector_params : public gevd_param_mixin
   float maxGap;   //!< Bridge small gaps up to max_gap across.
   bool spacingp;  //!< equalize spacing?
   bool borderp;   //!< insert virtual border for closure?
+  bool pool_topology; //!< allocate edges and vertices from a vsol_pool?
   //
   // Fold detection parameters
   //
@@ -26,12 +26,74 @@
 #include <iostream>
 #include <fstream>
 #include <deque>
+#include <vector>
+#include <new>
 #include <algorithm>
 #include "sdet_sel_utils.h"
 #include "sdet_sel_base.h"
 
 #include <vcl_cassert.h>
 #include <vcl_compiler.h>
+#include <bvgl/algo/bvgl_eulerspiral.h>
+
+//: Storage for short-lived curve models of one type.
+//  Forming the curvelets of an edgel constructs a hypothesis for each
+//  neighbour and tries intersecting each pair of them, and most of these
+//  curve models are discarded straight away.  Models constructed in the pool
+//  and destroyed with destroy() give their storage back to it, so once the
+//  pool has grown to the largest number of models alive at once, forming
+//  further curvelets does not allocate curve models at all.
+//  A pool must only be used by one thread at a time.
+template <class curve_model>
+class sdet_curve_model_pool
+{
+ public:
+  sdet_curve_model_pool() {}
+
+  //: release the storage (all the models constructed in it must have been destroyed)
+  ~sdet_curve_model_pool()
+  {
+    assert(free_.size()==blocks_.size());
+    for (unsigned i=0; i<blocks_.size(); i++)
+      ::operator delete(blocks_[i]);
+  }
+
+  //: uninitialised storage for a curve model, to be constructed with placement new
+  void* allocate()
+  {
+    if (free_.empty()) {
+      blocks_.push_back(::operator new(sizeof(curve_model)));
+      return blocks_.back();
+    }
+    void* p = free_.back();
+    free_.pop_back();
+    return p;
+  }
+
+  //: destroy a curve model constructed in the pool, keeping its storage
+  void destroy(curve_model* cm)
+  {
+    cm->~curve_model();
+    free_.push_back(cm);
+  }
+
+ private:
+  std::vector<void*> blocks_;
+  std::vector<void*> free_;
+
+  // not copyable
+  sdet_curve_model_pool(sdet_curve_model_pool const&);
+  sdet_curve_model_pool& operator=(sdet_curve_model_pool const&);
+};
+
+//: Prepare any tables that curve models of this type create on first use.
+//  This must happen before several threads form curvelets at once.
+inline void sdet_prepare_curve_model(sdet_curve_model* /*model type*/) {}
+inline void sdet_prepare_curve_model(sdet_ES_curve_model* /*model type*/)
+{
+  // used by sdet_ES_curve_model and sdet_ES_curve_model_perturbed
+  bvgl_eulerspiral_lookup_table::instance();
+}
 
 //: A templatized subclass that can work with different curve models
 template <class curve_model>
@@ -51,11 +113,26 @@ public:
   }
 
   //: destructor
-  virtual ~sdet_sel<curve_model>(){}
+  virtual ~sdet_sel<curve_model>()
+  {
+    for (unsigned i=0; i<pools_.size(); i++)
+      delete pools_[i];
+  }
+
+  //: make curve model pools for n_threads threads forming curvelets at once
+  virtual void prepare_greedy_threads(unsigned n_threads)
+  {
+    sdet_prepare_curve_model(static_cast<curve_model*>(VXL_NULLPTR));
+    while (pools_.size()<n_threads)
+      pools_.push_back(new sdet_curve_model_pool<curve_model>);
+  }
 
   //: form a curve hypothesis of the appropriate model given a pair of edgels
+  //  If a pool is given the hypothesis is constructed in its storage and is
+  //  destroyed by the pool, otherwise it is allocated with new.
   inline curve_model* form_a_hypothesis(sdet_edgel* ref_e, sdet_edgel* e2, bool &ref_first,
-      bool forward=true, bool centered=true, bool leading=true)
+      bool forward=true, bool centered=true, bool leading=true,
+      sdet_curve_model_pool<curve_model>* pool=VXL_NULLPTR)
   {
     // First check for consistency in the appearance information
     if (app_usage_==2){
@@ -77,48 +154,59 @@ public:
       if (sdet_dot(ref_dir, ref_e->tangent)>0) {
         if (forward){
           ref_first = true;
-          return new curve_model(ref_e, e2, ref_e, dpos_, dtheta_, token_len_, max_k_, max_gamma_, badap_uncer_);
+          return new_pair_model(ref_e, e2, ref_e, pool);
         }
         else {
           ref_first = false;
-          return new curve_model(e2, ref_e, ref_e, dpos_, dtheta_, token_len_, max_k_, max_gamma_, badap_uncer_);
+          return new_pair_model(e2, ref_e, ref_e, pool);
         }
       }
       else {
         if (forward){
           ref_first = false;
-          return new curve_model(e2, ref_e, ref_e, dpos_, dtheta_, token_len_, max_k_, max_gamma_, badap_uncer_);
+          return new_pair_model(e2, ref_e, ref_e, pool);
         }
         else {
           ref_first = true;
-          return new curve_model(ref_e, e2, ref_e, dpos_, dtheta_, token_len_, max_k_, max_gamma_, badap_uncer_);
+          return new_pair_model(ref_e, e2, ref_e, pool);
         }
       }
     }
     else { //not centered
       if (sdet_dot(ref_dir, ref_e->tangent)>0 && forward && leading) {
         ref_first = true;
-        return new curve_model(ref_e, e2, ref_e, dpos_, dtheta_, token_len_, max_k_, max_gamma_, badap_uncer_);
+        return new_pair_model(ref_e, e2, ref_e, pool);
       }
       if (sdet_dot(ref_dir, ref_e->tangent)<0) {
         if (forward && !leading){
           ref_first = false;
-          return new curve_model(e2, ref_e, ref_e, dpos_, dtheta_, token_len_, max_k_, max_gamma_, badap_uncer_);
+          return new_pair_model(e2, ref_e, ref_e, pool);
         }
         if (!forward){
           ref_first = true;
-          return new curve_model(ref_e, e2, ref_e, dpos_, dtheta_, token_len_, max_k_, max_gamma_, badap_uncer_);
+          return new_pair_model(ref_e, e2, ref_e, pool);
         }
       }
     }
     return 0;
   }
 
+  //: construct the curve model of the edgel pair (e1->e2), anchored at ref_e
+  inline curve_model* new_pair_model(sdet_edgel* e1, sdet_edgel* e2, sdet_edgel* ref_e,
+                                     sdet_curve_model_pool<curve_model>* pool)
+  {
+    if (pool)
+      return new (pool->allocate()) curve_model(e1, e2, ref_e, dpos_, dtheta_, token_len_, max_k_, max_gamma_, badap_uncer_);
+    return new curve_model(e1, e2, ref_e, dpos_, dtheta_, token_len_, max_k_, max_gamma_, badap_uncer_);
+  }
+
   virtual void form_an_edgel_pair(sdet_edgel* ref_e, sdet_edgel* e2);
   virtual void form_an_edgel_triplet(sdet_curvelet* /*p1*/, sdet_curvelet* /*p2*/){}
   virtual void form_an_edgel_quad(sdet_curvelet* /*t1*/, sdet_curvelet* /*t2*/){}
   virtual void build_curvelets_greedy_for_edge(sdet_edgel* eA, unsigned max_size_to_group,
       bool use_flag=false, bool forward=true,  bool centered=true, bool leading=true);
+  virtual void build_curvelets_greedy_for_edge(sdet_edgel* eA, unsigned max_size_to_group,
+      bool use_flag, bool forward, bool centered, bool leading, unsigned thread);
 
   //: check if two curvelets are consistent (is there an intersection in their curve bundles?)
   bool are_curvelets_consistent(sdet_curvelet* cvlet1, sdet_curvelet* cvlet2)
@@ -137,6 +225,10 @@ public:
   //: form an edgel grouping from an ordered list of edgemap_->edgels
   virtual sdet_curvelet* form_an_edgel_grouping(sdet_edgel* ref_e, std::deque<sdet_edgel*> &edgel_chain,
       bool forward=true,  bool centered=true, bool leading=true);
+
+ protected:
+  //: curve model pools, one for each thread forming curvelets
+  std::vector<sdet_curve_model_pool<curve_model>*> pools_;
 };
 
 // Caio SOUZA - 2014
@@ -175,10 +267,25 @@ void sdet_sel<curve_model>::form_an_edgel_pair(sdet_edgel* ref_e, sdet_edgel* e2
 template <class curve_model>
 void sdet_sel<curve_model>::build_curvelets_greedy_for_edge(sdet_edgel* eA, unsigned max_size_to_group, bool use_flag,
                                 bool forward, bool centered, bool leading)
+{
+  prepare_greedy_threads(1);
+  build_curvelets_greedy_for_edge(eA, max_size_to_group, use_flag, forward, centered, leading, 0);
+}
+
+//: form curvelets around the given edgel in a greedy fashion, using the curve model pool of the given thread
+template <class curve_model>
+void sdet_sel<curve_model>::build_curvelets_greedy_for_edge(sdet_edgel* eA, unsigned max_size_to_group, bool use_flag,
+                                bool forward, bool centered, bool leading, unsigned thread)
 {
   // 1) construct a structure to temporarily hold the pairwise-hypotheses
   std::vector<sel_hyp> eA_hyps;
 
+  //the hypotheses and the bundles of the growing groupings are short lived,
+  //so they are constructed in this thread's pool; only the bundle of a curvelet
+  //that is kept is copied to the heap
+  assert(thread<pools_.size());
+  sdet_curve_model_pool<curve_model>& pool = *pools_[thread];
+
   //get the grid coordinates of this edgel
   unsigned const ii = sdet_round(eA->pt.x());
   unsigned const jj = sdet_round(eA->pt.y());
@@ -202,7 +309,7 @@ void sdet_sel<curve_model>::build_curvelets_greedy_for_edge(sdet_edgel* eA, unsi
 
         // 4) form pair-wise hypotheses
         bool ref_first;
-        curve_model* cm = form_a_hypothesis(eA, eB, ref_first, forward, centered, leading);
+        curve_model* cm = form_a_hypothesis(eA, eB, ref_first, forward, centered, leading, &pool);
 
         if (cm){
           if (cm->bundle_is_valid()){ //if legal, record the hypothesis
@@ -217,7 +324,7 @@ void sdet_sel<curve_model>::build_curvelets_greedy_for_edge(sdet_edgel* eA, unsi
             eA_hyps.push_back(cur_hyp);
           }
           else
-            delete cm;
+            pool.destroy(cm);
         }
       }
     }
@@ -261,14 +368,14 @@ void sdet_sel<curve_model>::build_curvelets_greedy_for_edge(sdet_edgel* eA, unsi
 
       // 10) for the others we need to check for consistency with the current hypothesis
       //     (i.e., compute intersection of curve bundles)
-      curve_model* new_cm = cur_cm->intersect(static_cast<curve_model *>(eA_hyps[h2].cm));
+      curve_model* new_cm = new (pool.allocate()) curve_model(cur_cm, static_cast<curve_model *>(eA_hyps[h2].cm));
 
       // 11) if the intersection is valid, we can add this edgel to the grouping
       if (new_cm->bundle_is_valid())
       {
         //reassign the curve bundle for the growing grouping
         if (cur_cm != eA_hyps[h1].cm)
-          delete cur_cm;
+          pool.destroy(cur_cm);
         cur_cm = new_cm;
 
         // 12) add the new edgel to the growing edgel chain
@@ -279,7 +386,7 @@ void sdet_sel<curve_model>::build_curvelets_greedy_for_edge(sdet_edgel* eA, unsi
         eA_hyps[h2].flag = true;
       }
       else
-        delete new_cm; //delete this cb because it is not needed
+        pool.destroy(new_cm); //delete this cb because it is not needed
 
       // 13) check the size of the grouping
       if (cur_edgel_chain.size() >= max_size_to_group)
@@ -297,7 +404,9 @@ void sdet_sel<curve_model>::build_curvelets_greedy_for_edge(sdet_edgel* eA, unsi
         cur_cm->curve_fit_is_reasonable(cur_edgel_chain, eA, dpos_))// &&
         //curvelet_is_balanced(eA, cur_edgel_chain))
     {
-      sdet_curvelet* new_cvlet = new sdet_curvelet(eA, cur_cm, cur_edgel_chain, forward);
+      //the curvelet owns its curve model, so it gets a copy on the heap
+      sdet_curvelet* new_cvlet = new sdet_curvelet(eA, new curve_model(*cur_cm), cur_edgel_chain, forward);
+      pool.destroy(cur_cm);
 
       //compute curvelet quality
       new_cvlet->compute_properties(rad_, token_len_);
@@ -308,13 +417,13 @@ void sdet_sel<curve_model>::build_curvelets_greedy_for_edge(sdet_edgel* eA, unsi
     else {
       //delete cur_cm if no curvelet is formed
       if (cur_cm != eA_hyps[h1].cm)
-        delete cur_cm;
+        pool.destroy(cur_cm);
     }
   }
 
   // 15) now delete all the hyps for this edgel, before moving on to a new edgel
   for (unsigned h1=0; h1<eA_hyps.size(); h1++)
-    delete eA_hyps[h1].cm;
+    pool.destroy(static_cast<curve_model *>(eA_hyps[h1].cm));
 
   eA_hyps.clear();
 }
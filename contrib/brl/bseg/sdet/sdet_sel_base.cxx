@@ -8,11 +8,16 @@
 
 #include <vcl_cassert.h>
 #include <vcl_compiler.h>
+#include <vxl_config.h>
 #include <pdf1d/pdf1d_calc_mean_var.h>
 #include <mbl/mbl_stats_1d.h>
 
 #include "sdet_edgemap.h"
 
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
+
 //: Constructor
 sdet_sel_base
 ::sdet_sel_base(sdet_edgemap_sptr edgemap,
@@ -40,6 +45,7 @@ sdet_sel_base
   maxN_(2*nrad_),
   centered_(cvlet_params.centered_),
   bidir_(cvlet_params.bidirectional_),
+  n_threads_(1),
   use_anchored_curvelets_(true),
   min_deg_to_link_(4),
   use_hybrid_(false),
@@ -134,6 +140,56 @@ sdet_sel_base
 }
 
 
+//: form all the curvelets of an edgel, for the current grouping mode (centered_ and bidir_)
+void
+sdet_sel_base
+::build_curvelets_greedy_at(sdet_edgel* eA, unsigned max_size_to_group, bool use_flag, unsigned thread)
+{
+  if (centered_) {
+    if (bidir_) {
+      // centered_ && bidir_
+      build_curvelets_greedy_for_edge(eA, max_size_to_group, use_flag, true, centered_, false, thread); //first in the forward direction
+      build_curvelets_greedy_for_edge(eA, max_size_to_group, use_flag, false, centered_, false, thread); //then in the other direction
+    } else {
+      // centered_ && !bidir_
+      build_curvelets_greedy_for_edge(eA, max_size_to_group, use_flag, true, centered_, false, thread); //first in the forward direction
+    }
+  } else {
+    if (bidir_) {
+      // !centered_ && bidir_
+      build_curvelets_greedy_for_edge(eA, max_size_to_group, use_flag, true, centered_, true, thread); //forward half
+      build_curvelets_greedy_for_edge(eA, max_size_to_group, use_flag, false, centered_, true, thread); //backward half
+    } else {
+      // !centered_ && !bidir_
+      build_curvelets_greedy_for_edge(eA, max_size_to_group, use_flag, true, centered_, true, thread); //forward half
+      build_curvelets_greedy_for_edge(eA, max_size_to_group, use_flag, true, centered_, false, thread); //ENO style forward
+    }
+  }
+}
+
+//: Work for one thread of build_curvelets_greedy(): every n_threads'th band of edgels
+struct sdet_sel_greedy_job
+{
+  sdet_sel_base* sel;
+  std::vector<std::vector<sdet_edgel*> > const* bands;
+  unsigned max_size_to_group;
+  bool use_flag;
+  unsigned thread, n_threads;
+
+  void run()
+  {
+    for (unsigned b=thread; b<bands->size(); b+=n_threads)
+      for (unsigned i=0; i<(*bands)[b].size(); i++)
+        sel->build_curvelets_greedy_at((*bands)[b][i], max_size_to_group, use_flag, thread);
+  }
+
+  static void* run_thread(void* arg)
+  {
+    static_cast<sdet_sel_greedy_job*>(arg)->run();
+    return VXL_NULLPTR;
+  }
+};
+
 //: form curvelets around each edgel in a greedy fashion
 void
 sdet_sel_base
@@ -160,37 +216,60 @@ sdet_sel_base
   //store this parameter
   maxN_ = max_size_to_group;
 
-  if (centered_) {
-    if (bidir_) {
-      for (unsigned i=0; i<edgemap_->edgels.size(); i++) {
-        sdet_edgel* eA = edgemap_->edgels[i];
-        // centered_ && bidir_
-        build_curvelets_greedy_for_edge(eA, max_size_to_group, use_flag, true, centered_, false); //first in the forward direction
-        build_curvelets_greedy_for_edge(eA, max_size_to_group, use_flag, false, centered_, false); //then in the other direction
-      }
-    } else {
-      for (unsigned i=0; i<edgemap_->edgels.size(); i++) {
-        sdet_edgel* eA = edgemap_->edgels[i];
-        // centered_ && !bidir_
-        build_curvelets_greedy_for_edge(eA, max_size_to_group, use_flag, true, centered_, false); //first in the forward direction
-      }
-    }
-  } else {
-    if (bidir_) {
-      for (unsigned i=0; i<edgemap_->edgels.size(); i++) {
-        sdet_edgel* eA = edgemap_->edgels[i];
-        build_curvelets_greedy_for_edge(eA, max_size_to_group, use_flag, true, centered_, true); //forward half
-        build_curvelets_greedy_for_edge(eA, max_size_to_group, use_flag, false, centered_, true); //backward half
-        // !centered_ && bidir_
-      }
-    } else {
-      for (unsigned i=0; i<edgemap_->edgels.size(); i++) {
-        sdet_edgel* eA = edgemap_->edgels[i];
-        build_curvelets_greedy_for_edge(eA, max_size_to_group, use_flag, true, centered_, true); //forward half
-        build_curvelets_greedy_for_edge(eA, max_size_to_group, use_flag, true, centered_, false); //ENO style forward
-        // !centered_ && !bidir_
-      }
-    }
+  unsigned n_threads = n_threads_;
+  if (n_threads<1) n_threads=1;
+#if !VXL_HAS_PTHREAD_H
+  n_threads=1;
+#endif
+
+  //per-thread scratch space, and any tables the curve model builds on first use
+  prepare_greedy_threads(n_threads);
+
+  if (n_threads==1) {
+    for (unsigned i=0; i<edgemap_->edgels.size(); i++)
+      build_curvelets_greedy_at(edgemap_->edgels[i], max_size_to_group, use_flag, 0);
+  }
+  else {
+    // The curvelets anchored at an edgel are formed from its neighbourhood
+    // alone and are only added to its own list in the curvelet map, in the
+    // same order as when they are formed serially.  Each list is written by
+    // one thread only, so the lists serve as the per-thread buffers and the
+    // map is identical to the serial one without a merge step.  Group the
+    // edgels by row of edgemap cells, keeping edgel order within a row, and
+    // deal the rows out to the threads in bands (several per thread, to
+    // balance the load).
+    const unsigned n_bands = std::min(4*n_threads, std::max(nrows_, 1u));
+    std::vector<std::vector<sdet_edgel*> > bands(n_bands);
+    for (unsigned i=0; i<edgemap_->edgels.size(); i++) {
+      sdet_edgel* eA = edgemap_->edgels[i];
+      int row = sdet_round(eA->pt.y());
+      if (row>=(int)nrows_) row = (int)nrows_-1;
+      if (row<0) row = 0;
+      bands[row*n_bands/std::max(nrows_, 1u)].push_back(eA);
+    }
+
+    std::vector<sdet_sel_greedy_job> jobs(n_threads);
+#if VXL_HAS_PTHREAD_H
+    std::vector<pthread_t> threads(n_threads);
+    std::vector<bool> started(n_threads, false);
+#endif
+    for (unsigned t=0; t<n_threads; t++) {
+      jobs[t].sel = this; jobs[t].bands = &bands;
+      jobs[t].max_size_to_group = max_size_to_group; jobs[t].use_flag = use_flag;
+      jobs[t].thread = t; jobs[t].n_threads = n_threads;
+#if VXL_HAS_PTHREAD_H
+      if (t>0)
+        started[t] = pthread_create(&threads[t], VXL_NULLPTR,
+                                    sdet_sel_greedy_job::run_thread, &jobs[t])==0;
+#endif
+    }
+    jobs[0].run();
+#if VXL_HAS_PTHREAD_H
+    for (unsigned t=1; t<n_threads; t++) {
+      if (started[t]) pthread_join(threads[t], VXL_NULLPTR);
+      else            jobs[t].run();  // Couldn't start thread - do it here
+    }
+#endif
   }
 
   if (verbose)
@@ -139,10 +139,22 @@ public:
     void form_an_edgel_grouping(sdet_edgel* /*eA*/, sdet_curvelet* /*cvlet*/, sdet_curvelet* /*pair*/){}
 
     //: form curvelets around each edgel in a greedy fashion
+    //  The curvelets of an edgel depend only on its neighbourhood and are stored
+    //  with it, so the rows of edgemap cells are shared between num_threads()
+    //  threads; the curvelet map is the same whatever the number of threads.
     void build_curvelets_greedy(unsigned max_size_to_group, bool use_flag=false,  bool clear_existing=true, bool verbose=false);
     //: form curvelets around the given edgel in a greedy fashion
     virtual void build_curvelets_greedy_for_edge(sdet_edgel* eA, unsigned max_size_to_group,
         bool use_flag=false, bool forward=true,  bool centered=true, bool leading=true) = 0;
+    //: form curvelets around the given edgel, using the scratch space of the given thread
+    virtual void build_curvelets_greedy_for_edge(sdet_edgel* eA, unsigned max_size_to_group,
+        bool use_flag, bool forward, bool centered, bool leading, unsigned thread) = 0;
+    //: make the scratch space for n_threads threads forming curvelets at once
+    virtual void prepare_greedy_threads(unsigned /*n_threads*/) {}
+
+    //: set the number of threads used to form curvelets (if threads are available)
+    void set_num_threads(unsigned n_threads) { n_threads_ = n_threads; }
+    unsigned num_threads() const { return n_threads_; }
 
     //: form an edgel grouping from an ordered list of edgemap_->edgels
     virtual sdet_curvelet* form_an_edgel_grouping(sdet_edgel* ref_e, std::deque<sdet_edgel*> &edgel_chain,
@@ -386,6 +398,10 @@ public:
   void evaluate_curvelet_quality(int method);
 
 protected:
+  friend struct sdet_sel_greedy_job;
+
+  //: form all the curvelets of an edgel, for the current grouping mode (centered_ and bidir_)
+  void build_curvelets_greedy_at(sdet_edgel* eA, unsigned max_size_to_group, bool use_flag, unsigned thread);
 
   sdet_edgemap_sptr edgemap_; ///< the edgemap to link
   sdet_curvelet_map& curvelet_map_;             ///< The curvelet map (CM)
@@ -410,6 +426,7 @@ protected:
   unsigned maxN_; ///< largest curvelet size to form
   bool centered_; ///< curvelets centered on the anchor edgel
   bool bidir_;    ///< curvelets in both direction
+  unsigned n_threads_; ///< number of threads used to form curvelets
 
   //linking parameters
   bool use_anchored_curvelets_; ///< the curvelet set to use for linking
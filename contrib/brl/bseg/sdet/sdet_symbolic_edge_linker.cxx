@@ -79,6 +79,7 @@ void sdet_symbolic_edge_linker::apply(sdet_edgemap_sptr edgemap) {
   //set appearance usage flags
   edge_linker->set_appearance_usage(app_usage_);
   edge_linker->set_appearance_threshold(app_thresh_);
+  edge_linker->set_num_threads(n_threads_);
 
   //perform local edgel grouping
   switch (grouping_algo_)
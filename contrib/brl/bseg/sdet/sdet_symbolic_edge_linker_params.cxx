@@ -20,7 +20,8 @@ sdet_symbolic_edge_linker_params(const sdet_symbolic_edge_linker_params& dp)
   InitParams(dp.nrad_, dp.gap_, dp.badap_uncer_, dp.dx_, dp.dt_, dp.curve_model_type_, dp.token_len_, dp.max_k_, dp.max_gamma_,
              dp.grouping_algo_, dp.cvlet_type_, dp.app_usage_, dp.app_thresh_, dp.max_size_to_group_,
              dp.bFormCompleteCvletMap_, dp.bFormLinkGraph_, dp.b_use_all_cvlets_, dp.linkgraph_algo_,
-             dp.min_size_to_link_, dp.linking_algo_, dp.num_link_iters_, dp.bGetfinalcontours_);
+             dp.min_size_to_link_, dp.linking_algo_, dp.num_link_iters_, dp.bGetfinalcontours_,
+             dp.n_threads_);
 }
 
 sdet_symbolic_edge_linker_params::
@@ -32,12 +33,14 @@ sdet_symbolic_edge_linker_params(double nrad, double gap, bool adap_uncer,
                                  bool formCompleteCvletMap, bool formLinkGraph,
                                  bool use_all_cvlet, unsigned linkgraph_algo,
                                  unsigned min_size_to_link, unsigned linking_algo,
-                                 unsigned num_link_iters, bool get_final_contours)
+                                 unsigned num_link_iters, bool get_final_contours,
+                                 unsigned n_threads)
 {
   InitParams(nrad, gap, adap_uncer, dx, dt, curve_model, token_len, max_k, max_gamma,
              grouping_algo, cvlet_type, app_usage, app_thresh, max_size_to_group,
              formCompleteCvletMap, formLinkGraph, use_all_cvlet, linkgraph_algo,
-             min_size_to_link, linking_algo, num_link_iters, get_final_contours);
+             min_size_to_link, linking_algo, num_link_iters, get_final_contours,
+             n_threads);
 }
 
 void sdet_symbolic_edge_linker_params::InitParams(double nrad, double gap, bool adap_uncer,
@@ -48,7 +51,8 @@ void sdet_symbolic_edge_linker_params::InitParams(double nrad, double gap, bool
                                                   bool formCompleteCvletMap, bool formLinkGraph,
                                                   bool use_all_cvlet, unsigned linkgraph_algo,
                                                   unsigned min_size_to_link, unsigned linking_algo,
-                                                  unsigned num_link_iters, bool get_final_contours)
+                                                  unsigned num_link_iters, bool get_final_contours,
+                                                  unsigned n_threads)
 {
   nrad_ = nrad;
   gap_ = gap;
@@ -72,6 +76,7 @@ void sdet_symbolic_edge_linker_params::InitParams(double nrad, double gap, bool
   linking_algo_ = linking_algo;
   num_link_iters_ = num_link_iters;
   bGetfinalcontours_ = get_final_contours;
+  n_threads_ = n_threads;
 
   switch(cvlet_type) //set the grouping flags from the choice of cvlet type
   {
@@ -105,8 +110,19 @@ void sdet_symbolic_edge_linker_params::InitParams(double nrad, double gap, bool
 //    std::endl otherwise.
 bool sdet_symbolic_edge_linker_params::SanityCheck()
 {
-  //TODO
-  return true;
+  //TODO: check the other parameters
+  std::stringstream msg;
+  bool valid = true;
+
+  if (n_threads_ < 1)
+  {
+    msg << "ERROR: at least one thread is needed to form curvelets\n";
+    valid = false;
+  }
+  msg << std::ends;
+
+  SetErrorMsg(msg.str().c_str());
+  return valid;
 }
 
 std::ostream& operator<< (std::ostream& os, const sdet_symbolic_edge_linker_params& dp)
@@ -120,5 +136,6 @@ std::ostream& operator<< (std::ostream& os, const sdet_symbolic_edge_linker_para
             << "Form linkgraph: " << dp.bFormLinkGraph_ << std::endl
             << "Use all curvelets: " << dp.b_use_all_cvlets_ << std::endl
             << "Extract final contours: " << dp.linkgraph_algo_ << std::endl
-            << "Get final contours: " << dp.bGetfinalcontours_ << std::endl;
+            << "Get final contours: " << dp.bGetfinalcontours_ << std::endl
+            << "Number of threads: " << dp.n_threads_ << std::endl;
 }
@@ -40,6 +40,22 @@ static void test_detector(int argc, char * argv[])
       std::cout << "v(" << x << ' ' << y << ")\n";
       TEST("(x,y) is (229,235)", x==229&&y==235, true);
     }
+
+    // Same run with edges and vertices allocated from a vsol_pool
+    dp.set_pool_topology(true);
+    sdet_detector pooled_det(dp);
+    pooled_det.SetImage(image);
+    pooled_det.DoContour();
+    std::vector<vtol_edge_2d_sptr>* pooled_edges = pooled_det.GetEdges();
+    int np = pooled_edges ? int(pooled_edges->size()) : 0;
+    TEST("Pooled run gives same number of edges", np, n);
+    if (np)
+    {
+      vtol_edge_2d_sptr e = (*pooled_edges)[0];
+      TEST("Pooled run gives same first vertex",
+           int(e->v1()->cast_to_vertex_2d()->x())==229 &&
+           int(e->v1()->cast_to_vertex_2d()->y())==235, true);
+    }
   }else{
     TEST("image could not be loaded so no fault", true, true);
   }
@@ -11,6 +11,45 @@
 #include <sdet/sdet_curve_model.h>
 #include <sdet/sdet_sel.h>
 
+//: Form the curvelets of edgels on concentric circles, using n_threads threads.
+//  On exit signature lists, for each edgel, the ids of the edgel chain and
+//  the direction, length and quality of each curvelet anchored on it.
+static void circle_curvelets(unsigned n_threads, std::vector<double>& signature)
+{
+  sdet_edgemap_sptr edgemap = new sdet_edgemap(100, 100);
+  for (double r = 8.0; r < 40.0; r += 6.0) {
+    const unsigned n = unsigned(2.0*vnl_math::pi*r/0.9);
+    for (unsigned k = 0; k < n; ++k) {
+      double a = 2.0*vnl_math::pi*k/n;
+      vgl_point_2d<double> pt(50.0+r*std::cos(a), 50.0+r*std::sin(a));
+      edgemap->insert(new sdet_edgel(pt, a+vnl_math::pi_over_2));
+    }
+  }
+
+  sdet_curvelet_map cvlet_map;
+  sdet_edgel_link_graph edge_link_graph;
+  sdet_curve_fragment_graph curve_frag_graph;
+  sdet_curvelet_params params(sdet_curve_model::CC3d, 3.5, 1.0, 15, 0.5, false,
+                              0.7, 0.5, 0.05, true, true);
+  sdet_sel<sdet_CC_curve_model_3d> edge_linker(edgemap, cvlet_map, edge_link_graph,
+                                               curve_frag_graph, params);
+  edge_linker.set_num_threads(n_threads);
+  edge_linker.build_curvelets_greedy(7);
+
+  signature.clear();
+  for (unsigned i = 0; i < edgemap->num_edgels(); ++i) {
+    signature.push_back(-1.0);
+    cvlet_list const& cvlets = cvlet_map.curvelets(i);
+    for (cvlet_list::const_iterator it = cvlets.begin(); it != cvlets.end(); ++it) {
+      for (unsigned k = 0; k < (*it)->edgel_chain.size(); ++k)
+        signature.push_back((*it)->edgel_chain[k]->id);
+      signature.push_back((*it)->forward ? 1.0 : 0.0);
+      signature.push_back((*it)->length);
+      signature.push_back((*it)->quality);
+    }
+  }
+}
+
 //: Test the symbolic edge linker methods
 MAIN( test_sel )
 {
@@ -82,6 +121,15 @@ MAIN( test_sel )
 
   TEST("Constructor", &edge_linker != VXL_NULLPTR, true);
 
+  //*******************************************************
+  START (" Test threaded curvelet formation");
+
+  std::vector<double> serial, threaded;
+  circle_curvelets(1, serial);
+  circle_curvelets(4, threaded);
+  TEST("Curvelets are formed", serial.size() > 2000, true);
+  TEST("Threaded curvelet map matches serial", threaded == serial, true);
+
   //*******************************************************
 
 
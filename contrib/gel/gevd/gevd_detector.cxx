@@ -15,6 +15,7 @@
 #include "gevd_bufferxy.h"
 #include "gevd_contour.h"
 #include <vtol/vtol_edge_2d.h>
+#include <vsol/vsol_pool.h>
 
 //--------------------------------------------------------------------------------
 //
@@ -98,6 +99,9 @@ bool  gevd_detector::DoContour()
 {
   if (edges && vertices) return true;
 
+  // Edges and vertices built below come from one pool if requested
+  vsol_pool_scope pool_scope(this->pool_topology);
+
   if (!DoStep()) {
     std::cout << "***Fail on DoContour.\n";
     return false;
@@ -147,6 +151,9 @@ bool  gevd_detector::DoFoldContour()
 {
   if (edges && vertices) return true;
 
+  // Edges and vertices built below come from one pool if requested
+  vsol_pool_scope pool_scope(this->pool_topology);
+
 //   if (!DoFold()) {
 //     std::cout << "***Fail on DoFoldContour.\n";
 //     return false;
@@ -347,6 +354,7 @@ void gevd_detector::print(std::ostream &strm) const
        << "    maxGap " <<   maxGap << std::endl   // Bridge small gaps up to max_gap across.
        << "    spacingp " <<   spacingp << std::endl  // equalize spacing?
        << "    borderp " <<   borderp << std::endl   // insert virtual border for closure?
+       << "    pool_topology " <<   pool_topology << std::endl // allocate edges and vertices from a vsol_pool?
        << "    corner_angle " <<   corner_angle << std::endl // smallest angle at corner
        << "    separation " <<   separation << std::endl // |mean1-mean2|/sigma
        << "    min_corner_length " <<   min_corner_length << std::endl // min length to find corners
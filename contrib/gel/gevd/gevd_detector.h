@@ -55,6 +55,9 @@
 // - bool borderp:               If true, insert virtual contours at the border
 //                               to close regions. Nominally false.
 //
+// - bool pool_topology:         If true, allocate the vsol/vtol objects of a
+//                               detection run from a vsol_pool.  Nominally false.
+//
 // \author
 //             Jane S. Liu - 3/27/95
 //             GE Corporate Research and Development
@@ -19,6 +19,7 @@ gevd_detector_params::gevd_detector_params(const gevd_detector_params& dp)
              dp.peaks_only, dp.valleys_only,
              dp.corner_angle, dp.separation, dp.min_corner_length,
              dp.cycle, dp.ndimension);
+  pool_topology = dp.pool_topology;
 }
 
 gevd_detector_params::gevd_detector_params(float smooth_sigma, float noise_w,
@@ -62,6 +63,7 @@ void gevd_detector_params::InitParams(float smooth_sigma, float noise_w,
   minLength = minl;
   spacingp = equal_spacing;
   borderp = follow_b;
+  pool_topology = false;
   // Fold Parameters
   peaks_only = only_peaks;
   valleys_only = only_valleys;
@@ -115,6 +117,11 @@ void gevd_detector_params::set_close_borders(bool cb)
   borderp = cb;
 }
 
+void gevd_detector_params::set_pool_topology(bool pt)
+{
+  pool_topology = pt;
+}
+
 
 //-----------------------------------------------------------------------------
 //
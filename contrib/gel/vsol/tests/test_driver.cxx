@@ -9,6 +9,7 @@ DECLARE(test_vsol_point_2d);
 DECLARE(test_vsol_point_3d);
 DECLARE(test_vsol_polygon_2d);
 DECLARE(test_vsol_polygon_3d);
+DECLARE(test_vsol_pool);
 DECLARE(test_vsol_digital_curve_2d);
 DECLARE(test_vsol_digital_curve_3d);
 DECLARE(test_vsol_rectangle_2d);
@@ -30,6 +31,7 @@ register_tests()
   REGISTER(test_vsol_point_3d);
   REGISTER(test_vsol_polygon_2d);
   REGISTER(test_vsol_polygon_3d);
+  REGISTER(test_vsol_pool);
   REGISTER(test_vsol_digital_curve_2d);
   REGISTER(test_vsol_digital_curve_3d);
   REGISTER(test_vsol_rectangle_2d);
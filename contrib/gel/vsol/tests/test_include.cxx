@@ -26,6 +26,7 @@
 #include <vsol/vsol_polygon_2d_sptr.h>
 #include <vsol/vsol_polygon_3d.h>
 #include <vsol/vsol_polygon_3d_sptr.h>
+#include <vsol/vsol_pool.h>
 #include <vsol/vsol_polyhedron.h>
 #include <vsol/vsol_polyhedron_sptr.h>
 #include <vsol/vsol_polyline_2d.h>
@@ -0,0 +1,68 @@
+// This is gel/vsol/tests/test_vsol_pool.cxx
+#include <vector>
+#include <testlib/testlib_test.h>
+//:
+// \file
+#include <vsol/vsol_pool.h>
+#include <vsol/vsol_point_2d.h>
+#include <vsol/vsol_point_2d_sptr.h>
+#include <vsol/vsol_line_2d.h>
+#include <vsol/vsol_line_2d_sptr.h>
+
+void test_vsol_pool()
+{
+  TEST("No pool by default", vsol_pool::current()==VXL_NULLPTR, true);
+
+  vsol_point_2d_sptr heap_point = new vsol_point_2d(1,2);
+  std::vector<vsol_point_2d_sptr> kept;
+  {
+    vsol_pool_scope scope;
+    vsol_pool* pool = scope.pool();
+    TEST("Scope makes its pool current", vsol_pool::current(), pool);
+
+    std::vector<vsol_point_2d_sptr> points;
+    for (int i=0;i<5000;++i)
+      points.push_back(new vsol_point_2d(i,-i));
+    TEST("Objects counted", pool->n_live(), 5000);
+    TEST("Objects share chunks", pool->n_chunks()<50, true);
+    bool ok=true;
+    for (int i=0;i<5000;++i)
+      ok = ok && points[i]->x()==i && points[i]->y()==-i;
+    TEST("Pooled objects hold their values", ok, true);
+
+    // Released blocks are reused rather than taking more chunks
+    unsigned n_chunks = pool->n_chunks();
+    points.clear();
+    TEST("Released objects uncounted", pool->n_live(), 0);
+    for (int i=0;i<5000;++i)
+      points.push_back(new vsol_point_2d(i,i));
+    TEST("Free blocks recycled", pool->n_chunks(), n_chunks);
+
+    {
+      vsol_pool_scope inner(false);
+      TEST("Disabled scope leaves pool alone", vsol_pool::current(), pool);
+    }
+
+    vsol_line_2d_sptr line = new vsol_line_2d(points[0],points[1]);
+    TEST("Line from pooled points", line->length()>1.0, true);
+
+    kept.push_back(points[10]);
+    kept.push_back(points[20]);
+  }
+  TEST("Previous (null) pool restored", vsol_pool::current()==VXL_NULLPTR, true);
+
+  // Objects which outlive the scope remain valid and are freed with the pool
+  TEST("Pooled object outlives scope", kept[0]->x()==10 && kept[1]->y()==20, true);
+  kept.clear();
+  TEST("Heap object unaffected", heap_point->x()==1 && heap_point->y()==2, true);
+
+  // Objects bigger than the pool's largest block fall back to the heap
+  {
+    vsol_pool_scope scope;
+    void* big = vsol_pool::allocate(4096);
+    TEST("Large block not pooled", scope.pool()->n_live(), 0);
+    vsol_pool::release(big);
+  }
+}
+
+TESTMAIN(test_vsol_pool);
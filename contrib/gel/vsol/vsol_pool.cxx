@@ -0,0 +1,184 @@
+// This is gel/vsol/vsol_pool.cxx
+#include <new>
+#include "vsol_pool.h"
+//:
+// \file
+#include <vcl_cassert.h>
+
+//: Prefix stored in front of every object allocated by vsol_pool::allocate()
+//  The object itself starts granularity bytes after the block.
+struct vsol_pool_header
+{
+  vsol_pool* pool;    // Owning pool, or null for heap blocks
+  std::size_t size_class;
+};
+
+#if VXL_HAS_PTHREAD_H
+static pthread_key_t vsol_pool_key;
+static pthread_once_t vsol_pool_key_once = PTHREAD_ONCE_INIT;
+
+static void vsol_pool_make_key()
+{
+  pthread_key_create(&vsol_pool_key, VXL_NULLPTR);
+}
+
+static void vsol_pool_set_current(vsol_pool* pool)
+{
+  pthread_once(&vsol_pool_key_once, vsol_pool_make_key);
+  pthread_setspecific(vsol_pool_key, pool);
+}
+
+vsol_pool* vsol_pool::current()
+{
+  pthread_once(&vsol_pool_key_once, vsol_pool_make_key);
+  return static_cast<vsol_pool*>(pthread_getspecific(vsol_pool_key));
+}
+#else
+static vsol_pool* vsol_pool_current = VXL_NULLPTR;
+
+static void vsol_pool_set_current(vsol_pool* pool)
+{
+  vsol_pool_current = pool;
+}
+
+vsol_pool* vsol_pool::current()
+{
+  return vsol_pool_current;
+}
+#endif
+
+vsol_pool::vsol_pool()
+  : free_lists_(max_block_size/granularity, VXL_NULLPTR),
+    next_(VXL_NULLPTR), end_(VXL_NULLPTR), n_live_(0), open_(true)
+{
+#if VXL_HAS_PTHREAD_H
+  pthread_mutex_init(&mutex_, VXL_NULLPTR);
+#endif
+}
+
+vsol_pool::~vsol_pool()
+{
+  assert(n_live_==0);
+  for (unsigned i=0;i<chunks_.size();++i)
+    ::operator delete(chunks_[i]);
+#if VXL_HAS_PTHREAD_H
+  pthread_mutex_destroy(&mutex_);
+#endif
+}
+
+void vsol_pool::lock()
+{
+#if VXL_HAS_PTHREAD_H
+  pthread_mutex_lock(&mutex_);
+#endif
+}
+
+void vsol_pool::unlock()
+{
+#if VXL_HAS_PTHREAD_H
+  pthread_mutex_unlock(&mutex_);
+#endif
+}
+
+//: Allocate a block of at least n bytes (n<=max_block_size)
+void* vsol_pool::allocate_block(std::size_t n)
+{
+  std::size_t size_class = (n+granularity-1)/granularity - 1;
+  std::size_t size = (size_class+1)*granularity;
+
+  lock();
+  void* block = free_lists_[size_class];
+  if (block)
+    free_lists_[size_class] = *static_cast<void**>(block);
+  else
+  {
+    if (next_==VXL_NULLPTR || std::size_t(end_-next_)<size)
+    {
+      try
+      {
+        chunks_.push_back(static_cast<char*>(::operator new(chunk_size)));
+      }
+      catch (...)
+      {
+        unlock();
+        throw;
+      }
+      next_ = chunks_.back();
+      end_ = next_+chunk_size;
+    }
+    block = next_;
+    next_ += size;
+  }
+  ++n_live_;
+  unlock();
+
+  vsol_pool_header* header = static_cast<vsol_pool_header*>(block);
+  header->pool = this;
+  header->size_class = size_class;
+  return block;
+}
+
+bool vsol_pool::release_block(void* block)
+{
+  std::size_t size_class = static_cast<vsol_pool_header*>(block)->size_class;
+  lock();
+  *static_cast<void**>(block) = free_lists_[size_class];
+  free_lists_[size_class] = block;
+  --n_live_;
+  bool unused = !open_ && n_live_==0;
+  unlock();
+  return unused;
+}
+
+bool vsol_pool::close()
+{
+  lock();
+  open_ = false;
+  bool unused = n_live_==0;
+  unlock();
+  return unused;
+}
+
+void* vsol_pool::allocate(std::size_t n)
+{
+  std::size_t total = n + granularity;
+  vsol_pool* pool = current();
+  if (pool && total<=max_block_size)
+    return static_cast<char*>(pool->allocate_block(total)) + granularity;
+
+  void* block = ::operator new(total);
+  vsol_pool_header* header = static_cast<vsol_pool_header*>(block);
+  header->pool = VXL_NULLPTR;
+  header->size_class = 0;
+  return static_cast<char*>(block) + granularity;
+}
+
+void vsol_pool::release(void* p)
+{
+  if (!p) return;
+  void* block = static_cast<char*>(p) - granularity;
+  vsol_pool* pool = static_cast<vsol_pool_header*>(block)->pool;
+  if (!pool)
+    ::operator delete(block);
+  else if (pool->release_block(block))
+    delete pool;  // Scope has ended and this was the last object
+}
+
+//=======================================================================
+
+vsol_pool_scope::vsol_pool_scope(bool enabled)
+  : pool_(VXL_NULLPTR), previous_(VXL_NULLPTR)
+{
+  if (!enabled) return;
+  previous_ = vsol_pool::current();
+  pool_ = new vsol_pool;
+  vsol_pool_set_current(pool_);
+}
+
+vsol_pool_scope::~vsol_pool_scope()
+{
+  if (!pool_) return;
+  vsol_pool_set_current(previous_);
+  if (pool_->close())
+    delete pool_;
+}
@@ -0,0 +1,116 @@
+// This is gel/vsol/vsol_pool.h
+#ifndef vsol_pool_h_
+#define vsol_pool_h_
+//:
+// \file
+// \brief Arena allocation for vsol/vtol spatial objects
+//
+// Edge detectors and region processors create very large numbers of small
+// vsol and vtol objects, one heap allocation each.  While a vsol_pool_scope
+// is alive on a thread, every vsol_spatial_object (and hence every vtol
+// topology object) constructed on that thread is carved out of large chunks
+// owned by a vsol_pool instead.  Objects released during the run are
+// recycled through per-size free lists; the chunks themselves are returned
+// to the heap in one go once the scope has ended and the last pooled object
+// has been destroyed.
+//
+// Reference counting is unchanged: pooled objects are still managed by
+// smart pointers and may safely outlive the scope which created them.
+//
+// \verbatim
+//  Example
+//   {
+//     vsol_pool_scope pool; // objects created below are pooled
+//     detector.DoContour();
+//   }                       // pool freed once the edges are released
+// \endverbatim
+
+#include <cstddef>
+#include <vector>
+#include <vcl_compiler.h>
+#include <vxl_config.h>
+
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
+
+//: Chunked arena with per-size free lists, shared by all vsol objects
+class vsol_pool
+{
+ public:
+  //: Allocate n bytes for a spatial object.
+  //  Taken from the pool current on this thread, or the heap if none.
+  static void* allocate(std::size_t n);
+
+  //: Release memory obtained from allocate()
+  static void release(void* p);
+
+  //: Pool in use on this thread (null if objects go to the heap)
+  static vsol_pool* current();
+
+  //: Number of objects allocated from this pool and not yet released
+  std::size_t n_live() const { return n_live_; }
+
+  //: Number of chunks the pool has taken from the heap
+  std::size_t n_chunks() const { return chunks_.size(); }
+
+ private:
+  friend class vsol_pool_scope;
+
+  vsol_pool();
+  ~vsol_pool();
+
+  void* allocate_block(std::size_t n);
+  //: Return block to its free list.  Returns true if the pool is now unused.
+  bool release_block(void* block);
+  //: Stop allocating.  Returns true if the pool is now unused.
+  bool close();
+
+  void lock();
+  void unlock();
+
+  //: Blocks larger than this come straight from the heap
+  static const std::size_t max_block_size = 512;
+  //: Size of each chunk requested from the heap
+  static const std::size_t chunk_size = 65536;
+  //: Size granularity (and header size)
+  static const std::size_t granularity = 16;
+
+  std::vector<char*> chunks_;
+  //: Heads of the intrusive free lists, one per size class
+  std::vector<void*> free_lists_;
+  char* next_;
+  char* end_;
+  std::size_t n_live_;
+  bool open_;
+#if VXL_HAS_PTHREAD_H
+  pthread_mutex_t mutex_;
+#endif
+
+  // Not copyable
+  vsol_pool(const vsol_pool&);
+  vsol_pool& operator=(const vsol_pool&);
+};
+
+//: Makes a fresh vsol_pool current on this thread for its lifetime.
+//  Scopes nest; the previous pool is restored on exit.
+//  If enabled is false, the scope does nothing.
+class vsol_pool_scope
+{
+ public:
+  explicit vsol_pool_scope(bool enabled = true);
+  ~vsol_pool_scope();
+
+  //: The pool created by this scope (null if not enabled)
+  vsol_pool* pool() const { return pool_; }
+
+ private:
+  vsol_pool* pool_;
+  vsol_pool* previous_;
+
+  // Not copyable
+  vsol_pool_scope(const vsol_pool_scope&);
+  vsol_pool_scope& operator=(const vsol_pool_scope&);
+};
+
+#endif // vsol_pool_h_
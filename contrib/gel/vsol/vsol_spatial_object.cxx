@@ -2,6 +2,7 @@
 #include "vsol_spatial_object.h"
 //:
 // \file
+#include <vsol/vsol_pool.h>
 
 vsol_spatial_object::vsol_spatial_object()
 :vul_timestamp(), vbl_ref_count(), vsol_flags_id()
@@ -11,3 +12,13 @@ vsol_spatial_object::vsol_spatial_object()
 vsol_spatial_object::~vsol_spatial_object()
 {
 }
+
+void* vsol_spatial_object::operator new(std::size_t n)
+{
+  return vsol_pool::allocate(n);
+}
+
+void vsol_spatial_object::operator delete(void* p)
+{
+  vsol_pool::release(p);
+}
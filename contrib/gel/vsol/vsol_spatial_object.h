@@ -11,6 +11,7 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <cstddef>
 #include <vul/vul_timestamp.h>
 #include <vbl/vbl_ref_count.h>
 #include <vsol/vsol_flags_id.h>
@@ -20,6 +21,10 @@ class vsol_spatial_object : public vul_timestamp, public vbl_ref_count, public v
  public:
   // Constructors/Destructor---------------------------------------------------
   virtual ~vsol_spatial_object();
+
+  //: Allocate from the vsol_pool current on this thread, if any
+  static void* operator new(std::size_t n);
+  static void operator delete(void* p);
  protected:
   vsol_spatial_object();
 };
@@ -14,17 +14,23 @@
 #include <vil/vil_save.h>
 #include <vcl_compiler.h>
 #include <vcl_cassert.h>
+#include <vxl_config.h>
 
 #include <vsl/vsl_indent.h>
 #include <vsl/vsl_binary_loader.h>
 #include <vsl/vsl_vector_io.h>
 
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
+
 //=======================================================================
 // Dflt ctor
 //=======================================================================
 
 mfpf_mr_point_finder::mfpf_mr_point_finder()
-  : max_after_pruning_(0)
+  : max_after_pruning_(0),
+    cache_valid_(false), cached_image_id_(0), cached_fit_(9e99)
 {
 }
 
@@ -42,6 +48,7 @@ mfpf_mr_point_finder::~mfpf_mr_point_finder()
 void mfpf_mr_point_finder::set_max_after_pruning(unsigned max_n)
 {
   max_after_pruning_=max_n;
+  cache_valid_=false;
 }
 
 //: Define point finders.  Clone of each taken
@@ -50,6 +57,7 @@ void mfpf_mr_point_finder::set(const std::vector<mfpf_point_finder*>& finders)
   finders_.resize(finders.size());
   for (unsigned i=0;i<finders.size();++i)
     finders_[i]=*finders[i];  // Clone taken by copy operator
+  cache_valid_=false;
 }
 
 //: Select best level for searching around pose with finder i
@@ -131,7 +139,7 @@ double mfpf_mr_point_finder::search(const vimt_image_pyramid& im_pyr,
     assert(im_pyr(im_L).is_a()=="vimt_image_2d_of<float>");
     const vimt_image_2d_of<float>& image
       = static_cast<const vimt_image_2d_of<float>&>(im_pyr(im_L));
-    fit = finder(L).search_with_opt(image,pose.p(),pose.u(),
+    fit = finders_[L]->search_with_opt(image,pose.p(),pose.u(),
                            best_pose.p(),best_pose.u());
     pose=best_pose;
   }
@@ -139,6 +147,29 @@ double mfpf_mr_point_finder::search(const vimt_image_pyramid& im_pyr,
   return fit;
 }
 
+//: Searches around given pose, re-using the last result if possible.
+double mfpf_mr_point_finder::search(const vimt_image_pyramid& im_pyr,
+                                    const mfpf_pose& pose0,
+                                    mfpf_pose& best_pose,
+                                    unsigned long image_id)
+{
+  if (cache_valid_ && cached_image_id_==image_id && cached_pose0_==pose0)
+  {
+    best_pose = cached_best_pose_;
+    return cached_fit_;
+  }
+
+  double fit = search(im_pyr,pose0,best_pose);
+
+  cache_valid_=true;
+  cached_image_id_=image_id;
+  cached_pose0_=pose0;
+  cached_best_pose_=best_pose;
+  cached_fit_=fit;
+
+  return fit;
+}
+
 //: Searches around given pose, starting at coarsest model.
 //  Searches with finder(L_hi) and feeds best result into
 //  search for next model, until level L_lo.
@@ -159,7 +190,7 @@ double mfpf_mr_point_finder::mr_search(
     assert(im_pyr(im_L).is_a()=="vimt_image_2d_of<float>");
     const vimt_image_2d_of<float>& image
       = static_cast<const vimt_image_2d_of<float>&>(im_pyr(im_L));
-    fit = finder(L).search_with_opt(image,pose0.p(),pose0.u(),
+    fit = finders_[L]->search_with_opt(image,pose0.p(),pose0.u(),
                                     pose.p(),pose.u());
     pose0=pose;
   }
@@ -178,7 +209,7 @@ void mfpf_mr_point_finder::refine_match(
   assert(im_pyr(im_L).is_a()=="vimt_image_2d_of<float>");
   const vimt_image_2d_of<float>& image
     = static_cast<const vimt_image_2d_of<float>&>(im_pyr(im_L));
-  finder(L).refine_match(image,pose.p(),pose.u(),fit);
+  finders_[L]->refine_match(image,pose.p(),pose.u(),fit);
 }
 
 //: Find all local optima at coarsest scale and search around each
@@ -202,7 +233,7 @@ void mfpf_mr_point_finder::multi_search(
   assert(im_pyr(im_L).is_a()=="vimt_image_2d_of<float>");
   const vimt_image_2d_of<float>& image
     = static_cast<const vimt_image_2d_of<float>&>(im_pyr(im_L));
-  finder(L).multi_search(image,pose0.p(),pose0.u(),poses,fits);
+  finders_[L]->multi_search(image,pose0.p(),pose0.u(),poses,fits);
 
   if (L==0) return;
 
@@ -243,20 +274,20 @@ void mfpf_mr_point_finder::multi_search_and_prune(
   assert(im_pyr(im_L).is_a()=="vimt_image_2d_of<float>");
   const vimt_image_2d_of<float>& image
     = static_cast<const vimt_image_2d_of<float>&>(im_pyr(im_L));
-  finder(L0).multi_search(image,pose0.p(),pose0.u(),poses,fits);
+  finders_[L0]->multi_search(image,pose0.p(),pose0.u(),poses,fits);
 
   if (poses.size()==0)
   {
     std::cerr<<"Warning: No poses returned by mfpf_point_finder\n";
     // Perform search to find single good point
     vgl_point_2d<double> new_p;
-    double f = finder(L0).search_one_pose(image,pose0.p(),pose0.u(),new_p);
+    double f = finders_[L0]->search_one_pose(image,pose0.p(),pose0.u(),new_p);
     poses.resize(1); poses[0]=mfpf_pose(new_p,pose0.u());
     fits.resize(1); fits[0]=f;
   }
 
   if (L0==prune_level)
-    mfpf_prune_and_sort_overlaps(finder(L0),poses,fits,max_after_pruning_);
+    mfpf_prune_and_sort_overlaps(*finders_[L0],poses,fits,max_after_pruning_);
 //    mfpf_prune_overlaps(finder(L0),poses,fits);
 
   if (L0==0) return;
@@ -272,7 +303,7 @@ void mfpf_mr_point_finder::multi_search_and_prune(
     // Remove overlaps if we are at prune_level
     if (L==prune_level)
     {
-      mfpf_prune_and_sort_overlaps(finder(L),poses,fits,max_after_pruning_);
+      mfpf_prune_and_sort_overlaps(*finders_[L],poses,fits,max_after_pruning_);
 //      mfpf_prune_overlaps(finder(L),poses,fits);
     }
   }
@@ -364,6 +395,7 @@ void mfpf_mr_point_finder::b_read(vsl_b_istream& bfs)
       for (unsigned i=0;i<n;++i) vsl_b_read(bfs,finders_[i]);
       if (version==1) max_after_pruning_=0;
       else vsl_b_read(bfs,max_after_pruning_);
+      cache_valid_=false;
       break;
     default:
       std::cerr << "I/O ERROR: vsl_b_read(vsl_b_istream&)\n"
@@ -398,4 +430,94 @@ void vsl_b_read(vsl_b_istream& bfs, mfpf_mr_point_finder& b)
   b.b_read(bfs);
 }
 
+//=======================================================================
+// Parallel search over many points
+//=======================================================================
+
+namespace
+{
+  //: Data shared by the threads of mfpf_mr_search_points
+  struct mfpf_mr_search_job
+  {
+    std::vector<mfpf_mr_point_finder>* finders;
+    const vimt_image_pyramid* im_pyr;
+    const std::vector<mfpf_pose>* poses0;
+    std::vector<mfpf_pose>* poses;
+    std::vector<double>* fits;
+    //: Index of next point to be searched
+    unsigned next;
+#if VXL_HAS_PTHREAD_H
+    pthread_mutex_t mutex;
+#endif
+
+    //: Claim the next point to search.  Returns false when all are done.
+    bool claim(unsigned& i)
+    {
+#if VXL_HAS_PTHREAD_H
+      pthread_mutex_lock(&mutex);
+#endif
+      i=next;
+      if (next<finders->size()) ++next;
+#if VXL_HAS_PTHREAD_H
+      pthread_mutex_unlock(&mutex);
+#endif
+      return i<finders->size();
+    }
 
+    void run()
+    {
+      unsigned i;
+      while (claim(i))
+        (*fits)[i]=(*finders)[i].search(*im_pyr,(*poses0)[i],(*poses)[i]);
+    }
+  };
+
+#if VXL_HAS_PTHREAD_H
+  void* mfpf_mr_search_thread(void* arg)
+  {
+    static_cast<mfpf_mr_search_job*>(arg)->run();
+    return VXL_NULLPTR;
+  }
+#endif
+}
+
+//: Search around poses0[i] with finders[i], for every point i.
+void mfpf_mr_search_points(std::vector<mfpf_mr_point_finder>& finders,
+                           const vimt_image_pyramid& im_pyr,
+                           const std::vector<mfpf_pose>& poses0,
+                           std::vector<mfpf_pose>& poses,
+                           std::vector<double>& fits,
+                           unsigned n_threads)
+{
+  assert(finders.size()==poses0.size());
+  unsigned n=finders.size();
+  poses.resize(n);
+  fits.resize(n);
+
+  mfpf_mr_search_job job;
+  job.finders=&finders;
+  job.im_pyr=&im_pyr;
+  job.poses0=&poses0;
+  job.poses=&poses;
+  job.fits=&fits;
+  job.next=0;
+
+#if VXL_HAS_PTHREAD_H
+  if (n_threads>n) n_threads=n;
+  pthread_mutex_init(&job.mutex,VXL_NULLPTR);
+  std::vector<pthread_t> threads;
+  for (unsigned t=1;t<n_threads;++t)
+  {
+    pthread_t id;
+    if (pthread_create(&id,VXL_NULLPTR,mfpf_mr_search_thread,&job)==0)
+      threads.push_back(id);
+  }
+  job.run();  // This thread does its share too
+  for (unsigned t=0;t<threads.size();++t)
+    pthread_join(threads[t],VXL_NULLPTR);
+  pthread_mutex_destroy(&job.mutex);
+#else
+  (void)n_threads;
+  job.run();
+#endif
+}
@@ -7,6 +7,7 @@
 
 #include <iostream>
 #include <iosfwd>
+#include <vector>
 #include <mbl/mbl_cloneable_ptr.h>
 #include <mfpf/mfpf_point_finder.h>
 #include <vcl_cassert.h>
@@ -28,6 +29,16 @@ class mfpf_mr_point_finder
   //  If zero, then refine all.
   unsigned max_after_pruning_;
 
+  //: True if cached_* members hold the result of the last cached search()
+  bool cache_valid_;
+
+  //: Caller's identifier for the image used in the cached search()
+  unsigned long cached_image_id_;
+
+  //: Start pose, result and fit of the last cached search()
+  mfpf_pose cached_pose0_, cached_best_pose_;
+  double cached_fit_;
+
  public:
 
   //: Dflt ctor
@@ -44,8 +55,9 @@ class mfpf_mr_point_finder
   { assert (L<finders_.size()); return *finders_[L]; }
 
   //: Point finder at level L
+  //  Forgets any cached search result, as the finder may be modified.
   mfpf_point_finder& finder(unsigned L)
-  { assert (L<finders_.size()); return *finders_[L]; }
+  { assert (L<finders_.size()); cache_valid_=false; return *finders_[L]; }
 
   //: Define point finders.  Clone of each taken
   void set(const std::vector<mfpf_point_finder*>& finders);
@@ -60,6 +72,9 @@ class mfpf_mr_point_finder
   void set_max_after_pruning(unsigned max_n);
 
 
+  //: Forget any result cached by search(im_pyr,pose0,best_pose,image_id)
+  void clear_search_cache() { cache_valid_=false; }
+
   //: Select best level for searching around pose with finder \p i
   //  Selects pyramid level with pixel sizes best matching
   //  the model pixel size at given pose.
@@ -83,6 +98,19 @@ class mfpf_mr_point_finder
                 const mfpf_pose& pose0,
                 mfpf_pose& best_pose);
 
+  //: Searches around given pose, re-using the last result if possible.
+  //  As search(im_pyr,pose0,best_pose), but if the previous call was
+  //  made with the same image_id and pose0 its result is returned
+  //  immediately.  In iterative model fitting many points converge early
+  //  and are then searched again from exactly the same pose.
+  //  image_id is supplied by the caller (e.g. a frame number or a counter
+  //  incremented whenever the pyramid is rebuilt or modified) and must
+  //  change whenever the image data changes.
+  double search(const vimt_image_pyramid& im_pyr,
+                const mfpf_pose& pose0,
+                mfpf_pose& best_pose,
+                unsigned long image_id);
+
   //: Searches around given pose, starting at coarsest model.
   //  Searches with finder(L_hi) and feeds best result into
   //  search for next model, until level L_lo.
@@ -144,6 +172,19 @@ class mfpf_mr_point_finder
   virtual void b_read(vsl_b_istream& bfs);
 };
 
+//: Search around poses0[i] with finders[i], for every point i.
+//  Equivalent to calling finders[i].search(im_pyr,poses0[i],poses[i])
+//  for each i, but the points are shared between up to n_threads
+//  threads (if pthreads are available).  The finders must be distinct
+//  objects, as each is modified during its search.
+//  On exit fits[i] is the value returned by search() for point i.
+void mfpf_mr_search_points(std::vector<mfpf_mr_point_finder>& finders,
+                           const vimt_image_pyramid& im_pyr,
+                           const std::vector<mfpf_pose>& poses0,
+                           std::vector<mfpf_pose>& poses,
+                           std::vector<double>& fits,
+                           unsigned n_threads=4);
+
 //: Stream output operator for class reference
 std::ostream& operator<<(std::ostream& os,const mfpf_mr_point_finder& b);
 
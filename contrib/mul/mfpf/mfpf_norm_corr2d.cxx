@@ -1,6 +1,7 @@
 #include <cmath>
 #include <iostream>
 #include <algorithm>
+#include <vector>
 #include "mfpf_norm_corr2d.h"
 //:
 // \file
@@ -140,6 +141,29 @@ void mfpf_norm_corr2d::set_overlap_f(double f)
   overlap_f_=f;
 }
 
+// Dot product of ni x nj block of im1 with im2
+// Assumes element (i,j) is im1[i+j*jstep1] etc
+// Uses four partial sums to allow the compiler to vectorise the inner loop
+inline double block_dot(const float* im1, const double* im2,
+                        std::ptrdiff_t jstep1, std::ptrdiff_t jstep2,
+                        unsigned ni, unsigned nj)
+{
+  double s0=0.0,s1=0.0,s2=0.0,s3=0.0;
+  for (unsigned j=0;j<nj;++j,im1+=jstep1,im2+=jstep2)
+  {
+    unsigned i=0;
+    for (;i+4<=ni;i+=4)
+    {
+      s0+=im1[i]*im2[i];
+      s1+=im1[i+1]*im2[i+1];
+      s2+=im1[i+2]*im2[i+2];
+      s3+=im1[i+3]*im2[i+3];
+    }
+    for (;i<ni;++i) s0+=im1[i]*im2[i];
+  }
+  return (s0+s1)+(s2+s3);
+}
+
 // Assumes im2[i] has zero mean and unit length as a vector
 // Assumes element (i,j) is im1[i+j*jstep1] etc
 inline double norm_corr(const float* im1, const double* im2,
@@ -162,6 +186,86 @@ inline double norm_corr(const float* im1, const double* im2,
   return sum1/s;
 }
 
+//: Normalised correlation of kernel with every position in sample
+//  On exit r(i,j) is norm_corr() of kernel with the block of sample
+//  whose top-left corner is at (i,j), for the (1+sample.ni()-kernel.ni())
+//  by (1+sample.nj()-kernel.nj()) valid positions.
+//  The sums of sample values and squared values over each block are
+//  updated incrementally as the block slides, so only the dot product
+//  with the kernel costs O(kernel size) per position.
+//  The sums are of values less the mean of the whole sample, to limit
+//  cancellation when the block variance is small compared to its mean.
+//  Assumes kernel has zero mean and unit length, and sample.istep()==1
+static void norm_corr_grid(const vil_image_view<float>& sample,
+                           const vil_image_view<double>& kernel,
+                           vil_image_view<double>& r)
+{
+  const unsigned kni=kernel.ni(), knj=kernel.nj();
+  const unsigned sni=sample.ni();
+  const unsigned ni=1+sni-kni, nj=1+sample.nj()-knj;
+  const std::ptrdiff_t s_jstep=sample.jstep(), k_jstep=kernel.jstep();
+  const unsigned n=kni*knj;
+  assert(sample.istep()==1 && kernel.istep()==1);
+
+  r.set_size(ni,nj);
+
+  const float* s = sample.top_left_ptr();
+
+  // Offset subtracted from every value before summing.  As the kernel
+  // has zero mean, the dot products are unaffected by it.
+  double c=0.0;
+  for (unsigned j=0;j<sample.nj();++j)
+  {
+    const float* row = s+j*s_jstep;
+    for (unsigned i=0;i<sni;++i) c+=row[i];
+  }
+  c/=double(sni)*sample.nj();
+
+  // Sums of offset sample values (and squares) down each column of knj rows
+  std::vector<double> col_sum(sni,0.0),col_sq(sni,0.0);
+  for (unsigned j=0;j<knj;++j)
+  {
+    const float* row = s+j*s_jstep;
+    for (unsigned i=0;i<sni;++i)
+    { double x=row[i]-c; col_sum[i]+=x; col_sq[i]+=x*x; }
+  }
+
+  const double* k = kernel.top_left_ptr();
+  for (unsigned j=0;j<nj;++j,s+=s_jstep)
+  {
+    if (j>0)
+    {
+      // Slide column sums down by one row
+      const float* old_row = s-s_jstep;
+      const float* new_row = s+(knj-1)*s_jstep;
+      for (unsigned i=0;i<sni;++i)
+      {
+        double x_new=new_row[i]-c, x_old=old_row[i]-c;
+        col_sum[i]+=x_new-x_old;
+        col_sq[i]+=x_new*x_new-x_old*x_old;
+      }
+    }
+
+    double sum=0.0,sum_sq=0.0;
+    for (unsigned i=0;i<kni;++i) { sum+=col_sum[i]; sum_sq+=col_sq[i]; }
+
+    double* r_row = &r(0,j);
+    for (unsigned i=0;i<ni;++i)
+    {
+      if (i>0)
+      {
+        sum+=col_sum[i+kni-1]-col_sum[i-1];
+        sum_sq+=col_sq[i+kni-1]-col_sq[i-1];
+      }
+      // Rounding in the running sums can leave a tiny negative variance
+      double var = sum_sq-sum*sum/n;
+      if (var<0.0) var=0.0;
+      double ss = std::max(1e-6,var);
+      r_row[i] = block_dot(s+i,k,s_jstep,k_jstep,kni,knj)/std::sqrt(ss);
+    }
+  }
+}
+
 static void normalize(vil_image_view<double>& im)
 {
   unsigned ni=im.ni(),nj=im.nj();
@@ -300,22 +404,11 @@ void mfpf_norm_corr2d::evaluate_region(
                      im_v.x(),im_v.y(),
                      nsi,nsj);
 
-  response.image().set_size(ni,nj);
-  double* r = response.image().top_left_ptr();
-  const double* k = kernel_.top_left_ptr();
-  const float* s = sample.top_left_ptr();
-  std::ptrdiff_t r_jstep = response.image().jstep();
-  std::ptrdiff_t s_jstep = sample.jstep();
-  std::ptrdiff_t k_jstep = kernel_.jstep();
-
-  for (int j=0;j<nj;++j,r+=r_jstep,s+=s_jstep)
-  {
+  norm_corr_grid(sample,kernel_,response.image());
+  vil_image_view<double>& r = response.image();
+  for (int j=0;j<nj;++j)
     for (int i=0;i<ni;++i)
-    {
-      r[i] = 1.0-norm_corr(s+i,k,s_jstep,k_jstep,
-                           kernel_.ni(),kernel_.nj());
-    }
-  }
+      r(i,j) = 1.0-r(i,j);
 
   // Set up transformation parameters
 
@@ -359,20 +452,16 @@ double mfpf_norm_corr2d::search_one_pose(
                      im_v.x(),im_v.y(),
                      nsi,nsj);
 
-  const double* k = kernel_.top_left_ptr();
-  const float* s = sample.top_left_ptr();
-  std::ptrdiff_t s_jstep = sample.jstep();
-  std::ptrdiff_t k_jstep = kernel_.jstep();
+  vil_image_view<double> r;
+  norm_corr_grid(sample,kernel_,r);
 
   double best_r=-9e99;
   int best_i=-1,best_j=-1;
-  for (int j=0;j<nj;++j,s+=s_jstep)
+  for (int j=0;j<nj;++j)
   {
     for (int i=0;i<ni;++i)
     {
-      double r = norm_corr(s+i,k,s_jstep,k_jstep,
-                           kernel_.ni(),kernel_.nj());
-      if (r>best_r) { best_r=r; best_i=i; best_j=j; }
+      if (r(i,j)>best_r) { best_r=r(i,j); best_i=i; best_j=j; }
     }
   }
 
@@ -1,5 +1,7 @@
 // This is mul/mfpf/tests/test_mr_point_finder.cxx
 #include <iostream>
+#include <cmath>
+#include <vector>
 #include <testlib/testlib_test.h>
 //:
 // \file
@@ -87,6 +89,52 @@ void test_mr_point_finder_search(mfpf_mr_point_finder_builder& b,
 
   for (unsigned i=0;i<poses.size();++i)
     std::cout<<i<<") "<<poses[i]<<" fit: "<<fits[i]<<std::endl;
+
+  std::cout<<"Testing cached search."<<std::endl;
+  mfpf_pose serial_pose;
+  double serial_fit = pf.search(image_pyr,pose1,serial_pose);
+  mfpf_pose cache_pose1, cache_pose2;
+  double cache_fit1 = pf.search(image_pyr,pose1,cache_pose1,1);
+  double cache_fit2 = pf.search(image_pyr,pose1,cache_pose2,1);
+  TEST_NEAR("Cached search: same fit",cache_fit1,serial_fit,1e-12);
+  TEST("Cached search: same pose",cache_pose2==cache_pose1 &&
+                                  cache_fit2==cache_fit1,true);
+
+  // A new image id must force a new search.
+  vimt_image_2d_of<float> shifted(100,100);
+  shifted.image().fill(0);
+  for (unsigned i=43;i<=63;++i)
+  {
+    shifted.image()(i,51)=99;
+    shifted.image()(i,55)=99;
+    shifted.image()(51,i)=99;
+    shifted.image()(55,i)=99;
+  }
+  vimt_image_pyramid shifted_pyr;
+  pyr_builder.build(shifted_pyr,shifted);
+  mfpf_pose shifted_pose, shifted_cache_pose;
+  double shifted_fit = pf.search(shifted_pyr,pose1,shifted_pose);
+  double shifted_cache_fit = pf.search(shifted_pyr,pose1,shifted_cache_pose,2);
+  TEST("Cached search: new image id searches again",
+       shifted_cache_pose==shifted_pose && shifted_cache_fit==shifted_fit &&
+       !(shifted_cache_pose==cache_pose1),true);
+
+  std::cout<<"Testing parallel search over points."<<std::endl;
+  std::vector<mfpf_mr_point_finder> finders(5,pf);
+  std::vector<mfpf_pose> poses0(5);
+  for (unsigned i=0;i<5;++i)
+    poses0[i]=mfpf_pose(p1+vgl_vector_2d<double>(0.5*i,-0.3*i),u1);
+  std::vector<mfpf_pose> par_poses;
+  std::vector<double> par_fits;
+  mfpf_mr_search_points(finders,image_pyr,poses0,par_poses,par_fits,3);
+  bool all_same = par_poses.size()==5 && par_fits.size()==5;
+  for (unsigned i=0;i<5 && all_same;++i)
+  {
+    mfpf_pose pose_i;
+    double f = pf.search(image_pyr,poses0[i],pose_i);
+    all_same = (par_poses[i]==pose_i) && std::fabs(par_fits[i]-f)<1e-12;
+  }
+  TEST("Parallel search matches serial search",all_same,true);
 }
 
 void test_mr_point_finder()
@@ -1,5 +1,6 @@
 // This is mul/mfpf/tests/test_norm_corr2d.cxx
 #include <iostream>
+#include <cmath>
 #include <sstream>
 #include <testlib/testlib_test.h>
 //:
@@ -18,6 +19,7 @@
 #include <mfpf/mfpf_norm_corr2d.h>
 #include <mfpf/mfpf_norm_corr2d_builder.h>
 #include <vil/vil_bilin_interp.h>
+#include <vil/vil_math.h>
 #include <vgl/vgl_point_2d.h>
 #include <vgl/vgl_vector_2d.h>
 
@@ -93,6 +95,32 @@ void test_norm_corr2d_search(mfpf_point_finder_builder& b)
   TEST("Local minima 1",r0<r1,true);
   TEST("Local minima 2",r0<r2,true);
 
+  // Fast grid evaluation must agree with point-by-point evaluation
+  vimt_transform_2d i2w = response.world2im().inverse();
+  double max_diff=0.0;
+  for (unsigned j=0;j<response.image().nj();++j)
+    for (unsigned i=0;i<response.image().ni();++i)
+    {
+      double d = response.image()(i,j)-pf->evaluate(image,i2w(i,j),u);
+      if (std::fabs(d)>max_diff) max_diff=std::fabs(d);
+    }
+  TEST_NEAR("Response matches evaluate()",max_diff,0.0,1e-9);
+
+  // Grid evaluation must not lose precision on a large constant background
+  vimt_image_2d_of<float> bright_image;
+  bright_image.deep_copy(image);
+  vil_math_scale_and_offset_values(bright_image.image(),1.0,1e4);
+  vimt_image_2d_of<double> bright_response;
+  pf->evaluate_region(bright_image,p1,u,bright_response);
+  max_diff=0.0;
+  for (unsigned j=0;j<response.image().nj();++j)
+    for (unsigned i=0;i<response.image().ni();++i)
+    {
+      double d = response.image()(i,j)-bright_response.image()(i,j);
+      if (std::fabs(d)>max_diff) max_diff=std::fabs(d);
+    }
+  TEST_NEAR("Response independent of offset",max_diff,0.0,1e-6);
+
   delete pf;
 }
 
@@ -0,0 +1,410 @@
+// This is mul/vil3d/file_formats/vil3d_slice_cache.cxx
+#ifdef VCL_NEEDS_PRAGMA_INTERFACE
+#pragma implementation
+#endif
+//:
+// \file
+// \brief Out-of-core volume made up of 2D slice files, decoded on demand.
+//
+// Thread safety: the prefetch thread only ever decodes slices and hands
+// them over through ready_, under the lock. All insertion into and eviction
+// from the cache is done by the thread calling get_copy_view(), so the
+// (non-atomic) reference counts of cached views are never touched by two
+// threads at once.
+
+#include <iostream>
+#include <algorithm>
+#include "vil3d_slice_cache.h"
+#include <vcl_compiler.h>
+#include <vil/vil_load.h>
+#include <vil/vil_crop.h>
+#include <vil/vil_copy.h>
+#include <vil/vil_image_view.h>
+#include <vil3d/vil3d_image_view.h>
+#include <vil3d/vil3d_slice.h>
+#include <vil3d/file_formats/vil3d_slice_list.h>
+
+vil3d_slice_cache_image::vil3d_slice_cache_image(const std::vector<std::string>& filenames,
+                                                 unsigned max_cached_slices)
+  : filenames_(filenames), ni_(0), nj_(0), nk_(0), nplanes_(0),
+    format_(VIL_PIXEL_FORMAT_UNKNOWN),
+    max_cached_(max_cached_slices>0 ? max_cached_slices : 1), prefetch_(0),
+    last_k0_(-1), n_decoded_(0)
+{
+#if VXL_HAS_PTHREAD_H
+  pthread_mutex_init(&mutex_, VXL_NULLPTR);
+  pthread_cond_init(&cond_, VXL_NULLPTR);
+  thread_running_ = false;
+  stop_thread_ = false;
+#endif
+  loading_ = -1;
+
+  if (filenames_.empty()) return;
+
+  // Only the header of the first slice is needed to describe the volume.
+  first_ = vil_load_image_resource(filenames_.front().c_str());
+  if (!first_) return;
+
+  ni_ = first_->ni();
+  nj_ = first_->nj();
+  nplanes_ = first_->nplanes();
+  format_ = first_->pixel_format();
+  if (first_->file_format()) file_format_ = first_->file_format();
+  nk_ = (unsigned)(filenames_.size());
+}
+
+vil3d_slice_cache_image::~vil3d_slice_cache_image()
+{
+#if VXL_HAS_PTHREAD_H
+  stop_prefetch_thread();
+  pthread_cond_destroy(&cond_);
+  pthread_mutex_destroy(&mutex_);
+#endif
+}
+
+void vil3d_slice_cache_image::lock() const
+{
+#if VXL_HAS_PTHREAD_H
+  pthread_mutex_lock(&mutex_);
+#endif
+}
+
+void vil3d_slice_cache_image::unlock() const
+{
+#if VXL_HAS_PTHREAD_H
+  pthread_mutex_unlock(&mutex_);
+#endif
+}
+
+char const* vil3d_slice_cache_image::file_format() const
+{
+  return file_format_.empty() ? "slice_list" : file_format_.c_str();
+}
+
+//: Get the properties (of the first slice)
+bool vil3d_slice_cache_image::get_property(char const *key, void * value) const
+{
+  return first_ ? first_->get_property(key, value) : false;
+}
+
+//: This resource is read-only.
+bool vil3d_slice_cache_image::put_view(const vil3d_image_view_base& /*im*/,
+                                       unsigned /*i0*/, unsigned /*j0*/, unsigned /*k0*/)
+{
+  std::cerr << "ERROR: vil3d_slice_cache_image::put_view - resource is read-only\n";
+  return false;
+}
+
+//: Open and decode slice k without touching the cache.
+vil_image_view_base_sptr vil3d_slice_cache_image::decode_slice(unsigned k) const
+{
+  vil_image_resource_sptr im = k==0 ? first_ :
+    vil_load_image_resource(filenames_[k].c_str());
+  if (!im ||
+      im->nplanes() != nplanes_ || im->ni() != ni_ || im->nj() != nj_ ||
+      im->pixel_format() != format_)
+  {
+    std::cerr << "ERROR: vil3d_slice_cache_image: unable to read slice "
+             << filenames_[k] << " or it does not match the first slice\n";
+    return VXL_NULLPTR;
+  }
+  return im->get_view(0, ni_, 0, nj_);
+}
+
+//: Find slice k in the cache, and mark it as most recently used.
+vil_image_view_base_sptr vil3d_slice_cache_image::find_slice(unsigned k) const
+{
+  // Move any slices finished by the prefetch thread into the cache first.
+  while (!ready_.empty())
+  {
+    cache_entry e = ready_.back();
+    ready_.pop_back();
+    insert_slice(e.k, e.view);
+  }
+
+  for (std::list<cache_entry>::iterator it=cache_.begin(); it!=cache_.end(); ++it)
+    if (it->k == k)
+    {
+      if (it != cache_.begin())
+        cache_.splice(cache_.begin(), cache_, it);
+      return cache_.front().view;
+    }
+  return VXL_NULLPTR;
+}
+
+//: Insert a decoded slice, evicting the least recently used if needed.
+void vil3d_slice_cache_image::insert_slice(unsigned k,
+                                           const vil_image_view_base_sptr& view) const
+{
+  for (std::list<cache_entry>::const_iterator it=cache_.begin(); it!=cache_.end(); ++it)
+    if (it->k == k) return;
+  cache_entry e;
+  e.k = k;
+  e.view = view;
+  cache_.push_front(e);
+  while (cache_.size() > max_cached_)
+    cache_.pop_back();
+}
+
+//: Decoded view of the whole of slice k.
+vil_image_view_base_sptr vil3d_slice_cache_image::slice(unsigned k) const
+{
+  if (k >= nk_) return VXL_NULLPTR;
+
+  lock();
+  vil_image_view_base_sptr view = find_slice(k);
+#if VXL_HAS_PTHREAD_H
+  // If the prefetch thread is decoding this slice, wait for it rather
+  // than decoding it twice.
+  while (!view && loading_ == int(k))
+  {
+    pthread_cond_wait(&cond_, &mutex_);
+    view = find_slice(k);
+  }
+#endif
+  if (view)
+  {
+    unlock();
+    return view;
+  }
+  // No point in the prefetch thread decoding it as well.
+  std::vector<unsigned>::iterator p = std::find(pending_.begin(), pending_.end(), k);
+  if (p != pending_.end()) pending_.erase(p);
+  unlock();
+
+  view = decode_slice(k);
+  if (!view) return VXL_NULLPTR;
+
+  lock();
+  ++n_decoded_;
+  insert_slice(k, view);
+  unlock();
+  return view;
+}
+
+void vil3d_slice_cache_image::set_max_cached_slices(unsigned n)
+{
+  lock();
+  max_cached_ = n>0 ? n : 1;
+  while (cache_.size() > max_cached_)
+    cache_.pop_back();
+  unlock();
+}
+
+unsigned vil3d_slice_cache_image::n_cached_slices() const
+{
+  lock();
+  unsigned n = (unsigned)(cache_.size() + ready_.size());
+  unlock();
+  return n;
+}
+
+unsigned long vil3d_slice_cache_image::n_slices_decoded() const
+{
+  lock();
+  unsigned long n = n_decoded_;
+  unlock();
+  return n;
+}
+
+void vil3d_slice_cache_image::clear_cache()
+{
+  lock();
+  pending_.clear();
+  ready_.clear();
+  cache_.clear();
+  unlock();
+}
+
+//: Queue slices after k_last for background decoding.
+void vil3d_slice_cache_image::request_prefetch(unsigned k_last, unsigned n_in_use) const
+{
+#if VXL_HAS_PTHREAD_H
+  if (prefetch_==0 || !thread_running_) return;
+
+  // Don't read so far ahead that the slices just used are evicted.
+  unsigned n = prefetch_;
+  if (n + n_in_use > max_cached_)
+    n = max_cached_ > n_in_use ? max_cached_ - n_in_use : 0;
+
+  lock();
+  pending_.clear();
+  for (unsigned k=k_last+1; k<=k_last+n && k<nk_; ++k)
+  {
+    if (int(k) == loading_) continue;
+    bool found = false;
+    for (std::list<cache_entry>::const_iterator it=cache_.begin(); it!=cache_.end() && !found; ++it)
+      found = it->k == k;
+    for (unsigned i=0; i<ready_.size() && !found; ++i)
+      found = ready_[i].k == k;
+    if (!found) pending_.push_back(k);
+  }
+  if (!pending_.empty())
+    pthread_cond_broadcast(&cond_);
+  unlock();
+#else
+  (void)k_last; (void)n_in_use;
+#endif
+}
+
+void vil3d_slice_cache_image::set_prefetch(unsigned n)
+{
+#if VXL_HAS_PTHREAD_H
+  if (n==0)
+  {
+    stop_prefetch_thread();
+    prefetch_ = 0;
+    return;
+  }
+  prefetch_ = n;
+  if (!thread_running_ && nk_>0)
+  {
+    stop_thread_ = false;
+    thread_running_ =
+      pthread_create(&thread_, VXL_NULLPTR, prefetch_thread, this) == 0;
+    if (!thread_running_)
+    {
+      std::cerr << "WARNING: vil3d_slice_cache_image::set_prefetch"
+               << " unable to start thread - no read-ahead\n";
+      prefetch_ = 0;
+    }
+  }
+#else
+  (void)n;
+#endif
+}
+
+#if VXL_HAS_PTHREAD_H
+
+void* vil3d_slice_cache_image::prefetch_thread(void* arg)
+{
+  static_cast<vil3d_slice_cache_image*>(arg)->run_prefetch();
+  return VXL_NULLPTR;
+}
+
+void vil3d_slice_cache_image::run_prefetch()
+{
+  pthread_mutex_lock(&mutex_);
+  while (!stop_thread_)
+  {
+    if (pending_.empty())
+    {
+      pthread_cond_wait(&cond_, &mutex_);
+      continue;
+    }
+    unsigned k = pending_.front();
+    pending_.erase(pending_.begin());
+    loading_ = int(k);
+    pthread_mutex_unlock(&mutex_);
+
+    cache_entry e;
+    e.k = k;
+    e.view = decode_slice(k);
+
+    pthread_mutex_lock(&mutex_);
+    loading_ = -1;
+    if (e.view)
+    {
+      ++n_decoded_;
+      // Hand over to the reader thread. Our reference is released while
+      // still holding the lock.
+      ready_.push_back(e);
+      e.view = VXL_NULLPTR;
+    }
+    pthread_cond_broadcast(&cond_);
+  }
+  pthread_mutex_unlock(&mutex_);
+}
+
+void vil3d_slice_cache_image::stop_prefetch_thread()
+{
+  if (!thread_running_) return;
+  pthread_mutex_lock(&mutex_);
+  stop_thread_ = true;
+  pending_.clear();
+  pthread_cond_broadcast(&cond_);
+  pthread_mutex_unlock(&mutex_);
+  pthread_join(thread_, VXL_NULLPTR);
+  thread_running_ = false;
+}
+
+#endif // VXL_HAS_PTHREAD_H
+
+
+//: Copy a block of the volume, slice by slice, from the cache.
+template <class T>
+static vil3d_image_view_base_sptr vil3d_slice_cache_copy(const vil3d_slice_cache_image& im,
+                                                         unsigned i0, unsigned ni,
+                                                         unsigned j0, unsigned nj,
+                                                         unsigned k0, unsigned nk)
+{
+  vil3d_image_view<T> vv(ni, nj, nk, im.nplanes());
+  for (unsigned k=0; k<nk; ++k)
+  {
+    vil_image_view_base_sptr s = im.slice(k+k0);
+    if (!s) return VXL_NULLPTR;
+    vil_image_view<T> src = vil_crop(vil_image_view<T>(s), i0, ni, j0, nj);
+    vil_image_view<T> dest(vil3d_slice_ij(vv, k));
+    vil_copy_reformat(src, dest);
+  }
+  return new vil3d_image_view<T>(vv);
+}
+
+//: Get some or all of the volume.
+vil3d_image_view_base_sptr
+vil3d_slice_cache_image::get_copy_view(unsigned i0, unsigned ni,
+                                       unsigned j0, unsigned nj,
+                                       unsigned k0, unsigned nk) const
+{
+  if (i0+ni > ni_ || j0+nj > nj_ || k0+nk > nk_ || nk==0) return VXL_NULLPTR;
+
+  vil3d_image_view_base_sptr result;
+  switch (format_)
+  {
+#define macro( F , T ) \
+  case F : result = vil3d_slice_cache_copy<T >(*this, i0, ni, j0, nj, k0, nk); break;
+macro(VIL_PIXEL_FORMAT_BYTE, vxl_byte )
+macro(VIL_PIXEL_FORMAT_SBYTE , vxl_sbyte )
+macro(VIL_PIXEL_FORMAT_UINT_32 , vxl_uint_32 )
+macro(VIL_PIXEL_FORMAT_UINT_16 , vxl_uint_16 )
+macro(VIL_PIXEL_FORMAT_INT_32 , vxl_int_32 )
+macro(VIL_PIXEL_FORMAT_INT_16 , vxl_int_16 )
+macro(VIL_PIXEL_FORMAT_FLOAT , float )
+macro(VIL_PIXEL_FORMAT_DOUBLE , double )
+#undef macro
+  default:
+    std::cerr<< "ERROR: vil3d_slice_cache_image::get_copy_view\n"
+            << "       Can't deal with pixel_format " << format_ << '\n';
+    return VXL_NULLPTR;
+  }
+
+  // Read ahead if the caller appears to be scanning along k.
+  lock();
+  bool scanning = int(k0) > last_k0_;
+  last_k0_ = int(k0);
+  unlock();
+  if (result && scanning)
+    request_prefetch(k0+nk-1, nk);
+
+  return result;
+}
+
+
+vil3d_image_resource_sptr
+vil3d_slice_cache_volume(const std::vector<std::string>& filenames,
+                         unsigned max_cached_slices)
+{
+  vil3d_slice_cache_image* im =
+    new vil3d_slice_cache_image(filenames, max_cached_slices);
+  vil3d_image_resource_sptr sptr = im;
+  if (!im->is_valid()) return VXL_NULLPTR;
+  return sptr;
+}
+
+vil3d_image_resource_sptr
+vil3d_slice_cache_volume(const char* filename, unsigned max_cached_slices)
+{
+  std::vector<std::string> filenames;
+  if (!vil3d_slice_list_filenames(filename, filenames)) return VXL_NULLPTR;
+  return vil3d_slice_cache_volume(filenames, max_cached_slices);
+}
@@ -0,0 +1,212 @@
+// This is mul/vil3d/file_formats/vil3d_slice_cache.h
+#ifndef vil3d_slice_cache_h_
+#define vil3d_slice_cache_h_
+#ifdef VCL_NEEDS_PRAGMA_INTERFACE
+#pragma interface
+#endif
+//:
+// \file
+// \brief Out-of-core volume made up of 2D slice files, decoded on demand.
+//
+// vil3d_slice_list_image opens every slice of a series when it is created,
+// and keeps all the slice resources for the lifetime of the volume.
+// For very long series (thousands of CT or microscopy slices) this
+// exhausts both file handles and memory. A vil3d_slice_cache_image only
+// remembers the slice filenames. Each slice is opened and decoded the first
+// time a get_copy_view() touches it, and is then held in a bounded
+// least-recently-used cache of decoded slices.
+//
+// Optionally, when the volume is being scanned along k, a background
+// thread can decode the next few slices ahead of the reader.
+//
+// vil3d_load() only returns one of these for a slice list if
+// vil3d_slice_list_format::set_slice_cache_size() has been called.
+// There is no DICOM-specific handling: properties such as voxel size are
+// those of the first slice, so DICOM series loaded through vil3d_load()
+// still use vil3d_dicom_image.
+
+#include <string>
+#include <vector>
+#include <list>
+#include <vcl_compiler.h>
+#include <vxl_config.h>
+#include <vil/vil_image_view_base.h>
+#include <vil/vil_image_resource.h>
+#include <vil3d/vil3d_image_resource.h>
+
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
+
+//: A read-only volume whose slices are decoded lazily into a bounded cache.
+// Use vil3d_slice_cache_volume() to create one.
+//
+// All slices must have the same size, number of planes and pixel format.
+// Only the first slice is opened when the volume is created; a slice that
+// turns out not to match is reported when it is first read.
+class vil3d_slice_cache_image: public vil3d_image_resource
+{
+ public:
+  //: Construct from the filenames of the slices, in k order.
+  // At most max_cached_slices decoded slices will be held in memory.
+  vil3d_slice_cache_image(const std::vector<std::string>& filenames,
+                          unsigned max_cached_slices=32);
+
+  virtual ~vil3d_slice_cache_image();
+
+  //: True if the first slice could be opened.
+  bool is_valid() const { return nk_>0; }
+
+  //: Dimensions:  nplanes x ni x nj x nk.
+  // This concept is treated as a synonym to components.
+  virtual unsigned nplanes() const { return nplanes_; }
+  //: Dimensions:  nplanes x ni x nj x nk.
+  // The number of pixels in each row.
+  virtual unsigned ni() const { return ni_; }
+  //: Dimensions:  nplanes x ni x nj x nk.
+  // The number of pixels in each column.
+  virtual unsigned nj() const { return nj_; }
+  //: Dimensions:  nplanes x ni x nj x nk.
+  // The number of slices per image.
+  virtual unsigned nk() const { return nk_; }
+
+  //: Pixel Format.
+  virtual enum vil_pixel_format pixel_format() const { return format_; }
+
+  //: Create a read/write view of a copy of this data.
+  // Only slices k0 to k0+nk-1 are decoded (or taken from the cache).
+  // \return 0 if unable to get view of correct size, or if a slice
+  // cannot be read.
+  virtual vil3d_image_view_base_sptr get_copy_view(unsigned i0, unsigned ni,
+                                                   unsigned j0, unsigned nj,
+                                                   unsigned k0, unsigned nk) const;
+
+  //: This resource is read-only.
+  // \return false always.
+  virtual bool put_view(const vil3d_image_view_base& im,
+                        unsigned i0, unsigned j0, unsigned k0);
+
+  //: Return a string describing the file format.
+  // This is the format of the first slice, e.g. "dicom".
+  virtual char const* file_format() const;
+
+  //: Extra property information
+  // This will just return the property of the first slice in the list.
+  virtual bool get_property(char const* tag, void* property_value = 0) const;
+
+  //: Decoded view of the whole of slice k.
+  // Loads the slice into the cache if it is not already there.
+  // \return 0 if the slice cannot be read, or does not match the first slice.
+  vil_image_view_base_sptr slice(unsigned k) const;
+
+  //: Set the maximum number of decoded slices held in memory.
+  // Must be at least 1.
+  void set_max_cached_slices(unsigned n);
+
+  //: Maximum number of decoded slices held in memory.
+  unsigned max_cached_slices() const { return max_cached_; }
+
+  //: Number of decoded slices currently held in memory.
+  unsigned n_cached_slices() const;
+
+  //: Number of slices which have been decoded so far (including re-decodes).
+  unsigned long n_slices_decoded() const;
+
+  //: Decode up to n slices beyond the last slice requested, in a background thread.
+  // Read-ahead only happens while get_copy_view() is being called with
+  // increasing k0, i.e. when the volume is being scanned along k.
+  // n is clamped so that the read-ahead never evicts the slices just read.
+  // Setting n=0 (the default) stops the background thread.
+  // If threads are not available, this has no effect.
+  void set_prefetch(unsigned n);
+
+  //: Number of slices decoded ahead of the reader.
+  unsigned prefetch() const { return prefetch_; }
+
+  //: Remove all decoded slices from the cache.
+  void clear_cache();
+
+ private:
+  struct cache_entry
+  {
+    unsigned k;
+    vil_image_view_base_sptr view;
+  };
+
+  //: Open and decode slice k without touching the cache.
+  vil_image_view_base_sptr decode_slice(unsigned k) const;
+
+  //: Insert a decoded slice, evicting the least recently used if needed.
+  // Caller must hold the lock.
+  void insert_slice(unsigned k, const vil_image_view_base_sptr& view) const;
+
+  //: Find slice k in the cache, and mark it as most recently used.
+  // Also moves any slices decoded by the prefetch thread into the cache.
+  // Caller must hold the lock.
+  vil_image_view_base_sptr find_slice(unsigned k) const;
+
+  //: Queue slices after k_last for background decoding.
+  // n_in_use is the number of slices just read, which must not be evicted.
+  void request_prefetch(unsigned k_last, unsigned n_in_use) const;
+
+  void lock() const;
+  void unlock() const;
+
+  std::vector<std::string> filenames_;
+  unsigned ni_, nj_, nk_, nplanes_;
+  vil_pixel_format format_;
+  std::string file_format_;
+
+  //: First slice resource, kept open for properties.
+  vil_image_resource_sptr first_;
+
+  unsigned max_cached_;
+  unsigned prefetch_;
+
+  //: Decoded slices, most recently used at the front.
+  mutable std::list<cache_entry> cache_;
+  //: Slice indices queued for the prefetch thread.
+  mutable std::vector<unsigned> pending_;
+  //: Slice being decoded by the prefetch thread, or -1.
+  mutable int loading_;
+  //: Slices decoded by the prefetch thread, not yet moved into cache_.
+  mutable std::vector<cache_entry> ready_;
+  //: k0 of the last call to get_copy_view. Guarded by the lock.
+  mutable int last_k0_;
+  mutable unsigned long n_decoded_;
+
+#if VXL_HAS_PTHREAD_H
+  static void* prefetch_thread(void* arg);
+  void run_prefetch();
+  void stop_prefetch_thread();
+
+  mutable pthread_mutex_t mutex_;
+  //: Signalled when work is queued, a slice arrives, or the thread should exit.
+  mutable pthread_cond_t cond_;
+  pthread_t thread_;
+  bool thread_running_;
+  bool stop_thread_;
+#endif
+
+  // Disallow copying.
+  vil3d_slice_cache_image(const vil3d_slice_cache_image&);
+  vil3d_slice_cache_image& operator=(const vil3d_slice_cache_image&);
+};
+
+
+//: Create an out-of-core volume from a list of slice filenames.
+// No slice other than the first is opened until it is needed.
+// \return null pointer if the list is empty or the first slice can't be opened.
+vil3d_image_resource_sptr
+vil3d_slice_cache_volume(const std::vector<std::string>& filenames,
+                         unsigned max_cached_slices=32);
+
+//: Create an out-of-core volume from a slice_list filename specification.
+// The filename may be a ';' delimited list of files, or a single filename
+// in which '#' characters represent a contiguously numbered sequence,
+// as accepted by vil3d_slice_list_format.
+// \return null pointer if no matching files are found.
+vil3d_image_resource_sptr
+vil3d_slice_cache_volume(const char* filename, unsigned max_cached_slices=32);
+
+#endif // vil3d_slice_cache_h_
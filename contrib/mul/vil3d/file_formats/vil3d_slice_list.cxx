@@ -16,6 +16,19 @@
 #include <vil3d/vil3d_image_view.h>
 #include <vil3d/vil3d_slice.h>
 #include <vil3d/file_formats/vil3d_dicom.h>
+#include <vil3d/file_formats/vil3d_slice_cache.h>
+
+static unsigned vil3d_slice_list_cache_size = 0;
+
+void vil3d_slice_list_format::set_slice_cache_size(unsigned n)
+{
+  vil3d_slice_list_cache_size = n;
+}
+
+unsigned vil3d_slice_list_format::slice_cache_size()
+{
+  return vil3d_slice_list_cache_size;
+}
 
 vil3d_slice_list_format::vil3d_slice_list_format() {}
 
@@ -89,10 +102,10 @@ void parse_multiple_filenames(const std::string & input,
   filenames.push_back(input.substr(start, input.size() - start));
 }
 
-vil3d_image_resource_sptr
-vil3d_slice_list_format::make_input_image(const char * filename) const
+//: Expand a slice list filename specification into a list of slice filenames.
+bool vil3d_slice_list_filenames(const char * filename,
+                                std::vector<std::string> &filenames)
 {
-  std::vector<std::string> filenames;
   parse_multiple_filenames(filename, filenames);
 
   for (unsigned i=0; i<filenames.size(); ++i)
@@ -106,7 +119,23 @@ vil3d_slice_list_format::make_input_image(const char * filename) const
   if (filenames.empty() || filenames.size()==1)
     parse_globbed_filenames(filename, filenames);
 
-  if (filenames.empty()) return VXL_NULLPTR;
+  return !filenames.empty();
+}
+
+vil3d_image_resource_sptr
+vil3d_slice_list_format::make_input_image(const char * filename) const
+{
+  std::vector<std::string> filenames;
+  if (!vil3d_slice_list_filenames(filename, filenames)) return VXL_NULLPTR;
+
+  // Decode slices on demand, unless this is a DICOM series.
+  if (vil3d_slice_list_cache_size>0)
+  {
+    vil_image_resource_sptr first = vil_load_image_resource(filenames.front().c_str());
+    if (!first) return VXL_NULLPTR;
+    if (std::strcmp("dicom", first->file_format())!=0)
+      return vil3d_slice_cache_volume(filenames, vil3d_slice_list_cache_size);
+  }
 
   // load all the slices
   std::vector<vil_image_resource_sptr> images(filenames.size());
@@ -10,6 +10,7 @@
 
 #include <iostream>
 #include <vector>
+#include <string>
 #include <vcl_compiler.h>
 #include <vil3d/vil3d_file_format.h>
 #include <vil3d/vil3d_image_resource.h>
@@ -41,9 +42,28 @@ class vil3d_slice_list_format : public vil3d_file_format
 
   //: default filename tag for this image.
   virtual const char * tag() const {return "slice_list";}
+
+  //: Load long series lazily through a vil3d_slice_cache_image.
+  // If n>0, make_input_image() returns a vil3d_slice_cache_image holding at
+  // most n decoded slices, rather than opening every slice up front.
+  // DICOM series are still loaded in full as a vil3d_dicom_image, since
+  // the volume's voxel size and origin are derived from all the slice headers.
+  // n=0 (the default) always opens every slice.
+  static void set_slice_cache_size(unsigned n);
+
+  //: Maximum number of decoded slices used for lazily loaded series, or 0.
+  static unsigned slice_cache_size();
 };
 
 
+//: Expand a slice list filename specification into a list of slice filenames.
+// The specification can be a list of ';' delimited filenames, or a
+// single filename where '#' represents a numeric character, as accepted
+// by vil3d_slice_list_format.
+// \return false if no matching files were found.
+bool vil3d_slice_list_filenames(const char* filename,
+                                std::vector<std::string>& filenames);
+
 //: Create a volume from a list of matching 2D slices.
 // If the slices do not match (in size, type etc) a null ptr will
 // be returned.
@@ -16,6 +16,7 @@ DECLARE( test_analyze_format );
 DECLARE( test_reflect );
 DECLARE( test_image_resource );
 DECLARE( test_tricub_interp );
+DECLARE( test_slice_cache );
 
 DECLARE( test_algo_gauss_reduce );
 DECLARE( test_algo_threshold );
@@ -58,6 +59,7 @@ register_tests()
   REGISTER( test_analyze_format );
   REGISTER( test_reflect );
   REGISTER( test_tricub_interp );
+  REGISTER( test_slice_cache );
 
   REGISTER( test_algo_gauss_reduce );
   REGISTER( test_algo_threshold );
@@ -34,6 +34,7 @@
 #include <vil3d/file_formats/vil3d_gen_synthetic.h>
 #include <vil3d/file_formats/vil3d_gipl_format.h>
 #include <vil3d/file_formats/vil3d_slice_list.h>
+#include <vil3d/file_formats/vil3d_slice_cache.h>
 #include <vil3d/file_formats/vil3d_meta_image_format.h>
 
 #include <vil3d/vil3d_fwd.h>
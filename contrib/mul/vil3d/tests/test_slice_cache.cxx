@@ -0,0 +1,123 @@
+// This is mul/vil3d/tests/test_slice_cache.cxx
+#include <string>
+#include <vector>
+#include <iostream>
+#include <sstream>
+#include <testlib/testlib_test.h>
+//:
+// \file
+// \brief Tests for vil3d_slice_cache_image
+
+#include <vcl_compiler.h>
+#include <vxl_config.h> // for vxl_byte
+#include <vul/vul_file.h>
+#include <vul/vul_temp_filename.h>
+#include <vpl/vpl.h> // vpl_unlink()
+#include <vil/vil_image_view.h>
+#include <vil/vil_save.h>
+#include <vil3d/vil3d_image_view.h>
+#include <vil3d/vil3d_load.h>
+#include <vil3d/file_formats/vil3d_slice_list.h>
+#include <vil3d/file_formats/vil3d_slice_cache.h>
+
+static bool check_block(const vil3d_image_view<vxl_byte>& v,
+                        unsigned i0, unsigned j0, unsigned k0)
+{
+  for (unsigned k=0; k<v.nk(); ++k)
+    for (unsigned j=0; j<v.nj(); ++j)
+      for (unsigned i=0; i<v.ni(); ++i)
+        if (v(i,j,k) != vxl_byte(10*(k+k0) + (i+i0) + 2*(j+j0)))
+          return false;
+  return true;
+}
+
+static void test_slice_cache()
+{
+  std::cout << "**********************************\n"
+           << " Testing vil3d_slice_cache_image\n"
+           << "**********************************\n";
+
+  const unsigned ni=7, nj=5, nk=9;
+  std::string dir = vul_temp_filename();
+  vul_file::make_directory(dir);
+
+  std::vector<std::string> filenames;
+  for (unsigned k=0; k<nk; ++k)
+  {
+    vil_image_view<vxl_byte> slice(ni, nj);
+    for (unsigned j=0; j<nj; ++j)
+      for (unsigned i=0; i<ni; ++i)
+        slice(i,j) = vxl_byte(10*k + i + 2*j);
+    std::ostringstream ss;
+    ss << dir << "/slice" << k << ".pgm";
+    filenames.push_back(ss.str());
+    vil_save(slice, filenames.back().c_str());
+  }
+
+  vil3d_image_resource_sptr res = vil3d_slice_cache_volume(filenames, 3);
+  TEST("Created volume", !res, false);
+  if (!res) return;
+  vil3d_slice_cache_image& cache = static_cast<vil3d_slice_cache_image&>(*res);
+
+  TEST("Size", res->ni()==ni && res->nj()==nj && res->nk()==nk && res->nplanes()==1, true);
+  TEST("Pixel format", res->pixel_format(), VIL_PIXEL_FORMAT_BYTE);
+  TEST("Nothing decoded on creation", cache.n_slices_decoded(), 0);
+
+  vil3d_image_view<vxl_byte> v = res->get_copy_view(1,4, 2,3, 4,2);
+  TEST("Sub-volume size", v.ni()==4 && v.nj()==3 && v.nk()==2, true);
+  TEST("Sub-volume values", check_block(v, 1,2,4), true);
+  TEST("Only requested slices decoded", cache.n_slices_decoded(), 2);
+
+  v = res->get_copy_view(0,ni, 0,nj, 5,1);
+  TEST("Cached slice reused", cache.n_slices_decoded(), 2);
+  TEST("Cached slice values", check_block(v, 0,0,5), true);
+
+  v = res->get_view();
+  TEST("Whole volume values", v && check_block(v, 0,0,0), true);
+  TEST("Cache is bounded", cache.n_cached_slices(), 3);
+
+  TEST("Out of range request fails", !res->get_copy_view(0,ni, 0,nj, nk-1,2), true);
+
+  // Scan along k with read-ahead.
+  cache.clear_cache();
+  cache.set_max_cached_slices(4);
+  cache.set_prefetch(2);
+  bool scan_ok = true;
+  for (unsigned k=0; k<nk; ++k)
+  {
+    vil3d_image_view<vxl_byte> s = res->get_copy_view(0,ni, 0,nj, k,1);
+    scan_ok = scan_ok && s && check_block(s, 0,0,k);
+  }
+  TEST("Scan with prefetch", scan_ok, true);
+  TEST("Cache bounded while prefetching", cache.n_cached_slices()<=4, true);
+  cache.set_prefetch(0);
+
+  vil3d_image_resource_sptr res2 =
+    vil3d_slice_cache_volume((dir + "/slice#.pgm").c_str(), 2);
+  TEST("Created from '#' filename", res2 && res2->nk()==nk, true);
+  if (res2)
+  {
+    v = res2->get_copy_view(2,3, 0,nj, 3,4);
+    TEST("Values from '#' filename", v && check_block(v, 2,0,3), true);
+  }
+
+  vil3d_slice_list_format::set_slice_cache_size(2);
+  vil3d_image_resource_sptr res3 = vil3d_load_image_resource((dir + "/slice#.pgm").c_str());
+  vil3d_slice_list_format::set_slice_cache_size(0);
+  TEST("vil3d_load gives a slice cache", res3 &&
+       dynamic_cast<vil3d_slice_cache_image*>(res3.ptr())!=VXL_NULLPTR, true);
+  if (res3)
+  {
+    v = res3->get_copy_view(0,ni, 1,3, 6,3);
+    TEST("Values from vil3d_load", v && check_block(v, 0,1,6), true);
+  }
+
+  res = VXL_NULLPTR;
+  res2 = VXL_NULLPTR;
+  res3 = VXL_NULLPTR;
+  for (unsigned k=0; k<nk; ++k)
+    vpl_unlink(filenames[k].c_str());
+  vpl_rmdir(dir.c_str());
+}
+
+TESTMAIN(test_slice_cache);
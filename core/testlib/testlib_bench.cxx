@@ -0,0 +1,442 @@
+// This is core/testlib/testlib_bench.cxx
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <utility>
+#include "testlib_bench.h"
+//:
+// \file
+
+#include <vcl_compiler.h>
+#if defined(_WIN32)
+# include <windows.h>
+#else
+# include <vcl_sys/time.h>
+#endif
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+# include <intrin.h>
+#endif
+
+//: Largest number of iterations in a sample, in case the kernel has been optimised away.
+static const vxl_uint_64 testlib_bench_max_batch = vxl_uint_64(1) << 32;
+
+typedef std::vector<std::pair<std::string, testlib_bench_function> > testlib_bench_list;
+
+static testlib_bench_list& testlib_bench_registry()
+{
+  static testlib_bench_list list;
+  return list;
+}
+
+void testlib_bench_register(std::string const& name, testlib_bench_function f)
+{
+  testlib_bench_registry().push_back(std::make_pair(name, f));
+}
+
+static void const* volatile testlib_bench_sink = VXL_NULLPTR;
+
+void testlib_bench_keep(void const* p)
+{
+  testlib_bench_sink = p;
+}
+
+double testlib_bench_now()
+{
+#if defined(_WIN32)
+  LARGE_INTEGER count, frequency;
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&frequency);
+  return double(count.QuadPart) / double(frequency.QuadPart);
+#elif defined(CLOCK_MONOTONIC)
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return double(t.tv_sec) + 1e-9*double(t.tv_nsec);
+#else
+  struct timeval t;
+  gettimeofday(&t, VXL_NULLPTR);
+  return double(t.tv_sec) + 1e-6*double(t.tv_usec);
+#endif
+}
+
+vxl_uint_64 testlib_bench_ticks()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  unsigned int lo, hi;
+  __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+  return (vxl_uint_64(hi) << 32) | lo;
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+//=============================================================================
+
+testlib_bench_state::testlib_bench_state(testlib_bench_options const& options)
+  : options_(options), phase_(START), batch_(1), left_(0), samples_left_(0),
+    start_time_(0.0), start_ticks_(0), items_(0.0)
+{
+}
+
+bool testlib_bench_state::next_sample()
+{
+  const double elapsed = testlib_bench_now() - start_time_;
+  const vxl_uint_64 ticks = testlib_bench_ticks() - start_ticks_;
+  switch (phase_)
+  {
+   case START:
+    phase_ = CALIBRATE;
+    batch_ = 1;
+    break;
+   case CALIBRATE:
+    if (elapsed < options_.min_sample_time && batch_ < testlib_bench_max_batch)
+    {
+      // aim a little over the least time, growing by 2 to 10 times at once
+      double scale = elapsed > 0.0 ? 1.2*options_.min_sample_time/elapsed : 10.0;
+      scale = std::min(10.0, std::max(2.0, scale));
+      batch_ = std::min(testlib_bench_max_batch, vxl_uint_64(double(batch_)*scale));
+    }
+    else if (options_.warmup > 0)
+    {
+      phase_ = WARMUP;
+      samples_left_ = options_.warmup;
+    }
+    else
+    {
+      phase_ = TIMED;
+      samples_left_ = options_.repetitions;
+    }
+    break;
+   case WARMUP:
+    if (--samples_left_ == 0)
+    {
+      phase_ = TIMED;
+      samples_left_ = options_.repetitions;
+    }
+    break;
+   case TIMED:
+    times_.push_back(elapsed/double(batch_));
+    ticks_.push_back(double(ticks)/double(batch_));
+    --samples_left_;
+    break;
+   case DONE:
+    break;
+  }
+  if (phase_ == TIMED && samples_left_ == 0)
+    phase_ = DONE;
+  if (phase_ == DONE)
+    return false;
+
+  left_ = batch_ - 1;
+  start_ticks_ = testlib_bench_ticks();
+  start_time_ = testlib_bench_now();
+  return true;
+}
+
+//: Median of v, which is sorted.
+static double testlib_bench_median(std::vector<double> const& v)
+{
+  const std::size_t n = v.size();
+  if (n == 0) return 0.0;
+  return n%2 ? v[n/2] : 0.5*(v[n/2-1] + v[n/2]);
+}
+
+testlib_bench_result testlib_bench_state::result(std::string const& name) const
+{
+  testlib_bench_result r;
+  r.name = name;
+  r.iterations = batch_;
+  r.samples = static_cast<unsigned>(times_.size());
+  if (times_.empty())
+    return r;
+
+  std::vector<double> t(times_);
+  std::sort(t.begin(), t.end());
+  r.min = t.front();
+  r.max = t.back();
+  r.median = testlib_bench_median(t);
+  double sum = 0.0;
+  for (unsigned i = 0; i < t.size(); ++i) sum += t[i];
+  r.mean = sum / t.size();
+  if (t.size() > 1)
+  {
+    double ss = 0.0;
+    for (unsigned i = 0; i < t.size(); ++i) ss += (t[i]-r.mean)*(t[i]-r.mean);
+    r.stddev = std::sqrt(ss / (t.size()-1));
+  }
+
+  std::vector<double> c(ticks_);
+  std::sort(c.begin(), c.end());
+  r.cycles = testlib_bench_median(c);
+  if (items_ > 0.0 && r.median > 0.0)
+    r.items_per_second = items_ / r.median;
+  return r;
+}
+
+//=============================================================================
+
+testlib_bench_result testlib_bench_run(std::string const& name, testlib_bench_function f,
+                                       testlib_bench_options const& options)
+{
+  testlib_bench_state state(options);
+  f(state);
+  return state.result(name);
+}
+
+void testlib_bench_run_all(testlib_bench_options const& options,
+                           std::vector<testlib_bench_result>& results)
+{
+  testlib_bench_list const& list = testlib_bench_registry();
+  results.clear();
+  for (unsigned i = 0; i < list.size(); ++i)
+    if (list[i].first.find(options.filter) != std::string::npos)
+      results.push_back(testlib_bench_run(list[i].first, list[i].second, options));
+}
+
+//: Seconds in the most readable unit.
+static std::string testlib_bench_format_time(double s)
+{
+  std::ostringstream os;
+  os << std::fixed << std::setprecision(2);
+  if (s < 1e-6)      os << s*1e9 << " ns";
+  else if (s < 1e-3) os << s*1e6 << " us";
+  else if (s < 1.0)  os << s*1e3 << " ms";
+  else               os << s << " s";
+  return os.str();
+}
+
+void testlib_bench_write_table(std::ostream& os, std::vector<testlib_bench_result> const& results)
+{
+  std::size_t width = 9;
+  for (unsigned i = 0; i < results.size(); ++i)
+    width = std::max(width, results[i].name.size());
+  os << std::left << std::setw(int(width)) << "benchmark" << std::right
+     << std::setw(13) << "median" << std::setw(13) << "min"
+     << std::setw(10) << "stddev %" << std::setw(14) << "cycles"
+     << std::setw(14) << "items/s" << '\n';
+  for (unsigned i = 0; i < results.size(); ++i)
+  {
+    testlib_bench_result const& r = results[i];
+    os << std::left << std::setw(int(width)) << r.name << std::right
+       << std::setw(13) << testlib_bench_format_time(r.median)
+       << std::setw(13) << testlib_bench_format_time(r.min)
+       << std::setw(10) << std::fixed << std::setprecision(1)
+       << (r.mean > 0.0 ? 100.0*r.stddev/r.mean : 0.0)
+       << std::setw(14) << std::setprecision(0) << r.cycles
+       << std::setw(14);
+    if (r.items_per_second > 0.0)
+      os << std::scientific << std::setprecision(3) << r.items_per_second << '\n';
+    else
+      os << '-' << '\n';
+    os.unsetf(std::ios::floatfield);
+  }
+  os << std::setprecision(6);
+}
+
+static const char* testlib_bench_csv_header =
+  "name,iterations,samples,min,median,mean,stddev,max,cycles,items_per_second";
+
+void testlib_bench_write_csv(std::ostream& os, std::vector<testlib_bench_result> const& results)
+{
+  std::streamsize precision = os.precision(9);
+  os << testlib_bench_csv_header << '\n';
+  for (unsigned i = 0; i < results.size(); ++i)
+  {
+    testlib_bench_result const& r = results[i];
+    os << r.name << ',' << r.iterations << ',' << r.samples << ','
+       << r.min << ',' << r.median << ',' << r.mean << ',' << r.stddev << ',' << r.max << ','
+       << r.cycles << ',' << r.items_per_second << '\n';
+  }
+  os.precision(precision);
+}
+
+void testlib_bench_write_json(std::ostream& os, std::vector<testlib_bench_result> const& results)
+{
+  std::streamsize precision = os.precision(9);
+  os << "[\n";
+  for (unsigned i = 0; i < results.size(); ++i)
+  {
+    testlib_bench_result const& r = results[i];
+    os << "  { \"name\": \"";
+    for (unsigned c = 0; c < r.name.size(); ++c)
+    {
+      if (r.name[c] == '"' || r.name[c] == '\\') os << '\\';
+      os << r.name[c];
+    }
+    os << "\", \"iterations\": " << r.iterations << ", \"samples\": " << r.samples
+       << ", \"min\": " << r.min << ", \"median\": " << r.median << ", \"mean\": " << r.mean
+       << ", \"stddev\": " << r.stddev << ", \"max\": " << r.max
+       << ", \"cycles\": " << r.cycles << ", \"items_per_second\": " << r.items_per_second
+       << " }" << (i+1 < results.size() ? ",\n" : "\n");
+  }
+  os << "]\n";
+  os.precision(precision);
+}
+
+bool testlib_bench_read_csv(std::istream& is, std::vector<testlib_bench_result>& results)
+{
+  results.clear();
+  std::string line;
+  if (!std::getline(is, line) || line != testlib_bench_csv_header)
+    return false;
+  while (std::getline(is, line))
+  {
+    if (line.empty()) continue;
+    std::replace(line.begin(), line.end(), ',', ' ');
+    std::istringstream fields(line);
+    testlib_bench_result r;
+    fields >> r.name >> r.iterations >> r.samples >> r.min >> r.median >> r.mean
+           >> r.stddev >> r.max >> r.cycles >> r.items_per_second;
+    if (fields.fail())
+      return false;
+    results.push_back(r);
+  }
+  return true;
+}
+
+unsigned testlib_bench_compare(std::vector<testlib_bench_result> const& results,
+                               std::vector<testlib_bench_result> const& baseline,
+                               double tolerance, std::ostream& os)
+{
+  unsigned n_slower = 0;
+  for (unsigned i = 0; i < results.size(); ++i)
+  {
+    testlib_bench_result const& r = results[i];
+    os << r.name << ": ";
+    unsigned b = 0;
+    while (b < baseline.size() && baseline[b].name != r.name) ++b;
+    if (b == baseline.size() || baseline[b].median <= 0.0)
+    {
+      os << "not in baseline\n";
+      continue;
+    }
+    const double ratio = r.median / baseline[b].median;
+    os << testlib_bench_format_time(r.median) << " against "
+       << testlib_bench_format_time(baseline[b].median) << ", ratio "
+       << std::fixed << std::setprecision(3) << ratio;
+    os.unsetf(std::ios::floatfield);
+    os << std::setprecision(6);
+    if (ratio > 1.0 + tolerance)
+    {
+      os << "  SLOWER\n";
+      ++n_slower;
+    }
+    else if (ratio*(1.0 + tolerance) < 1.0)
+      os << "  faster\n";
+    else
+      os << "  ok\n";
+  }
+  return n_slower;
+}
+
+static void testlib_bench_usage(char const* program)
+{
+  std::cerr << "Usage: " << program << " [--filter text] [--list] [--repetitions n] [--warmup n]\n"
+            << "    [--min-time seconds] [--quick] [--csv file] [--json file]\n"
+            << "    [--baseline file] [--tolerance fraction]\n";
+}
+
+int testlib_bench_main(int argc, char* argv[])
+{
+  testlib_bench_options options;
+  std::string csv_file, json_file, baseline_file;
+  double tolerance = 0.1;
+  bool list = false;
+  for (int a = 1; a < argc; ++a)
+  {
+    const std::string arg = argv[a];
+    const bool has_value = a+1 < argc;
+    if (arg == "--list")
+      list = true;
+    else if (arg == "--quick")
+    {
+      options.repetitions = 1;
+      options.warmup = 0;
+      options.min_sample_time = 0.001;
+    }
+    else if (arg == "--filter" && has_value)
+      options.filter = argv[++a];
+    else if (arg == "--repetitions" && has_value)
+      options.repetitions = std::max(1, std::atoi(argv[++a]));
+    else if (arg == "--warmup" && has_value)
+      options.warmup = std::max(0, std::atoi(argv[++a]));
+    else if (arg == "--min-time" && has_value)
+      options.min_sample_time = std::atof(argv[++a]);
+    else if (arg == "--csv" && has_value)
+      csv_file = argv[++a];
+    else if (arg == "--json" && has_value)
+      json_file = argv[++a];
+    else if (arg == "--baseline" && has_value)
+      baseline_file = argv[++a];
+    else if (arg == "--tolerance" && has_value)
+      tolerance = std::atof(argv[++a]);
+    else
+    {
+      testlib_bench_usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (list)
+  {
+    testlib_bench_list const& benchmarks = testlib_bench_registry();
+    for (unsigned i = 0; i < benchmarks.size(); ++i)
+      std::cout << benchmarks[i].first << '\n';
+    return 0;
+  }
+
+  std::vector<testlib_bench_result> baseline;
+  if (!baseline_file.empty())
+  {
+    std::ifstream is(baseline_file.c_str());
+    if (!is || !testlib_bench_read_csv(is, baseline))
+    {
+      std::cerr << "Cannot read baseline " << baseline_file << '\n';
+      return 1;
+    }
+  }
+
+  std::vector<testlib_bench_result> results;
+  testlib_bench_run_all(options, results);
+  testlib_bench_write_table(std::cout, results);
+
+  if (!csv_file.empty())
+  {
+    std::ofstream os(csv_file.c_str());
+    testlib_bench_write_csv(os, results);
+    if (!os)
+    {
+      std::cerr << "Cannot write " << csv_file << '\n';
+      return 1;
+    }
+  }
+  if (!json_file.empty())
+  {
+    std::ofstream os(json_file.c_str());
+    testlib_bench_write_json(os, results);
+    if (!os)
+    {
+      std::cerr << "Cannot write " << json_file << '\n';
+      return 1;
+    }
+  }
+
+  if (!baseline_file.empty())
+  {
+    std::cout << "\nComparison with " << baseline_file << ":\n";
+    unsigned n_slower = testlib_bench_compare(results, baseline, tolerance, std::cout);
+    if (n_slower > 0)
+    {
+      std::cout << n_slower << " benchmark(s) slower than the baseline by more than "
+                << 100.0*tolerance << "%\n";
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,196 @@
+// This is core/testlib/testlib_bench.h
+#ifndef testlib_bench_h_
+#define testlib_bench_h_
+//:
+// \file
+// \brief Micro-benchmarks, with comparison against stored results
+//
+// A benchmark is a function which sets up its data and then runs its
+// kernel for as long as the testlib_bench_state asks:
+// \code
+//   #include <testlib/testlib_bench.h>
+//
+//   static void bench_gauss_reduce(testlib_bench_state& state)
+//   {
+//     vil_image_view<float> src(512, 512), dest, work;
+//     src.fill(1.0f);
+//     state.set_items_per_iteration(512*512);
+//     while (state.run())
+//       vil_gauss_reduce(src, dest, work);
+//   }
+//   TESTLIB_BENCH(bench_gauss_reduce);
+//
+//   TESTLIB_BENCH_MAIN;
+// \endcode
+// The state first finds how many iterations make a sample of at least
+// testlib_bench_options::min_sample_time seconds, runs some untimed
+// warm-up samples, and then times a number of samples.  The times per
+// iteration are summarised by their least, median, mean, standard
+// deviation and greatest values.
+//
+// Alongside the wall-clock time, the ticks of the x86 time-stamp counter
+// are counted where there is one.  On current processors it ticks at a
+// constant rate whatever the clock speed of the core, so counts can be
+// compared between runs on the same machine while the core is being
+// throttled or boosted.  On other processors the count is 0.
+//
+// The program made by TESTLIB_BENCH_MAIN takes the options
+// \verbatim
+//   --filter <text>     run only the benchmarks whose names contain text
+//   --list              list the benchmarks and exit
+//   --repetitions <n>   number of timed samples (10)
+//   --warmup <n>        number of untimed samples after calibration (1)
+//   --min-time <s>      least seconds per sample (0.01)
+//   --quick             one sample of 1ms each, to check the benchmarks run
+//   --csv <file>        write the results as CSV
+//   --json <file>       write the results as JSON
+//   --baseline <file>   compare with results saved by --csv
+//   --tolerance <f>     fraction by which the median may exceed the baseline (0.1)
+// \endverbatim
+// and returns 1 if any benchmark is slower than its baseline.
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <vxl_config.h>
+#include <vcl_compiler.h>
+
+//: Settings of a benchmark run.
+struct testlib_bench_options
+{
+  //: Run only the benchmarks whose names contain this; all if empty.
+  std::string filter;
+  //: Number of timed samples of each benchmark.
+  unsigned repetitions;
+  //: Number of untimed samples run after calibration.
+  unsigned warmup;
+  //: Least duration of a sample, in seconds.
+  double min_sample_time;
+
+  testlib_bench_options() : repetitions(10), warmup(1), min_sample_time(0.01) {}
+};
+
+//: Summary of the timed samples of one benchmark.
+struct testlib_bench_result
+{
+  std::string name;
+  //: Number of iterations in each sample.
+  vxl_uint_64 iterations;
+  //: Number of timed samples.
+  unsigned samples;
+  //: Statistics of the seconds per iteration over the samples.
+  double min, median, mean, stddev, max;
+  //: Median time-stamp counter ticks per iteration, or 0.
+  double cycles;
+  //: Items processed per second at the median time, or 0 if not set.
+  double items_per_second;
+
+  testlib_bench_result()
+    : iterations(0), samples(0), min(0), median(0), mean(0), stddev(0), max(0),
+      cycles(0), items_per_second(0) {}
+};
+
+//: Controls the iterations of a benchmark, and times them.
+class testlib_bench_state
+{
+ public:
+  explicit testlib_bench_state(testlib_bench_options const& options);
+
+  //: True while the benchmark should run its kernel once more.
+  bool run()
+  {
+    if (left_ == 0)
+      return next_sample();
+    --left_;
+    return true;
+  }
+
+  //: Set the number of items, such as pixels, processed by each iteration.
+  void set_items_per_iteration(double n) { items_ = n; }
+
+  //: Summary of the timed samples; valid once run() has returned false.
+  testlib_bench_result result(std::string const& name) const;
+
+ private:
+  //: End the sample just run, if any, and start the next; false when all are done.
+  bool next_sample();
+
+  enum phase_type { START, CALIBRATE, WARMUP, TIMED, DONE };
+
+  testlib_bench_options options_;
+  phase_type phase_;
+  //: Iterations per sample.
+  vxl_uint_64 batch_;
+  //: Iterations left in the current sample.
+  vxl_uint_64 left_;
+  //: Samples left in the current phase.
+  unsigned samples_left_;
+  double start_time_;
+  vxl_uint_64 start_ticks_;
+  double items_;
+  std::vector<double> times_;
+  std::vector<double> ticks_;
+};
+
+typedef void (*testlib_bench_function)(testlib_bench_state&);
+
+//: Add a benchmark to those run by testlib_bench_main().
+void testlib_bench_register(std::string const& name, testlib_bench_function f);
+
+//: Registers a benchmark when constructed; used by TESTLIB_BENCH.
+struct testlib_bench_registrar
+{
+  testlib_bench_registrar(char const* name, testlib_bench_function f)
+  { testlib_bench_register(name, f); }
+};
+
+//: Register function as a benchmark of the same name.
+#define TESTLIB_BENCH(function) \
+  static testlib_bench_registrar function##_bench_registrar(#function, &function)
+
+//: Define main() to run the registered benchmarks.
+#define TESTLIB_BENCH_MAIN \
+  int main(int argc, char* argv[]) { return testlib_bench_main(argc, argv); } \
+  typedef int testlib_bench_main_defined
+
+//: Make the compiler keep the computation of the data at p.
+void testlib_bench_keep(void const* p);
+
+//: Wall-clock time in seconds; only differences are meaningful.
+double testlib_bench_now();
+
+//: Time-stamp counter, or 0 if there is none.
+vxl_uint_64 testlib_bench_ticks();
+
+//: Run one benchmark.
+testlib_bench_result testlib_bench_run(std::string const& name, testlib_bench_function f,
+                                       testlib_bench_options const& options);
+
+//: Run the registered benchmarks chosen by options.filter, in order of registration.
+void testlib_bench_run_all(testlib_bench_options const& options,
+                           std::vector<testlib_bench_result>& results);
+
+//: Write results as a table for people to read.
+void testlib_bench_write_table(std::ostream& os, std::vector<testlib_bench_result> const& results);
+
+//: Write results as CSV, with a header line.
+void testlib_bench_write_csv(std::ostream& os, std::vector<testlib_bench_result> const& results);
+
+//: Write results as a JSON array of objects.
+void testlib_bench_write_json(std::ostream& os, std::vector<testlib_bench_result> const& results);
+
+//: Read results written by testlib_bench_write_csv().
+//  Returns false if the header or a line cannot be read.
+bool testlib_bench_read_csv(std::istream& is, std::vector<testlib_bench_result>& results);
+
+//: Compare median times with a baseline, writing a line about each benchmark to os.
+//  Returns the number of benchmarks whose median exceeds that of the
+//  baseline by more than the fraction tolerance.
+unsigned testlib_bench_compare(std::vector<testlib_bench_result> const& results,
+                               std::vector<testlib_bench_result> const& baseline,
+                               double tolerance, std::ostream& os);
+
+//: Run the registered benchmarks as directed by the command line.
+int testlib_bench_main(int argc, char* argv[]);
+
+#endif // testlib_bench_h_
@@ -0,0 +1,95 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <testlib/testlib_test.h>
+#include <testlib/testlib_bench.h>
+
+#include <vcl_compiler.h>
+
+static unsigned test_bench_calls = 0;
+
+static void test_bench_sum(testlib_bench_state& state)
+{
+  ++test_bench_calls;
+  std::vector<double> v(1000, 1.0);
+  double sum = 0.0;
+  state.set_items_per_iteration(1000);
+  while (state.run())
+  {
+    for (unsigned i = 0; i < v.size(); ++i) sum += v[i];
+    testlib_bench_keep(&sum);
+  }
+}
+TESTLIB_BENCH(test_bench_sum);
+
+static void test_bench_empty(testlib_bench_state& state)
+{
+  while (state.run()) {}
+}
+TESTLIB_BENCH(test_bench_empty);
+
+static void test_bench()
+{
+  testlib_bench_options options;
+  options.repetitions = 5;
+  options.min_sample_time = 0.002;
+
+  testlib_bench_result r = testlib_bench_run("sum", &test_bench_sum, options);
+  TEST("Name", r.name, "sum");
+  TEST("Number of samples", r.samples, 5);
+  TEST("Iterations calibrated", r.iterations > 1 && r.iterations*r.min >= 0.0019, true);
+  TEST("Statistics ordered", r.min > 0.0 && r.min <= r.median && r.median <= r.max &&
+       r.min <= r.mean && r.mean <= r.max && r.stddev >= 0.0, true);
+  TEST_NEAR_REL("Items per second", r.items_per_second, 1000.0/r.median, 1e-9);
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  TEST("Cycles counted", r.cycles > 0.0, true);
+#endif
+
+  // An empty kernel times just the cost of state.run()
+  r = testlib_bench_run("empty", &test_bench_empty, options);
+  TEST("Empty kernel", r.samples, 5);
+
+  // Registered benchmarks, chosen by filter
+  std::vector<testlib_bench_result> results;
+  options.filter = "_sum";
+  test_bench_calls = 0;
+  testlib_bench_run_all(options, results);
+  TEST("Filtered run", results.size() == 1 && results[0].name == "test_bench_sum" &&
+       test_bench_calls == 1, true);
+  options.filter = "";
+  testlib_bench_run_all(options, results);
+  TEST("Run all", results.size(), 2);
+
+  // Results written as CSV read back
+  std::stringstream csv;
+  testlib_bench_write_csv(csv, results);
+  std::vector<testlib_bench_result> read;
+  TEST("Read CSV", testlib_bench_read_csv(csv, read), true);
+  TEST("CSV round trip", read.size() == 2 && read[1].name == results[1].name &&
+       read[0].iterations == results[0].iterations, true);
+  TEST_NEAR_REL("CSV median", read[0].median, results[0].median, 1e-8);
+  std::istringstream bad("name,time\nx,1\n");
+  TEST("Reject other CSV", testlib_bench_read_csv(bad, read), false);
+
+  std::ostringstream json;
+  testlib_bench_write_json(json, results);
+  TEST("JSON", json.str().find("{ \"name\": \"test_bench_sum\", \"iterations\": ") != std::string::npos, true);
+
+  // Comparison with a baseline
+  std::vector<testlib_bench_result> baseline(results);
+  std::ostringstream report;
+  TEST("Same as baseline", testlib_bench_compare(results, baseline, 0.1, report), 0);
+  baseline[0].median = results[0].median / 1.5;
+  baseline[1].name = "renamed";
+  report.str("");
+  TEST("Slower than baseline", testlib_bench_compare(results, baseline, 0.1, report), 1);
+  std::cout << report.str();
+  TEST("Report", report.str().find("SLOWER") != std::string::npos &&
+       report.str().find("not in baseline") != std::string::npos, true);
+  TEST("Within tolerance", testlib_bench_compare(results, baseline, 0.6, report), 0);
+
+  testlib_bench_write_table(std::cout, results);
+}
+
+TESTMAIN(test_bench);
@@ -4,6 +4,7 @@ DECLARE( test_assert );
 DECLARE( test_macros );
 DECLARE( test_args );
 DECLARE( test_root_dir );
+DECLARE( test_bench );
 
 void
 register_tests()
@@ -12,6 +13,7 @@ register_tests()
   REGISTER( test_macros );
   REGISTER( test_args );
   REGISTER( test_root_dir );
+  REGISTER( test_bench );
 }
 
 DEFINE_MAIN;
@@ -1,3 +1,4 @@
+#include <testlib/testlib_bench.h>
 #include <testlib/testlib_register.h>
 #include <testlib/testlib_root_dir.h>
 #include <testlib/testlib_test.h>
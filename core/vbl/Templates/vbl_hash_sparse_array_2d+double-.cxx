@@ -0,0 +1,2 @@
+#include <vbl/vbl_hash_sparse_array_2d.hxx>
+VBL_HASH_SPARSE_ARRAY_2D_INSTANTIATE(double);
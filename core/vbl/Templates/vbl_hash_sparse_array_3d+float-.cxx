@@ -0,0 +1,2 @@
+#include <vbl/vbl_hash_sparse_array_3d.hxx>
+VBL_HASH_SPARSE_ARRAY_3D_INSTANTIATE(float);
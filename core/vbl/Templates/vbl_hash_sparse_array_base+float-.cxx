@@ -0,0 +1,2 @@
+#include <vbl/vbl_hash_sparse_array_base.hxx>
+VBL_HASH_SPARSE_ARRAY_BASE_INSTANTIATE(float);
@@ -0,0 +1,108 @@
+// This is core/vbl/examples/time_sparse_arrays.cxx
+//:
+// \file
+// \brief Compare timings and memory of vbl_hash_sparse_array_3d with the std::map sparse arrays.
+//
+// For a range of element counts, scattered at random through a large
+// volume, times accumulating into the elements of vbl_sparse_array_3d,
+// vbl_big_sparse_array_3d and vbl_hash_sparse_array_3d, looking up
+// filled and empty locations, and erasing the elements.  The memory of
+// vbl_big_sparse_array_3d is estimated as a std::map node per element,
+// of four pointers (three links and a colour, padded) and the element;
+// the allocator's own overhead per node is not counted.
+//
+// Usage: time_sparse_arrays [n_lookups]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <utility>
+#include <cstdlib>
+#include <vxl_config.h>
+#include <vcl_compiler.h>
+#include <vul/vul_timer.h>
+#include <vbl/vbl_sparse_array_3d.h>
+#include <vbl/vbl_big_sparse_array_3d.h>
+#include <vbl/vbl_hash_sparse_array_3d.h>
+#include <vbl/vbl_triple.h>
+
+static unsigned next_random(unsigned& state)
+{
+  state = state*1664525u + 1013904223u;
+  return state >> 12;
+}
+
+//: Time accumulating into the locations, and lookups of filled and empty locations.
+template <class A>
+static void time_array(A& a, std::vector<unsigned> const& loc, std::vector<unsigned> const& miss,
+                       unsigned n_lookups, double& sum)
+{
+  const unsigned n = unsigned(loc.size()/3);
+  vul_timer t;
+  for (unsigned i=0; i<n; ++i)
+    a(loc[3*i], loc[3*i+1], loc[3*i+2]) += 1.0;
+  std::cout << std::setw(8) << t.real();
+  t.mark();
+  for (unsigned l=0, i=0; l<n_lookups; ++l, i = (i+1==n ? 0 : i+1))
+    sum += static_cast<A const&>(a)(loc[3*i], loc[3*i+1], loc[3*i+2]);
+  std::cout << std::setw(8) << t.real();
+  t.mark();
+  const unsigned n_miss = unsigned(miss.size()/3);
+  for (unsigned l=0, i=0; l<n_lookups; ++l, i = (i+1==n_miss ? 0 : i+1))
+    sum += a.fullp(miss[3*i], miss[3*i+1], miss[3*i+2]);
+  std::cout << std::setw(8) << t.real();
+}
+
+int main(int argc, char** argv)
+{
+  unsigned n_lookups = argc>1 ? std::atoi(argv[1]) : 1000000;
+  const unsigned sizes[] = { 1000, 10000, 100000, 1000000 };
+  const unsigned n_sizes = sizeof(sizes)/sizeof(sizes[0]);
+  unsigned state = 9667566;
+  double sum = 0;
+
+  std::cout << n_lookups << " lookups; times in ms; memory in MB\n"
+            << "            ---- vbl_sparse_array_3d -----"
+            << "  -- big_sparse_array --  -- vbl_hash_sparse_array_3d --\n"
+            << "  elements  insert     hit    miss   erase  insert     hit    miss"
+            << "  insert     hit    miss   erase  map MB hash MB\n";
+  for (unsigned s=0; s<n_sizes; ++s)
+  {
+    const unsigned n = sizes[s];
+    // Locations are distinct, since the k index counts up; misses have odd k
+    std::vector<unsigned> loc(3*n), miss(3*n);
+    for (unsigned i=0; i<n; ++i)
+    {
+      loc[3*i] = next_random(state) & 0xfffff;
+      loc[3*i+1] = next_random(state) & 0xfffff;
+      loc[3*i+2] = 2*i;
+      miss[3*i] = loc[3*i];
+      miss[3*i+1] = loc[3*i+1];
+      miss[3*i+2] = 2*i+1;
+    }
+    std::cout << std::setw(10) << n;
+
+    vbl_sparse_array_3d<double> map_array;
+    time_array(map_array, loc, miss, n_lookups, sum);
+    vul_timer t;
+    for (unsigned i=0; i<n; ++i)
+      map_array.erase(vbl_make_triple(loc[3*i], loc[3*i+1], loc[3*i+2]));
+    std::cout << std::setw(8) << t.real();
+
+    vbl_big_sparse_array_3d<double> big_array;
+    time_array(big_array, loc, miss, n_lookups, sum);
+
+    vbl_hash_sparse_array_3d<double> hash_array;
+    time_array(hash_array, loc, miss, n_lookups, sum);
+    const double hash_mb = hash_array.memory_used()/1048576.0;
+    t.mark();
+    for (unsigned i=0; i<n; ++i)
+      hash_array.erase(loc[3*i], loc[3*i+1], loc[3*i+2]);
+    std::cout << std::setw(8) << t.real();
+
+    const double map_mb = n*(4*sizeof(void*)+sizeof(std::pair<vxl_uint_64,double>))/1048576.0;
+    std::cout << std::setw(8) << std::setprecision(3) << map_mb
+              << std::setw(8) << std::setprecision(3) << hash_mb << std::endl;
+  }
+  return sum < 0 ? 1 : 0;
+}
@@ -17,6 +17,9 @@
 #include <vbl/vbl_sparse_array_2d.h>
 #include <vbl/vbl_sparse_array_3d.h>
 #include <vbl/vbl_big_sparse_array_3d.h>
+#include <vbl/vbl_hash_sparse_array_base.h>
+#include <vbl/vbl_hash_sparse_array_2d.h>
+#include <vbl/vbl_hash_sparse_array_3d.h>
 
 #include <vbl/vbl_batch_compact_multimap.h>
 #include <vbl/vbl_batch_multimap.h>
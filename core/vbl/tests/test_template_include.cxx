@@ -4,6 +4,9 @@
 #include <vbl/vbl_attributes.hxx>
 #include <vbl/vbl_big_sparse_array_3d.hxx>
 #include <vbl/vbl_bounding_box.hxx>
+#include <vbl/vbl_hash_sparse_array_2d.hxx>
+#include <vbl/vbl_hash_sparse_array_3d.hxx>
+#include <vbl/vbl_hash_sparse_array_base.hxx>
 #include <vbl/vbl_local_minima.hxx>
 #include <vbl/vbl_quadruple.hxx>
 #include <vbl/vbl_smart_ptr.hxx>
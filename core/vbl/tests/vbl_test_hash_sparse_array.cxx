@@ -0,0 +1,126 @@
+#include <sstream>
+#include <string>
+#include <testlib/testlib_test.h>
+#include <vbl/vbl_hash_sparse_array_2d.h>
+#include <vbl/vbl_hash_sparse_array_3d.h>
+#include <vbl/vbl_sparse_array_2d.h>
+#include <vbl/vbl_sparse_array_3d.h>
+#include <vbl/vbl_triple.h>
+
+// A small linear congruential generator, so the test does not depend on vnl
+static unsigned next_random(unsigned& state, unsigned n)
+{
+  state = state*1664525u + 1013904223u;
+  return (state >> 8) % n;
+}
+
+static void test_hash_sparse_array_2d()
+{
+  vbl_hash_sparse_array_2d<double> x;
+  TEST("Empty 2d array", x.count_nonempty()==0 && !x.fullp(1,2) && x.begin()==x.end(), true);
+  x(1,2) = 1.23;
+  x(4000000000u,5) = 4.5;
+  TEST("Something in (1,2)", x.fullp(1,2) && x(1,2)==1.23, true);
+  TEST("Large index", x.fullp(4000000000u,5) && !x.fullp(5,4000000000u), true);
+  TEST("Put into empty location", x.put(2,3,7.0) && x(2,3)==7.0, true);
+  TEST("Put does not overwrite", !x.put(2,3,8.0) && x(2,3)==7.0, true);
+  TEST("get_addr", x.get_addr(2,3)!=VXL_NULLPTR && *x.get_addr(2,3)==7.0 &&
+                   x.get_addr(3,2)==VXL_NULLPTR, true);
+  TEST("Const access", static_cast<vbl_hash_sparse_array_2d<double> const&>(x)(1,2), 1.23);
+  unsigned i, j;
+  vbl_hash_sparse_array_2d<double>::decode(vbl_hash_sparse_array_2d<double>::encode(4000000000u,77), i, j);
+  TEST("Decode inverts encode", i==4000000000u && j==77, true);
+
+  // Random insertions and erasures agree with vbl_sparse_array_2d
+  vbl_hash_sparse_array_2d<double> h;
+  vbl_sparse_array_2d<double> m;
+  unsigned state = 1;
+  bool same = true;
+  for (unsigned n = 0; n < 20000; ++n)
+  {
+    unsigned a = next_random(state, 50), b = next_random(state, 50);
+    if (m.fullp(a,b) && next_random(state, 3)==0)
+    {
+      h.erase(a,b);
+      m.erase(a,b);
+    }
+    else
+      h(a,b) += n, m(a,b) += n;
+    same = same && h.fullp(a,b)==m.fullp(a,b) && h.count_nonempty()==m.count_nonempty();
+  }
+  TEST("Random operations agree with vbl_sparse_array_2d", same, true);
+  unsigned n_iterated = 0;
+  for (vbl_hash_sparse_array_2d<double>::const_iterator p = h.begin(); p != h.end(); ++p)
+  {
+    h.decode(p->first, i, j);
+    same = same && m.fullp(i,j) && m(i,j)==p->second;
+    ++n_iterated;
+  }
+  TEST("Iteration visits each element once", same && n_iterated==m.count_nonempty(), true);
+  std::ostringstream hs, ms;
+  hs << h;
+  ms << m;
+  TEST("Printed in order", hs.str(), ms.str());
+}
+
+static void test_hash_sparse_array_3d()
+{
+  vbl_hash_sparse_array_3d<double> x;
+  x(1,2,3) = 1.23;
+  x(100,200,300) = 100.2003;
+  TEST("Something in (1,2,3)", x.fullp(1,2,3) && x(1,2,3)==1.23, true);
+  TEST("Something in (100,200,300)", x.fullp(100,200,300), true);
+  TEST("Nothing in (2,3,4) yet", x.fullp(2,3,4), false);
+  x.put(2,3,4, 7);
+  TEST("Something in (2,3,4) now", x.fullp(2,3,4) && x(2,3,4)==7, true);
+  x(0x3fffff,0x1fffff,0x1fffff) = 9;
+  unsigned i, j, k;
+  vbl_hash_sparse_array_3d<double>::decode(vbl_hash_sparse_array_3d<double>::encode(0x3fffff,5,0x1fffff), i, j, k);
+  TEST("Largest indices", x(0x3fffff,0x1fffff,0x1fffff)==9 && i==0x3fffff && j==5 && k==0x1fffff, true);
+
+  // Random insertions and erasures agree with vbl_sparse_array_3d
+  vbl_hash_sparse_array_3d<double> h;
+  vbl_sparse_array_3d<double> m;
+  unsigned state = 7;
+  bool same = true;
+  for (unsigned n = 0; n < 50000; ++n)
+  {
+    unsigned a = next_random(state, 30), b = next_random(state, 30), c = next_random(state, 30);
+    if (m.fullp(a,b,c) && next_random(state, 2)==0)
+    {
+      h.erase(a,b,c);
+      m.erase(vbl_make_triple(a,b,c));
+    }
+    else
+      h(a,b,c) = n, m(a,b,c) = n;
+    same = same && h.fullp(a,b,c)==m.fullp(a,b,c) && h.count_nonempty()==m.count_nonempty();
+  }
+  TEST("Random operations agree with vbl_sparse_array_3d", same, true);
+  for (vbl_sparse_array_3d<double>::const_iterator p = m.begin(); p != m.end(); ++p)
+    same = same && h((*p).first.first, (*p).first.second, (*p).first.third)==(*p).second;
+  TEST("Values agree with vbl_sparse_array_3d", same, true);
+  std::ostringstream hs, ms;
+  hs << h;
+  ms << m;
+  TEST("Printed in order", hs.str(), ms.str());
+
+  // Reserving room, and releasing it
+  vbl_hash_sparse_array_3d<double> r;
+  r.reserve(1000);
+  const std::size_t capacity = r.capacity();
+  for (unsigned n = 0; n < 1000; ++n)
+    r(n,n,n) = n;
+  TEST("Reserve avoids rehashing", capacity>=1000 && r.capacity()==capacity, true);
+  r.clear();
+  TEST("Clear releases memory", r.count_nonempty()==0 && r.memory_used()==0 && !r.fullp(1,1,1), true);
+  r(1,1,1) = 1;
+  TEST("Usable after clear", r.count_nonempty()==1 && r(1,1,1)==1, true);
+}
+
+static void vbl_test_hash_sparse_array()
+{
+  test_hash_sparse_array_2d();
+  test_hash_sparse_array_3d();
+}
+
+TESTMAIN(vbl_test_hash_sparse_array);
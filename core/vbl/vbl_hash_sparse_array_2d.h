@@ -0,0 +1,94 @@
+// This is core/vbl/vbl_hash_sparse_array_2d.h
+#ifndef vbl_hash_sparse_array_2d_h_
+#define vbl_hash_sparse_array_2d_h_
+#ifdef VCL_NEEDS_PRAGMA_INTERFACE
+#pragma interface
+#endif
+//:
+// \file
+// \brief A space efficient 2d array stored in a hash table
+//
+//    vbl_hash_sparse_array_2d has the interface of vbl_sparse_array_2d,
+//    with its elements in a vbl_hash_sparse_array_base instead of a
+//    std::map.  Location (i,j) is stored under the key i*2^32+j, so
+//    sorting the keys orders the elements as in vbl_sparse_array_2d.
+//---------------------------------------------------------------------------
+
+#include <iosfwd>
+#include <vcl_compiler.h>
+#include <vbl/vbl_hash_sparse_array_base.h>
+
+//: Sparse 2D array allowing space efficient access of the form  s(300,700) =2
+template <class T>
+class vbl_hash_sparse_array_2d : public vbl_hash_sparse_array_base<T>
+{
+  typedef vbl_hash_sparse_array_base<T> base;
+ public:
+  typedef typename base::Index_type Index_type;
+
+  //: The key of location (i,j).
+  static Index_type encode(unsigned i, unsigned j)
+  {
+    return (Index_type(i) << 32) | Index_type(j);
+  }
+
+  //: The location (i,j) of a key.
+  static void decode(Index_type key, unsigned& i, unsigned& j)
+  {
+    i = unsigned(key >> 32);
+    j = unsigned(key & 0xffffffffu);
+  }
+
+  //: Put a value into location (i,j), unless it is already filled.
+  bool put(unsigned i, unsigned j, const T& t)
+  {
+    return base::put(encode(i, j), t);
+  }
+
+  //: Return contents of location (i,j).
+  //  Returns an undefined value (in fact
+  //  a T()) if location (i,j) has not been filled with a value.
+  T& operator () (unsigned i, unsigned j)
+  {
+    return base::operator() (encode(i, j));
+  }
+
+  //: Return contents of (i,j).  Assertion failure if not yet filled.
+  const T& operator () (unsigned i, unsigned j) const
+  {
+    return base::operator() (encode(i, j));
+  }
+
+  //: Erase element at location (i,j). Assertion failure if not yet filled.
+  void erase(unsigned i, unsigned j)
+  {
+    base::erase(encode(i, j));
+  }
+
+  //: Return true if location (i,j) has been filled.
+  bool fullp(unsigned i, unsigned j) const
+  {
+    return base::fullp(encode(i, j));
+  }
+
+  //: Return the address of location (i,j).  0 if not yet filled.
+  T* get_addr(unsigned i, unsigned j)
+  {
+    return base::get_addr(encode(i, j));
+  }
+
+  //: Print the Array to a stream in "(i,j): value" format, ordered by (i,j).
+  std::ostream& print(std::ostream&) const;
+};
+
+//: Stream operator - print the Array to a stream in "(i,j): value" format.
+template <class T>
+inline std::ostream& operator<< (std::ostream& s, const vbl_hash_sparse_array_2d<T>& a)
+{
+  return a.print(s);
+}
+
+#define VBL_HASH_SPARSE_ARRAY_2D_INSTANTIATE(T) \
+extern "please include vbl/vbl_hash_sparse_array_2d.hxx instead"
+
+#endif // vbl_hash_sparse_array_2d_h_
@@ -0,0 +1,33 @@
+// This is core/vbl/vbl_hash_sparse_array_2d.hxx
+#ifndef vbl_hash_sparse_array_2d_hxx_
+#define vbl_hash_sparse_array_2d_hxx_
+//:
+// \file
+
+#include <iostream>
+#include <vector>
+#include "vbl_hash_sparse_array_2d.h"
+#include "vbl_hash_sparse_array_base.hxx"
+#include <vcl_compiler.h>
+
+//: Print the array to a stream in "(i,j): value" format.
+template <class T>
+std::ostream& vbl_hash_sparse_array_2d<T>::print(std::ostream& out) const
+{
+  std::vector<typename base::sequence_value_type const*> entries;
+  this->ordered_entries(entries);
+  for (unsigned e = 0; e < entries.size(); ++e)
+  {
+    unsigned i, j;
+    decode(entries[e]->first, i, j);
+    out << '(' << i << ',' << j << "): " << entries[e]->second << '\n';
+  }
+  return out;
+}
+
+#undef VBL_HASH_SPARSE_ARRAY_2D_INSTANTIATE
+#define VBL_HASH_SPARSE_ARRAY_2D_INSTANTIATE(T) \
+template class vbl_hash_sparse_array_2d<T >; \
+VCL_INSTANTIATE_INLINE(std::ostream& operator<< (std::ostream&, const vbl_hash_sparse_array_2d<T > &))
+
+#endif // vbl_hash_sparse_array_2d_hxx_
@@ -0,0 +1,109 @@
+// This is core/vbl/vbl_hash_sparse_array_3d.h
+#ifndef vbl_hash_sparse_array_3d_h_
+#define vbl_hash_sparse_array_3d_h_
+#ifdef VCL_NEEDS_PRAGMA_INTERFACE
+#pragma interface
+#endif
+//:
+// \file
+// \brief A space efficient 3d array stored in a hash table
+//
+//    vbl_hash_sparse_array_3d has the interface of vbl_sparse_array_3d
+//    and vbl_big_sparse_array_3d, with its elements in a
+//    vbl_hash_sparse_array_base instead of a std::map.  As in
+//    vbl_big_sparse_array_3d, location (i,j,k) is packed into a 64-bit
+//    key, with 22 bits for i and 21 bits each for j and k; so i must be
+//    below 2^22 and j and k below 2^21.  Sorting the keys orders the
+//    elements as in vbl_sparse_array_3d.
+//
+// Example usage:
+// \code
+//  vbl_hash_sparse_array_3d<float> occupancy;
+//  occupancy.reserve(1000000);
+//  occupancy(1,2,3) += 0.5f;
+//  if (occupancy.fullp(1,2,3)) ...
+// \endcode
+//---------------------------------------------------------------------------
+
+#include <iosfwd>
+#include <vcl_compiler.h>
+#include <vcl_cassert.h>
+#include <vbl/vbl_hash_sparse_array_base.h>
+
+//: Sparse 3d array allowing space efficient access
+// You can use this as e.g. s(300,700,900) = T(2).
+template <class T>
+class vbl_hash_sparse_array_3d : public vbl_hash_sparse_array_base<T>
+{
+  typedef vbl_hash_sparse_array_base<T> base;
+ public:
+  typedef typename base::Index_type Index_type;
+
+  //: The key of location (i,j,k).
+  static Index_type encode(unsigned i, unsigned j, unsigned k)
+  {
+    assert( i <= 0x3fffff && j <= 0x1fffff && k <= 0x1fffff );
+    return (Index_type(i) << 42) | (Index_type(j) << 21) | Index_type(k);
+  }
+
+  //: The location (i,j,k) of a key.
+  static void decode(Index_type key, unsigned& i, unsigned& j, unsigned& k)
+  {
+    k = unsigned(key & 0x1fffff);
+    j = unsigned((key >> 21) & 0x1fffff);
+    i = unsigned((key >> 42) & 0x3fffff);
+  }
+
+  //: Put a value into location (i,j,k), unless it is already filled.
+  bool put(unsigned i, unsigned j, unsigned k, const T& t)
+  {
+    return base::put(encode(i, j, k), t);
+  }
+
+  //: Return contents of location (i,j,k).
+  //  Returns an undefined value (in fact
+  //  a T()) if location (i,j,k) has not been filled with a value.
+  T& operator () (unsigned i, unsigned j, unsigned k)
+  {
+    return base::operator() (encode(i, j, k));
+  }
+
+  //: Return contents of (i,j,k).  Assertion failure if not yet filled.
+  const T& operator () (unsigned i, unsigned j, unsigned k) const
+  {
+    return base::operator() (encode(i, j, k));
+  }
+
+  //: Erase element at location (i,j,k). Assertion failure if not yet filled.
+  void erase(unsigned i, unsigned j, unsigned k)
+  {
+    base::erase(encode(i, j, k));
+  }
+
+  //: Return true if location (i,j,k) has been filled.
+  bool fullp(unsigned i, unsigned j, unsigned k) const
+  {
+    return base::fullp(encode(i, j, k));
+  }
+
+  //: Return the address of location (i,j,k).  0 if not yet filled.
+  T* get_addr(unsigned i, unsigned j, unsigned k)
+  {
+    return base::get_addr(encode(i, j, k));
+  }
+
+  //: Print the Array to a stream in "(i,j,k): value" format, ordered by (i,j,k).
+  std::ostream& print(std::ostream&) const;
+};
+
+//: Stream operator - print the Array to a stream in "(i,j,k): value" format.
+template <class T>
+inline std::ostream& operator<< (std::ostream& s, const vbl_hash_sparse_array_3d<T>& a)
+{
+  return a.print(s);
+}
+
+#define VBL_HASH_SPARSE_ARRAY_3D_INSTANTIATE(T) \
+extern "please include vbl/vbl_hash_sparse_array_3d.hxx instead"
+
+#endif // vbl_hash_sparse_array_3d_h_
@@ -0,0 +1,33 @@
+// This is core/vbl/vbl_hash_sparse_array_3d.hxx
+#ifndef vbl_hash_sparse_array_3d_hxx_
+#define vbl_hash_sparse_array_3d_hxx_
+//:
+// \file
+
+#include <iostream>
+#include <vector>
+#include "vbl_hash_sparse_array_3d.h"
+#include "vbl_hash_sparse_array_base.hxx"
+#include <vcl_compiler.h>
+
+//: Print the array to a stream in "(i,j,k): value" format.
+template <class T>
+std::ostream& vbl_hash_sparse_array_3d<T>::print(std::ostream& out) const
+{
+  std::vector<typename base::sequence_value_type const*> entries;
+  this->ordered_entries(entries);
+  for (unsigned e = 0; e < entries.size(); ++e)
+  {
+    unsigned i, j, k;
+    decode(entries[e]->first, i, j, k);
+    out << '(' << i << ',' << j << ',' << k << "): " << entries[e]->second << '\n';
+  }
+  return out;
+}
+
+#undef VBL_HASH_SPARSE_ARRAY_3D_INSTANTIATE
+#define VBL_HASH_SPARSE_ARRAY_3D_INSTANTIATE(T) \
+template class vbl_hash_sparse_array_3d<T >; \
+VCL_INSTANTIATE_INLINE(std::ostream& operator<< (std::ostream&, const vbl_hash_sparse_array_3d<T > &))
+
+#endif // vbl_hash_sparse_array_3d_hxx_
@@ -0,0 +1,160 @@
+// This is core/vbl/vbl_hash_sparse_array_base.h
+#ifndef vbl_hash_sparse_array_base_h_
+#define vbl_hash_sparse_array_base_h_
+#ifdef VCL_NEEDS_PRAGMA_INTERFACE
+#pragma interface
+#endif
+//:
+// \file
+// \brief Base class for sparse arrays stored in an open-addressing hash table.
+//
+// vbl_sparse_array_base keeps its elements in a std::map, so each access
+// walks a balanced tree, and each element costs a separately allocated
+// node of three pointers and a colour besides its index and value.  This
+// class stores the elements of a sparse array in one table of
+// (key,value) slots, indexed by a hash of a 64-bit key and probed
+// linearly, so an access usually touches one or two adjacent slots and
+// no memory is allocated per element.  vbl_hash_sparse_array_2d and
+// vbl_hash_sparse_array_3d encode their indices into the key.
+//
+// The interface is that of vbl_sparse_array_base, except that:
+//  - iteration with begin() and end() visits the elements in no
+//    particular order; ordered_entries() sorts them by key on demand.
+//  - references and pointers to elements, and iterators, are invalidated
+//    by any insertion or erasure, which may move the elements.
+
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <cstddef>
+#include <vxl_config.h>
+#include <vcl_compiler.h>
+
+//: A sparse array of T indexed by 64-bit keys, stored in a hash table.
+template <class T>
+class vbl_hash_sparse_array_base
+{
+ public:
+  typedef std::size_t size_type;
+
+  //: The type of objects used to index the sparse array
+  typedef vxl_uint_64 Index_type;
+
+  //: The type of values stored by the sparse array
+  typedef T T_type;
+
+  //: The type of values of the controlled sequence
+  typedef std::pair<Index_type, T> sequence_value_type;
+
+  //: A forward iterator over the non-empty elements, in no particular order.
+  class const_iterator
+  {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef sequence_value_type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef sequence_value_type const* pointer;
+    typedef sequence_value_type const& reference;
+
+    const_iterator() : a_(VXL_NULLPTR), s_(0) {}
+    const_iterator(vbl_hash_sparse_array_base<T> const* a, size_type s) : a_(a), s_(s) { skip(); }
+
+    reference operator*() const { return a_->slots_[s_]; }
+    pointer operator->() const { return &a_->slots_[s_]; }
+    const_iterator& operator++() { ++s_; skip(); return *this; }
+    const_iterator operator++(int) { const_iterator t = *this; ++*this; return t; }
+    bool operator==(const_iterator const& that) const { return s_ == that.s_; }
+    bool operator!=(const_iterator const& that) const { return s_ != that.s_; }
+
+   private:
+    void skip() { while (s_ < a_->full_.size() && !a_->full_[s_]) ++s_; }
+    vbl_hash_sparse_array_base<T> const* a_;
+    size_type s_;
+  };
+
+  //: Construct an empty array.
+  vbl_hash_sparse_array_base() : size_(0) {}
+
+  //: Return contents at (i), inserting a T() if it is empty.
+  T      & operator () (Index_type i);
+
+  //: Return contents at (i). Asserts that (i) is non-empty.
+  T const& operator () (Index_type i) const;
+
+  //: Erase element at location (i). Assertion failure if not yet filled.
+  void erase(Index_type );
+
+  //: Return true if location (i) has been filled.
+  bool fullp(Index_type i) const { return find(i) != npos; }
+
+  //: Put a value into location (i), unless it is already filled.
+  //  Returns true if the value was put.
+  bool put(Index_type , const T& );
+
+  //: Return the address of location (i).  0 if not yet filled.
+  T* get_addr(Index_type);
+
+  //: Empty the sparse array, releasing its memory.
+  void clear();
+
+  //: Make room for n elements without rehashing.
+  void reserve(size_type n);
+
+  //: Return number of locations that have been assigned a value.
+  size_type count_nonempty() const { return size_; }
+
+  //: Number of slots in the table.
+  size_type capacity() const { return slots_.size(); }
+
+  //: Bytes of memory held by the table.
+  size_type memory_used() const
+  { return slots_.capacity()*sizeof(sequence_value_type) + full_.capacity(); }
+
+  //: An iterator pointing at the first non-empty element
+  const_iterator begin() const { return const_iterator(this, 0); }
+
+  //: An iterator pointing just beyond the last non-empty element.
+  const_iterator end() const { return const_iterator(this, slots_.size()); }
+
+  //: Pointers to the non-empty elements, sorted by index.
+  //  The pointers are invalidated by any insertion or erasure.
+  void ordered_entries(std::vector<sequence_value_type const*>& entries) const;
+
+ protected:
+  //: Value returned by find() for empty locations.
+  static const size_type npos = static_cast<size_type>(-1);
+
+  //: Hash of a key, well mixed in the low bits.
+  static size_type hash(Index_type i)
+  {
+    i ^= i >> 33;
+    i *= (vxl_uint_64(0xff51afd7u) << 32) | 0xed558ccdu;
+    i ^= i >> 33;
+    i *= (vxl_uint_64(0xc4ceb9feu) << 32) | 0x1a85ec53u;
+    i ^= i >> 33;
+    return size_type(i);
+  }
+
+  //: Slot holding location (i), or npos.
+  size_type find(Index_type i) const;
+
+  //: Put (i,t) into an empty slot, growing the table if needed; i must not be present.
+  size_type insert_new(Index_type i, const T& t);
+
+  //: Rebuild the table with n slots, a power of two.
+  void rehash(size_type n);
+
+  //: The (key,value) slots; the table size is zero or a power of two.
+  std::vector<sequence_value_type> slots_;
+  //: Nonzero for slots which hold an element.
+  std::vector<unsigned char> full_;
+  //: Number of elements.
+  size_type size_;
+
+  friend class const_iterator;
+};
+
+#define VBL_HASH_SPARSE_ARRAY_BASE_INSTANTIATE(T) \
+extern "please include vbl/vbl_hash_sparse_array_base.hxx instead"
+
+#endif // vbl_hash_sparse_array_base_h_
@@ -0,0 +1,182 @@
+// This is core/vbl/vbl_hash_sparse_array_base.hxx
+#ifndef vbl_hash_sparse_array_base_hxx_
+#define vbl_hash_sparse_array_base_hxx_
+//:
+// \file
+// \brief Contains a base class for sparse arrays stored in a hash table.
+
+#include <algorithm>
+#include "vbl_hash_sparse_array_base.h"
+#include <vcl_cassert.h>
+#include <vcl_compiler.h>
+
+//: Orders pointers to entries by their keys.
+template <class V>
+struct vbl_hash_sparse_array_key_less
+{
+  bool operator()(V const* a, V const* b) const { return a->first < b->first; }
+};
+
+template <class T>
+const typename vbl_hash_sparse_array_base<T>::size_type vbl_hash_sparse_array_base<T>::npos;
+
+//: Slot holding location (i), or npos.
+template <class T>
+typename vbl_hash_sparse_array_base<T>::size_type
+vbl_hash_sparse_array_base<T>::find(Index_type i) const
+{
+  if (size_ == 0) return npos;
+  const size_type mask = slots_.size()-1;
+  for (size_type s = hash(i) & mask; full_[s]; s = (s+1) & mask)
+    if (slots_[s].first == i)
+      return s;
+  return npos;
+}
+
+//: Put (i,t) into an empty slot, growing the table if needed.
+template <class T>
+typename vbl_hash_sparse_array_base<T>::size_type
+vbl_hash_sparse_array_base<T>::insert_new(Index_type i, const T& t)
+{
+  // keep the table at most 3/4 full
+  if (4*(size_+1) > 3*slots_.size())
+    rehash(slots_.empty() ? 16 : 2*slots_.size());
+  const size_type mask = slots_.size()-1;
+  size_type s = hash(i) & mask;
+  while (full_[s]) s = (s+1) & mask;
+  slots_[s].first = i;
+  slots_[s].second = t;
+  full_[s] = 1;
+  ++size_;
+  return s;
+}
+
+//: Rebuild the table with n slots, a power of two.
+template <class T>
+void vbl_hash_sparse_array_base<T>::rehash(size_type n)
+{
+  assert(n >= size_ && (n & (n-1)) == 0);
+  std::vector<sequence_value_type> old_slots;
+  std::vector<unsigned char> old_full;
+  old_slots.swap(slots_);
+  old_full.swap(full_);
+  slots_.resize(n);
+  full_.assign(n, 0);
+  const size_type mask = n-1;
+  for (size_type o = 0; o < old_slots.size(); ++o)
+    if (old_full[o])
+    {
+      size_type s = hash(old_slots[o].first) & mask;
+      while (full_[s]) s = (s+1) & mask;
+      slots_[s] = old_slots[o];
+      full_[s] = 1;
+    }
+}
+
+//: Return contents of (i), inserting a T() if it is empty.
+template <class T>
+T& vbl_hash_sparse_array_base<T>::operator () (Index_type i)
+{
+  size_type s = find(i);
+  if (s == npos)
+    s = insert_new(i, T());
+  return slots_[s].second;
+}
+
+//: Return contents of (i).  Assertion failure if not yet filled.
+template <class T>
+T const & vbl_hash_sparse_array_base<T>::operator () (Index_type i) const
+{
+  size_type s = find(i);
+
+  assert(s != npos);
+
+  return slots_[s].second;
+}
+
+//: Erase element at location (i). Assertion failure if not yet filled.
+//  The elements after it in its probe sequence are shifted back, so the
+//  table never holds deleted markers.
+template <class T>
+void vbl_hash_sparse_array_base<T>::erase (Index_type i)
+{
+  size_type hole = find(i);
+
+  assert(hole != npos);
+
+  const size_type mask = slots_.size()-1;
+  for (size_type s = (hole+1) & mask; full_[s]; s = (s+1) & mask)
+  {
+    // The element in s can fill the hole unless its home slot lies
+    // cyclically in (hole, s]
+    const size_type home = hash(slots_[s].first) & mask;
+    const bool stays = hole <= s ? (hole < home && home <= s)
+                                 : (hole < home || home <= s);
+    if (!stays)
+    {
+      slots_[hole] = slots_[s];
+      hole = s;
+    }
+  }
+  slots_[hole] = sequence_value_type();
+  full_[hole] = 0;
+  --size_;
+}
+
+//: Return the memory address of location (i).  0 if not yet filled.
+template <class T>
+T* vbl_hash_sparse_array_base<T>::get_addr(Index_type i)
+{
+  size_type s = find(i);
+
+  if (s == npos)
+    return VXL_NULLPTR;
+
+  return &slots_[s].second;
+}
+
+//: Put a value into location (i), unless it is already filled.
+template <class T>
+bool vbl_hash_sparse_array_base<T>::put(Index_type i, const T& t)
+{
+  if (find(i) != npos)
+    return false;
+  insert_new(i, t);
+  return true;
+}
+
+//: Empty the sparse array, releasing its memory.
+template <class T>
+void vbl_hash_sparse_array_base<T>::clear()
+{
+  std::vector<sequence_value_type>().swap(slots_);
+  std::vector<unsigned char>().swap(full_);
+  size_ = 0;
+}
+
+//: Make room for n elements without rehashing.
+template <class T>
+void vbl_hash_sparse_array_base<T>::reserve(size_type n)
+{
+  size_type slots = 16;
+  while (3*slots < 4*n) slots *= 2;
+  if (slots > slots_.size())
+    rehash(slots);
+}
+
+//: Pointers to the non-empty elements, sorted by index.
+template <class T>
+void vbl_hash_sparse_array_base<T>::ordered_entries(std::vector<sequence_value_type const*>& entries) const
+{
+  entries.clear();
+  entries.reserve(size_);
+  for (const_iterator p = begin(); p != end(); ++p)
+    entries.push_back(&*p);
+  std::sort(entries.begin(), entries.end(), vbl_hash_sparse_array_key_less<sequence_value_type>());
+}
+
+#undef VBL_HASH_SPARSE_ARRAY_BASE_INSTANTIATE
+#define VBL_HASH_SPARSE_ARRAY_BASE_INSTANTIATE(T) \
+template class vbl_hash_sparse_array_base<T >
+
+#endif // vbl_hash_sparse_array_base_hxx_
@@ -0,0 +1,216 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <vcl_compiler.h>
+#include <vgl/vgl_point_3d.h>
+#include <vgl/vgl_box_3d.h>
+#include <vgl/vgl_ray_3d.h>
+#include <vgl/vgl_distance.h>
+#include <vgl/vgl_triangle_3d.h>
+#include <vgl/algo/vgl_bvh_3d.h>
+#include <vnl/vnl_random.h>
+#include <testlib/testlib_test.h>
+
+static vgl_point_3d<double> random_point(vnl_random& rng, double size)
+{
+  return vgl_point_3d<double>(rng.drand64(0,size), rng.drand64(0,size), rng.drand64(0,size));
+}
+
+//: Small triangles scattered through a cube of side 10.
+static void random_soup(vnl_random& rng, unsigned n, std::vector<vgl_point_3d<double> >& corners)
+{
+  corners.clear();
+  for (unsigned i=0; i<n; ++i)
+  {
+    vgl_point_3d<double> c = random_point(rng, 10.0);
+    for (unsigned k=0; k<3; ++k)
+      corners.push_back(c + (random_point(rng, 1.0)-vgl_point_3d<double>(0.5,0.5,0.5)));
+  }
+}
+
+//: Distance to the first triangle hit, by testing every triangle.
+static double brute_ray(std::vector<vgl_point_3d<double> > const& corners,
+                        vgl_ray_3d<double> const& ray)
+{
+  double best = 1e300;
+  vgl_point_3d<double> far_pt = ray.origin() + 1000.0*ray.direction();
+  vgl_line_segment_3d<double> seg(ray.origin(), far_pt);
+  for (unsigned i=0; i<corners.size(); i+=3)
+  {
+    vgl_point_3d<double> p;
+    if (vgl_triangle_3d_line_intersection(seg, corners[i], corners[i+1], corners[i+2], p, true)
+        == Skew)
+      best = std::min(best, vgl_distance(ray.origin(), p));
+  }
+  return best;
+}
+
+static double brute_distance(std::vector<vgl_point_3d<double> > const& corners,
+                             vgl_point_3d<double> const& q)
+{
+  double best = 1e300;
+  for (unsigned i=0; i<corners.size(); i+=3)
+    best = std::min(best, vgl_triangle_3d_distance(q, corners[i], corners[i+1], corners[i+2]));
+  return best;
+}
+
+static void test_bvh_3d()
+{
+  vnl_random rng(1234);
+  std::vector<vgl_point_3d<double> > corners;
+  random_soup(rng, 500, corners);
+  vgl_bvh_3d bvh(corners);
+  TEST("Number of triangles", bvh.size(), 500);
+  TEST("Tree has internal nodes", bvh.nodes()>1, true);
+
+  // every leaf within the size limit, and every node contains its children
+  bool nodes_ok = true;
+  vgl_bvh_3d::node const* nodes = bvh.node_array();
+  for (unsigned i=0; i<bvh.nodes(); ++i)
+  {
+    if (nodes[i].count>4)
+      nodes_ok = false;
+    if (nodes[i].count==0)
+      for (unsigned c=nodes[i].first; c<nodes[i].first+2; ++c)
+        for (unsigned a=0; a<3; ++a)
+          if (nodes[c].min[a]<nodes[i].min[a] || nodes[c].max[a]>nodes[i].max[a])
+            nodes_ok = false;
+  }
+  TEST("Leaves are small and children lie inside parents", nodes_ok, true);
+
+  // Ray casting
+  std::vector<vgl_ray_3d<double> > rays;
+  for (unsigned i=0; i<200; ++i)
+  {
+    vgl_point_3d<double> o = random_point(rng, 10.0);
+    vgl_point_3d<double> p = random_point(rng, 10.0);
+    rays.push_back(vgl_ray_3d<double>(o, p-o));
+  }
+  unsigned n_hits = 0, n_ray_ok = 0;
+  for (unsigned i=0; i<rays.size(); ++i)
+  {
+    double t = 0.0;
+    unsigned tri = vgl_bvh_3d::no_triangle;
+    bool hit = bvh.ray_cast(rays[i], t, tri);
+    double expected = brute_ray(corners, rays[i]);
+    if (hit) ++n_hits;
+    if (hit ? std::fabs(t-expected)<1e-8 : expected>1e299)
+      ++n_ray_ok;
+  }
+  std::cout << n_hits << " of " << rays.size() << " rays hit\n";
+  TEST("Some rays hit", n_hits>0, true);
+  TEST("Ray casts match brute force", n_ray_ok, rays.size());
+
+  double t_limited;
+  unsigned tri_limited;
+  TEST("Ray cast limited by t_max",
+       bvh.ray_cast(vgl_ray_3d<double>(vgl_point_3d<double>(-100,5,5), vgl_vector_3d<double>(1,0,0)),
+                    t_limited, tri_limited, 50.0), false);
+
+  // Closest points
+  std::vector<vgl_point_3d<double> > qs;
+  for (unsigned i=0; i<200; ++i)
+    qs.push_back(random_point(rng, 14.0) - vgl_vector_3d<double>(2,2,2));
+  unsigned n_cp_ok = 0;
+  for (unsigned i=0; i<qs.size(); ++i)
+  {
+    vgl_point_3d<double> cp;
+    unsigned tri;
+    if (bvh.closest_point(qs[i], cp, tri) &&
+        std::fabs(vgl_distance(qs[i], cp) - brute_distance(corners, qs[i]))<1e-9 &&
+        std::fabs(vgl_triangle_3d_distance(cp, corners[3*tri], corners[3*tri+1], corners[3*tri+2]))<1e-9)
+      ++n_cp_ok;
+  }
+  TEST("Closest points match brute force", n_cp_ok, qs.size());
+
+  // Box overlap, checked against triangles sampled densely
+  unsigned n_box_ok = 0;
+  std::vector<vgl_box_3d<double> > boxes;
+  for (unsigned i=0; i<50; ++i)
+  {
+    vgl_box_3d<double> box;
+    box.add(random_point(rng, 10.0));
+    box.add(random_point(rng, 10.0));
+    boxes.push_back(box);
+    std::vector<unsigned> found;
+    bvh.box_overlap(box, found);
+    std::vector<unsigned> expected;
+    for (unsigned t=0; t<corners.size()/3; ++t)
+    {
+      // sample the triangle on a barycentric grid
+      bool meet = false;
+      for (unsigned u=0; u<=20 && !meet; ++u)
+        for (unsigned v=0; u+v<=20 && !meet; ++v)
+        {
+          double a = u/20.0, b = v/20.0;
+          vgl_point_3d<double> p(corners[3*t].x()*(1-a-b) + corners[3*t+1].x()*a + corners[3*t+2].x()*b,
+                                 corners[3*t].y()*(1-a-b) + corners[3*t+1].y()*a + corners[3*t+2].y()*b,
+                                 corners[3*t].z()*(1-a-b) + corners[3*t+1].z()*a + corners[3*t+2].z()*b);
+          meet = box.contains(p);
+        }
+      if (meet) expected.push_back(t);
+    }
+    // Sampling can miss triangles which only clip a corner of the box, so
+    // require every sampled triangle to be found, and no more than a few extras.
+    bool ok = std::includes(found.begin(), found.end(), expected.begin(), expected.end()) &&
+              found.size() <= expected.size() + expected.size()/10 + 2;
+    if (ok) ++n_box_ok;
+  }
+  TEST("Box overlaps match sampled triangles", n_box_ok, boxes.size());
+
+  std::vector<unsigned> all;
+  bvh.box_overlap(bvh.bounding_box(), all);
+  TEST("Bounding box meets every triangle", all.size(), 500);
+
+  // Batched queries on several threads give the single query answers
+  std::vector<double> t1, t4;
+  std::vector<unsigned> tri1, tri4;
+  bvh.ray_cast(rays, t1, tri1, 1);
+  bvh.ray_cast(rays, t4, tri4, 4);
+  TEST("Threaded ray casts match", t1==t4 && tri1==tri4, true);
+  unsigned n_miss = 0;
+  for (unsigned i=0; i<tri1.size(); ++i)
+    if (tri1[i]==vgl_bvh_3d::no_triangle) ++n_miss;
+  TEST("Batched misses are flagged", n_miss, rays.size()-n_hits);
+
+  std::vector<vgl_point_3d<double> > cp1, cp4;
+  bvh.closest_point(qs, cp1, tri1, 1);
+  bvh.closest_point(qs, cp4, tri4, 3);
+  TEST("Threaded closest points match", cp1==cp4 && tri1==tri4, true);
+
+  std::vector<std::vector<unsigned> > b1, b4;
+  bvh.box_overlap(boxes, b1, 1);
+  bvh.box_overlap(boxes, b4, 4);
+  TEST("Threaded box overlaps match", b1==b4, true);
+
+  // Indexed triangle sets give the same tree as the equivalent soup
+  std::vector<unsigned> indices(corners.size());
+  for (unsigned i=0; i<indices.size(); ++i) indices[i] = i;
+  vgl_bvh_3d bvh2(corners, indices);
+  std::vector<double> t2;
+  std::vector<unsigned> tri2;
+  bvh2.ray_cast(rays, t2, tri2);
+  TEST("Indexed build matches soup build", t2==t1, true);
+
+  // Coincident triangles cannot be split, and end up in one leaf
+  std::vector<vgl_point_3d<double> > same;
+  for (unsigned i=0; i<10; ++i)
+  {
+    same.push_back(vgl_point_3d<double>(0,0,0));
+    same.push_back(vgl_point_3d<double>(1,0,0));
+    same.push_back(vgl_point_3d<double>(0,1,0));
+  }
+  vgl_bvh_3d bvh3(same);
+  TEST("Coincident triangles form one leaf", bvh3.nodes(), 1);
+
+  vgl_bvh_3d empty;
+  double t;
+  unsigned tri;
+  vgl_point_3d<double> cp;
+  TEST("Empty tree", empty.empty() &&
+                     !empty.ray_cast(rays[0], t, tri) &&
+                     !empty.closest_point(qs[0], cp, tri), true);
+}
+
+TESTMAIN(test_bvh_3d);
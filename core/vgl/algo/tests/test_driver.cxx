@@ -1,5 +1,6 @@
 #include <testlib/testlib_register.h>
 
+DECLARE( test_bvh_3d );
 DECLARE( test_compute_similarity_3d );
 DECLARE( test_compute_rigid_3d );
 DECLARE( test_conic );
@@ -17,11 +18,13 @@ DECLARE( test_intersection );
 DECLARE( test_orient_box_3d );
 DECLARE( test_p_matrix );
 DECLARE( test_rotation_3d );
+DECLARE( test_packed_rtree );
 DECLARE( test_rtree );
 
 void
 register_tests()
 {
+  REGISTER( test_bvh_3d );
   REGISTER( test_compute_similarity_3d );
   REGISTER( test_compute_rigid_3d );
   REGISTER( test_conic );
@@ -39,6 +42,7 @@ register_tests()
   REGISTER( test_orient_box_3d );
   REGISTER( test_p_matrix );
   REGISTER( test_rotation_3d );
+  REGISTER( test_packed_rtree );
   REGISTER( test_rtree );
 }
 
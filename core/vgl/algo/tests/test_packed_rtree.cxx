@@ -0,0 +1,179 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <vcl_compiler.h>
+#include <vgl/vgl_point_2d.h>
+#include <vgl/vgl_box_2d.h>
+#include <vgl/algo/vgl_packed_rtree.h>
+#include <vgl/algo/vgl_rtree_c.h>
+#include <vnl/vnl_random.h>
+#include <testlib/testlib_test.h>
+
+typedef vgl_rtree_point_box_2d<float> C_pt;
+typedef vgl_packed_rtree<C_pt::v_type, C_pt::b_type, C_pt> pt_tree;
+typedef vgl_rtree_box_box_2d<float> C_bx;
+typedef vgl_packed_rtree<C_bx::v_type, C_bx::b_type, C_bx> box_tree;
+
+static bool less_pt(vgl_point_2d<float> const& a, vgl_point_2d<float> const& b)
+{
+  return a.x()<b.x() || (a.x()==b.x() && a.y()<b.y());
+}
+
+static bool less_box(vgl_box_2d<float> const& a, vgl_box_2d<float> const& b)
+{
+  if (a.min_x()!=b.min_x()) return a.min_x()<b.min_x();
+  if (a.min_y()!=b.min_y()) return a.min_y()<b.min_y();
+  if (a.max_x()!=b.max_x()) return a.max_x()<b.max_x();
+  return a.max_y()<b.max_y();
+}
+
+//: Return true if found holds exactly the points of pts inside box.
+static bool same_as_brute_force(std::vector<vgl_point_2d<float> > const& pts,
+                                vgl_box_2d<float> const& box,
+                                std::vector<vgl_point_2d<float> > found)
+{
+  std::vector<vgl_point_2d<float> > expected;
+  for (unsigned i=0; i<pts.size(); ++i)
+    if (box.contains(pts[i])) expected.push_back(pts[i]);
+  std::sort(expected.begin(), expected.end(), less_pt);
+  std::sort(found.begin(), found.end(), less_pt);
+  return expected==found;
+}
+
+static vgl_box_2d<float> random_box(vnl_random& r, float max_size)
+{
+  float x = float(r.drand32(0.0, 1.0)), y = float(r.drand32(0.0, 1.0));
+  float w = float(r.drand32(0.0, max_size)), h = float(r.drand32(0.0, max_size));
+  return vgl_box_2d<float>(x, x+w, y, y+h);
+}
+
+static void test_point_tree()
+{
+  std::cout << "\n<<<<<<<   test packed point_box tree >>>>>>>>>>>>>>\n";
+  vnl_random r(9667566);
+  std::vector<vgl_point_2d<float> > pts(5000);
+  for (unsigned i=0; i<pts.size(); ++i)
+    pts[i].set(float(r.drand32(0.0, 1.0)), float(r.drand32(0.0, 1.0)));
+
+  pt_tree tr(pts, 8);
+  TEST("size", tr.size(), 5000);
+  TEST("enough leaves for 8 elements each", tr.nodes() >= 5000/8, true);
+  TEST("root bounds all points", tr.node_array()[0].bounds.contains(pts[17]), true);
+
+  bool ok = true;
+  std::vector<vgl_box_2d<float> > queries;
+  for (unsigned q=0; q<50; ++q)
+  {
+    vgl_box_2d<float> box = random_box(r, 0.3f);
+    queries.push_back(box);
+    std::vector<vgl_point_2d<float> > found;
+    tr.get(box, found);
+    ok = ok && same_as_brute_force(pts, box, found)
+            && tr.count(box)==found.size();
+  }
+  TEST("box queries match brute force", ok, true);
+
+  // Point queries: a zero size box at a stored point finds that point.
+  vgl_box_2d<float> at_pt; at_pt.add(pts[1234]);
+  std::vector<vgl_point_2d<float> > found;
+  tr.get(at_pt, found);
+  TEST("point query", found.size()==1 && found[0]==pts[1234], true);
+
+  std::vector<std::vector<vgl_point_2d<float> > > results;
+  tr.get(queries, results, 4);
+  ok = results.size()==queries.size();
+  for (unsigned q=0; ok && q<queries.size(); ++q)
+  {
+    std::vector<vgl_point_2d<float> > serial;
+    tr.get(queries[q], serial);
+    ok = serial==results[q];
+  }
+  TEST("threaded batch queries match single queries", ok, true);
+
+  // Round trip through a stream.
+  std::stringstream ss;
+  TEST("write", tr.write(ss), true);
+  std::string data = ss.str();
+  pt_tree tr2;
+  TEST("read", tr2.read(ss), true);
+  TEST("read size", tr2.size()==tr.size() && tr2.nodes()==tr.nodes(), true);
+  found.clear();
+  tr2.get(queries[3], found);
+  TEST("query after read", same_as_brute_force(pts, queries[3], found), true);
+
+  // Attach to an aligned copy of the data, as if memory mapped.
+  std::vector<double> buffer(data.size()/sizeof(double)+1);
+  std::copy(data.begin(), data.end(), reinterpret_cast<char*>(&buffer[0]));
+  pt_tree tr3;
+  TEST("attach", tr3.attach(&buffer[0], data.size()), true);
+  found.clear();
+  tr3.get(queries[5], found);
+  TEST("query after attach", same_as_brute_force(pts, queries[5], found), true);
+  TEST("attach rejects short buffer", tr3.attach(&buffer[0], data.size()/2), false);
+
+  box_tree wrong_type;
+  TEST("attach rejects other element type", wrong_type.attach(&buffer[0], data.size()), false);
+
+  // Corrupt node ranges must be rejected, not followed.
+  typedef pt_tree::node pt_node;
+  std::vector<double> bad(buffer);
+  pt_node* bad_nodes = reinterpret_cast<pt_node*>(reinterpret_cast<char*>(&bad[0]) + 64);
+  pt_tree tr4;
+  bad_nodes[0].first = 0; // root is its own child
+  TEST("attach rejects a cycle", tr4.attach(&bad[0], data.size()), false);
+  bad = buffer;
+  bad_nodes = reinterpret_cast<pt_node*>(reinterpret_cast<char*>(&bad[0]) + 64);
+  bad_nodes[tr.nodes()-1].count = tr.size()+1; // last leaf past the elements
+  TEST("attach rejects leaf out of range", tr4.attach(&bad[0], data.size()), false);
+  std::stringstream bad_ss(std::string(reinterpret_cast<char*>(&bad[0]), data.size()));
+  TEST("read rejects leaf out of range", tr4.read(bad_ss), false);
+  TEST("rejected tree unchanged", tr4.empty(), true);
+
+  pt_tree empty(std::vector<vgl_point_2d<float> >(), 8);
+  found.clear();
+  empty.get(queries[0], found);
+  TEST("empty tree", empty.empty() && found.empty(), true);
+}
+
+static void test_box_tree()
+{
+  std::cout << "\n<<<<<<<   test packed box_box tree >>>>>>>>>>>>>>\n";
+  vnl_random r(1234);
+  std::vector<vgl_box_2d<float> > boxes(3000);
+  for (unsigned i=0; i<boxes.size(); ++i)
+    boxes[i] = random_box(r, 0.05f);
+  box_tree tr(boxes);
+  TEST("size", tr.size(), 3000);
+
+  bool ok = true;
+  for (unsigned q=0; q<50; ++q)
+  {
+    // Include long thin regions, which cross boxes without containing corners.
+    vgl_bbox_2d<float> region;
+    region.add(vgl_point_2d<float>(float(r.drand32(0.0, 1.0)), float(r.drand32(0.0, 1.0))));
+    if (q%2)
+      region.add(vgl_point_2d<float>(region.min_x()+0.8f, region.min_y()+0.002f));
+    else
+      region.add(vgl_point_2d<float>(region.min_x()+0.1f, region.min_y()+0.1f));
+    std::vector<vgl_box_2d<float> > found, expected;
+    tr.get(region, found);
+    for (unsigned i=0; i<boxes.size(); ++i)
+      if (region.min_x()<=boxes[i].max_x() && boxes[i].min_x()<=region.max_x() &&
+          region.min_y()<=boxes[i].max_y() && boxes[i].min_y()<=region.max_y())
+        expected.push_back(boxes[i]);
+    std::sort(found.begin(), found.end(), less_box);
+    std::sort(expected.begin(), expected.end(), less_box);
+    ok = ok && found==expected;
+  }
+  TEST("box queries match brute force", ok, true);
+}
+
+static void test_packed_rtree()
+{
+  test_point_tree();
+  test_box_tree();
+}
+
+TESTMAIN(test_packed_rtree);
@@ -18,6 +18,7 @@
 #include <vgl/algo/vgl_orient_box_3d.hxx>
 #include <vgl/algo/vgl_orient_box_3d_operators.hxx>
 #include <vgl/algo/vgl_p_matrix.hxx>
+#include <vgl/algo/vgl_packed_rtree.hxx>
 #include <vgl/algo/vgl_rtree.hxx>
 
 int main() { return 0; }
@@ -0,0 +1,697 @@
+// This is core/vgl/algo/vgl_bvh_3d.cxx
+#include <algorithm>
+#include <cmath>
+#include "vgl_bvh_3d.h"
+//:
+// \file
+
+#include <vcl_cassert.h>
+#include <vxl_config.h>
+
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
+
+// Number of centroid bins tried along each axis when splitting a node.
+static const unsigned vgl_bvh_3d_n_bins = 16;
+
+const unsigned vgl_bvh_3d::no_triangle;
+
+//: Axis aligned box accumulated from points or boxes.
+struct vgl_bvh_3d_bounds
+{
+  double min[3], max[3];
+
+  vgl_bvh_3d_bounds() { reset(); }
+
+  void reset()
+  {
+    for (unsigned a=0; a<3; ++a) { min[a] = 1e300; max[a] = -1e300; }
+  }
+  void add(double const* p)
+  {
+    for (unsigned a=0; a<3; ++a)
+    {
+      if (p[a]<min[a]) min[a] = p[a];
+      if (p[a]>max[a]) max[a] = p[a];
+    }
+  }
+  void add(vgl_bvh_3d_bounds const& b)
+  {
+    for (unsigned a=0; a<3; ++a)
+    {
+      if (b.min[a]<min[a]) min[a] = b.min[a];
+      if (b.max[a]>max[a]) max[a] = b.max[a];
+    }
+  }
+  double half_area() const
+  {
+    if (min[0]>max[0]) return 0.0;
+    double dx = max[0]-min[0], dy = max[1]-min[1], dz = max[2]-min[2];
+    return dx*dy + dy*dz + dz*dx;
+  }
+};
+
+//: Which side of a split plane a triangle's centroid lies on.
+struct vgl_bvh_3d_on_left
+{
+  std::vector<double> const* centroids;
+  unsigned axis, split_bin;
+  double lo, scale;
+  bool operator()(unsigned t) const
+  {
+    unsigned b = unsigned(((*centroids)[3*t+axis]-lo)*scale);
+    if (b>=vgl_bvh_3d_n_bins) b = vgl_bvh_3d_n_bins-1;
+    return b<split_bin;
+  }
+};
+
+//: A node still to be filled in, over the triangles order[begin,end).
+struct vgl_bvh_3d_task
+{
+  unsigned node, begin, end;
+};
+
+vgl_bvh_3d::vgl_bvh_3d()
+{
+}
+
+vgl_bvh_3d::vgl_bvh_3d(std::vector<vgl_point_3d<double> > const& corners,
+                       unsigned max_leaf_size)
+{
+  build(corners, max_leaf_size);
+}
+
+vgl_bvh_3d::vgl_bvh_3d(std::vector<vgl_point_3d<double> > const& verts,
+                       std::vector<unsigned> const& indices,
+                       unsigned max_leaf_size)
+{
+  build(verts, indices, max_leaf_size);
+}
+
+void vgl_bvh_3d::clear()
+{
+  nodes_.clear();
+  corners_.clear();
+  tri_index_.clear();
+}
+
+void vgl_bvh_3d::build(std::vector<vgl_point_3d<double> > const& corners,
+                       unsigned max_leaf_size)
+{
+  const unsigned n = unsigned(corners.size()/3);
+  corners_.resize(9*std::size_t(n));
+  for (unsigned i=0; i<3*n; ++i)
+  {
+    corners_[3*i]   = corners[i].x();
+    corners_[3*i+1] = corners[i].y();
+    corners_[3*i+2] = corners[i].z();
+  }
+  build_nodes(max_leaf_size);
+}
+
+void vgl_bvh_3d::build(std::vector<vgl_point_3d<double> > const& verts,
+                       std::vector<unsigned> const& indices,
+                       unsigned max_leaf_size)
+{
+  const unsigned n = unsigned(indices.size()/3);
+  corners_.resize(9*std::size_t(n));
+  for (unsigned i=0; i<3*n; ++i)
+  {
+    assert(indices[i]<verts.size());
+    vgl_point_3d<double> const& p = verts[indices[i]];
+    corners_[3*i]   = p.x();
+    corners_[3*i+1] = p.y();
+    corners_[3*i+2] = p.z();
+  }
+  build_nodes(max_leaf_size);
+}
+
+//: Build the tree top down.
+// Each node is split at the bin boundary, over all three axes, that
+// minimises the SAH cost  A(left) N(left) + A(right) N(right),  A being
+// the surface area of the triangles' bounding box and N their number.
+void vgl_bvh_3d::build_nodes(unsigned max_leaf_size)
+{
+  if (max_leaf_size<1) max_leaf_size = 1;
+  const unsigned n = unsigned(corners_.size()/9);
+  nodes_.clear();
+  tri_index_.resize(n);
+  for (unsigned t=0; t<n; ++t) tri_index_[t] = t;
+  if (n==0) return;
+
+  std::vector<vgl_bvh_3d_bounds> tri_bounds(n);
+  std::vector<double> centroids(3*std::size_t(n));
+  for (unsigned t=0; t<n; ++t)
+  {
+    double const* c = &corners_[9*std::size_t(t)];
+    for (unsigned k=0; k<3; ++k)
+      tri_bounds[t].add(c+3*k);
+    for (unsigned a=0; a<3; ++a)
+      centroids[3*t+a] = (c[a]+c[3+a]+c[6+a])/3.0;
+  }
+
+  // order[first..first+count) are the triangles of each leaf
+  std::vector<unsigned>& order = tri_index_;
+  nodes_.reserve(2*std::size_t(n));
+  nodes_.push_back(node());
+  std::vector<vgl_bvh_3d_task> tasks;
+  vgl_bvh_3d_task root = { 0u, 0u, n };
+  tasks.push_back(root);
+  while (!tasks.empty())
+  {
+    vgl_bvh_3d_task tk = tasks.back();
+    tasks.pop_back();
+
+    vgl_bvh_3d_bounds bounds, cbounds;
+    for (unsigned i=tk.begin; i<tk.end; ++i)
+    {
+      bounds.add(tri_bounds[order[i]]);
+      cbounds.add(&centroids[3*order[i]]);
+    }
+    node& nd = nodes_[tk.node];
+    for (unsigned a=0; a<3; ++a) { nd.min[a] = bounds.min[a]; nd.max[a] = bounds.max[a]; }
+    nd.first = tk.begin;
+    nd.count = tk.end-tk.begin;
+    if (nd.count<=max_leaf_size)
+      continue;
+
+    // Find the cheapest split over the bins of each axis.
+    double best_cost = -1.0;
+    vgl_bvh_3d_on_left best;
+    best.centroids = &centroids;
+    for (unsigned a=0; a<3; ++a)
+    {
+      const double extent = cbounds.max[a]-cbounds.min[a];
+      if (!(extent>0.0))
+        continue;
+      const double scale = vgl_bvh_3d_n_bins/extent;
+      vgl_bvh_3d_bounds bin_bounds[vgl_bvh_3d_n_bins];
+      unsigned bin_count[vgl_bvh_3d_n_bins] = { 0 };
+      for (unsigned i=tk.begin; i<tk.end; ++i)
+      {
+        unsigned b = unsigned((centroids[3*order[i]+a]-cbounds.min[a])*scale);
+        if (b>=vgl_bvh_3d_n_bins) b = vgl_bvh_3d_n_bins-1;
+        ++bin_count[b];
+        bin_bounds[b].add(tri_bounds[order[i]]);
+      }
+      // right_cost[s] is the cost of the bins s and above
+      double right_cost[vgl_bvh_3d_n_bins];
+      vgl_bvh_3d_bounds acc;
+      unsigned cnt = 0;
+      for (unsigned b=vgl_bvh_3d_n_bins; b-->1; )
+      {
+        acc.add(bin_bounds[b]);
+        cnt += bin_count[b];
+        right_cost[b] = cnt ? acc.half_area()*cnt : -1.0;
+      }
+      acc.reset();
+      cnt = 0;
+      for (unsigned s=1; s<vgl_bvh_3d_n_bins; ++s)
+      {
+        acc.add(bin_bounds[s-1]);
+        cnt += bin_count[s-1];
+        if (cnt==0 || right_cost[s]<0.0)
+          continue;
+        const double cost = acc.half_area()*cnt + right_cost[s];
+        if (best_cost<0.0 || cost<best_cost)
+        {
+          best_cost = cost;
+          best.axis = a;
+          best.split_bin = s;
+          best.lo = cbounds.min[a];
+          best.scale = scale;
+        }
+      }
+    }
+    if (best_cost<0.0)
+      continue; // all centroids coincide, so keep them in one leaf
+
+    const unsigned mid = unsigned(std::partition(order.begin()+tk.begin,
+                                                 order.begin()+tk.end, best)
+                                  - order.begin());
+    assert(mid>tk.begin && mid<tk.end);
+    const unsigned child = unsigned(nodes_.size());
+    nodes_[tk.node].first = child;
+    nodes_[tk.node].count = 0;
+    nodes_.push_back(node());
+    nodes_.push_back(node());
+    vgl_bvh_3d_task right = { child+1, mid, tk.end };
+    vgl_bvh_3d_task left = { child, tk.begin, mid };
+    tasks.push_back(right);
+    tasks.push_back(left);
+  }
+
+  // Store the triangles in leaf order.
+  std::vector<double> sorted(corners_.size());
+  for (unsigned i=0; i<n; ++i)
+    std::copy(corners_.begin()+9*std::size_t(order[i]),
+              corners_.begin()+9*std::size_t(order[i])+9,
+              sorted.begin()+9*std::size_t(i));
+  corners_.swap(sorted);
+}
+
+vgl_box_3d<double> vgl_bvh_3d::bounding_box() const
+{
+  vgl_box_3d<double> box;
+  if (!nodes_.empty())
+  {
+    box.add(vgl_point_3d<double>(nodes_[0].min[0], nodes_[0].min[1], nodes_[0].min[2]));
+    box.add(vgl_point_3d<double>(nodes_[0].max[0], nodes_[0].max[1], nodes_[0].max[2]));
+  }
+  return box;
+}
+
+//: Distance along the ray to where it enters the node's box, or -1 if it misses.
+static inline double vgl_bvh_3d_enter(vgl_bvh_3d::node const& nd, double const* org,
+                                      double const* dir, double const* inv,
+                                      double t_max)
+{
+  double t0 = 0.0, t1 = t_max;
+  for (unsigned a=0; a<3; ++a)
+  {
+    if (dir[a]==0.0)
+    {
+      if (org[a]<nd.min[a] || org[a]>nd.max[a]) return -1.0;
+      continue;
+    }
+    double tn = (nd.min[a]-org[a])*inv[a];
+    double tf = (nd.max[a]-org[a])*inv[a];
+    if (tn>tf) std::swap(tn, tf);
+    if (tn>t0) t0 = tn;
+    if (tf<t1) t1 = tf;
+    if (t0>t1) return -1.0;
+  }
+  return t0;
+}
+
+//: Moller-Trumbore ray/triangle test; sets t and returns true on a hit.
+static inline bool vgl_bvh_3d_hit(double const* c, double const* org,
+                                  double const* dir, double& t)
+{
+  const double e1[3] = { c[3]-c[0], c[4]-c[1], c[5]-c[2] };
+  const double e2[3] = { c[6]-c[0], c[7]-c[1], c[8]-c[2] };
+  const double pv[3] = { dir[1]*e2[2]-dir[2]*e2[1],
+                         dir[2]*e2[0]-dir[0]*e2[2],
+                         dir[0]*e2[1]-dir[1]*e2[0] };
+  const double det = e1[0]*pv[0]+e1[1]*pv[1]+e1[2]*pv[2];
+  if (det==0.0) return false;
+  const double inv_det = 1.0/det;
+  const double tv[3] = { org[0]-c[0], org[1]-c[1], org[2]-c[2] };
+  const double u = (tv[0]*pv[0]+tv[1]*pv[1]+tv[2]*pv[2])*inv_det;
+  if (u<0.0 || u>1.0) return false;
+  const double qv[3] = { tv[1]*e1[2]-tv[2]*e1[1],
+                         tv[2]*e1[0]-tv[0]*e1[2],
+                         tv[0]*e1[1]-tv[1]*e1[0] };
+  const double v = (dir[0]*qv[0]+dir[1]*qv[1]+dir[2]*qv[2])*inv_det;
+  if (v<0.0 || u+v>1.0) return false;
+  t = (e2[0]*qv[0]+e2[1]*qv[1]+e2[2]*qv[2])*inv_det;
+  return t>=0.0;
+}
+
+bool vgl_bvh_3d::ray_cast(vgl_ray_3d<double> const& ray, double& t, unsigned& tri,
+                          double t_max) const
+{
+  if (nodes_.empty()) return false;
+  const double org[3] = { ray.origin().x(), ray.origin().y(), ray.origin().z() };
+  const double dir[3] = { ray.direction().x(), ray.direction().y(), ray.direction().z() };
+  double inv[3];
+  for (unsigned a=0; a<3; ++a)
+    inv[a] = dir[a]==0.0 ? 0.0 : 1.0/dir[a];
+
+  bool found = false;
+  double best = t_max;
+  std::vector<unsigned> stack;
+  stack.reserve(64);
+  if (vgl_bvh_3d_enter(nodes_[0], org, dir, inv, best)>=0.0)
+    stack.push_back(0);
+  while (!stack.empty())
+  {
+    node const& nd = nodes_[stack.back()];
+    stack.pop_back();
+    if (nd.count>0)
+    {
+      for (unsigned i=nd.first; i<nd.first+nd.count; ++i)
+      {
+        double th;
+        if (vgl_bvh_3d_hit(&corners_[9*std::size_t(i)], org, dir, th) &&
+            (found ? th<best : th<=best))
+        {
+          found = true;
+          best = th;
+          tri = tri_index_[i];
+        }
+      }
+      continue;
+    }
+    // Visit the nearer child first, so the farther one is often pruned.
+    const double ta = vgl_bvh_3d_enter(nodes_[nd.first], org, dir, inv, best);
+    const double tb = vgl_bvh_3d_enter(nodes_[nd.first+1], org, dir, inv, best);
+    if (ta>=0.0 && tb>=0.0)
+    {
+      stack.push_back(ta<=tb ? nd.first+1 : nd.first);
+      stack.push_back(ta<=tb ? nd.first : nd.first+1);
+    }
+    else if (ta>=0.0)
+      stack.push_back(nd.first);
+    else if (tb>=0.0)
+      stack.push_back(nd.first+1);
+  }
+  if (found) t = best;
+  return found;
+}
+
+//: Squared distance from q to the node's box.
+static inline double vgl_bvh_3d_box_sqr_dist(vgl_bvh_3d::node const& nd, double const* q)
+{
+  double d2 = 0.0;
+  for (unsigned a=0; a<3; ++a)
+  {
+    double d = q[a]<nd.min[a] ? nd.min[a]-q[a] : (q[a]>nd.max[a] ? q[a]-nd.max[a] : 0.0);
+    d2 += d*d;
+  }
+  return d2;
+}
+
+//: Closest point to q on the triangle with corners c, by Voronoi regions.
+// See C. Ericson, Real-Time Collision Detection, section 5.1.5.
+static void vgl_bvh_3d_closest(double const* c, double const* q, double* cp)
+{
+  double const* a = c;
+  double const* b = c+3;
+  double const* p = c+6; // corner "c" in Ericson
+  double ab[3], ac[3], ap[3], bp[3], cq[3];
+  for (unsigned k=0; k<3; ++k)
+  {
+    ab[k] = b[k]-a[k]; ac[k] = p[k]-a[k];
+    ap[k] = q[k]-a[k]; bp[k] = q[k]-b[k]; cq[k] = q[k]-p[k];
+  }
+#define VGL_BVH_3D_DOT(u,v) (u[0]*v[0]+u[1]*v[1]+u[2]*v[2])
+  const double d1 = VGL_BVH_3D_DOT(ab,ap), d2 = VGL_BVH_3D_DOT(ac,ap);
+  const double d3 = VGL_BVH_3D_DOT(ab,bp), d4 = VGL_BVH_3D_DOT(ac,bp);
+  const double d5 = VGL_BVH_3D_DOT(ab,cq), d6 = VGL_BVH_3D_DOT(ac,cq);
+#undef VGL_BVH_3D_DOT
+  double u, v; // cp = a + u*ab + v*ac
+  const double vc = d1*d4 - d3*d2;
+  const double vb = d5*d2 - d1*d6;
+  const double va = d3*d6 - d5*d4;
+  if (d1<=0.0 && d2<=0.0)                    { u = 0.0; v = 0.0; }
+  else if (d3>=0.0 && d4<=d3)                { u = 1.0; v = 0.0; }
+  else if (d6>=0.0 && d5<=d6)                { u = 0.0; v = 1.0; }
+  else if (vc<=0.0 && d1>=0.0 && d3<=0.0)    { u = d1/(d1-d3); v = 0.0; }
+  else if (vb<=0.0 && d2>=0.0 && d6<=0.0)    { u = 0.0; v = d2/(d2-d6); }
+  else if (va<=0.0 && d4-d3>=0.0 && d5-d6>=0.0)
+  {
+    const double w = (d4-d3)/((d4-d3)+(d5-d6));
+    u = 1.0-w; v = w;
+  }
+  else
+  {
+    const double denom = va+vb+vc;
+    if (denom==0.0)
+    {
+      // Degenerate triangle: take the nearest of the corners.
+      u = 0.0; v = 0.0;
+      double best = ap[0]*ap[0]+ap[1]*ap[1]+ap[2]*ap[2];
+      double db = bp[0]*bp[0]+bp[1]*bp[1]+bp[2]*bp[2];
+      double dc = cq[0]*cq[0]+cq[1]*cq[1]+cq[2]*cq[2];
+      if (db<best) { best = db; u = 1.0; }
+      if (dc<best) { u = 0.0; v = 1.0; }
+    }
+    else
+    {
+      u = vb/denom;
+      v = vc/denom;
+    }
+  }
+  for (unsigned k=0; k<3; ++k)
+    cp[k] = a[k] + u*ab[k] + v*ac[k];
+}
+
+bool vgl_bvh_3d::closest_point(vgl_point_3d<double> const& qp,
+                               vgl_point_3d<double>& cp, unsigned& tri,
+                               double max_dist) const
+{
+  if (nodes_.empty()) return false;
+  const double q[3] = { qp.x(), qp.y(), qp.z() };
+  bool found = false;
+  double best = max_dist<1e150 ? max_dist*max_dist : 1e300;
+  double best_p[3] = { 0.0, 0.0, 0.0 };
+  std::vector<unsigned> stack;
+  stack.reserve(64);
+  stack.push_back(0);
+  while (!stack.empty())
+  {
+    node const& nd = nodes_[stack.back()];
+    stack.pop_back();
+    if (vgl_bvh_3d_box_sqr_dist(nd, q)>best)
+      continue;
+    if (nd.count>0)
+    {
+      for (unsigned i=nd.first; i<nd.first+nd.count; ++i)
+      {
+        double p[3];
+        vgl_bvh_3d_closest(&corners_[9*std::size_t(i)], q, p);
+        const double d2 = (p[0]-q[0])*(p[0]-q[0]) + (p[1]-q[1])*(p[1]-q[1]) + (p[2]-q[2])*(p[2]-q[2]);
+        if (found ? d2<best : d2<=best)
+        {
+          found = true;
+          best = d2;
+          best_p[0] = p[0]; best_p[1] = p[1]; best_p[2] = p[2];
+          tri = tri_index_[i];
+        }
+      }
+      continue;
+    }
+    const double da = vgl_bvh_3d_box_sqr_dist(nodes_[nd.first], q);
+    const double db = vgl_bvh_3d_box_sqr_dist(nodes_[nd.first+1], q);
+    stack.push_back(da<=db ? nd.first+1 : nd.first);
+    stack.push_back(da<=db ? nd.first : nd.first+1);
+  }
+  if (found) cp.set(best_p[0], best_p[1], best_p[2]);
+  return found;
+}
+
+//: Separating axis test of a triangle against a box (centre bc, half sizes h).
+// See T. Akenine-Moller, Fast 3D triangle-box overlap testing, JGT 2001.
+static bool vgl_bvh_3d_tri_box(double const* c, double const* bc, double const* h)
+{
+  double v[3][3];
+  for (unsigned k=0; k<3; ++k)
+    for (unsigned a=0; a<3; ++a)
+      v[k][a] = c[3*k+a]-bc[a];
+
+  // the box axes
+  for (unsigned a=0; a<3; ++a)
+  {
+    const double lo = std::min(v[0][a], std::min(v[1][a], v[2][a]));
+    const double hi = std::max(v[0][a], std::max(v[1][a], v[2][a]));
+    if (lo>h[a] || hi<-h[a]) return false;
+  }
+
+  // the edge cross products
+  double e[3][3];
+  for (unsigned k=0; k<3; ++k)
+    for (unsigned a=0; a<3; ++a)
+      e[k][a] = v[(k+1)%3][a]-v[k][a];
+  for (unsigned k=0; k<3; ++k)
+    for (unsigned a=0; a<3; ++a)
+    {
+      // axis = e[k] x (unit vector a)
+      double ax[3];
+      ax[a] = 0.0;
+      ax[(a+1)%3] = e[k][(a+2)%3];
+      ax[(a+2)%3] = -e[k][(a+1)%3];
+      const double p0 = ax[0]*v[0][0]+ax[1]*v[0][1]+ax[2]*v[0][2];
+      const double p1 = ax[0]*v[1][0]+ax[1]*v[1][1]+ax[2]*v[1][2];
+      const double p2 = ax[0]*v[2][0]+ax[1]*v[2][1]+ax[2]*v[2][2];
+      const double r = h[0]*std::fabs(ax[0])+h[1]*std::fabs(ax[1])+h[2]*std::fabs(ax[2]);
+      if (std::min(p0, std::min(p1, p2))>r || std::max(p0, std::max(p1, p2))<-r)
+        return false;
+    }
+
+  // the triangle's plane
+  const double nrm[3] = { e[0][1]*e[1][2]-e[0][2]*e[1][1],
+                          e[0][2]*e[1][0]-e[0][0]*e[1][2],
+                          e[0][0]*e[1][1]-e[0][1]*e[1][0] };
+  const double d = nrm[0]*v[0][0]+nrm[1]*v[0][1]+nrm[2]*v[0][2];
+  const double r = h[0]*std::fabs(nrm[0])+h[1]*std::fabs(nrm[1])+h[2]*std::fabs(nrm[2]);
+  return std::fabs(d)<=r;
+}
+
+void vgl_bvh_3d::box_overlap(vgl_box_3d<double> const& box, std::vector<unsigned>& tris) const
+{
+  if (nodes_.empty() || box.is_empty()) return;
+  const double lo[3] = { box.min_x(), box.min_y(), box.min_z() };
+  const double hi[3] = { box.max_x(), box.max_y(), box.max_z() };
+  const double bc[3] = { (lo[0]+hi[0])/2, (lo[1]+hi[1])/2, (lo[2]+hi[2])/2 };
+  const double h[3] = { (hi[0]-lo[0])/2, (hi[1]-lo[1])/2, (hi[2]-lo[2])/2 };
+  const std::size_t n_before = tris.size();
+  std::vector<unsigned> stack(1, 0u);
+  while (!stack.empty())
+  {
+    node const& nd = nodes_[stack.back()];
+    stack.pop_back();
+    bool meet = true;
+    for (unsigned a=0; a<3 && meet; ++a)
+      meet = nd.min[a]<=hi[a] && nd.max[a]>=lo[a];
+    if (!meet)
+      continue;
+    if (nd.count>0)
+    {
+      for (unsigned i=nd.first; i<nd.first+nd.count; ++i)
+        if (vgl_bvh_3d_tri_box(&corners_[9*std::size_t(i)], bc, h))
+          tris.push_back(tri_index_[i]);
+    }
+    else
+    {
+      stack.push_back(nd.first+1);
+      stack.push_back(nd.first);
+    }
+  }
+  std::sort(tris.begin()+n_before, tris.end());
+}
+
+//: A share of a batch of queries.
+struct vgl_bvh_3d_query_job
+{
+  enum kind_t { RAY, CLOSEST, BOX };
+
+  vgl_bvh_3d const* tree;
+  kind_t kind;
+  unsigned begin, end;
+  double limit;
+  std::vector<vgl_ray_3d<double> > const* rays;
+  std::vector<vgl_point_3d<double> > const* points;
+  std::vector<vgl_box_3d<double> > const* boxes;
+  std::vector<double>* t;
+  std::vector<vgl_point_3d<double> >* cps;
+  std::vector<unsigned>* tris;
+  std::vector<std::vector<unsigned> >* tri_lists;
+
+  void run()
+  {
+    for (unsigned i=begin; i<end; ++i)
+    {
+      switch (kind)
+      {
+        case RAY:
+          if (!tree->ray_cast((*rays)[i], (*t)[i], (*tris)[i], limit))
+          {
+            (*t)[i] = limit;
+            (*tris)[i] = vgl_bvh_3d::no_triangle;
+          }
+          break;
+        case CLOSEST:
+          if (!tree->closest_point((*points)[i], (*cps)[i], (*tris)[i], limit))
+          {
+            (*cps)[i] = (*points)[i];
+            (*tris)[i] = vgl_bvh_3d::no_triangle;
+          }
+          break;
+        case BOX:
+          (*tri_lists)[i].clear();
+          tree->box_overlap((*boxes)[i], (*tri_lists)[i]);
+          break;
+      }
+    }
+  }
+
+  static void* run_thread(void* job)
+  {
+    static_cast<vgl_bvh_3d_query_job*>(job)->run();
+    return VXL_NULLPTR;
+  }
+};
+
+//: Share the queries [0,n) described by proto between n_threads threads.
+static void vgl_bvh_3d_run_batch(vgl_bvh_3d_query_job const& proto,
+                                 unsigned n, unsigned n_threads)
+{
+  if (n==0) return;
+#if !VXL_HAS_PTHREAD_H
+  n_threads = 1;
+#endif
+  if (n_threads<1) n_threads = 1;
+  if (n_threads>n) n_threads = n;
+
+  std::vector<vgl_bvh_3d_query_job> jobs(n_threads, proto);
+  for (unsigned t=0; t<n_threads; ++t)
+  {
+    jobs[t].begin = unsigned(std::size_t(t)*n/n_threads);
+    jobs[t].end = unsigned(std::size_t(t+1)*n/n_threads);
+  }
+#if VXL_HAS_PTHREAD_H
+  std::vector<pthread_t> threads(n_threads);
+  std::vector<bool> started(n_threads, false);
+  for (unsigned t=1; t<n_threads; ++t)
+    started[t] = pthread_create(&threads[t], VXL_NULLPTR,
+                                &vgl_bvh_3d_query_job::run_thread, &jobs[t])==0;
+  jobs[0].run();
+  for (unsigned t=1; t<n_threads; ++t)
+  {
+    if (started[t]) pthread_join(threads[t], VXL_NULLPTR);
+    else            jobs[t].run(); // Couldn't start thread - do it here
+  }
+#else
+  jobs[0].run();
+#endif
+}
+
+static vgl_bvh_3d_query_job vgl_bvh_3d_make_job(vgl_bvh_3d const* tree,
+                                                vgl_bvh_3d_query_job::kind_t kind)
+{
+  vgl_bvh_3d_query_job job;
+  job.tree = tree;
+  job.kind = kind;
+  job.begin = job.end = 0;
+  job.limit = 0.0;
+  job.rays = VXL_NULLPTR;
+  job.points = VXL_NULLPTR;
+  job.boxes = VXL_NULLPTR;
+  job.t = VXL_NULLPTR;
+  job.cps = VXL_NULLPTR;
+  job.tris = VXL_NULLPTR;
+  job.tri_lists = VXL_NULLPTR;
+  return job;
+}
+
+void vgl_bvh_3d::ray_cast(std::vector<vgl_ray_3d<double> > const& rays,
+                          std::vector<double>& t, std::vector<unsigned>& tris,
+                          unsigned n_threads, double t_max) const
+{
+  t.resize(rays.size());
+  tris.resize(rays.size());
+  vgl_bvh_3d_query_job job = vgl_bvh_3d_make_job(this, vgl_bvh_3d_query_job::RAY);
+  job.limit = t_max;
+  job.rays = &rays;
+  job.t = &t;
+  job.tris = &tris;
+  vgl_bvh_3d_run_batch(job, unsigned(rays.size()), n_threads);
+}
+
+void vgl_bvh_3d::closest_point(std::vector<vgl_point_3d<double> > const& qs,
+                               std::vector<vgl_point_3d<double> >& cps,
+                               std::vector<unsigned>& tris,
+                               unsigned n_threads, double max_dist) const
+{
+  cps.resize(qs.size());
+  tris.resize(qs.size());
+  vgl_bvh_3d_query_job job = vgl_bvh_3d_make_job(this, vgl_bvh_3d_query_job::CLOSEST);
+  job.limit = max_dist;
+  job.points = &qs;
+  job.cps = &cps;
+  job.tris = &tris;
+  vgl_bvh_3d_run_batch(job, unsigned(qs.size()), n_threads);
+}
+
+void vgl_bvh_3d::box_overlap(std::vector<vgl_box_3d<double> > const& boxes,
+                             std::vector<std::vector<unsigned> >& tris,
+                             unsigned n_threads) const
+{
+  tris.resize(boxes.size());
+  vgl_bvh_3d_query_job job = vgl_bvh_3d_make_job(this, vgl_bvh_3d_query_job::BOX);
+  job.boxes = &boxes;
+  job.tri_lists = &tris;
+  vgl_bvh_3d_run_batch(job, unsigned(boxes.size()), n_threads);
+}
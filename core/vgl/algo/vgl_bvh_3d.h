@@ -0,0 +1,136 @@
+// This is core/vgl/algo/vgl_bvh_3d.h
+#ifndef vgl_bvh_3d_h_
+#define vgl_bvh_3d_h_
+//:
+// \file
+// \brief Bounding volume hierarchy over a set of 3D triangles
+//
+// vgl_triangle_3d only provides tests between single pairs of objects, so
+// finding the first triangle hit by a ray, or the triangle nearest a point,
+// otherwise means looping over every triangle.  vgl_bvh_3d sorts the
+// triangles into a binary tree of axis aligned boxes, split using the
+// surface area heuristic (SAH) over binned triangle centroids, and stores
+// the nodes in a single array with the two children of each node next to
+// each other.  Ray casting, closest point and box overlap queries then
+// visit only the nodes whose boxes can hold an answer.
+//
+// Queries do not modify the tree, so any number of threads may query one
+// tree at once; the batched queries share their work between n_threads
+// threads, if threads are available.
+//--------------------------------------------------------------------------------
+
+#include <vector>
+#include <vcl_compiler.h>
+#include <vgl/vgl_point_3d.h>
+#include <vgl/vgl_box_3d.h>
+#include <vgl/vgl_ray_3d.h>
+
+class vgl_bvh_3d
+{
+ public:
+  //: Triangle index returned by queries which find no triangle.
+  static const unsigned no_triangle = static_cast<unsigned>(-1);
+
+  //: A node of the tree.
+  // For leaves (count>0), first and count index the stored triangles;
+  // otherwise the children are the nodes first and first+1.
+  struct node
+  {
+    double min[3], max[3];
+    unsigned first;
+    unsigned count;
+  };
+
+  //: Construct an empty tree.
+  vgl_bvh_3d();
+
+  //: Construct from a triangle soup, three corners per triangle.
+  explicit vgl_bvh_3d(std::vector<vgl_point_3d<double> > const& corners,
+                      unsigned max_leaf_size = 4);
+
+  //: Construct from an indexed triangle set, three vertex indices per triangle.
+  vgl_bvh_3d(std::vector<vgl_point_3d<double> > const& verts,
+             std::vector<unsigned> const& indices,
+             unsigned max_leaf_size = 4);
+
+  //: Replace the contents by a triangle soup, three corners per triangle.
+  // Leaves hold at most max_leaf_size triangles, unless the triangles
+  // cannot be separated (e.g. because their centroids coincide).
+  void build(std::vector<vgl_point_3d<double> > const& corners,
+             unsigned max_leaf_size = 4);
+
+  //: Replace the contents by an indexed triangle set.
+  // Triangle i has corners verts[indices[3*i]], verts[indices[3*i+1]]
+  // and verts[indices[3*i+2]].
+  void build(std::vector<vgl_point_3d<double> > const& verts,
+             std::vector<unsigned> const& indices,
+             unsigned max_leaf_size = 4);
+
+  //: Remove all triangles.
+  void clear();
+
+  //: Number of triangles.
+  unsigned size() const { return unsigned(tri_index_.size()); }
+
+  //: Return true iff the tree holds no triangles.
+  bool empty() const { return tri_index_.empty(); }
+
+  //: Number of nodes used by the tree.
+  unsigned nodes() const { return unsigned(nodes_.size()); }
+
+  //: Nodes, root first.
+  node const* node_array() const { return nodes_.empty() ? VXL_NULLPTR : &nodes_[0]; }
+
+  //: Bounding box of all the triangles.
+  vgl_box_3d<double> bounding_box() const;
+
+  //: Find the first triangle hit by the ray, at a distance of at most t_max.
+  // On success t is the distance along the (unit) ray direction and tri
+  // the triangle index.  Triangles are hit from either side.
+  bool ray_cast(vgl_ray_3d<double> const& ray, double& t, unsigned& tri,
+                double t_max = 1e300) const;
+
+  //: Find the point on the triangles closest to q, at a distance of at most max_dist.
+  bool closest_point(vgl_point_3d<double> const& q,
+                     vgl_point_3d<double>& cp, unsigned& tri,
+                     double max_dist = 1e300) const;
+
+  //: Append to tris the indices of the triangles which meet the box.
+  void box_overlap(vgl_box_3d<double> const& box, std::vector<unsigned>& tris) const;
+
+  //: Cast many rays at once.
+  // On exit tris[i] is the triangle first hit by rays[i] and t[i] its
+  // distance, or no_triangle and t_max if the ray hits nothing.
+  void ray_cast(std::vector<vgl_ray_3d<double> > const& rays,
+                std::vector<double>& t, std::vector<unsigned>& tris,
+                unsigned n_threads = 1, double t_max = 1e300) const;
+
+  //: Find the closest points to many points at once.
+  // Points with no triangle within max_dist get no_triangle, and a closest
+  // point equal to themselves.
+  void closest_point(std::vector<vgl_point_3d<double> > const& qs,
+                     std::vector<vgl_point_3d<double> >& cps,
+                     std::vector<unsigned>& tris,
+                     unsigned n_threads = 1, double max_dist = 1e300) const;
+
+  //: Find the triangles meeting each of many boxes.
+  // On exit tris[i] holds the triangles meeting boxes[i].
+  void box_overlap(std::vector<vgl_box_3d<double> > const& boxes,
+                   std::vector<std::vector<unsigned> >& tris,
+                   unsigned n_threads = 1) const;
+
+ private:
+  //: Build the nodes over the triangles in corners_, three points per triangle.
+  void build_nodes(unsigned max_leaf_size);
+
+  //: Nodes, root first.
+  std::vector<node> nodes_;
+
+  //: Triangle corners (9 coordinates per triangle), in leaf order.
+  std::vector<double> corners_;
+
+  //: Index of each stored triangle in the input.
+  std::vector<unsigned> tri_index_;
+};
+
+#endif // vgl_bvh_3d_h_
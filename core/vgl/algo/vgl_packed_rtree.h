@@ -0,0 +1,166 @@
+// This is core/vgl/algo/vgl_packed_rtree.h
+#ifndef vgl_packed_rtree_h_
+#define vgl_packed_rtree_h_
+//:
+// \file
+// \brief Static rtree, bulk loaded into flat arrays
+//
+// vgl_rtree is built by inserting one element at a time, with every node
+// allocated separately.  For large static collections (millions of
+// footprints or block bounding boxes) vgl_packed_rtree is much faster to
+// build and to query: the elements are sorted once with the
+// Sort-Tile-Recursive (STR) algorithm of Leutenegger, Lopez and Edgington
+// (ICDE 1997), and the nodes are packed into a single array, root first,
+// with the children of each node stored contiguously.
+//
+// The packed arrays can be written to a stream, and a tree can be
+// attached to a block of memory holding that data (e.g. a memory-mapped
+// file) without copying or rebuilding it.
+//--------------------------------------------------------------------------------
+
+#include <vector>
+#include <iosfwd>
+#include <cstddef>
+#include <vcl_compiler.h>
+
+//: Static rtree of Vs with bounds of type B, packed into flat arrays.
+// The template arguments are as for vgl_rtree, and the same helper C
+// classes (e.g. those in vgl_rtree_c.h) can be used.  C must provide
+// \code
+//   void C::init  (B &, V const &);
+//   void C::update(B &, B const &);
+//   bool C::meet  (B const &, V const &);
+//   bool C::meet  (B const &, B const &);
+// \endcode
+// and B must provide centroid_x() and centroid_y(), which are used to
+// sort the elements (as do vgl_box_2d and vgl_box_3d).
+//
+// To use write() and attach(), V and B must be plain data which can be
+// copied byte by byte, such as vgl_point_2d<T> and vgl_box_2d<T>.
+//
+// Queries do not modify the tree, so any number of threads may query
+// one tree at once.
+template <class V, class B, class C>
+class vgl_packed_rtree
+{
+ public:
+  //: A node of the tree.
+  // For leaves, first and count index the elements; otherwise they index
+  // the child nodes.
+  struct node
+  {
+    B bounds;
+    unsigned first;
+    unsigned count;
+  };
+
+  //: Construct an empty tree.
+  vgl_packed_rtree();
+
+  //: Construct by bulk loading the given elements.
+  vgl_packed_rtree(std::vector<V> const& vs, unsigned max_children = 16);
+
+  //: Replace the contents of the tree by the given elements.
+  // Each node has at most max_children children (or elements).
+  void build(std::vector<V> const& vs, unsigned max_children = 16);
+
+  //: Remove all elements.
+  void clear();
+
+  //: Return number of elements stored in the tree.
+  unsigned size() const { return n_elements_; }
+
+  //: Return true iff the tree has no elements.
+  bool empty() const { return n_elements_==0; }
+
+  //: Return number of nodes used by the tree.
+  unsigned nodes() const { return n_nodes_; }
+
+  //: Elements, in the order in which they are stored in the leaves.
+  V const* elements() const { return elements_; }
+
+  //: Nodes, root first.
+  node const* node_array() const { return nodes_; }
+
+  //: Index of the first leaf in node_array(); all later nodes are leaves.
+  unsigned first_leaf() const { return first_leaf_; }
+
+  //: Append to vs the elements which meet the given region.
+  void get(B const& region, std::vector<V>& vs) const;
+
+  //: Append to indices the positions in elements() of the elements which meet the region.
+  void get_indices(B const& region, std::vector<unsigned>& indices) const;
+
+  //: Return number of elements which meet the given region.
+  unsigned count(B const& region) const;
+
+  //: Query many regions at once.
+  // On exit results[i] holds the elements meeting regions[i].
+  // The regions are shared between n_threads threads, if threads are
+  // available.  Point queries can be made with regions of zero size.
+  void get(std::vector<B> const& regions,
+           std::vector<std::vector<V> >& results,
+           unsigned n_threads = 1) const;
+
+  //: Write the packed arrays to a binary stream.
+  // The data can be read back with read(), or the stream contents
+  // loaded or mapped into memory and passed to attach().
+  bool write(std::ostream& os) const;
+
+  //: Read packed arrays previously written with write().
+  // \return false, leaving the tree unchanged, if the stream does not hold
+  // a consistent tree of this type.
+  bool read(std::istream& is);
+
+  //: Use packed arrays held in memory, as produced by write().
+  // No data is copied: the memory must stay valid, and unchanged, for
+  // as long as the tree uses it.  The buffer must be aligned at least
+  // as strictly as V and B (memory from mmap or new[] is).
+  // \return false, leaving the tree unchanged, if the buffer does not hold
+  // a consistent tree of this type.
+  bool attach(void const* buffer, std::size_t n_bytes);
+
+ private:
+  //: Header written in front of the packed arrays.
+  struct header
+  {
+    char magic[8];
+    unsigned sizeof_v, sizeof_b, sizeof_node;
+    unsigned n_elements, n_nodes, first_leaf;
+    unsigned pad[2];
+  };
+
+  //: Sort items (with the given bounds) into STR order, in place.
+  static void str_sort(std::vector<unsigned>& order,
+                       std::vector<B> const& bounds,
+                       unsigned max_children);
+
+  //: Point at the owned arrays.
+  void use_owned();
+
+  static void make_header(header& h, unsigned n_elements,
+                          unsigned n_nodes, unsigned first_leaf);
+
+  //: True if the nodes form a tree whose ranges lie within the arrays.
+  // Every node must be non-empty, internal nodes must refer to later
+  // nodes, and every node other than the root must have exactly one parent.
+  static bool valid_nodes(node const* nodes, unsigned n_nodes,
+                          unsigned n_elements, unsigned first_leaf);
+
+  //: Elements and nodes, when owned by the tree.
+  std::vector<V> owned_elements_;
+  std::vector<node> owned_nodes_;
+
+  //: Elements and nodes in use, either owned or attached.
+  V const* elements_;
+  node const* nodes_;
+  unsigned n_elements_, n_nodes_, first_leaf_;
+
+  // Copying would leave the pointers referring to the original's arrays.
+  vgl_packed_rtree(vgl_packed_rtree<V, B, C> const&);
+  vgl_packed_rtree<V, B, C>& operator=(vgl_packed_rtree<V, B, C> const&);
+};
+
+#define VGL_PACKED_RTREE_INSTANTIATE(V, B, C) extern "you must include vgl_packed_rtree.hxx first"
+
+#endif // vgl_packed_rtree_h_
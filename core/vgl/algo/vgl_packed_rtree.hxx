@@ -0,0 +1,440 @@
+// This is core/vgl/algo/vgl_packed_rtree.hxx
+#ifndef vgl_packed_rtree_hxx_
+#define vgl_packed_rtree_hxx_
+//:
+// \file
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include "vgl_packed_rtree.h"
+#include <vcl_cassert.h>
+#include <vxl_config.h>
+
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
+
+// Size of the header and the alignment of each array in the packed data.
+static const std::size_t vgl_packed_rtree_header_size = 64;
+static const std::size_t vgl_packed_rtree_align = 16;
+static const char vgl_packed_rtree_magic[8] = { 'v','g','l','p','r','t','1','\0' };
+
+inline std::size_t vgl_packed_rtree_round_up(std::size_t n)
+{
+  return (n + vgl_packed_rtree_align - 1) / vgl_packed_rtree_align * vgl_packed_rtree_align;
+}
+
+//: Compare items by the centroids of their bounds.
+template <class B>
+struct vgl_packed_rtree_less_x
+{
+  std::vector<B> const* bounds;
+  bool operator()(unsigned a, unsigned b) const
+  { return (*bounds)[a].centroid_x() < (*bounds)[b].centroid_x(); }
+};
+
+template <class B>
+struct vgl_packed_rtree_less_y
+{
+  std::vector<B> const* bounds;
+  bool operator()(unsigned a, unsigned b) const
+  { return (*bounds)[a].centroid_y() < (*bounds)[b].centroid_y(); }
+};
+
+template <class V, class B, class C>
+vgl_packed_rtree<V, B, C>::vgl_packed_rtree()
+  : elements_(VXL_NULLPTR), nodes_(VXL_NULLPTR),
+    n_elements_(0), n_nodes_(0), first_leaf_(0)
+{
+}
+
+template <class V, class B, class C>
+vgl_packed_rtree<V, B, C>::vgl_packed_rtree(std::vector<V> const& vs,
+                                            unsigned max_children)
+  : elements_(VXL_NULLPTR), nodes_(VXL_NULLPTR),
+    n_elements_(0), n_nodes_(0), first_leaf_(0)
+{
+  build(vs, max_children);
+}
+
+template <class V, class B, class C>
+void vgl_packed_rtree<V, B, C>::clear()
+{
+  owned_elements_.clear();
+  owned_nodes_.clear();
+  use_owned();
+}
+
+template <class V, class B, class C>
+void vgl_packed_rtree<V, B, C>::use_owned()
+{
+  n_elements_ = unsigned(owned_elements_.size());
+  n_nodes_ = unsigned(owned_nodes_.size());
+  elements_ = n_elements_ ? &owned_elements_[0] : VXL_NULLPTR;
+  nodes_ = n_nodes_ ? &owned_nodes_[0] : VXL_NULLPTR;
+  if (n_nodes_==0) first_leaf_ = 0;
+}
+
+//: Sort-Tile-Recursive ordering.
+// Sort by x, cut into about sqrt(n/M) vertical slices, then sort each
+// slice by y, so that runs of M consecutive items form compact tiles.
+template <class V, class B, class C>
+void vgl_packed_rtree<V, B, C>::str_sort(std::vector<unsigned>& order,
+                                         std::vector<B> const& bounds,
+                                         unsigned max_children)
+{
+  const std::size_t n = order.size();
+  const std::size_t n_groups = (n + max_children - 1) / max_children;
+  std::size_t n_slices = std::size_t(std::ceil(std::sqrt(double(n_groups))));
+  if (n_slices<1) n_slices = 1;
+  const std::size_t slice_size = n_slices * max_children;
+
+  vgl_packed_rtree_less_x<B> less_x; less_x.bounds = &bounds;
+  vgl_packed_rtree_less_y<B> less_y; less_y.bounds = &bounds;
+  std::sort(order.begin(), order.end(), less_x);
+  for (std::size_t s=0; s<n; s+=slice_size)
+    std::sort(order.begin()+s, order.begin()+std::min(n, s+slice_size), less_y);
+}
+
+template <class V, class B, class C>
+void vgl_packed_rtree<V, B, C>::build(std::vector<V> const& vs,
+                                      unsigned max_children)
+{
+  if (max_children<2) max_children = 2;
+  owned_nodes_.clear();
+  owned_elements_.clear();
+  const unsigned n = unsigned(vs.size());
+  if (n==0) { use_owned(); return; }
+
+  // Sort the elements into leaf order.
+  std::vector<B> bounds(n);
+  for (unsigned i=0; i<n; ++i)
+    C::init(bounds[i], vs[i]);
+  std::vector<unsigned> order(n);
+  for (unsigned i=0; i<n; ++i) order[i] = i;
+  str_sort(order, bounds, max_children);
+  owned_elements_.resize(n);
+  std::vector<B> sorted_bounds(n);
+  for (unsigned i=0; i<n; ++i)
+  {
+    owned_elements_[i] = vs[order[i]];
+    sorted_bounds[i] = bounds[order[i]];
+  }
+
+  // Build the levels bottom up.  Each level is STR sorted before its
+  // parents are formed, which only permutes whole nodes, so the child
+  // ranges of those nodes stay valid.
+  std::vector<std::vector<node> > levels(1);
+  for (unsigned i=0; i<n; i+=max_children)
+  {
+    node nd;
+    nd.first = i;
+    nd.count = std::min(max_children, n-i);
+    nd.bounds = sorted_bounds[i];
+    for (unsigned k=1; k<nd.count; ++k)
+      C::update(nd.bounds, sorted_bounds[i+k]);
+    levels[0].push_back(nd);
+  }
+  while (levels.back().size()>1)
+  {
+    std::vector<node>& lower = levels.back();
+    const unsigned m = unsigned(lower.size());
+    std::vector<B> lb(m);
+    for (unsigned i=0; i<m; ++i) lb[i] = lower[i].bounds;
+    order.resize(m);
+    for (unsigned i=0; i<m; ++i) order[i] = i;
+    str_sort(order, lb, max_children);
+    std::vector<node> sorted(m);
+    for (unsigned i=0; i<m; ++i) sorted[i] = lower[order[i]];
+    lower.swap(sorted);
+
+    std::vector<node> upper;
+    for (unsigned i=0; i<m; i+=max_children)
+    {
+      node nd;
+      nd.first = i;
+      nd.count = std::min(max_children, m-i);
+      nd.bounds = lower[i].bounds;
+      for (unsigned k=1; k<nd.count; ++k)
+        C::update(nd.bounds, lower[i+k].bounds);
+      upper.push_back(nd);
+    }
+    levels.push_back(upper);
+  }
+
+  // Flatten, root first.
+  const unsigned n_levels = unsigned(levels.size());
+  std::vector<unsigned> offset(n_levels);
+  unsigned total = 0;
+  for (unsigned l=n_levels; l-->0; )
+  {
+    offset[l] = total;
+    total += unsigned(levels[l].size());
+  }
+  owned_nodes_.reserve(total);
+  for (unsigned l=n_levels; l-->0; )
+    for (unsigned i=0; i<levels[l].size(); ++i)
+    {
+      node nd = levels[l][i];
+      if (l>0) nd.first += offset[l-1];
+      owned_nodes_.push_back(nd);
+    }
+  first_leaf_ = offset[0];
+  use_owned();
+}
+
+template <class V, class B, class C>
+void vgl_packed_rtree<V, B, C>::get_indices(B const& region,
+                                            std::vector<unsigned>& indices) const
+{
+  if (n_nodes_==0) return;
+  std::vector<unsigned> stack(1, 0u);
+  while (!stack.empty())
+  {
+    node const& nd = nodes_[stack.back()];
+    const bool leaf = stack.back() >= first_leaf_;
+    stack.pop_back();
+    if (!C::meet(region, nd.bounds))
+      continue;
+    const unsigned end = nd.first + nd.count;
+    if (leaf)
+    {
+      for (unsigned e=nd.first; e<end; ++e)
+        if (C::meet(region, elements_[e]))
+          indices.push_back(e);
+    }
+    else
+    {
+      // Push in reverse, so that children are visited in storage order.
+      for (unsigned c=end; c-->nd.first; )
+        stack.push_back(c);
+    }
+  }
+}
+
+template <class V, class B, class C>
+void vgl_packed_rtree<V, B, C>::get(B const& region, std::vector<V>& vs) const
+{
+  std::vector<unsigned> indices;
+  get_indices(region, indices);
+  vs.reserve(vs.size()+indices.size());
+  for (unsigned i=0; i<indices.size(); ++i)
+    vs.push_back(elements_[indices[i]]);
+}
+
+template <class V, class B, class C>
+unsigned vgl_packed_rtree<V, B, C>::count(B const& region) const
+{
+  std::vector<unsigned> indices;
+  get_indices(region, indices);
+  return unsigned(indices.size());
+}
+
+//: A share of a batch of queries.
+template <class V, class B, class C>
+struct vgl_packed_rtree_query_job
+{
+  vgl_packed_rtree<V, B, C> const* tree;
+  std::vector<B> const* regions;
+  std::vector<std::vector<V> >* results;
+  unsigned begin, end;
+
+  void run()
+  {
+    for (unsigned i=begin; i<end; ++i)
+      tree->get((*regions)[i], (*results)[i]);
+  }
+
+  static void* run_thread(void* job)
+  {
+    static_cast<vgl_packed_rtree_query_job<V, B, C>*>(job)->run();
+    return VXL_NULLPTR;
+  }
+};
+
+template <class V, class B, class C>
+void vgl_packed_rtree<V, B, C>::get(std::vector<B> const& regions,
+                                    std::vector<std::vector<V> >& results,
+                                    unsigned n_threads) const
+{
+  const unsigned n = unsigned(regions.size());
+  results.resize(n);
+  for (unsigned i=0; i<n; ++i) results[i].clear();
+  if (n==0) return;
+#if !VXL_HAS_PTHREAD_H
+  n_threads = 1;
+#endif
+  if (n_threads<1) n_threads = 1;
+  if (n_threads>n) n_threads = n;
+
+  std::vector<vgl_packed_rtree_query_job<V, B, C> > jobs(n_threads);
+  for (unsigned t=0; t<n_threads; ++t)
+  {
+    jobs[t].tree = this;
+    jobs[t].regions = &regions;
+    jobs[t].results = &results;
+    jobs[t].begin = unsigned(std::size_t(t)*n/n_threads);
+    jobs[t].end = unsigned(std::size_t(t+1)*n/n_threads);
+  }
+#if VXL_HAS_PTHREAD_H
+  std::vector<pthread_t> threads(n_threads);
+  std::vector<bool> started(n_threads, false);
+  for (unsigned t=1; t<n_threads; ++t)
+    started[t] = pthread_create(&threads[t], VXL_NULLPTR,
+                                &vgl_packed_rtree_query_job<V, B, C>::run_thread,
+                                &jobs[t])==0;
+  jobs[0].run();
+  for (unsigned t=1; t<n_threads; ++t)
+  {
+    if (started[t]) pthread_join(threads[t], VXL_NULLPTR);
+    else            jobs[t].run(); // Couldn't start thread - do it here
+  }
+#else
+  jobs[0].run();
+#endif
+}
+
+template <class V, class B, class C>
+void vgl_packed_rtree<V, B, C>::make_header(header& h, unsigned n_elements,
+                                            unsigned n_nodes, unsigned first_leaf)
+{
+  assert(sizeof(header) <= vgl_packed_rtree_header_size);
+  std::memset(&h, 0, sizeof(header));
+  std::memcpy(h.magic, vgl_packed_rtree_magic, 8);
+  h.sizeof_v = unsigned(sizeof(V));
+  h.sizeof_b = unsigned(sizeof(B));
+  h.sizeof_node = unsigned(sizeof(node));
+  h.n_elements = n_elements;
+  h.n_nodes = n_nodes;
+  h.first_leaf = first_leaf;
+}
+
+template <class V, class B, class C>
+bool vgl_packed_rtree<V, B, C>::valid_nodes(node const* nodes, unsigned n_nodes,
+                                            unsigned n_elements, unsigned first_leaf)
+{
+  if (n_nodes==0)
+    return n_elements==0 && first_leaf==0;
+  if (first_leaf>=n_nodes)
+    return false;
+  std::vector<unsigned char> has_parent(n_nodes, 0);
+  for (unsigned i=0; i<n_nodes; ++i)
+  {
+    node const& nd = nodes[i];
+    if (nd.count==0)
+      return false;
+    const unsigned long long end = (unsigned long long)nd.first + nd.count;
+    if (i>=first_leaf)
+    {
+      if (end>n_elements)
+        return false;
+      continue;
+    }
+    if (nd.first<=i || end>n_nodes)
+      return false;
+    for (unsigned c=nd.first; c<end; ++c)
+    {
+      if (has_parent[c])
+        return false;
+      has_parent[c] = 1;
+    }
+  }
+  for (unsigned i=1; i<n_nodes; ++i)
+    if (!has_parent[i])
+      return false;
+  return true;
+}
+
+template <class V, class B, class C>
+bool vgl_packed_rtree<V, B, C>::write(std::ostream& os) const
+{
+  header h;
+  make_header(h, n_elements_, n_nodes_, first_leaf_);
+  char zeros[vgl_packed_rtree_header_size];
+  std::memset(zeros, 0, sizeof(zeros));
+  os.write(reinterpret_cast<char const*>(&h), sizeof(header));
+  os.write(zeros, vgl_packed_rtree_header_size - sizeof(header));
+  std::size_t node_bytes = std::size_t(n_nodes_)*sizeof(node);
+  if (node_bytes)
+    os.write(reinterpret_cast<char const*>(nodes_), node_bytes);
+  os.write(zeros, vgl_packed_rtree_round_up(node_bytes) - node_bytes);
+  if (n_elements_)
+    os.write(reinterpret_cast<char const*>(elements_),
+             std::size_t(n_elements_)*sizeof(V));
+  return os.good();
+}
+
+template <class V, class B, class C>
+bool vgl_packed_rtree<V, B, C>::read(std::istream& is)
+{
+  char buf[vgl_packed_rtree_header_size];
+  if (!is.read(buf, vgl_packed_rtree_header_size))
+    return false;
+  header h, expected;
+  std::memcpy(&h, buf, sizeof(header));
+  make_header(expected, h.n_elements, h.n_nodes, h.first_leaf);
+  if (std::memcmp(&h, &expected, sizeof(header))!=0)
+    return false;
+
+  std::vector<node> nodes(h.n_nodes);
+  std::vector<V> elements(h.n_elements);
+  std::size_t node_bytes = std::size_t(h.n_nodes)*sizeof(node);
+  if (node_bytes && !is.read(reinterpret_cast<char*>(&nodes[0]), node_bytes))
+    return false;
+  is.ignore(vgl_packed_rtree_round_up(node_bytes) - node_bytes);
+  if (h.n_elements &&
+      !is.read(reinterpret_cast<char*>(&elements[0]),
+               std::size_t(h.n_elements)*sizeof(V)))
+    return false;
+  if (!valid_nodes(h.n_nodes ? &nodes[0] : VXL_NULLPTR,
+                   h.n_nodes, h.n_elements, h.first_leaf))
+    return false;
+
+  owned_nodes_.swap(nodes);
+  owned_elements_.swap(elements);
+  use_owned();
+  first_leaf_ = h.first_leaf;
+  return true;
+}
+
+template <class V, class B, class C>
+bool vgl_packed_rtree<V, B, C>::attach(void const* buffer, std::size_t n_bytes)
+{
+  if (n_bytes < vgl_packed_rtree_header_size)
+    return false;
+  header h, expected;
+  std::memcpy(&h, buffer, sizeof(header));
+  make_header(expected, h.n_elements, h.n_nodes, h.first_leaf);
+  if (std::memcmp(&h, &expected, sizeof(header))!=0)
+    return false;
+  std::size_t node_bytes = std::size_t(h.n_nodes)*sizeof(node);
+  std::size_t elem_start = vgl_packed_rtree_header_size
+                         + vgl_packed_rtree_round_up(node_bytes);
+  if (n_bytes < elem_start + std::size_t(h.n_elements)*sizeof(V))
+    return false;
+  char const* base = static_cast<char const*>(buffer);
+  node const* nodes = h.n_nodes ?
+    reinterpret_cast<node const*>(base + vgl_packed_rtree_header_size) : VXL_NULLPTR;
+  if (!valid_nodes(nodes, h.n_nodes, h.n_elements, h.first_leaf))
+    return false;
+
+  owned_nodes_.clear();
+  owned_elements_.clear();
+  nodes_ = nodes;
+  elements_ = h.n_elements ?
+    reinterpret_cast<V const*>(base + elem_start) : VXL_NULLPTR;
+  n_nodes_ = h.n_nodes;
+  n_elements_ = h.n_elements;
+  first_leaf_ = h.first_leaf;
+  return true;
+}
+
+#undef VGL_PACKED_RTREE_INSTANTIATE
+#define VGL_PACKED_RTREE_INSTANTIATE(V, B, C) \
+template class vgl_packed_rtree<V, B, C >; \
+template struct vgl_packed_rtree_query_job<V, B, C >
+
+#endif // vgl_packed_rtree_hxx_
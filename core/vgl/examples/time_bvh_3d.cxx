@@ -0,0 +1,116 @@
+// This is core/vgl/examples/time_bvh_3d.cxx
+//:
+// \file
+// \brief Compare timings of triangle queries with and without vgl_bvh_3d.
+//
+// For a range of triangle soup sizes, times:
+//  - building the tree;
+//  - casting rays and finding closest points by looping over every
+//    triangle, against single queries of the tree;
+//  - batched tree queries on 1, 2, 4 and 8 threads.
+//
+// Usage: time_bvh_3d [n_queries]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+#include <vcl_compiler.h>
+#include <vul/vul_timer.h>
+#include <vgl/vgl_point_3d.h>
+#include <vgl/vgl_ray_3d.h>
+#include <vgl/vgl_distance.h>
+#include <vgl/vgl_triangle_3d.h>
+#include <vgl/algo/vgl_bvh_3d.h>
+#include <vnl/vnl_random.h>
+
+static vgl_point_3d<double> random_point(vnl_random& rng, double size)
+{
+  return vgl_point_3d<double>(rng.drand64(0,size), rng.drand64(0,size), rng.drand64(0,size));
+}
+
+int main(int argc, char** argv)
+{
+  unsigned n_queries = argc>1 ? std::atoi(argv[1]) : 10000;
+  const unsigned sizes[] = { 1000, 10000, 100000, 1000000 };
+  const unsigned n_sizes = sizeof(sizes)/sizeof(sizes[0]);
+  vnl_random rng(9667566);
+
+  std::vector<vgl_ray_3d<double> > rays(n_queries);
+  std::vector<vgl_point_3d<double> > qs(n_queries);
+  for (unsigned i=0; i<n_queries; ++i)
+  {
+    vgl_point_3d<double> o = random_point(rng, 100.0);
+    rays[i] = vgl_ray_3d<double>(o, random_point(rng, 100.0)-o);
+    qs[i] = random_point(rng, 100.0);
+  }
+
+  std::cout << n_queries << " queries; times in ms; brute force times for 1/100 of the queries\n"
+            << "  triangles  build  ray(brute)  ray(bvh)  closest(brute)  closest(bvh)"
+            << "  batch 1/2/4/8 threads (rays+closest)\n";
+  for (unsigned s=0; s<n_sizes; ++s)
+  {
+    const unsigned n = sizes[s];
+    const double size = std::max(1.0, 100.0/std::pow(double(n), 1.0/3.0));
+    std::vector<vgl_point_3d<double> > corners;
+    for (unsigned i=0; i<n; ++i)
+    {
+      vgl_point_3d<double> c = random_point(rng, 100.0);
+      for (unsigned k=0; k<3; ++k)
+        corners.push_back(c + (random_point(rng, size)-vgl_point_3d<double>(size/2,size/2,size/2)));
+    }
+
+    vul_timer t;
+    vgl_bvh_3d bvh(corners);
+    long t_build = t.real();
+
+    // brute force, on a subset of the queries
+    const unsigned n_brute = std::max(1u, n_queries/100);
+    t.mark();
+    for (unsigned i=0; i<n_brute; ++i)
+    {
+      vgl_line_segment_3d<double> seg(rays[i].origin(), rays[i].origin()+1000.0*rays[i].direction());
+      for (unsigned j=0; j<corners.size(); j+=3)
+      {
+        vgl_point_3d<double> p;
+        vgl_triangle_3d_line_intersection(seg, corners[j], corners[j+1], corners[j+2], p, true);
+      }
+    }
+    long t_ray_brute = t.real();
+    t.mark();
+    for (unsigned i=0; i<n_brute; ++i)
+      for (unsigned j=0; j<corners.size(); j+=3)
+        vgl_triangle_3d_distance(qs[i], corners[j], corners[j+1], corners[j+2]);
+    long t_cp_brute = t.real();
+
+    t.mark();
+    double th;
+    unsigned tri;
+    for (unsigned i=0; i<n_queries; ++i)
+      bvh.ray_cast(rays[i], th, tri);
+    long t_ray = t.real();
+    t.mark();
+    vgl_point_3d<double> cp;
+    for (unsigned i=0; i<n_queries; ++i)
+      bvh.closest_point(qs[i], cp, tri);
+    long t_cp = t.real();
+
+    std::cout << std::setw(11) << n << std::setw(7) << t_build
+              << std::setw(12) << t_ray_brute << std::setw(10) << t_ray
+              << std::setw(16) << t_cp_brute << std::setw(14) << t_cp << "  ";
+    for (unsigned n_threads=1; n_threads<=8; n_threads*=2)
+    {
+      std::vector<double> ts;
+      std::vector<unsigned> tris;
+      std::vector<vgl_point_3d<double> > cps;
+      t.mark();
+      bvh.ray_cast(rays, ts, tris, n_threads);
+      bvh.closest_point(qs, cps, tris, n_threads);
+      std::cout << std::setw(6) << t.real();
+    }
+    std::cout << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,87 @@
+// This is core/vil/algo/tests/bench_vil_algo.cxx
+//:
+// \file
+// \brief Benchmarks of vil image filtering and resampling kernels
+// See testlib_bench.h for the options, e.g. --csv to save a baseline.
+
+#include <vxl_config.h>
+#include <testlib/testlib_bench.h>
+#include <vil/vil_image_view.h>
+#include <vil/vil_resample_bilin.h>
+#include <vil/algo/vil_convolve_1d.h>
+
+static const unsigned bench_ni = 1024, bench_nj = 768;
+
+template <class T>
+static void bench_fill(vil_image_view<T>& image)
+{
+  image.set_size(bench_ni, bench_nj);
+  for (unsigned j = 0; j < bench_nj; ++j)
+    for (unsigned i = 0; i < bench_ni; ++i)
+      image(i,j) = T((i*7 + j*13) % 251);
+}
+
+//: 5-tap smoothing along the rows of a byte image.
+static void bench_vil_convolve_1d_byte(testlib_bench_state& state)
+{
+  vil_image_view<vxl_byte> src;
+  bench_fill(src);
+  vil_image_view<float> dest;
+  const float kernel[5] = { 0.0625f, 0.25f, 0.375f, 0.25f, 0.0625f };
+  state.set_items_per_iteration(bench_ni*bench_nj);
+  while (state.run())
+  {
+    vil_convolve_1d(src, dest, kernel+2, -2, 2, float(),
+                    vil_convolve_zero_extend, vil_convolve_zero_extend);
+    testlib_bench_keep(dest.top_left_ptr());
+  }
+}
+TESTLIB_BENCH(bench_vil_convolve_1d_byte);
+
+//: 7-tap smoothing along the rows of a float image.
+static void bench_vil_convolve_1d_float(testlib_bench_state& state)
+{
+  vil_image_view<float> src, dest;
+  bench_fill(src);
+  const float kernel[7] = { 0.03f, 0.11f, 0.22f, 0.28f, 0.22f, 0.11f, 0.03f };
+  state.set_items_per_iteration(bench_ni*bench_nj);
+  while (state.run())
+  {
+    vil_convolve_1d(src, dest, kernel+3, -3, 3, float(),
+                    vil_convolve_constant_extend, vil_convolve_constant_extend);
+    testlib_bench_keep(dest.top_left_ptr());
+  }
+}
+TESTLIB_BENCH(bench_vil_convolve_1d_float);
+
+//: Enlarge a byte image by 3/2 with bilinear interpolation.
+static void bench_vil_resample_bilin_byte(testlib_bench_state& state)
+{
+  vil_image_view<vxl_byte> src, dest;
+  bench_fill(src);
+  const int n1 = 3*bench_ni/2, n2 = 3*bench_nj/2;
+  state.set_items_per_iteration(double(n1)*n2);
+  while (state.run())
+  {
+    vil_resample_bilin(src, dest, n1, n2);
+    testlib_bench_keep(dest.top_left_ptr());
+  }
+}
+TESTLIB_BENCH(bench_vil_resample_bilin_byte);
+
+//: Sample a float image on a rotated grid with bilinear interpolation.
+static void bench_vil_resample_bilin_float(testlib_bench_state& state)
+{
+  vil_image_view<float> src, dest;
+  bench_fill(src);
+  const int n = 512;
+  state.set_items_per_iteration(double(n)*n);
+  while (state.run())
+  {
+    vil_resample_bilin(src, dest, 300.0, 100.0, 0.8, 0.6, -0.6, 0.8, n, n);
+    testlib_bench_keep(dest.top_left_ptr());
+  }
+}
+TESTLIB_BENCH(bench_vil_resample_bilin_float);
+
+TESTLIB_BENCH_MAIN;
@@ -1,14 +1,56 @@
 // This is core/vil/algo/tests/test_algo_fft.cxx
 #include <complex>
+#include <cmath>
 #include <ctime>
+#include <algorithm>
 #include <testlib/testlib_test.h>
 #include <vil/vil_math.h>
 #include <vil/vil_image_view.h>
 #include <vil/algo/vil_fft.h>
 #include <vcl_compiler.h>
 
+// Compare with a direct evaluation of the DFT, for an image with
+// interleaved planes (so istep!=1), transformed by several threads.
+static void test_algo_fft_direct()
+{
+  const unsigned ni=6, nj=10, np=2;
+  vil_image_view<std::complex<double> > img(ni, nj, 1, np), dft(ni, nj, np);
+  for (unsigned p=0; p<np; ++p)
+    for (unsigned j=0; j<nj; ++j)
+      for (unsigned i=0; i<ni; ++i)
+        img(i,j,p) = std::complex<double>(std::cos(0.7*i+0.2*j+p), 0.1*i*j);
+
+  const double pi = 3.14159265358979323846;
+  for (unsigned p=0; p<np; ++p)
+    for (unsigned v=0; v<nj; ++v)
+      for (unsigned u=0; u<ni; ++u)
+      {
+        std::complex<double> sum(0.0, 0.0);
+        for (unsigned j=0; j<nj; ++j)
+          for (unsigned i=0; i<ni; ++i)
+            sum += img(i,j,p)*std::polar(1.0, 2*pi*(double(u*i)/ni+double(v*j)/nj));
+        dft(u,v,p) = sum/double(ni*nj);
+      }
+
+  vil_image_view<std::complex<double> > img1;
+  img1.deep_copy(img);
+  vil_fft_2d_fwd(img, 3);
+  double max_err = 0.0;
+  for (unsigned p=0; p<np; ++p)
+    for (unsigned j=0; j<nj; ++j)
+      for (unsigned i=0; i<ni; ++i)
+        max_err = std::max(max_err, std::abs(img(i,j,p)-dft(i,j,p)));
+  TEST_NEAR("Threaded FFT of interleaved image matches DFT", max_err, 0.0, 1e-12);
+
+  vil_fft_2d_bwd(img, 3);
+  double d = vil_math_ssd_complex(img, img1, double());
+  TEST_NEAR("Threaded inverse FFT recovers image", d, 0.0, 1e-18);
+}
+
 static void test_algo_fft()
 {
+  test_algo_fft_direct();
+
   vil_image_view<std::complex<double> > img0(4, 8, 2);
   unsigned int seed = (unsigned int)std::time(VXL_NULLPTR);
 
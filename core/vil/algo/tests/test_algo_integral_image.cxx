@@ -0,0 +1,121 @@
+// This is core/vil/algo/tests/test_algo_integral_image.cxx
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <testlib/testlib_test.h>
+#include <vil/algo/vil_integral_image.h>
+#include <vxl_config.h>
+
+static void test_integral_box()
+{
+  vil_image_view<vxl_byte> image(13,9,2);
+  for (unsigned p=0;p<image.nplanes();++p)
+    for (unsigned j=0;j<image.nj();++j)
+      for (unsigned i=0;i<image.ni();++i)
+        image(i,j,p) = vxl_byte((i*7+j*3+p*11)%23);
+
+  vil_image_view<vxl_int_64> sum, sum1;
+  vil_image_view<double> dsum, dsum_sq;
+  vil_integral_image(image,sum1);
+  vil_integral_image(image,sum,3);
+  vil_integral_sqr_image(image,dsum,dsum_sq,2);
+
+  TEST("Size", sum.ni()==14 && sum.nj()==10 && sum.nplanes()==2, true);
+
+  bool threads_ok=true;
+  for (unsigned p=0;p<2;++p)
+    for (unsigned j=0;j<sum.nj();++j)
+      for (unsigned i=0;i<sum.ni();++i)
+        threads_ok = threads_ok && sum(i,j,p)==sum1(i,j,p);
+  TEST("Threaded construction matches serial", threads_ok, true);
+
+  // Compare all boxes with brute force
+  bool box_ok=true, mean_ok=true, var_ok=true;
+  for (unsigned p=0;p<2;++p)
+    for (unsigned j0=0;j0<9;j0+=2)
+      for (unsigned i0=0;i0<13;i0+=3)
+        for (unsigned nj=1;j0+nj<=9;nj+=3)
+          for (unsigned ni=1;i0+ni<=13;ni+=2)
+          {
+            double s=0,ss=0;
+            for (unsigned j=j0;j<j0+nj;++j)
+              for (unsigned i=i0;i<i0+ni;++i)
+              { s+=image(i,j,p); ss+=double(image(i,j,p))*image(i,j,p); }
+            double n=ni*nj, mean=s/n;
+            box_ok = box_ok && vil_integral_box_sum(sum,i0,j0,ni,nj,p)==vxl_int_64(s);
+            mean_ok = mean_ok &&
+              std::fabs(vil_integral_box_mean(dsum,i0,j0,ni,nj,p)-mean)<1e-9;
+            var_ok = var_ok &&
+              std::fabs(vil_integral_box_variance(dsum,dsum_sq,i0,j0,ni,nj,p)
+                        -(ss/n-mean*mean))<1e-9;
+          }
+  TEST("Box sums", box_ok, true);
+  TEST("Box means", mean_ok, true);
+  TEST("Box variances", var_ok, true);
+}
+
+static void test_integral_tilted()
+{
+  vil_image_view<float> image(11,8);
+  for (unsigned j=0;j<image.nj();++j)
+    for (unsigned i=0;i<image.ni();++i)
+      image(i,j) = float((i*5+j*3)%7);
+
+  vil_image_view<double> tsum;
+  vil_integral_tilted_image(image,tsum);
+  TEST("Tilted size", tsum.ni()==12 && tsum.nj()==9, true);
+
+  bool ok=true;
+  for (int y=0;y<int(tsum.nj());++y)
+    for (int x=0;x<int(tsum.ni());++x)
+    {
+      double s=0;
+      for (int j=0;j<y;++j)
+        for (int i=0;i<int(image.ni());++i)
+          if (std::abs(i-x+1)<=y-1-j) s+=image(i,j);
+      ok = ok && std::fabs(s-tsum(x,y))<1e-9;
+    }
+  TEST("Tilted sums match brute force", ok, true);
+
+  // A rotated w x h rectangle in a constant image contains 2wh pixels
+  vil_image_view<float> ones(20,20);
+  ones.fill(1.0f);
+  vil_integral_tilted_image(ones,tsum);
+  TEST_NEAR("Rotated rectangle 3x2", vil_integral_tilted_sum(tsum,8,2,3,2), 12, 1e-9);
+  TEST_NEAR("Rotated rectangle 4x4", vil_integral_tilted_sum(tsum,10,1,4,4), 32, 1e-9);
+}
+
+static void test_integral_orientation_histogram()
+{
+  // Gradient pointing along +x on left half, +y on right half
+  vil_image_view<float> gi(10,6), gj(10,6);
+  for (unsigned j=0;j<6;++j)
+    for (unsigned i=0;i<10;++i)
+    {
+      gi(i,j) = i<5 ? 2.0f : 0.0f;
+      gj(i,j) = i<5 ? 0.0f : 3.0f;
+    }
+
+  vil_image_view<double> hist;
+  vil_integral_orientation_histogram(gi,gj,4,hist);
+  TEST("Histogram planes", hist.nplanes(), 4);
+
+  std::vector<double> h;
+  vil_integral_histogram_box(hist,0,0,10,6,h);
+  TEST_NEAR("Bin 0 (x direction)", h[0], 2.0*30, 1e-9);
+  TEST_NEAR("Bin 1 (y direction)", h[1], 3.0*30, 1e-9);
+  TEST_NEAR("Bin 2", h[2], 0.0, 1e-9);
+
+  vil_integral_histogram_box(hist,3,1,4,2,h);
+  TEST_NEAR("Sub-box bin 0", h[0], 2.0*4, 1e-9);
+  TEST_NEAR("Sub-box bin 1", h[1], 3.0*4, 1e-9);
+}
+
+static void test_algo_integral_image()
+{
+  test_integral_box();
+  test_integral_tilted();
+  test_integral_orientation_histogram();
+}
+
+TESTMAIN(test_algo_integral_image);
@@ -0,0 +1,214 @@
+// This is core/vil/algo/tests/test_algo_lazy_pyramid.cxx
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <vxl_config.h>
+#include <testlib/testlib_test.h>
+#include <vil/vil_config.h>
+#include <vil/vil_image_view.h>
+#include <vil/vil_crop.h>
+#include <vil/vil_new.h>
+#include <vil/vil_load.h>
+#include <vil/file_formats/vil_pyramid_image_list.h>
+#include <vil/algo/vil_gauss_reduce.h>
+#include <vil/algo/vil_lazy_pyramid_image_resource.h>
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
+
+//: Levels of a 2:1 pyramid made by vil_gauss_reduce of whole images.
+template <class T>
+static void reference_pyramid(vil_image_view<T> const& base, unsigned nlevels,
+                              std::vector<vil_image_view<T> >& levels)
+{
+  levels.assign(1, base);
+  vil_image_view<T> work;
+  for (unsigned l = 1; l < nlevels; ++l)
+  {
+    vil_image_view<T> next;
+    vil_gauss_reduce(levels.back(), next, work);
+    levels.push_back(next);
+  }
+}
+
+//: True if every level of pyr, taken in one view, matches levels.
+template <class T>
+static bool levels_match(vil_lazy_pyramid_image_resource const& pyr,
+                         std::vector<vil_image_view<T> > const& levels)
+{
+  if (pyr.nlevels() != levels.size()) return false;
+  for (unsigned l = 0; l < levels.size(); ++l)
+  {
+    vil_image_view_base_sptr v = pyr.get_level_view(l, 0, pyr.ni(l), 0, pyr.nj(l));
+    if (!v || !vil_image_view_deep_equality(vil_image_view<T>(v), levels[l]))
+      return false;
+  }
+  return true;
+}
+
+//: True if every tile of pyr matches the corresponding part of levels.
+template <class T>
+static bool tiles_match(vil_lazy_pyramid_image_resource const& pyr,
+                        std::vector<vil_image_view<T> > const& levels)
+{
+  const unsigned ts = pyr.tile_size();
+  for (unsigned l = 0; l < levels.size(); ++l)
+    for (unsigned tj = 0; tj < pyr.n_tiles_j(l); ++tj)
+      for (unsigned ti = 0; ti < pyr.n_tiles_i(l); ++ti)
+      {
+        vil_image_view_base_sptr t = pyr.get_tile(l, ti, tj);
+        unsigned ni = std::min(ts, levels[l].ni()-ti*ts), nj = std::min(ts, levels[l].nj()-tj*ts);
+        if (!t || !vil_image_view_deep_equality(vil_image_view<T>(t),
+                                                vil_crop(levels[l], ti*ts, ni, tj*ts, nj)))
+          return false;
+      }
+  return true;
+}
+
+#if VXL_HAS_PTHREAD_H
+struct lazy_pyramid_test_job
+{
+  vil_lazy_pyramid_image_resource const* pyr;
+  //: Own copies of the reference levels, as view reference counts are not thread safe.
+  std::vector<vil_image_view<float> > levels;
+  bool ok;
+  static void* run_thread(void* job)
+  {
+    lazy_pyramid_test_job* j = static_cast<lazy_pyramid_test_job*>(job);
+    j->ok = tiles_match(*j->pyr, j->levels);
+    return VXL_NULLPTR;
+  }
+};
+#endif
+
+static void test_lazy_pyramid_float()
+{
+  vil_image_view<float> image(301, 203);
+  for (unsigned j = 0; j < image.nj(); ++j)
+    for (unsigned i = 0; i < image.ni(); ++i)
+      image(i,j) = float((i*37 + j*101) % 251) + 0.25f*float(i%7);
+  vil_image_resource_sptr base = vil_new_image_resource_of_view(image);
+
+  vil_lazy_pyramid_image_resource* pyr = new vil_lazy_pyramid_image_resource(base, 0, 32, 1000);
+  vil_pyramid_image_resource_sptr pyr_sptr = pyr;
+  // 301x203, 151x102, 76x51, 38x26, 19x13
+  TEST("Number of levels", pyr->nlevels(), 5);
+  TEST("Level size", pyr->ni(2)==76 && pyr->nj(2)==51 && pyr->ni(4)==19 && pyr->nj(4)==13, true);
+  TEST("Only the base is stored", pyr->is_stored(0) && !pyr->is_stored(1), true);
+  TEST("Nothing made yet", pyr->n_tiles_made(), 0);
+
+  std::vector<vil_image_view<float> > levels;
+  reference_pyramid(image, 5, levels);
+  TEST("Tiles match vil_gauss_reduce of whole levels", tiles_match(*pyr, levels), true);
+  const unsigned long n_made = pyr->n_tiles_made();
+  // level 1 has 5x4 tiles, level 2 3x2, level 3 2x1 and level 4 one
+  TEST("Each tile made once", n_made, 29);
+  TEST("Whole levels match", levels_match(*pyr, levels), true);
+  TEST("Cached tiles are not made again", pyr->n_tiles_made(), n_made);
+
+  // A region across tile boundaries, and in base image coordinates
+  vil_image_view<float> part = pyr->get_level_view(2, 20, 30, 10, 40);
+  TEST("Region across tiles", vil_image_view_deep_equality(part, vil_crop(levels[2], 20, 30, 10, 40)), true);
+  vil_image_view<float> scaled = pyr->get_copy_view(80, 120, 40, 160, 2);
+  TEST("Region in base coordinates", scaled && scaled.ni()==30 && scaled.nj()==40 &&
+       vil_image_view_deep_equality(scaled, vil_crop(levels[2], 20, 30, 10, 40)), true);
+  float actual_scale;
+  vil_image_view<float> closest = pyr->get_copy_view(0.3f, actual_scale);
+  TEST_NEAR("Closest scale", actual_scale, 76.0f/301.0f, 1e-6);
+  TEST("Closest level", vil_image_view_deep_equality(closest, levels[2]), true);
+  TEST("Region outside level", pyr->get_level_view(3, 30, 10, 0, 5) == VXL_NULLPTR, true);
+  vil_image_resource_sptr r3 = pyr->get_resource(3);
+  TEST("Level resource", r3 && r3->ni()==38 && r3->nj()==26 &&
+       vil_image_view_deep_equality(vil_image_view<float>(r3->get_view()), levels[3]), true);
+
+  // A cache of a few tiles still gives the right answers
+  vil_lazy_pyramid_image_resource* small = new vil_lazy_pyramid_image_resource(base, 5, 16, 3);
+  vil_pyramid_image_resource_sptr small_sptr = small;
+  TEST("Small cache", tiles_match(*small, levels) && levels_match(*small, levels), true);
+  small->clear_cache();
+  TEST("Cleared cache", levels_match(*small, levels), true);
+
+#if VXL_HAS_PTHREAD_H
+  // Several threads asking for the same tiles make each only once
+  vil_lazy_pyramid_image_resource* shared = new vil_lazy_pyramid_image_resource(base, 0, 32, 1000);
+  vil_pyramid_image_resource_sptr shared_sptr = shared;
+  const unsigned n_threads = 4;
+  std::vector<lazy_pyramid_test_job> jobs(n_threads);
+  std::vector<pthread_t> threads(n_threads);
+  for (unsigned t = 0; t < n_threads; ++t)
+  {
+    jobs[t].pyr = shared;
+    for (unsigned l = 0; l < levels.size(); ++l)
+    {
+      jobs[t].levels.push_back(vil_image_view<float>());
+      jobs[t].levels.back().deep_copy(levels[l]);
+    }
+    jobs[t].ok = false;
+    pthread_create(&threads[t], VXL_NULLPTR, &lazy_pyramid_test_job::run_thread, &jobs[t]);
+  }
+  bool threads_ok = true;
+  for (unsigned t = 0; t < n_threads; ++t)
+  {
+    pthread_join(threads[t], VXL_NULLPTR);
+    threads_ok = threads_ok && jobs[t].ok;
+  }
+  TEST("Concurrent requests give the right tiles", threads_ok, true);
+  TEST("Concurrent requests for a tile are coalesced", shared->n_tiles_made(), n_made);
+#endif
+}
+
+static void test_lazy_pyramid_byte()
+{
+  vil_image_view<vxl_byte> image(130, 67, 3);
+  for (unsigned p = 0; p < 3; ++p)
+    for (unsigned j = 0; j < image.nj(); ++j)
+      for (unsigned i = 0; i < image.ni(); ++i)
+        image(i,j,p) = vxl_byte((i*13 + j*7 + p*50) % 256);
+  vil_image_resource_sptr base = vil_new_image_resource_of_view(image);
+  std::vector<vil_image_view<vxl_byte> > levels;
+  reference_pyramid(image, 4, levels);
+
+  vil_lazy_pyramid_image_resource* pyr = new vil_lazy_pyramid_image_resource(base, 4, 20);
+  vil_pyramid_image_resource_sptr pyr_sptr = pyr;
+  TEST("Byte image with three planes", pyr->nplanes()==3 && levels_match(*pyr, levels) &&
+       tiles_match(*pyr, levels), true);
+
+  // Levels of an existing pyramid are used; the rest are made from them
+  vil_image_view<vxl_byte> level1(65, 34, 3);
+  level1.fill(7);
+  std::vector<vil_image_resource_sptr> images;
+  images.push_back(base);
+  images.push_back(vil_new_image_resource_of_view(level1));
+  vil_pyramid_image_resource_sptr list = new vil_pyramid_image_list(images);
+  vil_lazy_pyramid_image_resource* over = new vil_lazy_pyramid_image_resource(list, 4, 20);
+  vil_pyramid_image_resource_sptr over_sptr = over;
+  std::vector<vil_image_view<vxl_byte> > over_levels;
+  reference_pyramid(level1, 3, over_levels);
+  over_levels.insert(over_levels.begin(), image);
+  TEST("Stored level used", over->is_stored(1) && !over->is_stored(2), true);
+  TEST("Levels made from the stored level", levels_match(*over, over_levels), true);
+
+#if HAS_TIFF
+  // Keep the levels as a pyramid TIFF
+  const char* file = "lazy_pyramid.tif";
+  TEST("Save as pyramid tiff", pyr->save(file), true);
+  {
+    vil_pyramid_image_resource_sptr saved = vil_load_pyramid_resource(file, false);
+    bool saved_ok = saved && saved->nlevels()==4;
+    for (unsigned l = 0; saved_ok && l < 4; ++l)
+      saved_ok = vil_image_view_deep_equality(vil_image_view<vxl_byte>(saved->get_resource(l)->get_view()),
+                                              levels[l]);
+    TEST("Saved levels read back", saved_ok, true);
+  }
+  std::remove(file);
+#endif
+}
+
+static void test_algo_lazy_pyramid()
+{
+  test_lazy_pyramid_float();
+  test_lazy_pyramid_byte();
+}
+
+TESTMAIN(test_algo_lazy_pyramid);
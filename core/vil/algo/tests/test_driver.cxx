@@ -16,6 +16,8 @@ DECLARE( test_algo_find_4con_boundary );
 DECLARE( test_algo_fft );
 DECLARE( test_algo_histogram );
 DECLARE( test_algo_histogram_equalise );
+DECLARE( test_algo_integral_image );
+DECLARE( test_algo_lazy_pyramid );
 DECLARE( test_algo_distance_transform );
 DECLARE( test_algo_blob );
 DECLARE( test_algo_find_peaks );
@@ -56,6 +58,8 @@ register_tests()
   REGISTER( test_algo_fft );
   REGISTER( test_algo_histogram );
   REGISTER( test_algo_histogram_equalise );
+  REGISTER( test_algo_integral_image );
+  REGISTER( test_algo_lazy_pyramid );
   REGISTER( test_algo_distance_transform );
   REGISTER( test_algo_blob );
   REGISTER( test_algo_find_peaks );
@@ -32,6 +32,8 @@
 #include <vil/algo/vil_grid_merge.h>
 #include <vil/algo/vil_histogram.h>
 #include <vil/algo/vil_histogram_equalise.h>
+#include <vil/algo/vil_integral_image.h>
+#include <vil/algo/vil_lazy_pyramid_image_resource.h>
 #include <vil/algo/vil_line_filter.h>
 #include <vil/algo/vil_median.h>
 #include <vil/algo/vil_normalised_correlation_2d.h>
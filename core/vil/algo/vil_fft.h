@@ -11,11 +11,13 @@
 #include <vil/vil_image_view.h>
 
 //: Perform in place forward FFT.
+// The rows, then the columns, of each plane are shared between n_threads
+// threads (if threads are available).
 // \relatesalso vil_image_view
 // \relatesalso vil_fft_2d_bwd
 template<class T>
 void
-vil_fft_2d_fwd (vil_image_view<std::complex<T> > & img);
+vil_fft_2d_fwd (vil_image_view<std::complex<T> > & img, unsigned n_threads=1);
 
 //: Perform in place backward FFT.
 // Unlike vnl_fft_2d, scaling is done properly, so using
@@ -25,6 +27,6 @@ vil_fft_2d_fwd (vil_image_view<std::complex<T> > & img);
 // \relatesalso vil_fft_2d_fwd
 template<class T>
 void
-vil_fft_2d_bwd (vil_image_view<std::complex<T> > & img);
+vil_fft_2d_bwd (vil_image_view<std::complex<T> > & img, unsigned n_threads=1);
 
 #endif // vil_fft_h_
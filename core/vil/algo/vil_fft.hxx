@@ -12,80 +12,128 @@
 #include <vcl_compiler.h>
 #include <vil/vil_image_view.h>
 #include <vnl/algo/vnl_fft_1d.h>
+#include <vxl_config.h>
+
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
+
+//: Transforms of one band of pixel rows (or columns) of one plane.
+template<class T>
+struct vil_fft_2d_job
+{
+  vnl_fft_1d<T>* fft_1d;
+  std::complex<T>* data;
+  std::ptrdiff_t step0, step1;
+  unsigned n0, n1_begin, n1_end;
+  int dir;
+
+  void run()
+  {
+    if (n1_end<=n1_begin) return;
+    std::complex<T> * d = data + n1_begin*step1;
+    // Transform all the rows of the band in one go, straight from the
+    // image memory, whatever the pixel layout.
+    fft_1d->transform_many(d, dir, step0, step1, n1_end-n1_begin);
+    if (dir >= 0)
+    {
+      T factor = T(1)/static_cast<T>(n0); // proper scaling for forward FFT
+      for (unsigned i1=n1_begin; i1<n1_end; ++i1, d+=step1)
+      {
+        std::complex<T> * p = d;
+        for (unsigned i0=0; i0<n0; ++i0, p+=step0)
+          *p *= factor;
+      }
+    }
+  }
+
+  static void* run_thread(void* job)
+  {
+    static_cast<vil_fft_2d_job<T>*>(job)->run();
+    return VXL_NULLPTR;
+  }
+};
 
 //: Perform in place FFT in one dimension.
+//  The n1 rows of each plane are split between n_threads threads.
 template<class T>
 static void
 vil_fft_2d_base(std::complex<T> * data,
                 unsigned n0, std::ptrdiff_t step0, // ni, istep
                 unsigned n1, std::ptrdiff_t step1, // nj, jstep
                 unsigned n2, std::ptrdiff_t step2, // nplanes, planestep
-                int dir)
+                int dir, unsigned n_threads)
 {
+  if (n0==0 || n1==0) return;
   vnl_fft_1d<T> fft_1d(n0);
-  T factor = dir<0 ? T(1) : T(1)/static_cast<T>(n0);
-
-  if (1 == step0) // use contiguous data memory directly
+  if (n_threads<1) n_threads=1;
+  if (n_threads>n1) n_threads=n1;
+#if !VXL_HAS_PTHREAD_H
+  n_threads=1;
+#endif
+  std::vector<vil_fft_2d_job<T> > jobs(n_threads);
+  for (unsigned i2=0; i2<n2; i2++)
   {
-    // FFT every pixel row (or column) in every colour band:
-    for (unsigned i1=0; i1<n1; i1++)
-    for (unsigned i2=0; i2<n2; i2++)
+    for (unsigned t=0; t<n_threads; ++t)
     {
-      std::complex<T> * d = data + i1*step1 + i2*step2;
-      fft_1d.transform(d, dir);
-      if (dir >= 0)
-        for (unsigned i0=0; i0<n0; ++i0)
-          d[i0] *= factor; // proper scaling for forward FFT
+      jobs[t].fft_1d = &fft_1d;
+      jobs[t].data = data + i2*step2;
+      jobs[t].step0 = step0;
+      jobs[t].step1 = step1;
+      jobs[t].n0 = n0;
+      jobs[t].n1_begin = t*n1/n_threads;
+      jobs[t].n1_end = (t+1)*n1/n_threads;
+      jobs[t].dir = dir;
     }
-  }
-  else // must copy non-contiguous data memory to a std::vector
-  {
-    std::vector<std::complex<T> > v(n0);
-    for (unsigned i1=0; i1<n1; i1++)
-    for (unsigned i2=0; i2<n2; i2++)
+#if VXL_HAS_PTHREAD_H
+    // The twiddle tables in fft_1d are only read, so can be shared.
+    std::vector<pthread_t> threads(n_threads);
+    std::vector<bool> started(n_threads,false);
+    for (unsigned t=1; t<n_threads; ++t)
+      started[t] = pthread_create(&threads[t], VXL_NULLPTR,
+                                  &vil_fft_2d_job<T>::run_thread, &jobs[t])==0;
+    jobs[0].run();
+    for (unsigned t=1; t<n_threads; ++t)
     {
-      std::complex<T> * d = data + i1*step1 + i2*step2;
-      for (unsigned i0=0; i0<n0; i0++, d+=step0)
-        v[i0] = *d;
-      fft_1d.transform(v, dir);
-      // copy std::vector back to non-contiguous data memory
-      d = data + i1*step1 + i2*step2;
-      for (unsigned i0=0; i0<n0; i0++, d+=step0)
-        *d = v[i0]*factor; // proper scaling for forward FFT
+      if (started[t]) pthread_join(threads[t], VXL_NULLPTR);
+      else            jobs[t].run(); // Couldn't start thread - do it here
     }
+#else
+    jobs[0].run();
+#endif
   }
 }
 
 template<class T>
 void
-vil_fft_2d_fwd(vil_image_view<std::complex<T> >& img)
+vil_fft_2d_fwd(vil_image_view<std::complex<T> >& img, unsigned n_threads)
 {
   vil_fft_2d_base(img.top_left_ptr(),
                   img.ni(), img.istep(),
                   img.nj(), img.jstep(),
                   img.nplanes(), img.planestep(),
-                  1);
+                  1, n_threads);
   vil_fft_2d_base(img.top_left_ptr(),
                   img.nj(), img.jstep(),
                   img.ni(), img.istep(),
                   img.nplanes(), img.planestep(),
-                  1);
+                  1, n_threads);
 }
 
 template<class T>
 void
-vil_fft_2d_bwd(vil_image_view<std::complex<T> >& img)
+vil_fft_2d_bwd(vil_image_view<std::complex<T> >& img, unsigned n_threads)
 {
   vil_fft_2d_base(img.top_left_ptr(),
                   img.nj(), img.jstep(),
                   img.ni(), img.istep(),
                   img.nplanes(), img.planestep(),
-                  -1);
+                  -1, n_threads);
   vil_fft_2d_base(img.top_left_ptr(),
                   img.ni(), img.istep(),
                   img.nj(), img.jstep(),
                   img.nplanes(), img.planestep(),
-                  -1);
+                  -1, n_threads);
 }
 
 #undef VIL_FFT_INSTANTIATE
@@ -94,8 +142,10 @@ template void vil_fft_2d_base(std::complex<T >* data, \
                               unsigned n0, std::ptrdiff_t step0, \
                               unsigned n1, std::ptrdiff_t step1, \
                               unsigned n2, std::ptrdiff_t step2, \
-                              int dir); \
-template void vil_fft_2d_fwd(vil_image_view<std::complex<T > >& img); \
-template void vil_fft_2d_bwd(vil_image_view<std::complex<T > >& img)
+                              int dir, unsigned n_threads); \
+template void vil_fft_2d_fwd(vil_image_view<std::complex<T > >& img, \
+                             unsigned n_threads); \
+template void vil_fft_2d_bwd(vil_image_view<std::complex<T > >& img, \
+                             unsigned n_threads)
 
 #endif // vil_fft_hxx_
@@ -0,0 +1,328 @@
+// This is core/vil/algo/vil_integral_image.h
+#ifndef vil_integral_image_h_
+#define vil_integral_image_h_
+//:
+// \file
+// \brief Integral images (summed area tables) and O(1) box queries.
+//
+// The integral image of an ni x nj image is an (ni+1) x (nj+1) image
+// with sum(i,j) = sum of src(x,y) for x<i, y<j.  The sum over any box
+// of pixels can then be read off with four lookups, whatever the size
+// of the box.  See Viola and Jones (CVPR01).
+//
+// Unlike vil_math_integral_image(), the functions here work on every
+// plane of a multi-plane image, can split construction between threads,
+// and provide tilted (45 degree) tables and integral histograms of
+// gradient orientation, as used for HOG style features.
+//
+// Choose the accumulator type sumT to suit the image size: an integral
+// image of a large byte image can overflow 32 bits, so use vxl_int_64,
+// vxl_uint_64 or double there.
+
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <vil/vil_image_view.h>
+#include <vnl/vnl_math.h>
+#include <vcl_cassert.h>
+#include <vcl_compiler.h>
+#include <vxl_config.h>
+
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
+
+//: Work shared by the threads building an integral image
+template <class aT, class sumT>
+struct vil_integral_image_job
+{
+  const vil_image_view<aT>* src;
+  vil_image_view<sumT>* sum;
+  //: If true, sum squares of pixel values rather than values
+  bool square;
+  //: Pass 0 sums along rows, pass 1 accumulates down columns
+  unsigned pass;
+  unsigned thread, n_threads;
+
+  //: Cumulative sum along each row in this thread's band of rows
+  void row_pass()
+  {
+    const unsigned ni=src->ni(), nj=src->nj(), np=src->nplanes();
+    const unsigned j0=thread*nj/n_threads, j1=(thread+1)*nj/n_threads;
+    for (unsigned p=0;p<np;++p)
+      for (unsigned j=j0;j<j1;++j)
+      {
+        const aT* s = &(*src)(0,j,p);
+        const std::ptrdiff_t istepA=src->istep();
+        sumT* d = &(*sum)(0,j+1,p);
+        const std::ptrdiff_t istepS=sum->istep();
+        sumT row_sum=0;
+        *d=0;
+        for (unsigned i=0;i<ni;++i,s+=istepA)
+        {
+          sumT v = sumT(*s);
+          row_sum += square ? v*v : v;
+          d+=istepS;
+          *d=row_sum;
+        }
+      }
+  }
+
+  //: Add each row to the next, for this thread's band of columns
+  void column_pass()
+  {
+    const unsigned ni1=sum->ni(), nj1=sum->nj(), np=sum->nplanes();
+    const unsigned i0=thread*ni1/n_threads, i1=(thread+1)*ni1/n_threads;
+    const std::ptrdiff_t istep=sum->istep(), jstep=sum->jstep();
+    for (unsigned p=0;p<np;++p)
+    {
+      sumT* prev = &(*sum)(0,0,p);
+      for (unsigned j=1;j<nj1;++j,prev+=jstep)
+      {
+        sumT* row = prev+jstep;
+        for (unsigned i=i0;i<i1;++i)
+          row[i*istep] += prev[i*istep];
+      }
+    }
+  }
+
+  void run() { if (pass==0) row_pass(); else column_pass(); }
+
+  static void* run_thread(void* arg)
+  {
+    static_cast<vil_integral_image_job*>(arg)->run();
+    return VXL_NULLPTR;
+  }
+};
+
+//: Run both passes of an integral image computation, using n_threads.
+template <class aT, class sumT>
+inline void vil_integral_image_run(const vil_image_view<aT>& src,
+                                   vil_image_view<sumT>& sum,
+                                   bool square, unsigned n_threads)
+{
+  if (n_threads<1) n_threads=1;
+#if !VXL_HAS_PTHREAD_H
+  n_threads=1;
+#endif
+  std::vector<vil_integral_image_job<aT,sumT> > jobs(n_threads);
+  for (unsigned pass=0;pass<2;++pass)
+  {
+#if VXL_HAS_PTHREAD_H
+    std::vector<pthread_t> threads(n_threads);
+    std::vector<bool> started(n_threads,false);
+#endif
+    for (unsigned t=0;t<n_threads;++t)
+    {
+      jobs[t].src=&src; jobs[t].sum=&sum; jobs[t].square=square;
+      jobs[t].pass=pass; jobs[t].thread=t; jobs[t].n_threads=n_threads;
+#if VXL_HAS_PTHREAD_H
+      if (t>0)
+        started[t] = pthread_create(&threads[t],VXL_NULLPTR,
+                       vil_integral_image_job<aT,sumT>::run_thread,&jobs[t])==0;
+#endif
+    }
+    jobs[0].run();
+#if VXL_HAS_PTHREAD_H
+    for (unsigned t=1;t<n_threads;++t)
+    {
+      if (started[t]) pthread_join(threads[t],VXL_NULLPTR);
+      else            jobs[t].run();  // Couldn't start thread - do it here
+    }
+#endif
+  }
+}
+
+//: Compute integral image of every plane of src.
+//  On exit sum is (ni+1) x (nj+1) x nplanes, with
+//  sum(i,j,p) = sum of src(x,y,p) for x<i, y<j.
+//  Rows, then columns, are shared between n_threads threads.
+// \relatesalso vil_image_view
+template <class aT, class sumT>
+inline void vil_integral_image(const vil_image_view<aT>& src,
+                               vil_image_view<sumT>& sum,
+                               unsigned n_threads=1)
+{
+  sum.set_size(src.ni()+1,src.nj()+1,src.nplanes());
+  for (unsigned p=0;p<sum.nplanes();++p)
+    for (unsigned i=0;i<sum.ni();++i) sum(i,0,p)=0;
+  vil_integral_image_run(src,sum,false,n_threads);
+}
+
+//: Compute integral images of values and squared values of src.
+//  Allows the mean and variance over any box to be computed in O(1).
+// \relatesalso vil_image_view
+template <class aT, class sumT>
+inline void vil_integral_sqr_image(const vil_image_view<aT>& src,
+                                   vil_image_view<sumT>& sum,
+                                   vil_image_view<sumT>& sum_sq,
+                                   unsigned n_threads=1)
+{
+  vil_integral_image(src,sum,n_threads);
+  sum_sq.set_size(src.ni()+1,src.nj()+1,src.nplanes());
+  for (unsigned p=0;p<sum_sq.nplanes();++p)
+    for (unsigned i=0;i<sum_sq.ni();++i) sum_sq(i,0,p)=0;
+  vil_integral_image_run(src,sum_sq,true,n_threads);
+}
+
+//: Sum of the ni x nj box of pixels with top-left corner (i0,j0) in plane p.
+//  sum is an integral image from vil_integral_image().
+// \relatesalso vil_image_view
+template <class sumT>
+inline sumT vil_integral_box_sum(const vil_image_view<sumT>& sum,
+                                 unsigned i0, unsigned j0,
+                                 unsigned ni, unsigned nj, unsigned p=0)
+{
+  assert(i0+ni<sum.ni() && j0+nj<sum.nj());
+  return sum(i0+ni,j0+nj,p)+sum(i0,j0,p)-sum(i0+ni,j0,p)-sum(i0,j0+nj,p);
+}
+
+//: Mean of the ni x nj box of pixels with top-left corner (i0,j0) in plane p.
+// \relatesalso vil_image_view
+template <class sumT>
+inline double vil_integral_box_mean(const vil_image_view<sumT>& sum,
+                                    unsigned i0, unsigned j0,
+                                    unsigned ni, unsigned nj, unsigned p=0)
+{
+  if (ni*nj==0) return 0.0;
+  return double(vil_integral_box_sum(sum,i0,j0,ni,nj,p))/(ni*nj);
+}
+
+//: Variance of the ni x nj box of pixels with top-left corner (i0,j0) in plane p.
+//  sum and sum_sq are from vil_integral_sqr_image().
+// \relatesalso vil_image_view
+template <class sumT>
+inline double vil_integral_box_variance(const vil_image_view<sumT>& sum,
+                                        const vil_image_view<sumT>& sum_sq,
+                                        unsigned i0, unsigned j0,
+                                        unsigned ni, unsigned nj, unsigned p=0)
+{
+  if (ni*nj==0) return 0.0;
+  double n = double(ni)*nj;
+  double mean = double(vil_integral_box_sum(sum,i0,j0,ni,nj,p))/n;
+  double v = double(vil_integral_box_sum(sum_sq,i0,j0,ni,nj,p))/n - mean*mean;
+  return v>0 ? v : 0.0;  // Guard against rounding errors
+}
+
+//: Compute tilted (45 degree) integral image of plane p of src.
+//  On exit tsum is (ni+1) x (nj+1), with tsum(x,y) the sum of
+//  the pixels src(i,j) with j<y and |i-x+1| <= y-1-j, i.e. of the
+//  triangle of pixels above and including src(x-1,y-1),
+//  widening by one pixel to each side per row.
+//  Pixels outside the image count as zero.
+//
+//  Sums over rectangles rotated by 45 degrees can then be computed
+//  in O(1) using vil_integral_tilted_sum().  See Lienhart and Maydt (ICIP02).
+// \relatesalso vil_image_view
+template <class aT, class sumT>
+inline void vil_integral_tilted_image(const vil_image_view<aT>& src,
+                                      vil_image_view<sumT>& tsum,
+                                      unsigned p=0)
+{
+  const int ni=src.ni(), nj=src.nj();
+  tsum.set_size(ni+1,nj+1,1);
+
+  // The recurrence
+  //   T(x,y) = T(x-1,y-1) + T(x+1,y-1) - T(x,y-2) + I(x-1,y-1) + I(x-1,y-2)
+  // holds on an unbounded plane.  Triangles near the left and right edges
+  // reach outside the image, so evaluate it on rows padded by nj on each
+  // side, keeping only the last three rows.
+  const int pad=nj+1;
+  const int w=ni+1+2*pad;
+  std::vector<sumT> r0(w,sumT(0)),r1(w,sumT(0)),r2(w,sumT(0));
+  sumT* t2=&r0[0];  // row y-2
+  sumT* t1=&r1[0];  // row y-1
+  sumT* t0=&r2[0];  // row y
+
+  for (int x=0;x<=ni;++x) tsum(x,0)=0;
+  for (int y=1;y<=nj;++y)
+  {
+    for (int k=1;k+1<w;++k)
+    {
+      int x=k-pad;
+      sumT v = t1[k-1]+t1[k+1];
+      if (y>=2) v-=t2[k];
+      if (x>=1 && x<=ni)
+      {
+        v+=sumT(src(x-1,y-1,p));
+        if (y>=2) v+=sumT(src(x-1,y-2,p));
+      }
+      t0[k]=v;
+    }
+    t0[0]=t0[w-1]=0;
+    for (int x=0;x<=ni;++x) tsum(x,y)=t0[x+pad];
+    sumT* tmp=t2; t2=t1; t1=t0; t0=tmp;
+  }
+}
+
+//: Sum of pixels in a rectangle rotated by 45 degrees.
+//  The rectangle has its top corner at (x,y) in tsum coordinates, extends
+//  w steps down and to the right and h steps down and to the left.
+//  tsum is from vil_integral_tilted_image(), and all four corners
+//  (x,y), (x+w,y+w), (x-h,y+h) and (x+w-h,y+w+h) must lie inside it.
+// \relatesalso vil_image_view
+template <class sumT>
+inline sumT vil_integral_tilted_sum(const vil_image_view<sumT>& tsum,
+                                    int x, int y, int w, int h)
+{
+  assert(x-h>=0 && x+w<int(tsum.ni()) && y+w+h<int(tsum.nj()));
+  return tsum(x,y)+tsum(x+w-h,y+w+h)-tsum(x+w,y+w)-tsum(x-h,y+h);
+}
+
+//: Compute integral histogram of gradient orientations.
+//  Orientation of gradient (gi,gj) at each pixel is binned into n_bins
+//  bins over [0,2pi), or over [0,pi) if signed_orientation is false.
+//  On exit hist is (ni+1) x (nj+1) x n_bins, and plane b is the integral
+//  image of gradient magnitude of those pixels falling in bin b.
+//  The histogram of any box is then available in O(n_bins) from
+//  vil_integral_histogram_box().
+// \relatesalso vil_image_view
+template <class gT, class sumT>
+inline void vil_integral_orientation_histogram(const vil_image_view<gT>& grad_i,
+                                               const vil_image_view<gT>& grad_j,
+                                               unsigned n_bins,
+                                               vil_image_view<sumT>& hist,
+                                               bool signed_orientation=true,
+                                               unsigned n_threads=1)
+{
+  assert(n_bins>0);
+  assert(grad_i.ni()==grad_j.ni() && grad_i.nj()==grad_j.nj());
+  const unsigned ni=grad_i.ni(), nj=grad_i.nj();
+  const double range = signed_orientation ? vnl_math::twopi : vnl_math::pi;
+  const double s = n_bins/range;
+
+  // Spread magnitudes into one plane per bin, then integrate each plane
+  vil_image_view<sumT> binned(ni,nj,n_bins);
+  binned.fill(0);
+  for (unsigned j=0;j<nj;++j)
+    for (unsigned i=0;i<ni;++i)
+    {
+      double gx=grad_i(i,j), gy=grad_j(i,j);
+      double mag = std::sqrt(gx*gx+gy*gy);
+      if (mag==0) continue;
+      double A = std::atan2(gy,gx);
+      if (A<0) A+=vnl_math::twopi;
+      if (A>=range) A-=range;
+      unsigned b = unsigned(A*s);
+      if (b>=n_bins) b=n_bins-1;
+      binned(i,j,b)=sumT(mag);
+    }
+  vil_integral_image(binned,hist,n_threads);
+}
+
+//: Histogram of the ni x nj box with top-left corner (i0,j0).
+//  hist is an integral histogram (eg from vil_integral_orientation_histogram()),
+//  with one plane per bin.
+// \relatesalso vil_image_view
+template <class sumT>
+inline void vil_integral_histogram_box(const vil_image_view<sumT>& hist,
+                                       unsigned i0, unsigned j0,
+                                       unsigned ni, unsigned nj,
+                                       std::vector<double>& h)
+{
+  h.resize(hist.nplanes());
+  for (unsigned b=0;b<hist.nplanes();++b)
+    h[b]=double(vil_integral_box_sum(hist,i0,j0,ni,nj,b));
+}
+
+#endif // vil_integral_image_h_
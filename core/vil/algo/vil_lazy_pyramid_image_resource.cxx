@@ -0,0 +1,387 @@
+// This is core/vil/algo/vil_lazy_pyramid_image_resource.cxx
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include "vil_lazy_pyramid_image_resource.h"
+//:
+// \file
+#include <vcl_compiler.h>
+#include <vil/vil_image_view.h>
+#include <vil/vil_crop.h>
+#include <vil/vil_copy.h>
+#include <vil/vil_new.h>
+#include <vil/algo/vil_gauss_reduce.h>
+
+//: An image resource for one level of a lazy pyramid, in the coordinates of the level.
+class vil_lazy_pyramid_level_resource : public vil_image_resource
+{
+ public:
+  vil_lazy_pyramid_level_resource(vil_lazy_pyramid_image_resource const* pyramid,
+                                  unsigned level)
+    : pyramid_(pyramid), level_(level) {}
+
+  virtual unsigned nplanes() const { return pyramid_->nplanes(); }
+  virtual unsigned ni() const { return pyramid_->ni(level_); }
+  virtual unsigned nj() const { return pyramid_->nj(level_); }
+  virtual enum vil_pixel_format pixel_format() const { return pyramid_->pixel_format(); }
+
+  virtual vil_image_view_base_sptr get_copy_view(unsigned i0, unsigned n_i,
+                                                 unsigned j0, unsigned n_j) const
+  { return pyramid_->get_level_view(level_, i0, n_i, j0, n_j); }
+
+  //: The pyramid is read only.
+  virtual bool put_view(const vil_image_view_base& /*im*/, unsigned /*i0*/, unsigned /*j0*/)
+  { return false; }
+
+  virtual bool get_property(char const* /*tag*/, void* /*property_value*/ = VXL_NULLPTR) const
+  { return false; }
+
+ private:
+  vil_lazy_pyramid_image_resource const* pyramid_;
+  unsigned level_;
+};
+
+//: True if vil_gauss_reduce can make levels of images with this pixel format.
+static bool vil_lazy_pyramid_reducible(vil_pixel_format fmt)
+{
+  return fmt == VIL_PIXEL_FORMAT_BYTE || fmt == VIL_PIXEL_FORMAT_UINT_16 ||
+         fmt == VIL_PIXEL_FORMAT_INT_16 || fmt == VIL_PIXEL_FORMAT_FLOAT ||
+         fmt == VIL_PIXEL_FORMAT_DOUBLE;
+}
+
+//: Copy the part of tile, whose top left is at (ti0,tj0), that overlaps dest, whose top left is at (i0,j0).
+template <class T>
+static void vil_lazy_pyramid_copy(vil_image_view_base const& tile, unsigned ti0, unsigned tj0,
+                                  vil_image_view_base& dest, unsigned i0, unsigned j0)
+{
+  vil_image_view<T> const& src = static_cast<vil_image_view<T> const&>(tile);
+  vil_image_view<T>& dst = static_cast<vil_image_view<T>&>(dest);
+  unsigned a_i = std::max(ti0, i0), b_i = std::min(ti0+src.ni(), i0+dst.ni());
+  unsigned a_j = std::max(tj0, j0), b_j = std::min(tj0+src.nj(), j0+dst.nj());
+  if (a_i >= b_i || a_j >= b_j) return;
+  vil_copy_to_window(vil_crop(src, a_i-ti0, b_i-a_i, a_j-tj0, b_j-a_j), dst, a_i-i0, a_j-j0);
+}
+
+//: Reduce src, and return the n_i x n_j pixels of the result from (ci,cj).
+template <class T>
+static vil_image_view_base_sptr vil_lazy_pyramid_reduce(vil_image_view_base const& src_base,
+                                                        unsigned ci, unsigned n_i,
+                                                        unsigned cj, unsigned n_j)
+{
+  vil_image_view<T> src(src_base), reduced, work;
+  vil_gauss_reduce(src, reduced, work);
+  vil_image_view<T>* tile = new vil_image_view<T>;
+  tile->deep_copy(vil_crop(reduced, ci, n_i, cj, n_j));
+  return tile;
+}
+
+vil_lazy_pyramid_image_resource::
+vil_lazy_pyramid_image_resource(vil_image_resource_sptr const& base,
+                                unsigned nlevels, unsigned tile_size,
+                                unsigned cache_tiles)
+  : tile_size_(tile_size), cache_tiles_(cache_tiles), n_tiles_made_(0)
+{
+  init(base, nlevels);
+}
+
+vil_lazy_pyramid_image_resource::
+vil_lazy_pyramid_image_resource(vil_pyramid_image_resource_sptr const& pyramid,
+                                unsigned nlevels, unsigned tile_size,
+                                unsigned cache_tiles)
+  : tile_size_(tile_size), cache_tiles_(cache_tiles), n_tiles_made_(0)
+{
+  vil_image_resource_sptr base = pyramid->get_resource(0);
+  init(base, nlevels);
+  // Use the stored levels which fit into the 2:1 pyramid
+  for (unsigned k = 1; k < pyramid->nlevels(); ++k)
+  {
+    vil_image_resource_sptr r = pyramid->get_resource(k);
+    if (!r || r->nplanes() != base->nplanes() || r->pixel_format() != base->pixel_format())
+      continue;
+    for (unsigned l = 1; l < levels_.size(); ++l)
+      if (!levels_[l] && ni_[l] == r->ni() && nj_[l] == r->nj())
+        levels_[l] = r;
+  }
+}
+
+void vil_lazy_pyramid_image_resource::init(vil_image_resource_sptr const& base,
+                                           unsigned nlevels)
+{
+  if (tile_size_ == 0) tile_size_ = 1;
+  levels_.push_back(base);
+  ni_.push_back(base->ni());
+  nj_.push_back(base->nj());
+  if (vil_lazy_pyramid_reducible(base->pixel_format()))
+    for (;;)
+    {
+      const unsigned n_i = ni_.back(), n_j = nj_.back();
+      if (nlevels ? levels_.size() >= nlevels : (n_i <= tile_size_ && n_j <= tile_size_))
+        break;
+      // vil_gauss_reduce needs at least 3 pixels in each direction
+      if (n_i < 3 || n_j < 3)
+        break;
+      levels_.push_back(VXL_NULLPTR);
+      ni_.push_back((n_i+1)/2);
+      nj_.push_back((n_j+1)/2);
+    }
+#if VXL_HAS_PTHREAD_H
+  pthread_mutex_init(&cache_mutex_, VXL_NULLPTR);
+  pthread_cond_init(&tile_done_, VXL_NULLPTR);
+  pthread_mutex_init(&read_mutex_, VXL_NULLPTR);
+#endif
+}
+
+vil_lazy_pyramid_image_resource::~vil_lazy_pyramid_image_resource()
+{
+#if VXL_HAS_PTHREAD_H
+  pthread_mutex_destroy(&cache_mutex_);
+  pthread_cond_destroy(&tile_done_);
+  pthread_mutex_destroy(&read_mutex_);
+#endif
+}
+
+vil_image_view_base_sptr
+vil_lazy_pyramid_image_resource::get_level_view(unsigned level,
+                                                unsigned i0, unsigned n_i,
+                                                unsigned j0, unsigned n_j) const
+{
+  if (level >= nlevels() || n_i == 0 || n_j == 0 ||
+      i0+n_i > ni_[level] || j0+n_j > nj_[level])
+    return VXL_NULLPTR;
+
+  if (levels_[level])
+  {
+#if VXL_HAS_PTHREAD_H
+    pthread_mutex_lock(&read_mutex_);
+#endif
+    vil_image_view_base_sptr v = levels_[level]->get_copy_view(i0, n_i, j0, n_j);
+#if VXL_HAS_PTHREAD_H
+    pthread_mutex_unlock(&read_mutex_);
+#endif
+    return v;
+  }
+
+  vil_image_view_base_sptr view;
+  switch (pixel_format())
+  {
+#define vil_lazy_pyramid_new_view_case(FORMAT, T) \
+   case FORMAT: view = new vil_image_view<T >(n_i, n_j, nplanes()); break
+    vil_lazy_pyramid_new_view_case(VIL_PIXEL_FORMAT_BYTE, vxl_byte);
+    vil_lazy_pyramid_new_view_case(VIL_PIXEL_FORMAT_UINT_16, vxl_uint_16);
+    vil_lazy_pyramid_new_view_case(VIL_PIXEL_FORMAT_INT_16, vxl_int_16);
+    vil_lazy_pyramid_new_view_case(VIL_PIXEL_FORMAT_FLOAT, float);
+    vil_lazy_pyramid_new_view_case(VIL_PIXEL_FORMAT_DOUBLE, double);
+#undef vil_lazy_pyramid_new_view_case
+   default:
+    return VXL_NULLPTR;
+  }
+  for (unsigned tj = j0/tile_size_; tj <= (j0+n_j-1)/tile_size_; ++tj)
+    for (unsigned ti = i0/tile_size_; ti <= (i0+n_i-1)/tile_size_; ++ti)
+      if (!copy_tile(level, ti, tj, *view, i0, j0))
+        return VXL_NULLPTR;
+  return view;
+}
+
+vil_image_view_base_sptr
+vil_lazy_pyramid_image_resource::get_tile(unsigned level, unsigned ti, unsigned tj) const
+{
+  if (level >= nlevels() || ti >= n_tiles_i(level) || tj >= n_tiles_j(level))
+    return VXL_NULLPTR;
+  const unsigned i0 = ti*tile_size_, j0 = tj*tile_size_;
+  return get_level_view(level, i0, std::min(tile_size_, ni_[level]-i0),
+                        j0, std::min(tile_size_, nj_[level]-j0));
+}
+
+//: Copy from a cached tile, making it first if it is not in the cache.
+//  The cached views are only referenced or copied with cache_mutex_ held,
+//  since the reference counts of views are not safe to change from
+//  several threads.
+bool vil_lazy_pyramid_image_resource::copy_tile(unsigned level, unsigned ti, unsigned tj,
+                                                vil_image_view_base& dest,
+                                                unsigned i0, unsigned j0) const
+{
+  void (*copy)(vil_image_view_base const&, unsigned, unsigned, vil_image_view_base&, unsigned, unsigned);
+  switch (pixel_format())
+  {
+   case VIL_PIXEL_FORMAT_BYTE: copy = vil_lazy_pyramid_copy<vxl_byte>; break;
+   case VIL_PIXEL_FORMAT_UINT_16: copy = vil_lazy_pyramid_copy<vxl_uint_16>; break;
+   case VIL_PIXEL_FORMAT_INT_16: copy = vil_lazy_pyramid_copy<vxl_int_16>; break;
+   case VIL_PIXEL_FORMAT_FLOAT: copy = vil_lazy_pyramid_copy<float>; break;
+   case VIL_PIXEL_FORMAT_DOUBLE: copy = vil_lazy_pyramid_copy<double>; break;
+   default: return false;
+  }
+  const vxl_uint_64 key = tile_key(level, ti, tj);
+  const unsigned ti0 = ti*tile_size_, tj0 = tj*tile_size_;
+
+#if VXL_HAS_PTHREAD_H
+  pthread_mutex_lock(&cache_mutex_);
+#endif
+  for (;;)
+  {
+    std::map<vxl_uint_64, tile_list::iterator>::iterator f = tile_index_.find(key);
+    if (f != tile_index_.end())
+    {
+      tiles_.splice(tiles_.begin(), tiles_, f->second);
+      copy(*f->second->second, ti0, tj0, dest, i0, j0);
+#if VXL_HAS_PTHREAD_H
+      pthread_mutex_unlock(&cache_mutex_);
+#endif
+      return true;
+    }
+    if (pending_.find(key) == pending_.end())
+      break;
+    // Another thread is making this tile; wait for it
+#if VXL_HAS_PTHREAD_H
+    pthread_cond_wait(&tile_done_, &cache_mutex_);
+#endif
+  }
+  pending_.insert(key);
+#if VXL_HAS_PTHREAD_H
+  pthread_mutex_unlock(&cache_mutex_);
+#endif
+
+  vil_image_view_base_sptr tile = make_tile(level, ti, tj);
+
+#if VXL_HAS_PTHREAD_H
+  pthread_mutex_lock(&cache_mutex_);
+#endif
+  pending_.erase(key);
+  const bool made = tile != VXL_NULLPTR;
+  if (made)
+  {
+    ++n_tiles_made_;
+    copy(*tile, ti0, tj0, dest, i0, j0);
+    if (cache_tiles_ > 0)
+    {
+      tiles_.push_front(std::make_pair(key, tile));
+      tile_index_[key] = tiles_.begin();
+      while (tile_index_.size() > cache_tiles_)
+      {
+        tile_index_.erase(tiles_.back().first);
+        tiles_.pop_back();
+      }
+    }
+    tile = VXL_NULLPTR;
+  }
+#if VXL_HAS_PTHREAD_H
+  pthread_cond_broadcast(&tile_done_);
+  pthread_mutex_unlock(&cache_mutex_);
+#endif
+  return made;
+}
+
+//: Make a tile by vil_gauss_reduce of a window of the level before.
+//  Away from the edges of the level, output pixel x of vil_gauss_reduce
+//  depends on input pixels 2x-2 to 2x+2, and the first and last outputs
+//  use one-sided filters.  So the window starts two pixels before twice
+//  the first output of the tile, and ends two pixels after twice the
+//  last, or at the edge of the level; the extra outputs at either end of
+//  the window are dropped.
+vil_image_view_base_sptr
+vil_lazy_pyramid_image_resource::make_tile(unsigned level, unsigned ti, unsigned tj) const
+{
+  const unsigned o0_i = ti*tile_size_, o1_i = std::min(o0_i+tile_size_, ni_[level]);
+  const unsigned o0_j = tj*tile_size_, o1_j = std::min(o0_j+tile_size_, nj_[level]);
+  const unsigned s0_i = o0_i > 0 ? 2*o0_i-2 : 0;
+  const unsigned s1_i = o1_i < ni_[level] ? 2*o1_i+1 : ni_[level-1];
+  const unsigned s0_j = o0_j > 0 ? 2*o0_j-2 : 0;
+  const unsigned s1_j = o1_j < nj_[level] ? 2*o1_j+1 : nj_[level-1];
+
+  vil_image_view_base_sptr src = get_level_view(level-1, s0_i, s1_i-s0_i, s0_j, s1_j-s0_j);
+  if (!src)
+    return VXL_NULLPTR;
+  switch (pixel_format())
+  {
+#define vil_lazy_pyramid_reduce_case(FORMAT, T) \
+   case FORMAT: \
+    return vil_lazy_pyramid_reduce<T >(*src, o0_i-s0_i/2, o1_i-o0_i, o0_j-s0_j/2, o1_j-o0_j)
+    vil_lazy_pyramid_reduce_case(VIL_PIXEL_FORMAT_BYTE, vxl_byte);
+    vil_lazy_pyramid_reduce_case(VIL_PIXEL_FORMAT_UINT_16, vxl_uint_16);
+    vil_lazy_pyramid_reduce_case(VIL_PIXEL_FORMAT_INT_16, vxl_int_16);
+    vil_lazy_pyramid_reduce_case(VIL_PIXEL_FORMAT_FLOAT, float);
+    vil_lazy_pyramid_reduce_case(VIL_PIXEL_FORMAT_DOUBLE, double);
+#undef vil_lazy_pyramid_reduce_case
+   default:
+    return VXL_NULLPTR;
+  }
+}
+
+vil_image_view_base_sptr
+vil_lazy_pyramid_image_resource::get_copy_view(unsigned i0, unsigned n_i,
+                                               unsigned j0, unsigned n_j,
+                                               unsigned level) const
+{
+  if (level >= nlevels())
+    return VXL_NULLPTR;
+  // transform base image coordinates to the level, keeping within it
+  const float s = scale(level);
+  unsigned si0 = static_cast<unsigned>(std::floor(s*i0));
+  unsigned sj0 = static_cast<unsigned>(std::floor(s*j0));
+  if (si0 >= ni_[level] || sj0 >= nj_[level])
+    return VXL_NULLPTR;
+  unsigned sni = std::max(1u, static_cast<unsigned>(std::floor(s*n_i)));
+  unsigned snj = std::max(1u, static_cast<unsigned>(std::floor(s*n_j)));
+  sni = std::min(sni, ni_[level]-si0);
+  snj = std::min(snj, nj_[level]-sj0);
+  return get_level_view(level, si0, sni, sj0, snj);
+}
+
+vil_image_view_base_sptr
+vil_lazy_pyramid_image_resource::get_copy_view(unsigned i0, unsigned n_i,
+                                               unsigned j0, unsigned n_j,
+                                               const float scale,
+                                               float& actual_scale) const
+{
+  // find the level closest to scale, by ratio
+  unsigned best = 0;
+  float best_d = std::fabs(std::log(this->scale(0)/scale));
+  for (unsigned l = 1; l < nlevels(); ++l)
+  {
+    float d = std::fabs(std::log(this->scale(l)/scale));
+    if (d < best_d) { best_d = d; best = l; }
+  }
+  actual_scale = this->scale(best);
+  return get_copy_view(i0, n_i, j0, n_j, best);
+}
+
+vil_image_resource_sptr
+vil_lazy_pyramid_image_resource::get_resource(const unsigned level) const
+{
+  if (level >= nlevels())
+    return VXL_NULLPTR;
+  return new vil_lazy_pyramid_level_resource(this, level);
+}
+
+void vil_lazy_pyramid_image_resource::clear_cache()
+{
+#if VXL_HAS_PTHREAD_H
+  pthread_mutex_lock(&cache_mutex_);
+#endif
+  tile_index_.clear();
+  tiles_.clear();
+#if VXL_HAS_PTHREAD_H
+  pthread_mutex_unlock(&cache_mutex_);
+#endif
+}
+
+bool vil_lazy_pyramid_image_resource::save(char const* file_or_directory,
+                                           char const* format) const
+{
+  vil_pyramid_image_resource_sptr out =
+    vil_new_pyramid_image_resource(file_or_directory, format);
+  if (!out)
+    return false;
+  for (unsigned l = 0; l < nlevels(); ++l)
+    if (!out->put_resource(get_resource(l)))
+      return false;
+  return true;
+}
+
+void vil_lazy_pyramid_image_resource::print(const unsigned level)
+{
+  if (level >= nlevels())
+    return;
+  std::cout << "level[" << level << "]  scale: " << scale(level)
+            << "  ni: " << ni_[level] << "  nj: " << nj_[level]
+            << (levels_[level] ? "  stored\n" : "  made on demand\n");
+}
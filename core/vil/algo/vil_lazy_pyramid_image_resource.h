@@ -0,0 +1,217 @@
+// This is core/vil/algo/vil_lazy_pyramid_image_resource.h
+#ifndef vil_lazy_pyramid_image_resource_h_
+#define vil_lazy_pyramid_image_resource_h_
+//:
+// \file
+// \brief A pyramid image resource whose missing levels are made on demand
+//
+// The pyramid resources in vil/file_formats can only serve the levels
+// that are already stored.  This resource serves every level of a 2:1
+// pyramid over a base image, taking the levels which exist from an image
+// or an existing pyramid, and making the others tile by tile, only when
+// they are asked for.  Each missing tile is made by vil_gauss_reduce from
+// the next finer level, from a window of that level large enough to give
+// exactly the pixels that vil_gauss_reduce of the whole level would give.
+//
+// The tiles made are kept in a cache of a bounded number of tiles, the
+// least recently used being dropped first.  All the methods may be called
+// from several threads at once: if a tile is asked for while another
+// thread is making it, the request waits for that tile rather than making
+// it again.  Reads from the stored levels are serialised, since file
+// image resources are not safe to read from two threads.
+//
+// Views and tiles of a level are given in the pixel coordinates of the
+// level; as for the other pyramid resources, the get_copy_view() methods
+// with a level or scale take positions and sizes in base image coordinates.
+//
+// A tile server might use it so:
+// \code
+//   vil_image_resource_sptr base = vil_load_image_resource("big.tif");
+//   vil_lazy_pyramid_image_resource* pyr = new vil_lazy_pyramid_image_resource(base);
+//   vil_pyramid_image_resource_sptr pyr_sptr = pyr;
+//   vil_image_view_base_sptr tile = pyr->get_tile(level, ti, tj);
+//   ...
+//   pyr->save("big_pyramid.tif"); // keep all the levels for next time
+// \endcode
+//
+// Only images with scalar pixel types that vil_gauss_reduce is
+// instantiated for (byte, 16-bit integers, float and double) get
+// levels other than the base; they may have any number of planes.
+
+#include <vector>
+#include <list>
+#include <map>
+#include <set>
+#include <utility>
+#include <vxl_config.h>
+#include <vcl_compiler.h>
+#include <vil/vil_pyramid_image_resource.h>
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
+
+class vil_lazy_pyramid_image_resource : public vil_pyramid_image_resource
+{
+ public:
+  //: Construct a pyramid over a base image.
+  //  If nlevels is 0, levels are added until the smallest fits in one
+  //  tile.  Levels cannot be made from a level narrower than 3 pixels,
+  //  which may limit nlevels.  At most cache_tiles tiles are kept.
+  vil_lazy_pyramid_image_resource(vil_image_resource_sptr const& base,
+                                  unsigned nlevels = 0,
+                                  unsigned tile_size = 256,
+                                  unsigned cache_tiles = 256);
+
+  //: Construct a pyramid over the base of an existing pyramid.
+  //  Levels of the existing pyramid which have the size of a 2:1
+  //  pyramid level are served from it; the others are made on demand.
+  vil_lazy_pyramid_image_resource(vil_pyramid_image_resource_sptr const& pyramid,
+                                  unsigned nlevels = 0,
+                                  unsigned tile_size = 256,
+                                  unsigned cache_tiles = 256);
+
+  virtual ~vil_lazy_pyramid_image_resource();
+
+  //: The number of planes of the base image.
+  virtual unsigned nplanes() const { return levels_[0]->nplanes(); }
+
+  //: The number of pixels in each row of the base image.
+  virtual unsigned ni() const { return ni_[0]; }
+
+  //: The number of pixels in each column of the base image.
+  virtual unsigned nj() const { return nj_[0]; }
+
+  //: Pixel Format.
+  virtual enum vil_pixel_format pixel_format() const { return levels_[0]->pixel_format(); }
+
+  using vil_pyramid_image_resource::get_copy_view;
+
+  //: Create a read/write view of a copy of part of the base image.
+  virtual vil_image_view_base_sptr get_copy_view(unsigned i0, unsigned n_i,
+                                                 unsigned j0, unsigned n_j) const
+  { return get_level_view(0, i0, n_i, j0, n_j); }
+
+  //: Not a file image.
+  virtual char const* file_format() const { return VXL_NULLPTR; }
+
+  // === Methods particular to pyramid resource ===
+
+  //: Number of pyramid levels
+  virtual unsigned nlevels() const { return static_cast<unsigned>(levels_.size()); }
+
+  //: Get a partial view from a level, with position and size in base image coordinates.
+  virtual vil_image_view_base_sptr get_copy_view(unsigned i0, unsigned n_i,
+                                                 unsigned j0, unsigned n_j,
+                                                 unsigned level) const;
+
+  //: Get a partial view from the level closest to scale, in base image coordinates.
+  virtual vil_image_view_base_sptr get_copy_view(unsigned i0, unsigned n_i,
+                                                 unsigned j0, unsigned n_j,
+                                                 const float scale,
+                                                 float& actual_scale) const;
+
+  //: The pyramid is read only.
+  virtual bool put_resource(vil_image_resource_sptr const& /*resc*/) { return false; }
+
+  //: Get an image resource for a level, in the coordinates of the level.
+  //  The resource refers to this pyramid, so must not outlive it.
+  virtual vil_image_resource_sptr get_resource(const unsigned level) const;
+
+  //: for debug purposes
+  virtual void print(const unsigned level);
+
+  // === Methods particular to lazy pyramids ===
+
+  //: Width of a level.
+  unsigned ni(unsigned level) const { return ni_[level]; }
+
+  //: Height of a level.
+  unsigned nj(unsigned level) const { return nj_[level]; }
+
+  //: Scale of a level with respect to the base image.
+  float scale(unsigned level) const { return float(ni_[level])/ni_[0]; }
+
+  //: Get a view of part of a level, in the coordinates of the level.
+  //  Returns 0 if the region is not within the level.
+  vil_image_view_base_sptr get_level_view(unsigned level,
+                                          unsigned i0, unsigned n_i,
+                                          unsigned j0, unsigned n_j) const;
+
+  //: Width and height of the tiles.
+  unsigned tile_size() const { return tile_size_; }
+
+  //: Number of tiles across a level.
+  unsigned n_tiles_i(unsigned level) const { return (ni_[level]+tile_size_-1)/tile_size_; }
+
+  //: Number of tiles down a level.
+  unsigned n_tiles_j(unsigned level) const { return (nj_[level]+tile_size_-1)/tile_size_; }
+
+  //: Get tile (ti,tj) of a level; tiles at the right and bottom may be smaller.
+  vil_image_view_base_sptr get_tile(unsigned level, unsigned ti, unsigned tj) const;
+
+  //: True if the level is served from a stored image, rather than made.
+  bool is_stored(unsigned level) const { return levels_[level] != VXL_NULLPTR; }
+
+  //: Number of tiles made so far.
+  unsigned long n_tiles_made() const { return n_tiles_made_; }
+
+  //: Maximum number of tiles kept in the cache.
+  unsigned cache_tiles() const { return cache_tiles_; }
+
+  //: Drop all the tiles from the cache.
+  void clear_cache();
+
+  //: Write all the levels to a new pyramid resource, e.g. a pyramid TIFF.
+  //  Makes each missing level in full.
+  bool save(char const* file_or_directory, char const* format = "tiff") const;
+
+ private:
+  //: Set up the level sizes, given the base image.
+  void init(vil_image_resource_sptr const& base, unsigned nlevels);
+
+  //: Key of a tile in the cache.
+  static vxl_uint_64 tile_key(unsigned level, unsigned ti, unsigned tj)
+  { return (vxl_uint_64(level) << 48) | (vxl_uint_64(ti) << 24) | vxl_uint_64(tj); }
+
+  //: Copy the part of tile (ti,tj) of a made level that overlaps dest.
+  //  dest holds the level region starting at (i0,j0).
+  bool copy_tile(unsigned level, unsigned ti, unsigned tj,
+                 vil_image_view_base& dest, unsigned i0, unsigned j0) const;
+
+  //: Make tile (ti,tj) of a level from the level before.
+  vil_image_view_base_sptr make_tile(unsigned level, unsigned ti, unsigned tj) const;
+
+  //: Stored image of each level, or 0 for levels made on demand.
+  std::vector<vil_image_resource_sptr> levels_;
+  //: Width of each level.
+  std::vector<unsigned> ni_;
+  //: Height of each level.
+  std::vector<unsigned> nj_;
+
+  unsigned tile_size_;
+  unsigned cache_tiles_;
+
+  typedef std::list<std::pair<vxl_uint_64, vil_image_view_base_sptr> > tile_list;
+  //: Cached tiles, most recently used first.
+  mutable tile_list tiles_;
+  //: Position of each cached tile in tiles_.
+  mutable std::map<vxl_uint_64, tile_list::iterator> tile_index_;
+  //: Tiles being made.
+  mutable std::set<vxl_uint_64> pending_;
+  mutable unsigned long n_tiles_made_;
+
+#if VXL_HAS_PTHREAD_H
+  //: Guards the cache, pending_ and n_tiles_made_.
+  mutable pthread_mutex_t cache_mutex_;
+  //: Signalled when a pending tile is done.
+  mutable pthread_cond_t tile_done_;
+  //: Serialises reads from the stored levels.
+  mutable pthread_mutex_t read_mutex_;
+#endif
+
+  // not copyable
+  vil_lazy_pyramid_image_resource(vil_lazy_pyramid_image_resource const&);
+  vil_lazy_pyramid_image_resource& operator=(vil_lazy_pyramid_image_resource const&);
+};
+
+#endif // vil_lazy_pyramid_image_resource_h_
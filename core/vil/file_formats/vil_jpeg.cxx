@@ -27,6 +27,7 @@
 #include <vil/vil_stream.h>
 #include <vil/vil_image_view.h>
 #include <vil/vil_exception.h>
+#include <vul/vul_profile.h>
 
 //: the file probe, as a C function.
 bool vil_jpeg_file_probe(vil_stream *vs)
@@ -149,6 +150,7 @@ vil_image_view_base_sptr vil_jpeg_image::get_copy_view(unsigned x0,
                                                        unsigned y0,
                                                        unsigned ny) const
 {
+  VUL_PROFILE_SCOPE("vil_jpeg_image::get_copy_view");
   if (!jd) {
     std::cerr << "attempted get_copy_view() failed -- no jpeg decompressor\n";
     return VXL_NULLPTR;
@@ -18,6 +18,7 @@
 #include <vil/vil_image_view.h>
 #include <vil/vil_property.h>
 #include <vil/vil_exception.h>
+#include <vul/vul_profile.h>
 
 #include <png.h>
 #if (PNG_LIBPNG_VER_MAJOR == 0)
@@ -461,6 +462,7 @@ vil_image_view_base_sptr vil_png_image::get_copy_view(unsigned x0,
                                                       unsigned y0,
                                                       unsigned ny) const
 {
+  VUL_PROFILE_SCOPE("vil_png_image::get_copy_view");
   if (!p_->ok)
     return VXL_NULLPTR;
 
@@ -27,6 +27,7 @@
 #include <vil/vil_image_list.h>
 #include "vil_tiff_header.h"
 #include <vil/vil_exception.h>
+#include <vul/vul_profile.h>
 //#define DEBUG
 
 // Constants
@@ -709,6 +710,7 @@ vil_image_view_base_sptr
 vil_tiff_image::get_block( unsigned block_index_i,
                            unsigned block_index_j ) const
 {
+  VUL_PROFILE_SCOPE("vil_tiff_image::get_block");
   // the only two possibilities
   assert(h_->is_tiled() || h_->is_striped());
   //
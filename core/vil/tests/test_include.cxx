@@ -65,6 +65,7 @@
 #include <vil/vil_transpose.h>
 #include <vil/vil_view_as.h>
 #include <vil/vil_warp.h>
+#include <vil/vil_warp_homography.h>
 
 // Image file format interface headers:
 #include <vil/file_formats/vil_bmp.h>
@@ -1,8 +1,12 @@
 // This is core/vil/tests/test_warp.cxx
+#include <algorithm>
+#include <cmath>
 #include <testlib/testlib_test.h>
 #include <vil/vil_image_view.h>
 #include <vil/vil_nearest_interp.h>
 #include <vil/vil_warp.h>
+#include <vil/vil_warp_homography.h>
+#include <vil/vil_bilin_interp.h>
 #include <vil/vil_print.h>
 
 static vxl_byte interpolator(vil_image_view<vxl_byte> const& view,
@@ -17,6 +21,64 @@ void mapper(double ox, double oy, double &ix, double &iy)
   iy = -ox+1;
 }
 
+static const double homography[9] = { 0.9, 0.2, 1.5,
+                                      -0.1, 1.1, 0.5,
+                                      0.002, 0.001, 1.0 };
+
+static void homography_mapper(double ox, double oy, double &ix, double &iy)
+{
+  const double* H = homography;
+  double w = H[6]*ox + H[7]*oy + H[8];
+  ix = (H[0]*ox + H[1]*oy + H[2]) / w;
+  iy = (H[3]*ox + H[4]*oy + H[5]) / w;
+}
+
+static double bilin_interpolator(vil_image_view<float> const& view,
+                                 double x, double y, unsigned p)
+{
+  return vil_bilin_interp_safe(view, x, y, p);
+}
+
+static void test_warp_homography()
+{
+  // rows of positions, with odd and even lengths and offsets
+  bool row_ok = true;
+  for (unsigned n = 1; n < 8; ++n)
+  {
+    double xs[8], ys[8];
+    vil_warp_homography_row(homography, 3.0, n, n, xs, ys);
+    for (unsigned i = 0; i < n; ++i)
+    {
+      double ix, iy;
+      homography_mapper(double(n+i), 3.0, ix, iy);
+      if (std::fabs(ix-xs[i]) > 1e-12 || std::fabs(iy-ys[i]) > 1e-12)
+        row_ok = false;
+    }
+  }
+  TEST("Rows of homography positions", row_ok, true);
+
+  vil_image_view<float> in(20, 15, 2);
+  for (unsigned p = 0; p < in.nplanes(); ++p)
+    for (unsigned j = 0; j < in.nj(); ++j)
+      for (unsigned i = 0; i < in.ni(); ++i)
+        in(i,j,p) = float(i*i + 3*j + 50*p);
+
+  vil_image_view<float> out(17, 16, 2), expected(17, 16, 2);
+  vil_warp_homography_bilin(in, out, homography);
+  vil_warp(in, expected, homography_mapper, bilin_interpolator);
+  double max_diff = 0.0;
+  unsigned n_zero = 0;
+  for (unsigned p = 0; p < out.nplanes(); ++p)
+    for (unsigned j = 0; j < out.nj(); ++j)
+      for (unsigned i = 0; i < out.ni(); ++i)
+      {
+        max_diff = std::max(max_diff, double(std::fabs(out(i,j,p)-expected(i,j,p))));
+        if (out(i,j,p) == 0.0f) ++n_zero;
+      }
+  TEST_NEAR("Homography warp matches vil_warp", max_diff, 0.0, 1e-3);
+  TEST("Some pixels map outside the input", n_zero > 0, true);
+}
+
 static void test_warp()
 {
   vil_image_view<vxl_byte>  in(2,2);
@@ -37,6 +99,8 @@ static void test_warp()
   TEST("pixel 1,1", out(1,1), 3);
   TEST("pixel 1,1", out(0,2), 0);
   TEST("pixel 1,1", out(1,2), 0);
+
+  test_warp_homography();
 }
 
 TESTMAIN(test_warp);
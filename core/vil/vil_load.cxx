@@ -16,10 +16,12 @@
 #include <vil/vil_image_resource_plugin.h>
 #include <vil/vil_image_view.h>
 #include <vil/vil_exception.h>
+#include <vul/vul_profile.h>
 
 vil_image_resource_sptr vil_load_image_resource_raw(vil_stream *is,
                                                     bool verbose)
 {
+  VUL_PROFILE_SCOPE("vil_load_image_resource_raw");
   for (vil_file_format** p = vil_file_format::all(); *p; ++p) {
 #if 0 // debugging
     std::cerr << __FILE__ " : trying \'" << (*p)->tag() << "\'\n";
@@ -130,8 +132,11 @@ vil_load_pyramid_resource(char const* directory_or_file, bool verbose)
 //: Convenience function for loading an image into an image view.
 vil_image_view_base_sptr vil_load(const char *file, bool verbose)
 {
+  VUL_PROFILE_SCOPE("vil_load");
   vil_image_resource_sptr data = vil_load_image_resource(file, verbose);
   if (!data) return VXL_NULLPTR;
+  VUL_PROFILE_SCOPE("vil_load decode");
+  VUL_PROFILE_COUNT("vil_load pixels", double(data->ni())*data->nj()*data->nplanes());
   return data -> get_view();
 }
 
@@ -0,0 +1,94 @@
+// This is core/vil/vil_warp_homography.h
+#ifndef vil_warp_homography_h_
+#define vil_warp_homography_h_
+//:
+// \file
+// \brief Warp an image through a 2D homography.
+//
+// vil_warp() maps every output pixel with a general functor.  When the map
+// is a homography H, the numerator and denominator of the projective
+// transform are each a constant for the output row plus x times a column
+// of H, so a row of input positions costs three multiply-adds and two
+// divides per pixel, and no matrix product.  vil_warp_homography_row()
+// computes a row of positions this way, two pixels at a time with SSE2
+// where available; it is also used by other libraries to warp their own
+// image types.
+
+#include <vector>
+#include <cstddef>
+#include <vcl_compiler.h>
+#include <vcl_cassert.h>
+#include <vil/vil_config.h>
+#include <vil/vil_image_view.h>
+#include <vil/vil_bilin_interp.h>
+
+#ifdef VXL_HAS_SSE2_HARDWARE_SUPPORT
+#include <emmintrin.h>
+#endif
+
+//: Input positions of the output pixels (x0,y) to (x0+n-1,y) under a homography.
+// H is a row-major 3x3 matrix mapping output (x,y,1) to homogeneous input
+// coordinates.  On exit (xs[i],ys[i]) is the input position of output
+// pixel (x0+i,y).
+inline void vil_warp_homography_row(const double H[9], double y,
+                                    unsigned x0, unsigned n,
+                                    double* xs, double* ys)
+{
+  const double ax = H[1]*y + H[2];
+  const double ay = H[4]*y + H[5];
+  const double aw = H[7]*y + H[8];
+  unsigned i = 0;
+#ifdef VXL_HAS_SSE2_HARDWARE_SUPPORT
+  const __m128d cx = _mm_set1_pd(H[0]), cy = _mm_set1_pd(H[3]), cw = _mm_set1_pd(H[6]);
+  const __m128d bx = _mm_set1_pd(ax), by = _mm_set1_pd(ay), bw = _mm_set1_pd(aw);
+  const __m128d two = _mm_set1_pd(2.0);
+  __m128d x = _mm_set_pd(double(x0)+1.0, double(x0));
+  for (; i+1 < n; i+=2, x = _mm_add_pd(x, two))
+  {
+    __m128d w = _mm_add_pd(bw, _mm_mul_pd(cw, x));
+    _mm_storeu_pd(xs+i, _mm_div_pd(_mm_add_pd(bx, _mm_mul_pd(cx, x)), w));
+    _mm_storeu_pd(ys+i, _mm_div_pd(_mm_add_pd(by, _mm_mul_pd(cy, x)), w));
+  }
+#endif
+  for (; i < n; ++i)
+  {
+    const double x = double(x0+i);
+    const double w = aw + H[6]*x;
+    xs[i] = (ax + H[0]*x) / w;
+    ys[i] = (ay + H[3]*x) / w;
+  }
+}
+
+//: Warp an image through a homography, using bilinear interpolation.
+// out(x,y,p) = in(H(x,y),p), where H is a row-major 3x3 matrix mapping
+// output (x,y,1) to homogeneous input coordinates, i.e. the inverse of the
+// map from input to output.  Output pixels which map outside
+// [0,in.ni()-1]*[0,in.nj()-1] are set to zero, as by
+// vil_warp(in, out, mapper, vil_bilin_interp_safe).  The input positions
+// are computed once per pixel and shared by all the planes.
+// \relatesalso vil_image_view
+template <class sType, class dType>
+void vil_warp_homography_bilin(const vil_image_view<sType>& in,
+                               vil_image_view<dType>& out,
+                               const double H[9])
+{
+  assert(out.nplanes() == in.nplanes());
+  const unsigned ni = out.ni(), nj = out.nj(), np = out.nplanes();
+  if (ni == 0)
+    return;
+  std::vector<double> xs(ni), ys(ni);
+  for (unsigned j = 0; j < nj; ++j)
+  {
+    vil_warp_homography_row(H, double(j), 0, ni, &xs[0], &ys[0]);
+    for (unsigned p = 0; p < np; ++p)
+    {
+      const sType* plane = in.top_left_ptr() + p*in.planestep();
+      for (unsigned i = 0; i < ni; ++i)
+        out(i, j, p) = dType(vil_bilin_interp_safe(xs[i], ys[i], plane,
+                                                   in.ni(), in.nj(),
+                                                   in.istep(), in.jstep()));
+    }
+  }
+}
+
+#endif // vil_warp_homography_h_
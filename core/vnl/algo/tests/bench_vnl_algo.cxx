@@ -0,0 +1,69 @@
+// This is core/vnl/algo/tests/bench_vnl_algo.cxx
+//:
+// \file
+// \brief Benchmarks of vnl matrix products and decompositions
+// See testlib_bench.h for the options, e.g. --csv to save a baseline.
+
+#include <testlib/testlib_bench.h>
+#include <vnl/vnl_matrix.h>
+#include <vnl/vnl_random.h>
+#include <vnl/algo/vnl_svd.h>
+
+static vnl_matrix<double> bench_random_matrix(unsigned r, unsigned c)
+{
+  vnl_random rng(9667566);
+  vnl_matrix<double> m(r, c);
+  for (unsigned i = 0; i < r; ++i)
+    for (unsigned j = 0; j < c; ++j)
+      m(i,j) = rng.drand64(-1.0, 1.0);
+  return m;
+}
+
+//: Product of two matrices of size n.
+static void bench_vnl_matrix_multiply(testlib_bench_state& state, unsigned n)
+{
+  vnl_matrix<double> a = bench_random_matrix(n, n), b = bench_random_matrix(n, n), c;
+  state.set_items_per_iteration(2.0*n*n*n); // floating point operations
+  while (state.run())
+  {
+    c = a * b;
+    testlib_bench_keep(c.data_block());
+  }
+}
+
+static void bench_vnl_matrix_multiply_32(testlib_bench_state& state)
+{
+  bench_vnl_matrix_multiply(state, 32);
+}
+TESTLIB_BENCH(bench_vnl_matrix_multiply_32);
+
+static void bench_vnl_matrix_multiply_256(testlib_bench_state& state)
+{
+  bench_vnl_matrix_multiply(state, 256);
+}
+TESTLIB_BENCH(bench_vnl_matrix_multiply_256);
+
+//: SVD of an r by c matrix.
+static void bench_vnl_svd(testlib_bench_state& state, unsigned r, unsigned c)
+{
+  vnl_matrix<double> a = bench_random_matrix(r, c);
+  while (state.run())
+  {
+    vnl_svd<double> svd(a);
+    testlib_bench_keep(svd.W().diagonal().data_block());
+  }
+}
+
+static void bench_vnl_svd_10x10(testlib_bench_state& state)
+{
+  bench_vnl_svd(state, 10, 10);
+}
+TESTLIB_BENCH(bench_vnl_svd_10x10);
+
+static void bench_vnl_svd_200x50(testlib_bench_state& state)
+{
+  bench_vnl_svd(state, 200, 50);
+}
+TESTLIB_BENCH(bench_vnl_svd_200x50);
+
+TESTLIB_BENCH_MAIN;
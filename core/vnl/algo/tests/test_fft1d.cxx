@@ -4,6 +4,7 @@
 #include <iostream>
 #include <complex>
 #include <vector>
+#include <algorithm>
 #include <testlib/testlib_test.h>
 //:
 // \file
@@ -127,8 +128,55 @@ void test_fft_1d(int n)
   delete[] fTestPtrFwd;
 }
 
+// Compare the real input transforms and transform_many() with the complex transform
+void test_fft_1d_real(int n)
+{
+  std::cout << "Testing vnl_fft_1d real transforms for length " << n << '\n';
+  vnl_fft_1d<double> fft(n);
+
+  std::vector<double> x(n), y(n);
+  std::vector<std::complex<double> > c(n), spec(n/2+1);
+  for (int k=0; k<n; ++k)
+    c[k] = x[k] = std::cos(0.3*k) + 0.01*k*k - 2.0*(k%3);
+  fft.fwd_transform(c);
+  fft.fwd_transform_real(&x[0], &spec[0]);
+  double err = 0.0;
+  for (int k=0; k<=n/2; ++k)
+    err = std::max(err, std::abs(spec[k]-c[k]));
+  TEST_NEAR("fwd_transform_real matches complex transform", err/n, 0.0, 1e-12);
+
+  fft.bwd_transform_real(&spec[0], &y[0]);
+  err = 0.0;
+  for (int k=0; k<n; ++k)
+    err = std::max(err, std::fabs(y[k]/n - x[k]));
+  TEST_NEAR("bwd_transform_real inverts fwd_transform_real", err, 0.0, 1e-10);
+
+  // Three interleaved signals, transformed together and one at a time
+  const int lot = 3;
+  std::vector<std::complex<double> > many(n*lot), one(n);
+  for (int k=0; k<n*lot; ++k)
+    many[k] = std::complex<double>(std::sin(0.1*k), 0.5*(k%7));
+  std::vector<std::complex<double> > orig(many);
+  fft.transform_many(&many[0], +1, lot, 1, lot);
+  err = 0.0;
+  for (int l=0; l<lot; ++l)
+  {
+    for (int k=0; k<n; ++k) one[k] = orig[k*lot+l];
+    fft.fwd_transform(one);
+    for (int k=0; k<n; ++k) err = std::max(err, std::abs(one[k]-many[k*lot+l]));
+  }
+  TEST_NEAR("transform_many matches single transforms", err/n, 0.0, 1e-12);
+}
+
 void test_fft1d()
 {
+  test_fft_1d_real(2);
+  test_fft_1d_real(4);
+  test_fft_1d_real(15);
+  test_fft_1d_real(64);
+  test_fft_1d_real(90);
+  test_fft_1d_real(1000);
+
   test_fft_1d(256);
   test_fft_1d(243);
   test_fft_1d(625);
@@ -19,6 +19,7 @@
 #include <vnl/vnl_vector.h>
 #include <vnl/vnl_cost_function.h>
 #include <vnl/vnl_least_squares_function.h>
+#include <vul/vul_profile.h>
 
 bool vnl_amoeba::default_verbose = false;
 
@@ -249,6 +250,7 @@ void vnl_amoebaFit::amoeba(vnl_vector<double>& x, const vnl_vector<double>& dx)
 void vnl_amoebaFit::amoeba(vnl_vector<double>& x,
                            std::vector<vnl_amoeba_SimplexCorner>& simplex)
 {
+  VUL_PROFILE_SCOPE("vnl_amoeba::minimize");
   int n = x.size();
   sort_simplex(simplex);
 
@@ -16,6 +16,7 @@
 #include <vnl/vnl_cost_function.h>
 #include <vnl/vnl_vector_ref.h>
 #include <vnl/algo/vnl_netlib.h>
+#include <vul/vul_profile.h>
 
 /////////////////////////////////////
 
@@ -85,6 +86,7 @@ void vnl_conjugate_gradient::preconditioner_( double *out, double *in, void* use
 ///////////////////////////////////////
 bool vnl_conjugate_gradient::minimize( vnl_vector<double> &x)
 {
+  VUL_PROFILE_SCOPE("vnl_conjugate_gradient::minimize");
   double *xp = x.data_block();
   double max_norm_of_gradient;
   long number_of_iterations;
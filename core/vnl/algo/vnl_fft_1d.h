@@ -15,6 +15,7 @@
 // \endverbatim
 
 #include <vector>
+#include <cstddef>
 #include <vcl_compiler.h>
 #include <vnl/vnl_vector.h>
 #include <vnl/algo/vnl_fft_base.h>
@@ -69,6 +70,39 @@ struct vnl_fft_1d : public vnl_fft_base<1, T>
   //: backward (inverse) FFT
   void bwd_transform(vnl_vector<std::complex<T> > &signal)
   { transform(signal, -1); }
+
+  //: Transform lot signals, each of length size(), in one call.
+  // Element k of signal l is signal[l*jump + k*inc], with inc and jump
+  // counted in complex elements.  The prime factor code then works on
+  // all the signals in its inner loops, which is much faster than
+  // transforming them one at a time, particularly when inc>1 (e.g. the
+  // columns of an image).  dir = +1/-1 according to direction of transform.
+  void transform_many(std::complex<T> *signal, int dir,
+                      std::ptrdiff_t inc, std::ptrdiff_t jump, unsigned lot);
+
+  //: forward FFT of a real signal of length size().
+  // Writes the size()/2+1 non-redundant coefficients to out; the others
+  // are their complex conjugates.  For even sizes this costs about half
+  // as much as a complex transform of the same length.
+  // The first call to either real transform builds the half-length tables
+  // in this object, so it must not race with other calls on the same
+  // object.  After that the real transforms only read the object.
+  void fwd_transform_real(T const *in, std::complex<T> *out);
+
+  //: backward (inverse) FFT of the spectrum of a real signal.
+  // in holds size()/2+1 coefficients, as written by fwd_transform_real().
+  // As with bwd_transform(), the result is size() times the original signal.
+  void bwd_transform_real(std::complex<T> const *in, T *out);
+
+ private:
+  //: Prepare half_ and twiddle_ for the real transforms.
+  // Returns false if the complex transform must be used instead.
+  bool setup_real();
+
+  //: Plan for transforms of length size()/2, made on first use.
+  vnl_fft_prime_factors<T> half_;
+  //: exp(2 pi i k/size()) for k = 0 .. size()/2.
+  std::vector<std::complex<T> > twiddle_;
 };
 
 #endif // vnl_fft_1d_h_
@@ -2,7 +2,127 @@
 #define vnl_fft_1d_hxx_
 // -*- c++ -*-
 
+#include <cmath>
 #include "vnl_fft_1d.h"
+#include <vnl/algo/vnl_fft.h>
+#include <vcl_cassert.h>
+
+template <class T>
+void vnl_fft_1d<T>::transform_many(std::complex<T> *signal, int dir,
+                                   std::ptrdiff_t inc, std::ptrdiff_t jump,
+                                   unsigned lot)
+{
+  assert((dir == +1) || (dir == -1));
+  if (lot == 0) return;
+  // Same layout assumption as vnl_fft_base<D,T>::transform()
+  T *data = (T *) signal;
+  long info = 0;
+  vnl_fft_gpfa (/* A */     data,
+                /* B */     data + 1,
+                /* TRIGS */ base::factors_[0].trigs (),
+                /* INC */   2*long(inc),
+                /* JUMP */  2*long(jump),
+                /* N */     base::factors_[0].number (),
+                /* LOT */   long(lot),
+                /* ISIGN */ dir,
+                /* NIPQ */  base::factors_[0].pqr (),
+                /* INFO */  &info);
+  assert(info != -1);
+}
+
+template <class T>
+bool vnl_fft_1d<T>::setup_real()
+{
+  const int n = size();
+  // Odd lengths cannot be split into even and odd samples.
+  if (n%2 != 0 || n < 4)
+    return false;
+  if (!half_)
+  {
+    const int m = n/2;
+    half_.resize(m);
+    twiddle_.resize(m+1);
+    const double w = 2*3.14159265358979323846/n;
+    for (int k=0; k<=m; ++k)
+      twiddle_[k] = std::complex<T>(T(std::cos(w*k)), T(std::sin(w*k)));
+  }
+  return true;
+}
+
+// A real signal x of even length n=2m is packed as z[j] = x[2j] + i x[2j+1],
+// and z is transformed with a complex FFT of length m.  The spectra E and O
+// of the even and odd samples are then
+//   E[k] = (Z[k] + conj(Z[m-k]))/2,  O[k] = (Z[k] - conj(Z[m-k]))/2i
+// and X[k] = E[k] + W^k O[k], with W = exp(2 pi i/n) the forward twiddle.
+template <class T>
+void vnl_fft_1d<T>::fwd_transform_real(T const *in, std::complex<T> *out)
+{
+  const int n = size();
+  if (!setup_real())
+  {
+    std::vector<std::complex<T> > work(n);
+    for (int k=0; k<n; ++k) work[k] = std::complex<T>(in[k], T(0));
+    base::transform(&work[0], +1);
+    for (int k=0; k<=n/2; ++k) out[k] = work[k];
+    return;
+  }
+
+  const int m = n/2;
+  std::vector<std::complex<T> > work(m);
+  std::complex<T> *z = &work[0];
+  for (int j=0; j<m; ++j) z[j] = std::complex<T>(in[2*j], in[2*j+1]);
+  long info = 0;
+  vnl_fft_gpfa ((T *) z, (T *) z + 1, half_.trigs (),
+                2, 0, m, 1, +1, half_.pqr (), &info);
+  assert(info != -1);
+
+  const std::complex<T> minus_half_i(T(0), T(-0.5));
+  for (int k=0; k<=m; ++k)
+  {
+    std::complex<T> a = z[k%m];
+    std::complex<T> b = std::conj(z[(m-k)%m]);
+    std::complex<T> e = T(0.5)*(a+b);
+    std::complex<T> o = minus_half_i*(a-b);
+    out[k] = e + twiddle_[k]*o;
+  }
+}
+
+// Inverse of the above: rebuild Z[k] = 2E[k] + 2i O[k] from the spectrum,
+// then a backward complex FFT of length m gives n*(x[2j] + i x[2j+1]).
+template <class T>
+void vnl_fft_1d<T>::bwd_transform_real(std::complex<T> const *in, T *out)
+{
+  const int n = size();
+  if (!setup_real())
+  {
+    std::vector<std::complex<T> > work(n);
+    for (int k=0; k<=n/2; ++k) work[k] = in[k];
+    for (int k=n/2+1; k<n; ++k) work[k] = std::conj(in[n-k]);
+    base::transform(&work[0], -1);
+    for (int k=0; k<n; ++k) out[k] = work[k].real();
+    return;
+  }
+
+  const int m = n/2;
+  std::vector<std::complex<T> > work(m);
+  std::complex<T> *z = &work[0];
+  const std::complex<T> i(T(0), T(1));
+  for (int k=0; k<m; ++k)
+  {
+    std::complex<T> a = in[k];
+    std::complex<T> b = std::conj(in[m-k]);
+    z[k] = (a+b) + i*((a-b)*std::conj(twiddle_[k]));
+  }
+  long info = 0;
+  vnl_fft_gpfa ((T *) z, (T *) z + 1, half_.trigs (),
+                2, 0, m, 1, -1, half_.pqr (), &info);
+  assert(info != -1);
+  for (int j=0; j<m; ++j)
+  {
+    out[2*j]   = z[j].real();
+    out[2*j+1] = z[j].imag();
+  }
+}
 
 #undef VNL_FFT_1D_INSTANTIATE
 #define VNL_FFT_1D_INSTANTIATE(T) \
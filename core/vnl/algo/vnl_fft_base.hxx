@@ -25,31 +25,48 @@ void vnl_fft_base<D, T>::transform(std::complex<T> *signal, int dir)
     }
 
     // pretend the signal is N1xN2xN3. we want to transform
-    // along the second dimension.
-    for (int n1=0; n1<N1; ++n1) {
-      // FIXME: we could avoid one loop by using the LOT parameter
-      // but it's not entirely clear that would save us anything.
-
-      for (int n3=0; n3<N3; ++n3) {
-        // This relies on the assumption that std::complex<T> is layout
-        // compatible with "struct { T real; T imag; }". It is probably
-        // a valid assumption for all sane C++ libraries.
-        T *data = (T *) (signal + n1*N2*N3 + n3);
+    // along the second dimension. Each call to gpfa transforms a
+    // whole batch (LOT) of signals, which lets its inner loops run
+    // over the batch rather than over one short signal at a time.
+    // This relies on the assumption that std::complex<T> is layout
+    // compatible with "struct { T real; T imag; }". It is probably
+    // a valid assumption for all sane C++ libraries.
+    if (N3 > 1) {
+      // batch over n3, one call per n1.
+      for (int n1=0; n1<N1; ++n1) {
+        T *data = (T *) (signal + n1*N2*N3);
 
         long info = 0;
         vnl_fft_gpfa (/* A */     data,
                       /* B */     data + 1,
                       /* TRIGS */ factors_[i].trigs (),
                       /* INC */   2*N3,
-                      /* JUMP */  0,
+                      /* JUMP */  2,
                       /* N */     N2,
-                      /* LOT */   1,
+                      /* LOT */   N3,
                       /* ISIGN */ dir,
                       /* NIPQ */  factors_[i].pqr (),
                       /* INFO */  &info);
         assert(info != -1);
       }
     }
+    else {
+      // last dimension: the signals are contiguous, so batch over n1.
+      T *data = (T *) signal;
+
+      long info = 0;
+      vnl_fft_gpfa (/* A */     data,
+                    /* B */     data + 1,
+                    /* TRIGS */ factors_[i].trigs (),
+                    /* INC */   2,
+                    /* JUMP */  2*N2,
+                    /* N */     N2,
+                    /* LOT */   N1,
+                    /* ISIGN */ dir,
+                    /* NIPQ */  factors_[i].pqr (),
+                    /* INFO */  &info);
+      assert(info != -1);
+    }
   }
 }
 
@@ -17,6 +17,7 @@
 #include <vcl_compiler.h>
 
 #include <vnl/algo/vnl_netlib.h> // lbfgs_()
+#include <vul/vul_profile.h>
 
 //: Default constructor.
 // memory is set to 5, line_search_accuracy to 0.9.
@@ -46,6 +47,7 @@ void vnl_lbfgs::init_parameters()
 
 bool vnl_lbfgs::minimize(vnl_vector<double>& x)
 {
+  VUL_PROFILE_SCOPE("vnl_lbfgs::minimize");
   // Local variables
   // The driver for vnl_lbfgs must always declare LB2 as EXTERNAL
 
@@ -22,6 +22,7 @@
 #include <vnl/vnl_matrix_ref.h>
 #include <vnl/vnl_least_squares_function.h>
 #include <vnl/algo/vnl_netlib.h> // lmdif_()
+#include <vul/vul_profile.h>
 
 // see header
 vnl_vector<double> vnl_levenberg_marquardt_minimize(vnl_least_squares_function& f,
@@ -126,6 +127,7 @@ bool vnl_levenberg_marquardt::minimize(vnl_vector<double>& x)
 //
 bool vnl_levenberg_marquardt::minimize_without_gradient(vnl_vector<double>& x)
 {
+  VUL_PROFILE_SCOPE("vnl_levenberg_marquardt::minimize_without_gradient");
   //fsm
   if (f_->has_gradient()) {
     std::cerr << __FILE__ " : WARNING. calling minimize_without_gradient(), but f_ has gradient.\n";
@@ -283,6 +285,7 @@ void vnl_levenberg_marquardt::lmder_lsqfun(long* n,     // I   Number of residua
 //
 bool vnl_levenberg_marquardt::minimize_using_gradient(vnl_vector<double>& x)
 {
+  VUL_PROFILE_SCOPE("vnl_levenberg_marquardt::minimize_using_gradient");
   //fsm
   if (! f_->has_gradient()) {
     std::cerr << __FILE__ ": called method minimize_using_gradient(), but f_ has no gradient.\n";
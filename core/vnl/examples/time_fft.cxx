@@ -0,0 +1,103 @@
+// This is core/vnl/examples/time_fft.cxx
+//:
+// \file
+// \brief Compare timings of the FFT code paths.
+//
+// Times, for a range of sizes:
+//  - the columns of an image transformed one at a time (as vnl_fft_2d
+//    used to do) against all at once with vnl_fft_1d::transform_many();
+//  - a real signal transformed as complex against fwd_transform_real().
+//
+// Usage: time_fft [n_repeats]
+
+#include <iostream>
+#include <iomanip>
+#include <complex>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+#include <vcl_compiler.h>
+#include <vul/vul_timer.h>
+#include <vnl/algo/vnl_fft.h>
+#include <vnl/algo/vnl_fft_1d.h>
+#include <vnl/algo/vnl_fft_prime_factors.h>
+
+typedef std::complex<double> cplx;
+
+static void fill(std::vector<cplx>& v)
+{
+  for (unsigned k=0; k<v.size(); ++k)
+    v[k] = cplx(std::sin(0.01*k), std::cos(0.03*k));
+}
+
+//: Transform the n columns of an n x n row-major image, one at a time.
+static void columns_one_at_a_time(std::vector<cplx>& im, int n,
+                                  vnl_fft_prime_factors<double> const& pf)
+{
+  for (int c=0; c<n; ++c)
+  {
+    double* data = (double*)(&im[c]);
+    long info = 0;
+    vnl_fft_gpfa(data, data+1, pf.trigs(), 2*n, 0, n, 1, +1, pf.pqr(), &info);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  int n_repeats = argc>1 ? std::atoi(argv[1]) : 20;
+  const int sizes[] = { 64, 128, 240, 256, 500, 512, 1024 };
+  const unsigned n_sizes = sizeof(sizes)/sizeof(sizes[0]);
+
+  std::cout << "Image columns (n x n image, " << n_repeats << " repeats)\n"
+            << "     n  one-at-a-time(ms)  transform_many(ms)\n";
+  for (unsigned s=0; s<n_sizes; ++s)
+  {
+    int n = sizes[s];
+    std::vector<cplx> im(n*n);
+    vnl_fft_1d<double> fft(n);
+    vnl_fft_prime_factors<double> pf(n);
+
+    fill(im);
+    vul_timer t;
+    for (int r=0; r<n_repeats; ++r)
+      columns_one_at_a_time(im, n, pf);
+    long t_one = t.real();
+
+    fill(im);
+    t.mark();
+    for (int r=0; r<n_repeats; ++r)
+      fft.transform_many(&im[0], +1, n, 1, n);
+    long t_many = t.real();
+
+    std::cout << std::setw(6) << n << std::setw(19) << t_one
+              << std::setw(20) << t_many << '\n';
+  }
+
+  std::cout << "\nReal signals (" << 100*n_repeats << " repeats)\n"
+            << "     n  complex(ms)  real(ms)\n";
+  for (unsigned s=0; s<n_sizes; ++s)
+  {
+    int n = 16*sizes[s];
+    vnl_fft_1d<double> fft(n);
+    std::vector<double> x(n);
+    std::vector<cplx> c(n), spec(n/2+1);
+    for (int k=0; k<n; ++k) x[k] = std::sin(0.01*k);
+
+    vul_timer t;
+    for (int r=0; r<100*n_repeats; ++r)
+    {
+      for (int k=0; k<n; ++k) c[k] = x[k];
+      fft.fwd_transform(c);
+    }
+    long t_complex = t.real();
+
+    t.mark();
+    for (int r=0; r<100*n_repeats; ++r)
+      fft.fwd_transform_real(&x[0], &spec[0]);
+    long t_real = t.real();
+
+    std::cout << std::setw(6) << n << std::setw(13) << t_complex
+              << std::setw(10) << t_real << '\n';
+  }
+  return 0;
+}
@@ -0,0 +1,72 @@
+// This is core/vsl/tests/bench_vsl.cxx
+//:
+// \file
+// \brief Benchmarks of vsl binary I/O to and from memory
+// See testlib_bench.h for the options, e.g. --csv to save a baseline.
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include <testlib/testlib_bench.h>
+#include <vsl/vsl_binary_io.h>
+#include <vsl/vsl_vector_io.h>
+
+static const unsigned bench_n = 100000;
+
+//: Write a vector of doubles.
+static void bench_vsl_write_vector_double(testlib_bench_state& state)
+{
+  std::vector<double> v(bench_n);
+  for (unsigned i = 0; i < bench_n; ++i) v[i] = 0.5*i;
+  state.set_items_per_iteration(bench_n);
+  while (state.run())
+  {
+    std::ostringstream os;
+    vsl_b_ostream bos(&os);
+    vsl_b_write(bos, v);
+    testlib_bench_keep(&os);
+  }
+}
+TESTLIB_BENCH(bench_vsl_write_vector_double);
+
+//: Read a vector of doubles.
+static void bench_vsl_read_vector_double(testlib_bench_state& state)
+{
+  std::vector<double> v(bench_n);
+  for (unsigned i = 0; i < bench_n; ++i) v[i] = 0.5*i;
+  std::ostringstream os;
+  {
+    vsl_b_ostream bos(&os);
+    vsl_b_write(bos, v);
+  }
+  const std::string data = os.str();
+  state.set_items_per_iteration(bench_n);
+  while (state.run())
+  {
+    std::istringstream is(data);
+    vsl_b_istream bis(&is);
+    vsl_b_read(bis, v);
+    testlib_bench_keep(&v[0]);
+  }
+}
+TESTLIB_BENCH(bench_vsl_read_vector_double);
+
+//: Write and read back a vector of ints, which are stored in a variable length encoding.
+static void bench_vsl_round_trip_vector_int(testlib_bench_state& state)
+{
+  std::vector<int> v(bench_n), w;
+  for (unsigned i = 0; i < bench_n; ++i) v[i] = int(i*i % 100003) - 50000;
+  state.set_items_per_iteration(bench_n);
+  while (state.run())
+  {
+    std::stringstream s;
+    vsl_b_ostream bos(&s);
+    vsl_b_write(bos, v);
+    vsl_b_istream bis(&s);
+    vsl_b_read(bis, w);
+    testlib_bench_keep(&w[0]);
+  }
+}
+TESTLIB_BENCH(bench_vsl_round_trip_vector_int);
+
+TESTLIB_BENCH_MAIN;
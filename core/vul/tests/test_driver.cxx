@@ -13,6 +13,7 @@ DECLARE( test_vul_file );
 DECLARE( test_expand_path );
 DECLARE( test_get_time_as_string );
 DECLARE( test_checksum );
+DECLARE( test_profile );
 
 void
 register_tests()
@@ -30,6 +31,7 @@ register_tests()
   REGISTER( test_expand_path );
   REGISTER( test_get_time_as_string );
   REGISTER( test_checksum );
+  REGISTER( test_profile );
 }
 
 DEFINE_MAIN;
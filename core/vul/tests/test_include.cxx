@@ -10,6 +10,7 @@
 #include <vul/vul_get_timestamp.h>
 #include <vul/vul_ios_state.h>
 #include <vul/vul_printf.h>
+#include <vul/vul_profile.h>
 #include <vul/vul_psfile.h>
 #include <vul/vul_redirector.h>
 #include <vul/vul_reg_exp.h>
@@ -0,0 +1,138 @@
+// This is core/vul/tests/test_profile.cxx
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <vcl_compiler.h>
+#include <vxl_config.h>
+#include <vul/vul_profile.h>
+#include <vpl/vpl.h>
+#include <testlib/testlib_test.h>
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
+
+#if VXL_HAS_PTHREAD_H
+struct profile_test_job
+{
+  unsigned counter, histogram;
+  unsigned n;
+  static void* run_thread(void* job)
+  {
+    profile_test_job* j = static_cast<profile_test_job*>(job);
+    for (unsigned i = 0; i < j->n; ++i)
+    {
+      vul_profile::add_count(j->counter, 2.0);
+      vul_profile::add_sample(j->histogram, double(i));
+    }
+    return VXL_NULLPTR;
+  }
+};
+#endif
+
+static void instrumented(unsigned n)
+{
+  VUL_PROFILE_SCOPE("test_profile instrumented");
+  VUL_PROFILE_COUNT("test_profile calls", 1);
+  VUL_PROFILE_HISTOGRAM("test_profile n", n);
+  VUL_PROFILE_SCOPE_NAMED(std::string("test_profile named"));
+}
+
+void test_profile()
+{
+  std::cout << "**********************\n"
+            << " Testing vul_profile\n"
+            << "**********************\n";
+
+  // Timers
+  const unsigned timer = vul_profile::timer_id("test timer");
+  TEST("Same name, same timer", vul_profile::timer_id("test timer"), timer);
+  TEST("Kinds are named apart", vul_profile::counter_id("test timer") != timer, true);
+  {
+    vul_profile_scope scope(timer);
+    vpl_usleep(20000);
+  }
+  vul_profile::add_time(timer, 0.5);
+  vul_profile_stats s;
+  TEST("Timer found", vul_profile::stats("test timer", vul_profile_stats::TIMER, s), true);
+  TEST("Timer count", s.count, 2);
+  std::cout << "Timed scope: " << s.min << " seconds\n";
+  TEST("Timed scope lasted at least 20ms", s.min >= 0.0199 && s.min < 0.5, true);
+  TEST_NEAR("Timer max", s.max, 0.5, 1e-12);
+  TEST_NEAR("Timer total", s.total, 0.5 + s.min, 1e-12);
+  TEST("Unknown name", vul_profile::stats("no such timer", vul_profile_stats::TIMER, s), false);
+
+  // Counters
+  const unsigned counter = vul_profile::counter_id("test counter");
+  vul_profile::add_count(counter, 3);
+  vul_profile::add_count(counter, 4);
+  vul_profile::stats("test counter", vul_profile_stats::COUNTER, s);
+  TEST("Counter additions", s.count, 2);
+  TEST_NEAR("Counter sum", s.total, 7.0, 0.0);
+
+  // Histograms
+  const unsigned histogram = vul_profile::histogram_id("test histogram");
+  vul_profile::add_sample(histogram, 0.5);
+  vul_profile::add_sample(histogram, 1.0);
+  vul_profile::add_sample(histogram, 3.0);
+  vul_profile::add_sample(histogram, 4.0);
+  vul_profile::add_sample(histogram, 1e300);
+  vul_profile::stats("test histogram", vul_profile_stats::HISTOGRAM, s);
+  TEST("Histogram bins", s.bins.size(), (unsigned)vul_profile::n_bins);
+  TEST("Bins of 0.5, 1, 3 and 4", s.bins[0]==1 && s.bins[1]==1 && s.bins[2]==1 && s.bins[3]==1, true);
+  TEST("Large samples in the last bin", s.bins[vul_profile::n_bins-1], 1);
+  TEST("Histogram range", s.min == 0.5 && s.max == 1e300, true);
+
+  // Macros, which only record when VUL_CONFIG_PROFILE is set
+  for (unsigned i = 0; i < 3; ++i)
+    instrumented(i);
+  bool recorded = vul_profile::stats("test_profile calls", vul_profile_stats::COUNTER, s);
+#if VUL_CONFIG_PROFILE
+  TEST("Macros record", recorded && s.count == 3 &&
+       vul_profile::stats("test_profile named", vul_profile_stats::TIMER, s) && s.count == 3, true);
+#else
+  TEST("Macros compiled out", recorded, false);
+#endif
+
+#if VXL_HAS_PTHREAD_H
+  // Threads add to their own tables, which are combined when read
+  vul_profile::reset();
+  vul_profile::stats("test counter", vul_profile_stats::COUNTER, s);
+  TEST("Reset", s.count, 0);
+  vul_profile::add_count(counter, 1);
+  const unsigned n_threads = 4, n = 1000;
+  std::vector<profile_test_job> jobs(n_threads);
+  std::vector<pthread_t> threads(n_threads);
+  for (unsigned t = 0; t < n_threads; ++t)
+  {
+    jobs[t].counter = counter;
+    jobs[t].histogram = histogram;
+    jobs[t].n = n;
+    pthread_create(&threads[t], VXL_NULLPTR, &profile_test_job::run_thread, &jobs[t]);
+  }
+  for (unsigned t = 0; t < n_threads; ++t)
+    pthread_join(threads[t], VXL_NULLPTR);
+  vul_profile::stats("test counter", vul_profile_stats::COUNTER, s);
+  TEST("Counts of ended threads kept", s.count, 1 + n_threads*n);
+  TEST_NEAR("Sum over threads", s.total, 1.0 + 2.0*n_threads*n, 0.0);
+  vul_profile::stats("test histogram", vul_profile_stats::HISTOGRAM, s);
+  // each thread adds 0..999: one sample in bin 0, 1 in bin 1, 2 in bin 2, ..., 488 in bin 10
+  TEST("Histogram over threads", s.count == n_threads*n && s.bins[0] == n_threads &&
+       s.bins[2] == 2*n_threads && s.bins[10] == 488*n_threads, true);
+#endif
+
+  // Reports
+  std::ostringstream json, csv;
+  vul_profile::write_json(json);
+  vul_profile::write_csv(csv);
+  std::cout << json.str() << csv.str();
+  TEST("JSON report", json.str().find("{ \"name\": \"test counter\", \"kind\": \"counter\"") != std::string::npos &&
+       json.str()[0] == '[', true);
+  TEST("CSV report", csv.str().find("name,kind,count,total,mean,min,max,bins\n") == 0 &&
+       csv.str().find("\ntest histogram,histogram,") != std::string::npos, true);
+  std::vector<vul_profile_stats> all;
+  vul_profile::stats(all);
+  TEST("All quantities listed", all.size() >= 4 && all[0].name == "test timer", true);
+}
+
+TEST_MAIN(test_profile);
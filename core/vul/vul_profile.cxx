@@ -0,0 +1,486 @@
+// This is core/vul/vul_profile.cxx
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include "vul_profile.h"
+//:
+// \file
+// Each thread keeps its statistics in its own table, found through a
+// pthread key, so that adding to them needs no lock.  A table is made of
+// chunks of records, allocated under the registry mutex as new
+// identifiers are used, so that readers holding the mutex see a stable
+// set of chunks.  When a thread ends, its table is added into the table
+// of retired threads and freed.
+
+#include <vcl_compiler.h>
+#if defined(_WIN32)
+# include <windows.h>
+#else
+# include <vcl_sys/time.h>
+#endif
+#if VXL_HAS_PTHREAD_H
+# include <pthread.h>
+#endif
+
+//: Statistics of one quantity in one table.
+struct vul_profile_record
+{
+  vxl_uint_64 count;
+  double total;
+  double min, max;
+  vxl_uint_64 bins[vul_profile::n_bins];
+
+  void clear()
+  {
+    count = 0; total = min = max = 0.0;
+    for (unsigned b = 0; b < vul_profile::n_bins; ++b) bins[b] = 0;
+  }
+
+  void add(double v)
+  {
+    if (count == 0 || v < min) min = v;
+    if (count == 0 || v > max) max = v;
+    ++count;
+    total += v;
+  }
+
+  void add_sample(double v)
+  {
+    add(v);
+    // bin 0 holds v < 1; v in [2^(e-1),2^e) has frexp exponent e
+    int e = 0;
+    if (v >= 1.0) std::frexp(v, &e);
+    if (e >= int(vul_profile::n_bins)) e = vul_profile::n_bins - 1;
+    ++bins[e];
+  }
+
+  void merge(vul_profile_record const& r)
+  {
+    if (r.count == 0) return;
+    if (count == 0 || r.min < min) min = r.min;
+    if (count == 0 || r.max > max) max = r.max;
+    count += r.count;
+    total += r.total;
+    for (unsigned b = 0; b < vul_profile::n_bins; ++b) bins[b] += r.bins[b];
+  }
+};
+
+//: The statistics kept by one thread.
+struct vul_profile_table
+{
+  enum { chunk_size = 64 };
+  std::vector<vul_profile_record*> chunks;
+
+  ~vul_profile_table()
+  {
+    for (unsigned c = 0; c < chunks.size(); ++c) delete [] chunks[c];
+  }
+
+  //: Record of id, or 0 if its chunk is not allocated.
+  vul_profile_record* find(unsigned id) const
+  {
+    unsigned c = id / chunk_size;
+    return c < chunks.size() && chunks[c] ? chunks[c] + id % chunk_size : VXL_NULLPTR;
+  }
+
+  //: Allocate the chunk holding id; the registry mutex must be held.
+  vul_profile_record* make(unsigned id)
+  {
+    unsigned c = id / chunk_size;
+    if (c >= chunks.size()) chunks.resize(c+1, VXL_NULLPTR);
+    if (!chunks[c])
+    {
+      chunks[c] = new vul_profile_record[chunk_size];
+      for (unsigned r = 0; r < chunk_size; ++r) chunks[c][r].clear();
+    }
+    return chunks[c] + id % chunk_size;
+  }
+
+  void merge(vul_profile_table const& t)
+  {
+    for (unsigned c = 0; c < t.chunks.size(); ++c)
+      if (t.chunks[c])
+        for (unsigned r = 0; r < chunk_size; ++r)
+          make(c*chunk_size + r)->merge(t.chunks[c][r]);
+  }
+
+  void clear()
+  {
+    for (unsigned c = 0; c < chunks.size(); ++c)
+      if (chunks[c])
+        for (unsigned r = 0; r < chunk_size; ++r) chunks[c][r].clear();
+  }
+};
+
+//: Names of the quantities, and the tables of all the threads.
+//  Made on first use and never destroyed, so that it outlives any thread.
+struct vul_profile_registry
+{
+  std::vector<std::string> names;
+  std::vector<vul_profile_stats::kind_type> kinds;
+  std::map<std::string, unsigned> ids[3];
+  //: Tables of the running threads.
+  std::vector<vul_profile_table*> tables;
+  //: Statistics of the threads which have ended.
+  vul_profile_table retired;
+#if VXL_HAS_PTHREAD_H
+  pthread_mutex_t mutex;
+  pthread_key_t key;
+#else
+  vul_profile_table only;
+#endif
+
+  vul_profile_registry();
+
+  void lock()
+  {
+#if VXL_HAS_PTHREAD_H
+    pthread_mutex_lock(&mutex);
+#endif
+  }
+
+  void unlock()
+  {
+#if VXL_HAS_PTHREAD_H
+    pthread_mutex_unlock(&mutex);
+#endif
+  }
+
+  //: Table of the calling thread, made if need be.
+  vul_profile_table* local_table();
+
+  //: Record of id in the table of the calling thread.
+  vul_profile_record& local_record(unsigned id)
+  {
+    vul_profile_table* t = local_table();
+    vul_profile_record* r = t->find(id);
+    if (!r)
+    {
+      lock();
+      r = t->make(id);
+      unlock();
+    }
+    return *r;
+  }
+
+  unsigned id(std::string const& name, vul_profile_stats::kind_type kind);
+
+  //: Statistics of id, summed over all the tables; the mutex must be held.
+  void combine(unsigned id, vul_profile_stats& s) const;
+};
+
+static vul_profile_registry* vul_profile_the_registry = VXL_NULLPTR;
+
+//: Write the report named by VUL_PROFILE_OUTPUT.
+static void vul_profile_write_at_exit()
+{
+  char const* file = std::getenv("VUL_PROFILE_OUTPUT");
+  if (file && *file && !vul_profile::write(file))
+    std::cerr << "vul_profile: cannot write " << file << '\n';
+}
+
+#if VXL_HAS_PTHREAD_H
+//: Add the table of an ending thread into the retired table.
+static void vul_profile_thread_end(void* p)
+{
+  vul_profile_table* t = static_cast<vul_profile_table*>(p);
+  vul_profile_registry& reg = *vul_profile_the_registry;
+  reg.lock();
+  reg.retired.merge(*t);
+  for (unsigned i = 0; i < reg.tables.size(); ++i)
+    if (reg.tables[i] == t)
+    {
+      reg.tables[i] = reg.tables.back();
+      reg.tables.pop_back();
+      break;
+    }
+  reg.unlock();
+  delete t;
+}
+
+static pthread_once_t vul_profile_once = PTHREAD_ONCE_INIT;
+#endif
+
+static void vul_profile_make_registry()
+{
+  vul_profile_the_registry = new vul_profile_registry;
+  char const* file = std::getenv("VUL_PROFILE_OUTPUT");
+  if (file && *file)
+    std::atexit(vul_profile_write_at_exit);
+}
+
+static vul_profile_registry& vul_profile_registry_instance()
+{
+#if VXL_HAS_PTHREAD_H
+  pthread_once(&vul_profile_once, vul_profile_make_registry);
+#else
+  if (!vul_profile_the_registry) vul_profile_make_registry();
+#endif
+  return *vul_profile_the_registry;
+}
+
+vul_profile_registry::vul_profile_registry()
+{
+#if VXL_HAS_PTHREAD_H
+  pthread_mutex_init(&mutex, VXL_NULLPTR);
+  pthread_key_create(&key, vul_profile_thread_end);
+#else
+  tables.push_back(&only);
+#endif
+}
+
+vul_profile_table* vul_profile_registry::local_table()
+{
+#if VXL_HAS_PTHREAD_H
+  vul_profile_table* t = static_cast<vul_profile_table*>(pthread_getspecific(key));
+  if (!t)
+  {
+    t = new vul_profile_table;
+    pthread_setspecific(key, t);
+    lock();
+    tables.push_back(t);
+    unlock();
+  }
+  return t;
+#else
+  return &only;
+#endif
+}
+
+unsigned vul_profile_registry::id(std::string const& name, vul_profile_stats::kind_type kind)
+{
+  lock();
+  std::map<std::string, unsigned>::const_iterator i = ids[kind].find(name);
+  unsigned n;
+  if (i != ids[kind].end())
+    n = i->second;
+  else
+  {
+    n = static_cast<unsigned>(names.size());
+    names.push_back(name);
+    kinds.push_back(kind);
+    ids[kind][name] = n;
+  }
+  unlock();
+  return n;
+}
+
+void vul_profile_registry::combine(unsigned id, vul_profile_stats& s) const
+{
+  vul_profile_record r;
+  r.clear();
+  if (vul_profile_record const* p = retired.find(id)) r.merge(*p);
+  for (unsigned t = 0; t < tables.size(); ++t)
+    if (vul_profile_record const* p = tables[t]->find(id)) r.merge(*p);
+  s.name = names[id];
+  s.kind = kinds[id];
+  s.count = r.count;
+  s.total = r.total;
+  if (s.kind == vul_profile_stats::COUNTER)
+    s.min = s.max = 0.0;
+  else
+  {
+    s.min = r.min;
+    s.max = r.max;
+  }
+  if (s.kind == vul_profile_stats::HISTOGRAM)
+    s.bins.assign(r.bins, r.bins + vul_profile::n_bins);
+  else
+    s.bins.clear();
+}
+
+//=============================================================================
+
+unsigned vul_profile::timer_id(std::string const& name)
+{
+  return vul_profile_registry_instance().id(name, vul_profile_stats::TIMER);
+}
+
+unsigned vul_profile::counter_id(std::string const& name)
+{
+  return vul_profile_registry_instance().id(name, vul_profile_stats::COUNTER);
+}
+
+unsigned vul_profile::histogram_id(std::string const& name)
+{
+  return vul_profile_registry_instance().id(name, vul_profile_stats::HISTOGRAM);
+}
+
+void vul_profile::add_time(unsigned id, double seconds)
+{
+  vul_profile_registry_instance().local_record(id).add(seconds);
+}
+
+void vul_profile::add_count(unsigned id, double n)
+{
+  vul_profile_record& r = vul_profile_registry_instance().local_record(id);
+  ++r.count;
+  r.total += n;
+}
+
+void vul_profile::add_sample(unsigned id, double value)
+{
+  vul_profile_registry_instance().local_record(id).add_sample(value);
+}
+
+double vul_profile::now()
+{
+#if defined(_WIN32)
+  LARGE_INTEGER count, frequency;
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&frequency);
+  return double(count.QuadPart) / double(frequency.QuadPart);
+#elif defined(CLOCK_MONOTONIC)
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return double(t.tv_sec) + 1e-9*double(t.tv_nsec);
+#else
+  struct timeval t;
+  gettimeofday(&t, VXL_NULLPTR);
+  return double(t.tv_sec) + 1e-6*double(t.tv_usec);
+#endif
+}
+
+void vul_profile::stats(std::vector<vul_profile_stats>& all)
+{
+  vul_profile_registry& reg = vul_profile_registry_instance();
+  reg.lock();
+  all.resize(reg.names.size());
+  for (unsigned i = 0; i < all.size(); ++i)
+    reg.combine(i, all[i]);
+  reg.unlock();
+}
+
+bool vul_profile::stats(std::string const& name, vul_profile_stats::kind_type kind,
+                        vul_profile_stats& s)
+{
+  vul_profile_registry& reg = vul_profile_registry_instance();
+  reg.lock();
+  std::map<std::string, unsigned>::const_iterator i = reg.ids[kind].find(name);
+  bool found = i != reg.ids[kind].end();
+  if (found)
+    reg.combine(i->second, s);
+  reg.unlock();
+  return found;
+}
+
+void vul_profile::reset()
+{
+  vul_profile_registry& reg = vul_profile_registry_instance();
+  reg.lock();
+  reg.retired.clear();
+  for (unsigned t = 0; t < reg.tables.size(); ++t)
+    reg.tables[t]->clear();
+  reg.unlock();
+}
+
+static char const* vul_profile_kind_name(vul_profile_stats::kind_type kind)
+{
+  switch (kind)
+  {
+    case vul_profile_stats::TIMER: return "timer";
+    case vul_profile_stats::COUNTER: return "counter";
+    default: return "histogram";
+  }
+}
+
+//: Write s as a JSON string.
+static void vul_profile_json_string(std::ostream& os, std::string const& s)
+{
+  os << '"';
+  for (unsigned i = 0; i < s.size(); ++i)
+  {
+    unsigned char c = static_cast<unsigned char>(s[i]);
+    if (c == '"' || c == '\\')
+      os << '\\' << s[i];
+    else if (c < 0x20)
+      os << "\\u00" << "0123456789abcdef"[c >> 4] << "0123456789abcdef"[c & 15];
+    else
+      os << s[i];
+  }
+  os << '"';
+}
+
+//: Write s as a CSV field, quoted if need be.
+static void vul_profile_csv_string(std::ostream& os, std::string const& s)
+{
+  if (s.find_first_of(",\"\n\r") == std::string::npos)
+  {
+    os << s;
+    return;
+  }
+  os << '"';
+  for (unsigned i = 0; i < s.size(); ++i)
+  {
+    if (s[i] == '"') os << '"';
+    os << s[i];
+  }
+  os << '"';
+}
+
+void vul_profile::write_json(std::ostream& os)
+{
+  std::vector<vul_profile_stats> all;
+  stats(all);
+  std::streamsize precision = os.precision(9);
+  os << "[\n";
+  for (unsigned i = 0; i < all.size(); ++i)
+  {
+    vul_profile_stats const& s = all[i];
+    os << "  { \"name\": ";
+    vul_profile_json_string(os, s.name);
+    os << ", \"kind\": \"" << vul_profile_kind_name(s.kind) << '"'
+       << ", \"count\": " << s.count
+       << ", \"total\": " << s.total
+       << ", \"mean\": " << s.mean();
+    if (s.kind != vul_profile_stats::COUNTER)
+      os << ", \"min\": " << s.min << ", \"max\": " << s.max;
+    if (s.kind == vul_profile_stats::HISTOGRAM)
+    {
+      os << ", \"bins\": [";
+      for (unsigned b = 0; b < s.bins.size(); ++b)
+        os << (b ? ", " : "") << s.bins[b];
+      os << ']';
+    }
+    os << " }" << (i+1 < all.size() ? ",\n" : "\n");
+  }
+  os << "]\n";
+  os.precision(precision);
+}
+
+void vul_profile::write_csv(std::ostream& os)
+{
+  std::vector<vul_profile_stats> all;
+  stats(all);
+  std::streamsize precision = os.precision(9);
+  os << "name,kind,count,total,mean,min,max,bins\n";
+  for (unsigned i = 0; i < all.size(); ++i)
+  {
+    vul_profile_stats const& s = all[i];
+    vul_profile_csv_string(os, s.name);
+    os << ',' << vul_profile_kind_name(s.kind)
+       << ',' << s.count << ',' << s.total << ',' << s.mean()
+       << ',' << s.min << ',' << s.max << ',';
+    for (unsigned b = 0; b < s.bins.size(); ++b)
+      os << (b ? " " : "") << s.bins[b];
+    os << '\n';
+  }
+  os.precision(precision);
+}
+
+bool vul_profile::write(std::string const& filename)
+{
+  std::ofstream os(filename.c_str());
+  if (!os)
+    return false;
+  const std::string::size_type n = filename.size();
+  if (n >= 4 && filename.substr(n-4) == ".csv")
+    write_csv(os);
+  else
+    write_json(os);
+  return bool(os);
+}
@@ -0,0 +1,173 @@
+// This is core/vul/vul_profile.h
+#ifndef vul_profile_h_
+#define vul_profile_h_
+//:
+// \file
+// \brief Scoped timers, counters and histograms for profiling hot paths
+//
+// vul_timer measures milliseconds between explicit marks.  vul_profile
+// collects, by name, statistics of
+//  - timers: the number of times, and the total, least and greatest
+//    wall-clock seconds, that a scope was executed;
+//  - counters: the number of additions to, and the sum of, a count;
+//  - histograms: the number, sum, range and a base-2 logarithmic
+//    histogram of sampled values.
+//
+// Code is instrumented with the macros:
+// \code
+//   void decode_tile(...)
+//   {
+//     VUL_PROFILE_SCOPE("decode_tile");
+//     VUL_PROFILE_COUNT("decode_tile bytes", n_bytes);
+//     VUL_PROFILE_HISTOGRAM("decode_tile width", ni);
+//     ...
+//   }
+// \endcode
+// which compile to nothing unless VXL is configured with the CMake option
+// VUL_CONFIG_PROFILE; the vul_profile class itself is always available.
+// The name given to each macro must be a string which lives for the
+// whole run, normally a literal; VUL_PROFILE_SCOPE_NAMED takes a
+// std::string expression, such as the name of a process, and looks it up
+// on every use.
+//
+// Each thread adds to its own table of statistics, so updates take no
+// locks; the tables of all the threads, including threads which have
+// finished, are combined when the statistics are read.  Read them when
+// the threads being profiled are idle to be sure of exact totals.
+//
+// write_json() and write_csv() report all the statistics.  If the
+// environment variable VUL_PROFILE_OUTPUT names a file when the program
+// exits, the report is written to it, as CSV if the name ends in .csv and
+// as JSON otherwise.
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <vxl_config.h>
+#include <vcl_compiler.h>
+#include <vul/vul_config.h>
+
+//: Combined statistics of one profiled quantity.
+struct vul_profile_stats
+{
+  //: The kinds of profiled quantity.
+  enum kind_type { TIMER, COUNTER, HISTOGRAM };
+
+  std::string name;
+  kind_type kind;
+  //: Number of timings, additions or samples.
+  vxl_uint_64 count;
+  //: Total seconds, count or sum of samples.
+  double total;
+  //: Least and greatest timing or sample; 0 for counters.
+  double min, max;
+  //: For histograms, the number of samples in each bin.
+  //  Bin 0 holds samples below 1, and bin k (k>0) those in [2^(k-1), 2^k);
+  //  the last bin also holds all larger samples.
+  std::vector<vxl_uint_64> bins;
+
+  //: Mean timing, addition or sample.
+  double mean() const { return count ? total/double(count) : 0.0; }
+};
+
+//: Registry and report of profiling statistics; all methods are static.
+class vul_profile
+{
+ public:
+  //: Number of bins in each histogram.
+  enum { n_bins = 32 };
+
+  //: Identifier of the timer with this name, registering it if new.
+  static unsigned timer_id(std::string const& name);
+
+  //: Identifier of the counter with this name, registering it if new.
+  static unsigned counter_id(std::string const& name);
+
+  //: Identifier of the histogram with this name, registering it if new.
+  static unsigned histogram_id(std::string const& name);
+
+  //: Add a timing, in seconds, to a timer.
+  static void add_time(unsigned id, double seconds);
+
+  //: Add n to a counter.
+  static void add_count(unsigned id, double n);
+
+  //: Add a sample to a histogram.
+  static void add_sample(unsigned id, double value);
+
+  //: Wall-clock time in seconds, with the best resolution available.
+  //  The origin is arbitrary, so only differences are meaningful.
+  static double now();
+
+  //: Get the statistics of all the registered quantities, in order of registration.
+  static void stats(std::vector<vul_profile_stats>& all);
+
+  //: Get the statistics of the quantity with this name and kind.
+  //  Returns false if there is none.
+  static bool stats(std::string const& name, vul_profile_stats::kind_type kind,
+                    vul_profile_stats& s);
+
+  //: Set all the statistics to zero, keeping the registered names.
+  static void reset();
+
+  //: Write all the statistics as a JSON array of objects.
+  static void write_json(std::ostream& os);
+
+  //: Write all the statistics as CSV, with a header line.
+  //  Histogram bins are written as one field, separated by spaces.
+  static void write_csv(std::ostream& os);
+
+  //: Write all the statistics to a file, as CSV if its name ends in .csv, else JSON.
+  static bool write(std::string const& filename);
+};
+
+//: Adds the time between its construction and destruction to a timer.
+class vul_profile_scope
+{
+ public:
+  explicit vul_profile_scope(unsigned id) : id_(id), start_(vul_profile::now()) {}
+  ~vul_profile_scope() { vul_profile::add_time(id_, vul_profile::now() - start_); }
+
+ private:
+  unsigned id_;
+  double start_;
+
+  // not copyable
+  vul_profile_scope(vul_profile_scope const&);
+  vul_profile_scope& operator=(vul_profile_scope const&);
+};
+
+#if VUL_CONFIG_PROFILE
+
+#define vul_profile_cat2(a, b) a##b
+#define vul_profile_cat(a, b) vul_profile_cat2(a, b)
+
+//: Time the rest of the enclosing scope, with a timer named by a string literal.
+#define VUL_PROFILE_SCOPE(name) \
+  static const unsigned vul_profile_cat(vul_profile_id_, __LINE__) = vul_profile::timer_id(name); \
+  vul_profile_scope vul_profile_cat(vul_profile_scope_, __LINE__)(vul_profile_cat(vul_profile_id_, __LINE__))
+
+//: Time the rest of the enclosing scope, with a timer named by a std::string expression.
+#define VUL_PROFILE_SCOPE_NAMED(name) \
+  vul_profile_scope vul_profile_cat(vul_profile_scope_, __LINE__)(vul_profile::timer_id(name))
+
+//: Add n to the counter named by a string literal.
+#define VUL_PROFILE_COUNT(name, n) \
+  do { static const unsigned vul_profile_id = vul_profile::counter_id(name); \
+       vul_profile::add_count(vul_profile_id, double(n)); } while (false)
+
+//: Add a sample to the histogram named by a string literal.
+#define VUL_PROFILE_HISTOGRAM(name, value) \
+  do { static const unsigned vul_profile_id = vul_profile::histogram_id(name); \
+       vul_profile::add_sample(vul_profile_id, double(value)); } while (false)
+
+#else
+
+#define VUL_PROFILE_SCOPE(name) do {} while (false)
+#define VUL_PROFILE_SCOPE_NAMED(name) do {} while (false)
+#define VUL_PROFILE_COUNT(name, n) do {} while (false)
+#define VUL_PROFILE_HISTOGRAM(name, value) do {} while (false)
+
+#endif // VUL_CONFIG_PROFILE
+
+#endif // vul_profile_h_